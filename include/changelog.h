@@ -0,0 +1,138 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que guarda, no servidor, as ultimas escritas aplicadas a
+ * tabela, para as enviar por ordem a consumidores externos.
+ *
+ * Cada escrita e identificada pela versao atribuida pela cabeca e
+ * propagada pela cadeia, por isso todos os servidores da cadeia
+ * guardam as mesmas escritas com as mesmas sequencias, pela mesma
+ * ordem, e um consumidor pode continuar noutro servidor a partir da
+ * ultima sequencia que recebeu. As sequencias sao crescentes mas nao
+ * consecutivas.
+ *
+ * O registo e limitado em numero de escritas e em memoria: as mais
+ * antigas sao descartadas, e um consumidor que pede escritas ja
+ * descartadas e avisado para voltar a ler a tabela. A estrutura e
+ * thread-safe.
+*/
+
+#ifndef _CHANGELOG_H
+#define _CHANGELOG_H
+
+#include "data.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define CHANGELOG_RECORDS 65536                 /* escritas guardadas por omissao */
+#define CHANGELOG_BYTES (32L * 1024 * 1024)     /* memoria das escritas guardadas por omissao */
+#define CHANGELOG_BATCH 64                      /* maximo de escritas por mensagem */
+#define CHANGELOG_BATCH_BYTES 32768             /* chaves e valores por mensagem, abaixo do limite de 64 KiB */
+#define CHANGELOG_IDLE_MS 1000                  /* periodo da verificacao da ligacao sem escritas */
+
+/**
+ * Escrita aplicada a tabela.
+*/
+struct changelog_record_t {
+    uint64_t sequence;              /* versao atribuida pela cabeca */
+    char *key;
+    struct data_t *value;           /* NULL se a chave foi removida */
+    unsigned long expire_at;        /* 0 = sem expiracao */
+};
+
+struct changelog_t {
+    pthread_mutex_t lock;
+    pthread_cond_t appended;
+    struct changelog_record_t *records;     /* fila circular, por ordem das sequencias */
+    int capacity;
+    int first;                      /* posicao da escrita mais antiga */
+    int n_records;
+    long bytes;                     /* memoria ocupada pelas chaves e valores */
+    long max_bytes;
+    uint64_t discarded;             /* maior sequencia que ja nao esta no registo */
+    uint64_t last;                  /* sequencia da ultima escrita guardada */
+    int closed;                     /* 1 quando o servidor termina */
+};
+
+/**
+ * Cria o registo vazio.
+ * \param max_records
+ *      Numero maximo de escritas guardadas, maior que 0.
+ * \param max_bytes
+ *      Memoria maxima das chaves e valores guardados, maior que 0.
+ * \return
+ *      Apontador ao registo ou NULL em caso de erro.
+*/
+struct changelog_t *changelog_create(int max_records, long max_bytes);
+
+/**
+ * Termina o envio das escritas aos consumidores. O registo nao e
+ * libertado, porque as threads das ligacoes ainda o usam ate
+ * acordarem.
+*/
+void changelog_destroy(struct changelog_t *log);
+
+/**
+ * Guarda uma escrita aplicada, descartando as mais antigas se o
+ * registo estiver cheio. Deve ser chamada dentro da seccao critica
+ * de escrita da tabela, para as escritas ficarem pela ordem em que
+ * foram aplicadas. Uma sequencia que nao e maior que a ultima
+ * guardada ja esta no registo e e ignorada.
+ * \param sequence
+ *      Versao da escrita.
+ * \param key
+ *      Chave escrita.
+ * \param value
+ *      Novo valor, copiado, ou NULL se a chave foi removida.
+ * \param expire_at
+ *      Instante de expiracao em ms (0 = sem expiracao).
+ * \return
+ *      0 (OK) ou -1 em caso de erro, caso em que os consumidores que
+ *      ainda nao receberam a escrita sao avisados de que a perderam.
+*/
+int changelog_append(struct changelog_t *log, uint64_t sequence, const char *key,
+                     struct data_t *value, unsigned long expire_at);
+
+/**
+ * Marca as escritas ate a sequencia como indisponiveis, quando a
+ * tabela as recebeu por outro meio (a copia inicial da tabela do
+ * servidor anterior).
+*/
+void changelog_truncate(struct changelog_t *log, uint64_t sequence);
+
+/**
+ * Envia pela ligacao as escritas com sequencia maior que after, por
+ * ordem, e as seguintes a medida que sao guardadas, ate a ligacao
+ * fechar ou o servidor terminar. Se as escritas seguintes a after ja
+ * foram descartadas, envia o aviso e termina. Deve ser chamada pela
+ * thread da ligacao.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+int changelog_serve(struct changelog_t *log, int sockfd, uint64_t after);
+
+/**
+ * Copia por ordem as escritas com sequencia maior que after, ate
+ * max_records e CHANGELOG_BATCH_BYTES.
+ * \param records
+ *      Onde ficam as copias, libertadas com changelog_free_records().
+ * \return
+ *      Numero de escritas copiadas, 0 se nao ha mais, ou -1 se as
+ *      seguintes a after ja foram descartadas ou em caso de erro.
+*/
+int changelog_copy(struct changelog_t *log, uint64_t after,
+                   struct changelog_record_t *records, int max_records);
+
+/**
+ * Liberta as copias obtidas com changelog_copy().
+*/
+void changelog_free_records(struct changelog_record_t *records, int n_records);
+
+#endif
@@ -13,11 +13,15 @@
 
 #define SUGG_GET "\033[2met <key>\033[0m"
 #define SUGG_PUT "\033[2mut <key> <value>\033[0m"
+#define SUGG_PUTEX "\033[2mx <key> <ttl> <value>\033[0m"
 #define SUGG_DEL "\033[2mel <key>\033[0m"
 #define SUGG_SIZE "\033[2mize\033[0m"
 #define SUGG_STATS "\033[2mats\033[0m"
-#define SUGG_GKEYS "\033[2meys\033[0m"
-#define SUGG_GTABLE "\033[2mable\033[0m"
+#define SUGG_GKEYS "\033[2meys [<filter>]\033[0m"
+#define SUGG_GTABLE "\033[2mable [<filter>]\033[0m"
+#define SUGG_SCAN "\033[2man <start> <end> [<limit>]\033[0m"
+#define SUGG_MGET "\033[2met <key> [<key> ...]\033[0m"
+#define SUGG_MDEL "\033[2mel <key> [<key> ...]\033[0m"
 #define SUGG_HELP "\033[2melp\033[0m"
 #define SUGG_QUIT "\033[2muit\033[0m"
 
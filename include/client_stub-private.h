@@ -10,11 +10,256 @@
 #define _CLIENT_STUB_PRIVATE_H
 
 #include "client_stub.h"
+#include "sdmessage.pb-c.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * Recebe as chaves de um OP_INVALIDATE enviado pelo servidor. keys
+ * e NULL e n_keys e -1 quando o servidor perdeu avisos e todas as
+ * chaves devem ser esquecidas, ou n_keys e 0 quando a ligacao das
+ * invalidacoes falha. Corre na thread do ciclo de eventos.
+*/
+typedef void (*rtable_invalidate_t)(char **keys, int n_keys, void *arg);
+
+/**
+ * Memoria onde as respostas sao de-serializadas sem reservar memoria
+ * por campo. E reutilizada de resposta em resposta e cresce quando
+ * uma resposta nao coube.
+*/
+struct rtable_arena_t {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t missing;         /* pedida alem de size, reservada a parte */
+};
+
+/**
+ * Ligacao ao servidor, usada por uma thread de cada vez.
+*/
+struct rtable_conn_t {
+    int sockfd;
+    int pending;            /* respostas por ler dos pedidos enviados sem esperar */
+    uint8_t *out;           /* pedido serializado, reutilizado pelos envios */
+    size_t out_size;
+    uint8_t *in;            /* resposta lida, reutilizado pelas rececoes */
+    size_t in_size;
+    struct rtable_arena_t arena;
+    struct rtable_conn_t *next;     /* seguinte na lista das livres */
+};
+
+/**
+ * Pedido assincrono a espera da resposta.
+*/
+struct rtable_request_t {
+    void (*done)(MessageT *resp, void *arg);    /* recebe a resposta, NULL se falhou */
+    void *arg;
+    struct rtable_request_t *next;
+};
+
+/**
+ * Ligacao dos pedidos assincronos e o seu ciclo de eventos, uma
+ * thread que le as respostas pela ordem dos pedidos.
+*/
+struct rtable_loop_t {
+    struct rtable_conn_t conn;
+    pthread_t thread;
+    pthread_mutex_t lock;           /* protege a fila */
+    pthread_mutex_t send_lock;      /* ordena os envios, nunca pedido com lock */
+    struct rtable_request_t *head;  /* pedidos enviados, por ordem */
+    struct rtable_request_t *tail;
+    int closed;                     /* 1 depois de a ligacao falhar */
+    int finished;                   /* 1 depois de terminar os pedidos */
+    void (*push)(MessageT *msg, void *arg);     /* recebe as mensagens sem pedido, NULL se nao ha */
+    void *push_arg;
+};
+
+/**
+ * Pedido assincrono do ponto de vista do cliente, completado pelo
+ * ciclo de eventos.
+*/
+struct rtable_future_t {
+    pthread_mutex_t lock;
+    pthread_cond_t completed;
+    int done;                       /* 1 depois da resposta e da callback */
+    MessageT__Opcode opcode;        /* operacao pedida */
+    int result;                     /* 0 (OK) ou -1 */
+    struct data_t *data;            /* valor lido por um get */
+    unsigned long version;
+    rtable_callback_t callback;
+    void *arg;
+};
 
 struct rtable_t {
     char *server_address;
     int server_port;
-    int sockfd;
+    char *unix_path;        /* socket local do servidor, NULL se esta noutra maquina */
+
+    // Conjunto de ligacoes ao servidor, partilhado pelas threads
+    struct rtable_conn_t *idle;     /* ligacoes livres */
+    int n_idle;
+    int n_open;             /* ligacoes abertas, livres ou em uso */
+    int pool_size;          /* maximo de ligacoes abertas */
+    long checkouts;         /* pedidos que obtiveram uma ligacao */
+    long waits;             /* pedidos que esperaram por uma ligacao livre */
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_released;
+
+    unsigned int replicas;  /* durabilidade colocada nas escritas, 0 = toda a cadeia */
+    int async;              /* 1 se os pedidos sao enviados sem esperar pela resposta */
+
+    struct rtable_loop_t *loop;     /* pedidos assincronos, aberta no primeiro */
+    pthread_mutex_t loop_lock;
+    void (*push)(MessageT *msg, void *arg);     /* passada ao ciclo de eventos quando e criado */
+    void *push_arg;
+    rtable_invalidate_t invalidate; /* recebe os OP_INVALIDATE de rtable_track() */
+    void *invalidate_arg;
 };
 
+/**
+ * Subscricao das alteracoes de chaves, com a sua ligacao.
+*/
+struct rtable_watch_t {
+    struct rtable_t *rtable;        /* ligacao reservada aos eventos */
+    rtable_watch_callback_t callback;
+    void *arg;
+};
+
+/**
+ * Rececao das escritas aplicadas por um servidor, com a sua ligacao.
+*/
+struct rtable_changes_t {
+    struct rtable_t *rtable;        /* ligacao reservada as escritas */
+    rtable_changes_callback_t callback;
+    void *arg;
+};
+
+struct rtable_batch_t {
+    EntryT **ops;       /* operacoes pela ordem, deleted marca as remocoes */
+    int n_ops;
+    int capacity;
+};
+
+/**
+ * Adiciona um elemento na tabela com o instante de expiracao e a
+ * versao ja fixados, usado para propagar a entrada pela cadeia.
+ * \param rtable
+ *      Tabela remota.
+ * \param entry
+ *      Entrada para ser colocada.
+ * \param expire_at
+ *      Instante de expiracao em ms (0 = sem expiracao).
+ * \param version
+ *      Versao atribuida pela cabeca.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rtable_put_expire(struct rtable_t *rtable, struct entry_t *entry, unsigned long expire_at,
+                      uint64_t version);
+
+/**
+ * Adiciona varias entradas na tabela num so pedido, com os
+ * instantes de expiracao e as versoes ja fixados, usado para
+ * propagar um OP_MPUT pela cadeia.
+ * \param rtable
+ *      Tabela remota.
+ * \param entries
+ *      Array de entradas terminada por NULL.
+ * \param expire_at
+ *      Instante de expiracao em ms de cada entrada (0 = sem expiracao).
+ * \param version
+ *      Versao de cada entrada, atribuida pela cabeca.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rtable_mput_expire(struct rtable_t *rtable, struct entry_t **entries, unsigned long *expire_at,
+                       uint64_t *version);
+
+/**
+ * Remove um elemento da tabela com a versao da remocao ja fixada,
+ * usado para propagar a remocao pela cadeia.
+ * \param rtable
+ *      Tabela remota.
+ * \param key
+ *      Chave da entrada para ser removida.
+ * \param version
+ *      Versao atribuida pela cabeca.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rtable_del_version(struct rtable_t *rtable, char *key, uint64_t version);
+
+/**
+ * Remove varios elementos da tabela num so pedido, com as versoes
+ * das remocoes ja fixadas, usado para propagar um OP_MDEL pela cadeia.
+ * \param rtable
+ *      Tabela remota.
+ * \param keys
+ *      Array de chaves terminada por NULL.
+ * \param version
+ *      Versao da remocao da primeira chave, atribuida pela cabeca. As
+ *      seguintes tem as versoes seguintes.
+ * \return
+ *      Numero de chaves removidas ou -1 em caso de erro.
+*/
+int rtable_mdel_version(struct rtable_t *rtable, char **keys, uint64_t version);
+
+/**
+ * Envia para a cabeca de outra cadeia as entradas que o anel lhe
+ * passou a atribuir. A cabeca so coloca as entradas cujas chaves 
+ * nao existem, atribuindo-lhes novas versoes.
+ * \param rtable
+ *      Cabeca da cadeia dona das chaves.
+ * \param entries
+ *      Array de entradas terminada por NULL.
+ * \param expire_at
+ *      Instante de expiracao em ms de cada entrada (0 = sem expiracao).
+ * \return
+ *      Numero de entradas colocadas ou -1 em caso de erro.
+*/
+int rtable_migrate(struct rtable_t *rtable, struct entry_t **entries, unsigned long *expire_at);
+
+/**
+ * Envia ao servidor seguinte a sequencia atual da cabeca, para as
+ * replicas saberem ha quanto tempo estao atualizadas.
+ * \param rtable
+ *      Servidor seguinte da cadeia.
+ * \param version
+ *      Ultima versao atribuida pela cabeca.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rtable_heartbeat(struct rtable_t *rtable, uint64_t version);
+
+/**
+ * Passa a receber nesta ligacao as invalidacoes das chaves lidas
+ * com rtable_get_track() e o mesmo id. A ligacao fica reservada as
+ * invalidacoes, que sao entregues a invalidate no ciclo de eventos.
+ * invalidate nao pode fechar a ligacao nem fazer pedidos nela.
+ * \param rtable
+ *      Tabela remota, sem outros pedidos.
+ * \param id
+ *      Identificador do cliente, diferente de 0.
+ * \param invalidate
+ *      Funcao que recebe as chaves que mudaram.
+ * \param arg
+ *      Argumento passado a invalidate.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rtable_track(struct rtable_t *rtable, uint64_t id, rtable_invalidate_t invalidate, void *arg);
+
+/**
+ * Igual a rtable_get_version(), pedindo ao servidor que avise o
+ * cliente id quando a chave mudar.
+ * \param tracked
+ *      Fica a 1 se o servidor segue a chave e o valor pode ser
+ *      guardado, a 0 caso contrario.
+ * \return
+ *      O valor ou NULL se a chave nao existe ou em caso de erro.
+*/
+struct data_t *rtable_get_track(struct rtable_t *rtable, char *key, uint64_t id,
+                                unsigned long *version, int *tracked);
+
 #endif
\ No newline at end of file
@@ -10,8 +10,53 @@
  */
 struct rtable_t;
 
+/* Lote de escritas aplicado de forma atómica por rtable_batch_commit().
+ */
+struct rtable_batch_t;
+
+/* Cursor de uma iteração paginada pelas keys da tabela. Começa a zero
+ * e é avançado por cada página, a iteração termina quando volta a zero.
+ * Só é válido no servidor que o devolveu. O campo chain só é usado
+ * pela tabela replicada particionada, para indicar a cadeia atual.
+ */
+struct rtable_cursor_t {
+    unsigned int bucket;
+    unsigned long position;
+    unsigned int chain;
+};
+
+/* Consistência pedida por uma leitura de uma key. Uma leitura forte
+ * devolve sempre a versão confirmada pela cauda. Uma leitura com
+ * atraso limitado pode ser servida por qualquer réplica que tenha
+ * recebido notícias da cabeça há no máximo max_lag milissegundos,
+ * e uma leitura RTABLE_READ_ANY por qualquer réplica.
+ */
+enum rtable_consistency {
+    RTABLE_READ_STRONG,
+    RTABLE_READ_BOUNDED,
+    RTABLE_READ_ANY
+};
+
+/* Função chamada por rtable_iterate() para cada entrada. A entrada é
+ * libertada depois da chamada. Um valor diferente de 0 para a iteração.
+ */
+typedef int (*rtable_iter_t)(struct entry_t *entry, void *arg);
+
+/* Estado do conjunto de ligações de uma tabela remota.
+ */
+struct rtable_pool_stats_t {
+    int size;           /* máximo de ligações abertas */
+    int open;           /* ligações abertas */
+    int idle;           /* ligações livres */
+    long checkouts;     /* pedidos que obtiveram uma ligação */
+    long waits;         /* pedidos que esperaram por uma ligação livre */
+};
+
 /* Função para estabelecer uma associação entre o cliente e o servidor, 
- * em que address_port é uma string no formato <hostname>:<port>.
+ * em que address_port é uma string no formato <hostname>:<port>, ou
+ * <hostname>:<port>;<path> quando o servidor anuncia um socket local.
+ * Se o servidor estiver nesta máquina, as ligações usam o socket
+ * local, e o TCP se o socket local falhar.
  * Retorna a estrutura rtable preenchida, ou NULL em caso de erro.
  */
 struct rtable_t *rtable_connect(char *address_port);
@@ -22,23 +67,168 @@ struct rtable_t *rtable_connect(char *address_port);
  */
 int rtable_disconnect(struct rtable_t *rtable);
 
+/* Define quantos servidores da cadeia aplicam cada escrita seguinte
+ * antes de o servidor responder: 1 responde depois da cabeça, N
+ * depois de N servidores, e 0 (por omissão) depois de toda a cadeia.
+ * Os restantes servidores recebem a escrita de forma assíncrona.
+ * Retorna 0 (OK) ou -1 (erro).
+ */
+int rtable_set_durability(struct rtable_t *rtable, unsigned int replicas);
+
+/* A tabela remota pode ser usada por várias threads ao mesmo tempo:
+ * cada pedido obtém uma ligação livre, abre uma nova se há menos de
+ * size abertas, ou espera que outro pedido devolva a sua. Por omissão
+ * size é 1 e os pedidos são enviados um de cada vez.
+ * Retorna 0 (OK) ou -1 (erro).
+ */
+int rtable_set_pool_size(struct rtable_t *rtable, int size);
+
+/* Preenche stats com o estado do conjunto de ligações.
+ * Retorna 0 (OK) ou -1 (erro).
+ */
+int rtable_pool_stats(struct rtable_t *rtable, struct rtable_pool_stats_t *stats);
+
 /* Função para adicionar um elemento na tabela.
  * Se a key já existe, vai substituir essa entrada pelos novos dados.
  * Retorna 0 (OK, em adição/substituição), ou -1 (erro).
  */
 int rtable_put(struct rtable_t *rtable, struct entry_t *entry);
 
+/* Função para adicionar um elemento na tabela com tempo de vida.
+ * A entrada expira ttl milissegundos depois de ser colocada no
+ * servidor, ttl igual a 0 significa sem expiração.
+ * Retorna 0 (OK, em adição/substituição), ou -1 (erro).
+ */
+int rtable_put_ttl(struct rtable_t *rtable, struct entry_t *entry, unsigned long ttl);
+
 /* Retorna o elemento da tabela com chave key, ou NULL caso não exista
  * ou se ocorrer algum erro.
  */
 struct data_t *rtable_get(struct rtable_t *rtable, char *key);
 
+/* Igual a rtable_get(), mas guarda também em version a versão da
+ * entrada, que a cabeça da cadeia incrementa em cada escrita.
+ */
+struct data_t *rtable_get_version(struct rtable_t *rtable, char *key, unsigned long *version);
+
+/* Igual a rtable_get_version(), com a consistência dada. Se a réplica
+ * estiver mais atrasada do que max_lag, retorna NULL e coloca stale
+ * a 1, para o pedido ser repetido noutra réplica. stale pode ser NULL.
+ */
+struct data_t *rtable_get_consistency(struct rtable_t *rtable, char *key,
+                                      enum rtable_consistency consistency,
+                                      unsigned long max_lag, unsigned long *version,
+                                      int *stale);
+
+/* Igual a rtable_get_version(), mas copia o valor para buf, com size
+ * bytes, sem reservar memória: os buffers da ligação são reutilizados,
+ * por isso um ciclo de leituras não faz nenhum malloc. A leitura é
+ * forte, como a de rtable_get(): uma réplica que não é a cauda só
+ * responde com a versão confirmada pela cauda. Se o valor não
+ * couber em buf, nada é copiado e o tamanho retornado indica o buffer
+ * necessário. version pode ser NULL.
+ * Retorna o tamanho do valor, ou -1 caso não exista ou se ocorrer algum
+ * erro.
+ */
+int rtable_get_into(struct rtable_t *rtable, char *key, void *buf, int size,
+                    unsigned long *version);
+
+/* Função para adicionar um elemento na tabela apenas se a versão
+ * guardada da key for expected, ou se a key não existir quando
+ * expected é 0. Guarda em version a nova versão, se escreveu, ou a
+ * versão guardada, se não escreveu (0 se a key não existe).
+ * Retorna 1 se escreveu, 0 se a versão era diferente, ou -1 (erro).
+ */
+int rtable_put_if_version(struct rtable_t *rtable, struct entry_t *entry,
+                          unsigned long expected, unsigned long *version);
+
+/* Função para remover um elemento da tabela apenas se a versão
+ * guardada da key for expected (maior que 0). Guarda em version a
+ * versão guardada (0 se a key não existe).
+ * Retorna 1 se removeu, 0 se a versão era diferente, ou -1 (erro).
+ */
+int rtable_del_if_version(struct rtable_t *rtable, char *key, unsigned long expected,
+                          unsigned long *version);
+
 /* Função para remover um elemento da tabela. Vai libertar 
  * toda a memoria alocada na respetiva operação rtable_put().
  * Retorna 0 (OK), ou -1 (chave não encontrada ou erro).
  */
 int rtable_del(struct rtable_t *rtable, char *key);
 
+/* Retorna, num só pedido, um array de entry_t* com as entradas das
+ * n_keys chaves que existem, pela ordem pedida, colocando um último
+ * elemento do array a NULL. As chaves que não existem não têm entrada.
+ * Liberta-se com rtable_free_entries(). Retorna NULL em caso de erro.
+ */
+struct entry_t **rtable_mget(struct rtable_t *rtable, char **keys, int n_keys);
+
+/* Função para adicionar, num só pedido, as entradas do array entries,
+ * terminado por NULL, todas com o tempo de vida ttl em milissegundos
+ * (0 = sem expiração). O servidor escreve-as de uma vez e propaga-as
+ * pela cadeia num só pedido.
+ * Retorna 0 (OK), ou -1 (erro).
+ */
+int rtable_mput(struct rtable_t *rtable, struct entry_t **entries, unsigned long ttl);
+
+/* Função para remover, num só pedido, as chaves do array keys,
+ * terminado por NULL.
+ * Retorna o número de chaves removidas, ou -1 (erro).
+ */
+int rtable_mdel(struct rtable_t *rtable, char **keys);
+
+/* Função que soma atomicamente delta ao inteiro, em decimal, guardado
+ * na key, que vale 0 se não existir, e guarda o resultado em value.
+ * Retorna 0 (OK), ou -1 (erro, também se o valor não for um inteiro
+ * ou a soma ultrapassar os 64 bits).
+ */
+int rtable_incr(struct rtable_t *rtable, char *key, long delta, long *value);
+
+/* Igual a rtable_incr(), mas subtrai delta.
+ */
+int rtable_decr(struct rtable_t *rtable, char *key, long delta, long *value);
+
+/* Função que acrescenta atomicamente os dados da entry ao fim do valor
+ * guardado na sua key, que é criada se não existir.
+ * Retorna o novo tamanho do valor, ou -1 (erro).
+ */
+int rtable_append(struct rtable_t *rtable, struct entry_t *entry);
+
+/* Função que substitui atomicamente o valor da key da entry pelos seus
+ * dados, apenas se o valor guardado for igual a expected.
+ * Retorna 1 se o valor foi substituído, 0 se era diferente ou a key
+ * não existe, ou -1 (erro).
+ */
+int rtable_cas(struct rtable_t *rtable, struct entry_t *entry, struct data_t *expected);
+
+/* Cria um lote de escritas vazio.
+ * Retorna o lote ou NULL em caso de erro.
+ */
+struct rtable_batch_t *rtable_batch_create();
+
+/* Acrescenta ao lote a colocação de uma cópia da entry, com o tempo de
+ * vida ttl em milissegundos (0 = sem expiração).
+ * Retorna 0 (OK), ou -1 (erro).
+ */
+int rtable_batch_put(struct rtable_batch_t *batch, struct entry_t *entry, unsigned long ttl);
+
+/* Acrescenta ao lote a remoção da key.
+ * Retorna 0 (OK), ou -1 (erro).
+ */
+int rtable_batch_del(struct rtable_batch_t *batch, char *key);
+
+/* Envia o lote num só pedido. O servidor aplica as operações, pela
+ * ordem em que foram acrescentadas, todas ou nenhuma, e a cadeia
+ * propaga-as como uma unidade, pelo que nenhuma leitura vê apenas
+ * parte do lote. O lote pode ser enviado outra vez ou destruído.
+ * Retorna 0 (OK, todas aplicadas), ou -1 (erro, nenhuma aplicada).
+ */
+int rtable_batch_commit(struct rtable_t *rtable, struct rtable_batch_t *batch);
+
+/* Liberta o lote e as cópias das entradas.
+ */
+void rtable_batch_destroy(struct rtable_batch_t *batch);
+
 /* Retorna o número de elementos contidos na tabela ou -1 em caso de erro.
  */
 int rtable_size(struct rtable_t *rtable);
@@ -54,6 +244,12 @@ struct statistics_t *rtable_stats(struct rtable_t *rtable);
  */
 char **rtable_get_keys(struct rtable_t *rtable);
 
+/* Igual a rtable_get_keys(), mas retorna apenas as keys que começam por
+ * prefix e correspondem ao padrão glob pattern (ver fnmatch(3)), sendo
+ * o filtro avaliado no servidor. Um prefix ou pattern a NULL não filtra.
+ */
+char **rtable_get_keys_filter(struct rtable_t *rtable, char *prefix, char *pattern);
+
 /* Liberta a memória alocada por rtable_get_keys().
  */
 void rtable_free_keys(char **keys);
@@ -63,8 +259,206 @@ void rtable_free_keys(char **keys);
  */
 struct entry_t **rtable_get_table(struct rtable_t *rtable);
 
+/* Igual a rtable_get_table(), mas retorna apenas as entradas cujas keys
+ * começam por prefix e correspondem ao padrão glob pattern (ver
+ * fnmatch(3)), sendo o filtro avaliado no servidor. Um prefix ou
+ * pattern a NULL não filtra.
+ */
+struct entry_t **rtable_get_table_filter(struct rtable_t *rtable, char *prefix, char *pattern);
+
+/* Igual a rtable_get_table(), mas guarda em version a sequência da
+ * última escrita incluída na cópia, a passar a rtable_changes() para
+ * receber as escritas seguintes.
+ */
+struct entry_t **rtable_get_table_version(struct rtable_t *rtable, unsigned long *version);
+
+/* Retorna uma página das keys da tabela, que começam por prefix e
+ * correspondem ao padrão pattern (NULL não filtra), a partir do cursor,
+ * que é avançado. Cada página percorre cerca de count keys da tabela,
+ * pelo que pode ter menos (ou nenhuma) keys quando há filtro. Uma key
+ * presente durante toda a iteração é retornada pelo menos uma vez.
+ * Liberta-se com rtable_free_keys(). Retorna NULL em caso de erro.
+ */
+char **rtable_get_keys_page(struct rtable_t *rtable, struct rtable_cursor_t *cursor,
+                            int count, char *prefix, char *pattern);
+
+/* Igual a rtable_get_keys_page(), mas retorna as entradas. Liberta-se
+ * com rtable_free_entries(). Retorna NULL em caso de erro.
+ */
+struct entry_t **rtable_get_table_page(struct rtable_t *rtable, struct rtable_cursor_t *cursor,
+                                       int count, char *prefix, char *pattern);
+
+/* Percorre as entradas da tabela que começam por prefix e correspondem
+ * ao padrão pattern, pedindo-as em páginas de page_size, e chama
+ * callback(entry, arg) para cada uma. Retorna 0 se percorreu a tabela,
+ * o valor do callback se este parou a iteração, ou -1 em caso de erro.
+ */
+int rtable_iterate(struct rtable_t *rtable, char *prefix, char *pattern, int page_size,
+                   rtable_iter_t callback, void *arg);
+
+/* Retorna um array de entry_t* com as entradas cujas chaves estão entre
+ * start e end (inclusive), por ordem das chaves, colocando um último
+ * elemento do array a NULL. Um start ou end a NULL deixa o intervalo
+ * aberto desse lado e um limit maior que 0 limita o número de entradas.
+ * Liberta-se com rtable_free_entries(). Retorna NULL em caso de erro.
+ */
+struct entry_t **rtable_scan(struct rtable_t *rtable, char *start, char *end, int limit);
+
 /* Liberta a memória alocada por rtable_get_table().
  */
 void rtable_free_entries(struct entry_t **entries);
 
+/* Pedido assíncrono em curso, retornado pelas funções _async.
+ */
+struct rtable_future_t;
+
+/* Função chamada quando um pedido assíncrono termina, na thread do
+ * ciclo de eventos da tabela, com o resultado já disponível. Pode
+ * submeter outros pedidos, mas não deve esperar por eles nem
+ * desligar a tabela.
+ */
+typedef void (*rtable_callback_t)(struct rtable_future_t *future, void *arg);
+
+/* Versões assíncronas de rtable_get(), rtable_put() e rtable_del():
+ * enviam o pedido numa ligação própria da tabela e retornam logo,
+ * sem esperar pela resposta. Uma thread interna lê as respostas, por
+ * isso uma só thread pode ter centenas de pedidos em curso. Quando o
+ * pedido termina, callback(future, arg) é chamada, se não for NULL.
+ * Retornam o pedido, que se liberta com rtable_future_destroy(), ou
+ * NULL em caso de erro.
+ */
+struct rtable_future_t *rtable_get_async(struct rtable_t *rtable, char *key,
+                                         rtable_callback_t callback, void *arg);
+struct rtable_future_t *rtable_put_async(struct rtable_t *rtable, struct entry_t *entry,
+                                         rtable_callback_t callback, void *arg);
+struct rtable_future_t *rtable_del_async(struct rtable_t *rtable, char *key,
+                                         rtable_callback_t callback, void *arg);
+
+/* Retorna 1 se o pedido já terminou, 0 se ainda está em curso ou
+ * -1 em caso de erro.
+ */
+int rtable_future_poll(struct rtable_future_t *future);
+
+/* Espera que o pedido termine, incluindo a sua callback.
+ * Retorna o resultado do pedido, 0 (OK) ou -1 (erro ou, num get,
+ * key não encontrada).
+ */
+int rtable_future_wait(struct rtable_future_t *future);
+
+/* Retorna o resultado de um pedido que já terminou, 0 (OK) ou -1.
+ */
+int rtable_future_result(struct rtable_future_t *future);
+
+/* Retorna o valor lido por um get que já terminou e guarda a sua
+ * versão em version, se não for NULL. O valor passa a ser de quem
+ * chama. Retorna NULL se a key não existe ou em caso de erro.
+ */
+struct data_t *rtable_future_data(struct rtable_future_t *future, unsigned long *version);
+
+/* Espera que o pedido termine e liberta-o.
+ */
+void rtable_future_destroy(struct rtable_future_t *future);
+
+/* Subscrição das alterações de keys, criada por rtable_watch().
+ */
+struct rtable_watch_t;
+
+/* Tipo de um evento de uma subscrição.
+ */
+enum rtable_event_type {
+    RTABLE_EVENT_PUT,       /* a key passou a ter value */
+    RTABLE_EVENT_DEL,       /* a key foi removida */
+    RTABLE_EVENT_DROPPED,   /* o servidor descartou eventos, as keys devem ser lidas de novo */
+    RTABLE_EVENT_CLOSED     /* a ligação falhou, não chegam mais eventos */
+};
+
+/* Evento de uma subscrição. key e value só são válidos durante a
+ * callback. version é a versão do novo valor em RTABLE_EVENT_PUT e
+ * dropped o número de eventos perdidos em RTABLE_EVENT_DROPPED.
+ */
+struct rtable_event_t {
+    enum rtable_event_type type;
+    char *key;
+    struct data_t *value;
+    unsigned long version;
+    long dropped;
+};
+
+/* Função chamada para cada evento de uma subscrição, na thread que
+ * recebe os eventos. Não pode chamar rtable_unwatch().
+ */
+typedef void (*rtable_watch_callback_t)(struct rtable_event_t *event, void *arg);
+
+/* Subscreve as alterações das keys e das keys que começam por um
+ * dos prefixes (arrays terminados por NULL, um deles pode ser NULL),
+ * numa ligação própria ao servidor. Cada escrita aplicada pelo
+ * servidor numa dessas keys chega como um evento, pela ordem das
+ * escritas, podendo o mesmo estado chegar repetido. O servidor
+ * guarda até queue_size eventos por enviar (0 para o valor de
+ * omissão) e avisa com RTABLE_EVENT_DROPPED quando descarta outros.
+ * Retorna a subscrição ou NULL em caso de erro, caso em que a
+ * callback pode ter recebido RTABLE_EVENT_CLOSED.
+ */
+struct rtable_watch_t *rtable_watch(struct rtable_t *rtable, char **keys, char **prefixes,
+                                    int queue_size, rtable_watch_callback_t callback, void *arg);
+
+/* Termina a subscrição e liberta-a. A callback recebe
+ * RTABLE_EVENT_CLOSED antes de a função retornar.
+ */
+void rtable_unwatch(struct rtable_watch_t *watch);
+
+/* Receção das escritas aplicadas por um servidor, criada por
+ * rtable_changes().
+ */
+struct rtable_changes_t;
+
+/* Tipo de uma mensagem da receção das escritas.
+ */
+enum rtable_change_type {
+    RTABLE_CHANGE_PUT,      /* a key passou a ter value */
+    RTABLE_CHANGE_DEL,      /* a key foi removida */
+    RTABLE_CHANGE_LOST,     /* o servidor já descartou escritas pedidas, a tabela deve ser copiada de novo */
+    RTABLE_CHANGE_CLOSED    /* a ligação terminou, não chegam mais escritas */
+};
+
+/* Escrita aplicada pelo servidor. key e value só são válidos durante
+ * a callback. sequence é a versão atribuída à escrita pela cabeça da
+ * cadeia, igual em todos os servidores da cadeia, e expire_at o
+ * instante de expiração em ms de RTABLE_CHANGE_PUT (0 = sem
+ * expiração). Em RTABLE_CHANGE_LOST, sequence é a menor sequência a
+ * partir da qual o servidor ainda pode continuar.
+ */
+struct rtable_change_t {
+    enum rtable_change_type type;
+    unsigned long sequence;
+    char *key;
+    struct data_t *value;
+    unsigned long expire_at;
+};
+
+/* Função chamada para cada escrita recebida, na thread que as
+ * recebe. Não pode chamar rtable_changes_close().
+ */
+typedef void (*rtable_changes_callback_t)(struct rtable_change_t *change, void *arg);
+
+/* Recebe, numa ligação própria ao servidor, as escritas que aplicou
+ * com sequência maior que after, pela ordem em que as aplicou, e as
+ * seguintes à medida que as aplica. As sequências são crescentes mas
+ * não consecutivas. Depois de a ligação terminar, a receção pode
+ * continuar em qualquer servidor da mesma cadeia, com after igual à
+ * sequência da última escrita recebida. O servidor guarda apenas as
+ * últimas escritas: se as seguintes a after já foram descartadas, a
+ * callback recebe RTABLE_CHANGE_LOST e a tabela deve ser copiada de
+ * novo com rtable_get_table_version().
+ * Retorna a receção ou NULL em caso de erro, caso em que a callback
+ * pode ter recebido RTABLE_CHANGE_CLOSED.
+ */
+struct rtable_changes_t *rtable_changes(struct rtable_t *rtable, unsigned long after,
+                                        rtable_changes_callback_t callback, void *arg);
+
+/* Termina a receção das escritas e liberta-a. A callback recebe
+ * RTABLE_CHANGE_CLOSED antes de a função retornar.
+ */
+void rtable_changes_close(struct rtable_changes_t *changes);
+
 #endif
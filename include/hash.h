@@ -0,0 +1,64 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que implementa a função de hash das chaves da tabela,
+ * da família wyhash, com uma semente aleatória escolhida uma vez
+ * por processo para dificultar ataques de colisões (hash flooding).
+ *
+ * Os valores de hash mudam de processo para processo, não devem
+ * ser guardados nem enviados pela rede. A exceção é hash_stable(),
+ * que usa uma semente fixa.
+*/
+
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Calcula o hash de 64 bits de um bloco de bytes.
+ * \attention
+ *      Thread-safe.
+ * \param data
+ *      Bytes a serem processados.
+ * \param len
+ *      Numero de bytes.
+ * \return
+ *      Hash dos bytes.
+*/
+uint64_t hash_bytes(const void *data, size_t len);
+
+/**
+ * Calcula o hash de 64 bits de um bloco de bytes com uma semente
+ * fixa, igual em todos os processos, para valores que sao
+ * partilhados entre maquinas (p.e. o anel das particoes).
+ * \attention
+ *      Thread-safe. Nao deve ser usada nos indices da tabela.
+ * \param data
+ *      Bytes a serem processados.
+ * \param len
+ *      Numero de bytes.
+ * \return
+ *      Hash dos bytes.
+*/
+uint64_t hash_stable(const void *data, size_t len);
+
+/**
+ * Calcula o hash de 64 bits de uma chave.
+ * \attention
+ *      Thread-safe.
+ * \param key
+ *      String terminada em '\0'.
+ * \return
+ *      Hash da chave.
+*/
+uint64_t hash_key(const char *key);
+
+#endif
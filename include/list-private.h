@@ -2,15 +2,75 @@
 #define _LIST_PRIVATE_H
 
 #include "entry.h"
+#include "slab.h"
 
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define NODE_KEY_INLINE 24	/* chaves mais curtas ficam dentro do nó */
+#define NODE_VALUE_INLINE 64	/* valores até este tamanho ficam dentro do nó */
+
+/* O nó contém a entry e o cabeçalho dos dados. As chaves com menos de
+ * NODE_KEY_INLINE bytes e os valores com até NODE_VALUE_INLINE bytes
+ * são guardados em inline_data, logo a seguir à estrutura, e os
+ * maiores em objetos à parte reservados no alocador da lista.
+ * A lista está ordenada pelo hash e depois pela chave, assim a
+ * procura só compara chaves quando os hashes são iguais.
+ */
 struct node_t {
-	struct entry_t *entry;
-	struct node_t  *next; 
+	struct node_t  *next;
+	uint64_t hash;		/* hash_key() da chave */
+	uint64_t version;	/* versão da entry, 0 se não tiver */
+	struct entry_t entry;	/* aponta para a chave e os dados do nó */
+	struct data_t data;
+	int size;		/* bytes reservados para o nó */
+	atomic_char referenced;	/* bit de referencia do CLOCK, marcado por leitores concorrentes */
+	char inline_data[];	/* chave e valor curtos, por esta ordem */
 };
 
 struct list_t {
 	int size;
+	long memory;		/* bytes ocupados pelos nos da lista */
 	struct node_t *head;
+	struct slab_t *slab;	/* alocador dos nos, NULL usa o malloc */
 };
 
+/* Função que adiciona à lista uma entry com cópias da chave e dos
+ * dados passados, reservando-as num bloco do alocador da lista.
+ * O hash tem de ser hash_key(key).
+ * Se já existir uma entry com a mesma chave, os dados e a versão são
+ * substituídos.
+ * Retorna 0 se a entry ainda não existia, 1 se já existia e foi
+ * substituída, ou -1 em caso de erro.
+ */
+int list_put(struct list_t *list, char *key, uint64_t hash, struct data_t *value,
+	     uint64_t version);
+
+/* Função igual a list_get(), com o hash da chave já calculado.
+ */
+struct entry_t *list_find(struct list_t *list, char *key, uint64_t hash);
+
+/* Função igual a list_remove(), com o hash da chave já calculado.
+ */
+int list_delete(struct list_t *list, char *key, uint64_t hash);
+
+/* Função que retorna a versão de uma entry obtida com list_find() ou
+ * list_get(), que tem de estar ainda na lista.
+ */
+uint64_t list_entry_version(struct entry_t *entry);
+
+/* Função que calcula a memória ocupada por um nó, contando o próprio
+ * nó e a chave e os dados guardados fora dele.
+ * Retorna o número de bytes ou -1 em caso de erro.
+ */
+long node_memory(struct node_t *node);
+
+/* Função que percorre a lista como o ponteiro do algoritmo CLOCK,
+ * limpando o bit de referência dos nós referenciados até encontrar
+ * um nó que não foi referenciado desde a última passagem.
+ * Retorna a entry desse nó (referência na lista) ou NULL se todos os
+ * nós tinham sido referenciados ou em caso de erro.
+ */
+struct entry_t *list_clock_victim(struct list_t *list);
+
 #endif
\ No newline at end of file
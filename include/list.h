@@ -19,8 +19,9 @@ struct list_t *list_create();
 int list_destroy(struct list_t *list);
 
 /* Função que adiciona à lista a entry passada como argumento.
- * A entry é inserida de forma ordenada, tendo por base a comparação
- * de entries feita pela função entry_compare do módulo entry e
+ * A entry é inserida de forma ordenada, tendo por base o hash da
+ * chave (hash_key do módulo hash) e, para hashes iguais, a comparação
+ * de entries feita pela função entry_compare do módulo entry,
  * considerando que a entry menor deve ficar na cabeça da lista.
  * Se já existir uma entry igual (com a mesma chave), a entry
  * já existente na lista será substituída pela nova entry,
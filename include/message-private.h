@@ -8,6 +8,12 @@
 
 #ifndef _MESSAGE_PRIVATE_H
 #define _MESSAGE_PRIVATE_H
+
+#include <stdint.h>
+
+// Maior mensagem serializada, o tamanho e enviado em 16 bits
+#define MESSAGE_MAX_SIZE UINT16_MAX
+
 /**
  * Enviar o conteudo para o servidor atraves do socket.
  * \param sock
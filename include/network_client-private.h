@@ -22,10 +22,31 @@
 
 #define ERROR_SEND_MSG "\033[0;31m[!] Error network:\033[0m Failed to send request.\n"
 
+#define ERROR_SEND_TOO_BIG "\033[0;31m[!] Error network:\033[0m Request larger than 64 KiB.\n"
+
 #define ERROR_READ_SIZE "\033[0;31m[!] Error network:\033[0m Failed to read response size.\n"
 
 #define ERROR_READ_MSG "\033[0;31m[!] Error network:\033[0m Failed to read response.\n"
 
+#define ERROR_DEFERRED "\033[0;31m[!] Error network:\033[0m A request sent without waiting failed.\n"
+
+// ==================================================================
+//                     Pedidos sem espera
+// ==================================================================
+
+// Maximo de pedidos enviados sem esperar com a resposta por ler
+#define NETWORK_MAX_PENDING 64
+
+// ==================================================================
+//                     Buffers das ligacoes
+// ==================================================================
+
+// Tamanho inicial dos buffers de envio, rececao e de-serializacao
+#define NETWORK_BUFFER 1024
+
+// Alinhamento dos campos de-serializados na arena
+#define NETWORK_ARENA_ALIGN 16
+
 #define ERROR_WRITE "\033[0;31m[!] Error network:\033[0m Failed to write from pipe"
 
 #define ERROR_READ "\033[0;31m[!] Error network:\033[0m Failed to read from pipe"
@@ -8,24 +8,72 @@
  * - Obter o endereço do servidor (struct sockaddr_in) com base na
  *   informação guardada na estrutura rtable;
  * - Estabelecer a ligação com o servidor;
- * - Guardar toda a informação necessária (e.g., descritor do socket)
- *   na estrutura rtable;
+ * - Guardar a ligação como livre no conjunto de ligações da
+ *   estrutura rtable;
  * - Retornar 0 (OK) ou -1 (erro).
  */
 int network_connect(struct rtable_t *rtable);
 
 /* Esta função deve:
- * - Obter o descritor da ligação (socket) da estrutura rtable_t;
+ * - Obter uma ligação livre do conjunto da estrutura rtable_t,
+ *   abrindo outra ou esperando se todas estão em uso;
  * - Serializar a mensagem contida em msg;
  * - Enviar a mensagem serializada para o servidor;
  * - Esperar a resposta do servidor;
  * - De-serializar a mensagem de resposta;
  * - Tratar de forma apropriada erros de comunicação;
+ * - Com rtable->async, não esperar: retornar uma resposta de sucesso,
+ *   e ler a verdadeira antes da resposta de um pedido seguinte;
+ * - Devolver a ligação ao conjunto, ou fechá-la se falhou;
  * - Retornar a mensagem de-serializada ou NULL em caso de erro.
  */
 MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg);
 
-/* Fecha a ligação estabelecida por network_connect().
+/* Lê as respostas dos pedidos enviados sem esperar (rtable->async)
+ * nas ligações livres do conjunto, que devem ser todas.
+ * Retorna 0 (OK) ou -1 se algum desses pedidos falhou no servidor
+ * ou uma ligação falhou.
+ */
+int network_flush(struct rtable_t *rtable);
+
+/* Função chamada por network_send_receive_with() com a resposta. A
+ * resposta está nos buffers da ligação: só é válida durante a chamada
+ * e não pode ser libertada.
+ * Retorna o valor que network_send_receive_with() deve retornar.
+ */
+typedef int (*network_handler_t)(MessageT *resp, void *arg);
+
+/* Igual a network_send_receive(), sem reservar memória: o pedido é
+ * serializado e a resposta lida e de-serializada em buffers da ligação,
+ * reutilizados de pedido em pedido, e a resposta é entregue a
+ * handler(resp, arg) antes de a ligação ser devolvida ao conjunto.
+ * Espera sempre pela resposta, mesmo com rtable->async.
+ * Retorna o valor de handler ou -1 (erro).
+ */
+int network_send_receive_with(struct rtable_t *rtable, MessageT *msg,
+                              network_handler_t handler, void *arg);
+
+/* Função chamada pelo ciclo de eventos com a resposta de um pedido
+ * assíncrono, ou NULL se a ligação falhou. A resposta passa a ser da
+ * função, que a deve libertar.
+ */
+typedef void (*network_done_t)(MessageT *resp, void *arg);
+
+/* Envia o pedido numa ligação própria dos pedidos assíncronos, sem
+ * esperar pela resposta. Uma thread (o ciclo de eventos) lê as
+ * respostas pela ordem dos pedidos e chama done(resp, arg) com cada
+ * uma. A ligação e a thread são criadas no primeiro pedido.
+ * Retorna 0 (OK) ou -1 (erro), caso em que done não é chamada.
+ */
+int network_submit(struct rtable_t *rtable, MessageT *msg, network_done_t done, void *arg);
+
+/* Muda o número máximo de ligações abertas ao servidor. As ligações
+ * a mais são fechadas quando ficam livres.
+ * Retorna 0 (OK) ou -1 (erro).
+ */
+int network_pool_resize(struct rtable_t *rtable, int size);
+
+/* Fecha as ligações livres do conjunto, nenhuma pode estar em uso.
  * Retorna 0 (OK) ou -1 (erro).
  */
 int network_close(struct rtable_t *rtable);
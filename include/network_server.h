@@ -12,6 +12,21 @@
  */
 int network_server_init(short port);
 
+/* Prepara um socket AF_UNIX de receção de pedidos de ligação no
+ * caminho dado, para os clientes da mesma máquina evitarem a pilha
+ * TCP. Um socket deixado no caminho por um servidor anterior é
+ * substituído. As ligações são aceites numa thread própria por
+ * network_main_loop() e o socket é fechado, e o caminho apagado, por
+ * network_server_close().
+ * Retorna o descritor do socket ou -1 em caso de erro.
+ */
+int network_server_init_unix(const char *path);
+
+/* Retorna o caminho do socket local, anunciado no ZooKeeper junto do
+ * endereço TCP, ou NULL se o servidor não tem socket local.
+ */
+const char *network_server_unix_path();
+
 /* A função network_main_loop() deve:
  * - Aceitar uma conexão de um cliente;
  * - Receber uma mensagem usando a função network_receive;
@@ -39,6 +54,12 @@ MessageT *network_receive(int client_socket);
  */
 int network_send(int client_socket, MessageT *msg);
 
+/* Verifica, sem bloquear, se o cliente fechou a ligação, numa
+ * ligação onde só o servidor envia mensagens.
+ * Retorna 1 se a ligação fechou, 0 caso contrário.
+ */
+int network_peer_closed(int client_socket);
+
 /* Liberta os recursos alocados por network_server_init(), nomeadamente
  * fechando o socket passado como argumento.
  * Retorna 0 (OK) ou -1 em caso de erro.
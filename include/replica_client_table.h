@@ -18,17 +18,121 @@
 #define _REPLICA_CLIENT_TABLE_H
 
 #include "data.h"
+#include "ring.h"
 #include "entry.h"
 #include "stats.h"
 #include "zk_adaptor.h"
 #include "replica_table.h"
+#include "synchronization.h"
 #include "client_stub-private.h"
 
 #include <zookeeper/zookeeper.h>
 
+/**
+ * Ligacoes a todos os servidores de uma cadeia, usadas para
+ * repartir as leituras de chaves por todas as replicas em vez
+ * de as enviar apenas a cauda. Uma replica com uma escrita por
+ * confirmar pede a versao confirmada a cauda.
+*/
+struct rptable_replicas_t {
+    char **sockets;             /* da cabeca para a cauda, terminado por NULL */
+    struct rtable_t **rtables;  /* NULL se a ligacao falhou */
+    int n_replicas;
+    unsigned int next;          /* proxima replica a ler */
+};
+
+/**
+ * Ligacoes a cabeca e a cauda de uma das cadeias de uma
+ * instalacao particionada. Uma cadeia sem servidores fica
+ * com as ligacoes a NULL.
+*/
+struct rptable_chain_t {
+    char *name;         /* nome do no da cadeia em RPTABLE_ZK_SHARDS_PATH */
+
+    char *wsocket;
+    struct rtable_t *rtable_w;
+
+    char *rsocket;
+    struct rtable_t *rtable_r;
+
+    struct rptable_replicas_t replicas;
+};
+
+/**
+ * Valor guardado na cache local, ou a ser lido da cauda enquanto
+ * data e NULL.
+*/
+struct rptable_cached_t {
+    char *key;
+    struct data_t *data;
+    unsigned long version;
+    unsigned long fill;                 /* leitura que vai colocar o valor */
+    struct rptable_cached_t *next;      /* seguinte na lista do indice */
+    struct rptable_cached_t *newer;     /* vizinhos na ordem de uso */
+    struct rptable_cached_t *older;
+};
+
+/**
+ * Ligacao a cauda de uma cadeia, reservada as invalidacoes.
+*/
+struct rptable_tracker_t {
+    struct rtable_t *rtable;            /* NULL se nao conseguiu ligar */
+    int live;                           /* 0 depois de a ligacao falhar */
+    struct rptable_cache_t *cache;
+};
+
+/**
+ * Cache local dos valores lidos com rptable_get(). A cauda de cada
+ * cadeia segue as chaves lidas para a cache e avisa o cliente, na
+ * ligacao do tracker, quando mudam. Tem o seu proprio lock, porque
+ * as invalidacoes chegam no ciclo de eventos dos trackers.
+*/
+struct rptable_cache_t {
+    pthread_mutex_t lock;
+    uint64_t id;                        /* identificador do cliente nos servidores */
+    struct rptable_cached_t **buckets;
+    int n_buckets;
+    struct rptable_cached_t *newest;    /* lista LRU, a mais antiga e removida */
+    struct rptable_cached_t *oldest;
+    int n_entries;
+    int max_entries;
+    unsigned long fills;                /* ultima leitura que colocou um valor */
+
+    struct rptable_tracker_t *trackers; /* um por cadeia, pela ordem das cadeias */
+    int n_trackers;
+
+    long hits;
+    long misses;
+    long invalidations;                 /* valores removidos por aviso dos servidores */
+    long evictions;                     /* valores removidos por falta de espaco */
+};
+
+/**
+ * Subscricao das alteracoes de chaves numa ou mais cadeias, com
+ * uma ligacao a cauda de cada cadeia envolvida.
+*/
+struct rptable_watch_t {
+    struct rtable_watch_t **watches;    /* por cadeia, NULL se nao tem chaves subscritas */
+    int n_watches;
+};
+
+/**
+ * Estado da cache local.
+*/
+struct rptable_cache_stats_t {
+    long hits;
+    long misses;
+    long invalidations;
+    long evictions;
+    int entries;
+    int max_entries;
+};
+
 /**
  * Estrutura que contem dados para fazer comunicacao
  * com o ZooKeeper e invocar metodos sobre a tabela remota.
+ * Pode ser usada por varias threads: as operacoes leem as ligacoes
+ * dentro de cctrl e os watchers do ZooKeeper mudam-nas como escritores.
 */
 typedef struct client_rptable_t {
     zhandle_t *handler;
@@ -38,6 +142,27 @@ typedef struct client_rptable_t {
 
     char *rptable_rsocket;
     struct rtable_t *rtable_r;
+
+    // Instalacao particionada, chains e ring a NULL se ha uma so cadeia
+    struct rptable_chain_t *chains;     /* cadeias por ordem do nome */
+    int n_chains;
+    struct ring_t *ring;                /* anel que atribui as chaves as cadeias */
+
+    // Anel anterior a ultima mudanca das cadeias, enquanto as chaves
+    // ainda podem estar a ser migradas para os novos donos
+    struct ring_t *prev_ring;
+    char **prev_names;                  /* nomes das cadeias do anel anterior */
+    int migration_seen;                 /* 1 se ja viu uma migracao depois da mudanca */
+
+    // Replicas da cadeia unica, numa instalacao particionada estao nas cadeias
+    struct rptable_replicas_t replicas;
+
+    unsigned int durability;            /* servidores que aplicam cada escrita, 0 todos */
+
+    rwcctrl_t *cctrl;                   /* protege as ligacoes e o anel */
+    int pool_size;                      /* ligacoes abertas a cada servidor */
+
+    struct rptable_cache_t *cache;      /* NULL se a cache local esta desligada */
 } c_rptable_t;
 
 /**
@@ -67,6 +192,10 @@ c_rptable_t *rptable_connect(node_watcher watcher, failure_handler handler);
 /**
  * Estabelece ligacao as tabelas replicadas, especificando o 
  * socket do servidor ZooKeeper.
+ * Se existirem cadeias em RPTABLE_ZK_SHARDS_PATH, liga-se a 
+ * cabeca e a cauda de cada uma e encaminha cada pedido para a
+ * cadeia dona da chave no anel de hash consistente. As operacoes
+ * sobre toda a tabela juntam os resultados de todas as cadeias.
  * \param zksock
  *      String que descreve o socket do servidor ZooKeeper.
  * \param watcher
@@ -103,6 +232,21 @@ int rptable_disconnect(c_rptable_t *rptable);
  */
 int rptable_put(c_rptable_t *rptable, char *key, struct data_t *value);
 
+/** 
+ * Função para adicionar um elemento na tabela com tempo de vida.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param data
+ *      Conteudo para ser colocado na entrada.
+ * \param ttl
+ *      Tempo de vida em milissegundos (0 = sem expiracao).
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_put_ttl(c_rptable_t *rptable, char *key, struct data_t *value, unsigned long ttl);
+
 /** 
  * Retorna o elemento da tabela com chave key, ou NULL caso não exista
  * ou se ocorrer algum erro.
@@ -116,6 +260,270 @@ int rptable_put(c_rptable_t *rptable, char *key, struct data_t *value);
  */
 struct data_t *rptable_get(c_rptable_t *rptable, char *key);
 
+/**
+ * Igual a rptable_get(), mas guarda tambem a versao da entrada.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param version
+ *      Onde guardar a versao, pode ser NULL.
+ * \return
+ *      Estrutura data_t que contem o conteudo da entrada ou NULL
+ *      caso nao exista ou se ocorreu algum erro.
+ */
+struct data_t *rptable_get_version(c_rptable_t *rptable, char *key, unsigned long *version);
+
+/**
+ * Igual a rptable_get_version(), com a consistencia dada. Todas as
+ * leituras sao repartidas pelas replicas da cadeia. Se a replica
+ * escolhida estiver mais atrasada do que max_lag, a leitura e
+ * repetida na cauda.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param consistency
+ *      RTABLE_READ_STRONG, RTABLE_READ_BOUNDED ou RTABLE_READ_ANY.
+ * \param max_lag
+ *      Atraso maximo em ms de uma leitura RTABLE_READ_BOUNDED.
+ * \param version
+ *      Onde guardar a versao, pode ser NULL.
+ * \return
+ *      Estrutura data_t que contem o conteudo da entrada ou NULL
+ *      caso nao exista ou se ocorreu algum erro.
+ */
+struct data_t *rptable_get_consistency(c_rptable_t *rptable, char *key,
+                                       enum rtable_consistency consistency,
+                                       unsigned long max_lag, unsigned long *version);
+
+/**
+ * Igual a rptable_get_version(), mas copia o valor para o buffer dado,
+ * sem reservar memoria. Ver rtable_get_into(). Um valor na cache local
+ * e copiado dela, e uma falta e lida de uma replica da cadeia, como em
+ * rptable_get(), sem guardar o valor na cache.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param buf
+ *      Onde copiar o valor.
+ * \param size
+ *      Tamanho de buf.
+ * \param version
+ *      Onde guardar a versao, pode ser NULL.
+ * \return
+ *      O tamanho do valor, copiado so se nao for maior que size, ou
+ *      -1 caso nao exista ou se ocorreu algum erro.
+ */
+int rptable_get_into(c_rptable_t *rptable, char *key, void *buf, int size, unsigned long *version);
+
+/**
+ * Versoes assincronas de rptable_get(), rptable_put() e rptable_del(),
+ * enviadas ao servidor que guarda a chave. Ver rtable_get_async().
+ * Durante uma migracao, um get que nao encontra a chave no novo dono
+ * nao e repetido no anterior. A callback nao pode chamar funcoes
+ * rptable_, porque um watcher que feche a ligacao espera por ela.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param callback
+ *      Chamada quando o pedido termina, pode ser NULL.
+ * \return
+ *      O pedido, libertado com rtable_future_destroy(), ou NULL em
+ *      caso de erro.
+ */
+struct rtable_future_t *rptable_get_async(c_rptable_t *rptable, char *key,
+                                          rtable_callback_t callback, void *arg);
+struct rtable_future_t *rptable_put_async(c_rptable_t *rptable, char *key, struct data_t *value,
+                                          rtable_callback_t callback, void *arg);
+struct rtable_future_t *rptable_del_async(c_rptable_t *rptable, char *key,
+                                          rtable_callback_t callback, void *arg);
+
+/**
+ * Define a durabilidade das escritas seguintes, em todas as cadeias.
+ * Ver rtable_set_durability().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param replicas
+ *      Servidores que aplicam a escrita antes da resposta, 1 so a
+ *      cabeca, 0 toda a cadeia.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_set_durability(c_rptable_t *rptable, unsigned int replicas);
+
+/**
+ * Define o numero maximo de ligacoes abertas a cada servidor, para
+ * varias threads fazerem pedidos ao mesmo servidor em paralelo.
+ * Ver rtable_set_pool_size().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param size
+ *      Ligacoes por servidor, maior que 0.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_set_pool_size(c_rptable_t *rptable, int size);
+
+/**
+ * Preenche stats com a soma do estado dos conjuntos de ligacoes
+ * a todos os servidores. size e o maximo de ligacoes a cada um.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param stats
+ *      Onde guardar o estado.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_pool_stats(c_rptable_t *rptable, struct rtable_pool_stats_t *stats);
+
+/**
+ * Liga a cache local dos valores lidos, com lugar para max_entries
+ * valores, ou desliga-a com 0. Os valores sao lidos da cauda, que
+ * avisa o cliente quando mudam, e os mais antigos sao removidos
+ * quando a cache enche. Enquanto as chaves estao a ser migradas
+ * entre cadeias a cache nao e usada.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param max_entries
+ *      Numero maximo de valores guardados, 0 para desligar.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_cache_enable(c_rptable_t *rptable, int max_entries);
+
+/**
+ * Preenche stats com o estado da cache local.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param stats
+ *      Onde guardar o estado.
+ * \return
+ *      0 (OK) ou -1 se a cache esta desligada.
+ */
+int rptable_cache_stats(c_rptable_t *rptable, struct rptable_cache_stats_t *stats);
+
+/**
+ * Subscreve as alteracoes das chaves e dos prefixos na cauda de cada
+ * cadeia, com uma ligacao propria. Ver rtable_watch(). Numa
+ * instalacao particionada cada chave e subscrita na cadeia dona e
+ * os prefixos em todas, e a callback pode ser chamada ao mesmo tempo
+ * por varias cadeias. A subscricao nao segue as mudancas da cadeia:
+ * quando a cauda muda, a callback recebe RTABLE_EVENT_CLOSED e deve
+ * voltar a subscrever.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param keys
+ *      Chaves subscritas, terminado por NULL, pode ser NULL.
+ * \param prefixes
+ *      Prefixos subscritos, terminado por NULL, pode ser NULL.
+ * \param queue_size
+ *      Eventos por enviar guardados pelo servidor, 0 para o de omissao.
+ * \param callback
+ *      Funcao chamada para cada evento.
+ * \param arg
+ *      Argumento passado a callback.
+ * \return
+ *      A subscricao ou NULL em caso de erro.
+ */
+struct rptable_watch_t *rptable_watch(c_rptable_t *rptable, char **keys, char **prefixes,
+                                      int queue_size, rtable_watch_callback_t callback, void *arg);
+
+/**
+ * Termina a subscricao em todas as cadeias e liberta-a.
+ * \param watch
+ *      Subscricao devolvida por rptable_watch().
+ */
+void rptable_unwatch(struct rptable_watch_t *watch);
+
+/**
+ * Retorna o numero de cadeias da instalacao, 1 se nao e particionada.
+ * Cada cadeia tem a sua sequencia de escritas.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \return
+ *      Numero de cadeias ou -1 em caso de erro.
+ */
+int rptable_chains(c_rptable_t *rptable);
+
+/**
+ * Copia as entradas de uma cadeia, lidas na cauda, e a sequencia da
+ * ultima escrita incluida. Ver rtable_get_table_version().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param chain
+ *      Indice da cadeia, entre 0 e rptable_chains() - 1.
+ * \param version
+ *      Onde guardar a sequencia da copia.
+ * \return
+ *      Array de entradas terminada por NULL ou NULL em caso de erro.
+ */
+struct entry_t **rptable_get_table_version(c_rptable_t *rptable, int chain, unsigned long *version);
+
+/**
+ * Recebe, numa ligacao propria a cauda de uma cadeia, as escritas
+ * aplicadas com sequencia maior que after. Ver rtable_changes(). A
+ * cauda so tem as escritas aplicadas por toda a cadeia. A rececao
+ * nao segue as mudancas da cadeia: quando a cauda muda, a callback
+ * recebe RTABLE_CHANGE_CLOSED e a rececao deve ser pedida de novo,
+ * com a ultima sequencia recebida. Termina-se com
+ * rtable_changes_close().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param chain
+ *      Indice da cadeia, entre 0 e rptable_chains() - 1.
+ * \param after
+ *      Sequencia da ultima escrita ja recebida, 0 para todas.
+ * \param callback
+ *      Funcao chamada para cada escrita.
+ * \param arg
+ *      Argumento passado a callback.
+ * \return
+ *      A rececao ou NULL em caso de erro.
+ */
+struct rtable_changes_t *rptable_changes(c_rptable_t *rptable, int chain, unsigned long after,
+                                         rtable_changes_callback_t callback, void *arg);
+
+/**
+ * Adiciona um elemento na cabeca da cadeia apenas se a versao
+ * guardada for a esperada. Ver rtable_put_if_version().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param value
+ *      Conteudo para ser colocado na entrada.
+ * \param expected
+ *      Versao esperada, 0 para exigir que a chave nao exista.
+ * \param version
+ *      Onde guardar a nova versao ou a guardada, pode ser NULL.
+ * \return
+ *      1 se escreveu, 0 se a versao era diferente ou -1 em caso
+ *      de erro.
+ */
+int rptable_put_if_version(c_rptable_t *rptable, char *key, struct data_t *value,
+                           unsigned long expected, unsigned long *version);
+
+/**
+ * Remove um elemento na cabeca da cadeia apenas se a versao
+ * guardada for a esperada. Ver rtable_del_if_version().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave da entrada para ser removida.
+ * \param expected
+ *      Versao esperada.
+ * \param version
+ *      Onde guardar a versao guardada, pode ser NULL.
+ * \return
+ *      1 se removeu, 0 se a versao era diferente ou -1 em caso
+ *      de erro.
+ */
+int rptable_del_if_version(c_rptable_t *rptable, char *key, unsigned long expected,
+                           unsigned long *version);
+
 /**
  * Função para remover um elemento da tabela. Vai libertar 
  * toda a memoria alocada na respetiva operação rptable_put().
@@ -128,6 +536,105 @@ struct data_t *rptable_get(c_rptable_t *rptable, char *key);
  */
 int rptable_del(c_rptable_t *rptable, char *key);
 
+/**
+ * Obtem da cauda da cadeia, num so pedido, as entradas das chaves
+ * que existem, pela ordem pedida.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param keys
+ *      Array de chaves.
+ * \param n_keys
+ *      Numero de chaves.
+ * \return
+ *      Array de entry_t* terminada por NULL, que deve ser libertada
+ *      com rptable_free_entries(), ou NULL em caso de erro.
+ */
+struct entry_t **rptable_mget(c_rptable_t *rptable, char **keys, int n_keys);
+
+/**
+ * Adiciona na cabeca da cadeia, num so pedido, as entradas do
+ * array, todas com o mesmo tempo de vida.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param entries
+ *      Array de entradas terminada por NULL.
+ * \param ttl
+ *      Tempo de vida em milissegundos (0 = sem expiracao).
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_mput(c_rptable_t *rptable, struct entry_t **entries, unsigned long ttl);
+
+/**
+ * Remove na cabeca da cadeia, num so pedido, as chaves do array.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param keys
+ *      Array de chaves terminada por NULL.
+ * \return 
+ *      Numero de chaves removidas ou -1 em caso de erro.
+ */
+int rptable_mdel(c_rptable_t *rptable, char **keys);
+
+/**
+ * Soma atomicamente, na cabeca da cadeia, delta ao inteiro guardado
+ * na chave. Ver rtable_incr().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave do contador.
+ * \param delta
+ *      Valor a somar, negativo para subtrair.
+ * \param value
+ *      Onde guardar o novo valor do contador.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_incr(c_rptable_t *rptable, char *key, long delta, long *value);
+
+/**
+ * Acrescenta atomicamente, na cabeca da cadeia, os dados ao fim
+ * do valor guardado na chave. Ver rtable_append().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave da entrada.
+ * \param value
+ *      Dados a acrescentar.
+ * \return 
+ *      Novo tamanho do valor ou -1 em caso de erro.
+ */
+int rptable_append(c_rptable_t *rptable, char *key, struct data_t *value);
+
+/**
+ * Substitui atomicamente, na cabeca da cadeia, o valor da chave se
+ * o valor guardado for igual ao esperado. Ver rtable_cas().
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param key
+ *      Chave da entrada.
+ * \param expected
+ *      Valor esperado.
+ * \param value
+ *      Novo valor.
+ * \return 
+ *      1 se substituiu, 0 se nao substituiu ou -1 em caso de erro.
+ */
+int rptable_cas(c_rptable_t *rptable, char *key, struct data_t *expected, struct data_t *value);
+
+/**
+ * Aplica na cabeca da cadeia, todas ou nenhuma, as escritas do
+ * lote. Ver rtable_batch_commit(). Numa instalacao particionada
+ * todas as chaves do lote tem de pertencer a mesma cadeia.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param batch
+ *      Lote criado com rtable_batch_create().
+ * \return 
+ *      0 se aplicou todas ou -1 em caso de erro.
+ */
+int rptable_batch_commit(c_rptable_t *rptable, struct rtable_batch_t *batch);
+
 /**
  *  Retorna o número de elementos contidos na tabela ou -1 em caso de erro.
  * \param rptable
@@ -158,6 +665,21 @@ struct statistics_t *rptable_stats(c_rptable_t *rptable);
  */
 char **rptable_get_keys(c_rptable_t *rptable);
 
+/**
+ * Retorna um array de char* com a cópia das keys da tabela que
+ * começam por prefix e correspondem ao padrão glob pattern,
+ * filtradas no servidor, colocando um último elemento do array a NULL.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param prefix
+ *      Prefixo das keys, NULL para nao filtrar.
+ * \param pattern
+ *      Padrao glob das keys, NULL para nao filtrar.
+ * \return
+ *      Array de keys ou NULL em caso de erro.
+*/
+char **rptable_get_keys_filter(c_rptable_t *rptable, char *prefix, char *pattern);
+
 /**
  * Liberta a memória alocada por rptable_get_keys().
  * \param keys
@@ -175,6 +697,78 @@ void rptable_free_keys(char **keys);
 */
 struct entry_t **rptable_get_table(c_rptable_t *rptable);
 
+/**
+ * Retorna um array de entry_t* com as entradas da tabela cujas keys
+ * começam por prefix e correspondem ao padrão glob pattern, filtradas
+ * no servidor, colocando um último elemento do array a NULL.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param prefix
+ *      Prefixo das keys, NULL para nao filtrar.
+ * \param pattern
+ *      Padrao glob das keys, NULL para nao filtrar.
+ * \return
+ *      Array de entry_t* ou NULL em caso de erro.
+*/
+struct entry_t **rptable_get_table_filter(c_rptable_t *rptable, char *prefix, char *pattern);
+
+/**
+ * Obtem, da cauda da cadeia, uma pagina das keys da tabela a partir
+ * do cursor, que e avancado. Ver rtable_get_keys_page(). Numa
+ * instalacao particionada as cadeias sao percorridas uma a seguir a
+ * outra, a iteracao termina quando o cursor volta todo a zero.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param cursor
+ *      Cursor da iteracao, a zero na primeira pagina.
+ * \param count
+ *      Numero aproximado de keys percorridas na tabela.
+ * \param prefix
+ *      Prefixo das keys, NULL para nao filtrar.
+ * \param pattern
+ *      Padrao glob das keys, NULL para nao filtrar.
+ * \return
+ *      Array de keys ou NULL em caso de erro.
+*/
+char **rptable_get_keys_page(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                             int count, char *prefix, char *pattern);
+
+/**
+ * Obtem, da cauda da cadeia, uma pagina das entradas da tabela a
+ * partir do cursor, que e avancado. Ver rtable_get_table_page().
+ * \return
+ *      Array de entry_t* ou NULL em caso de erro.
+*/
+struct entry_t **rptable_get_table_page(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                                        int count, char *prefix, char *pattern);
+
+/**
+ * Percorre em paginas as entradas da cauda da cadeia, chamando
+ * callback(entry, arg) para cada uma. Ver rtable_iterate().
+ * \return
+ *      0 se percorreu a tabela, o valor do callback se este parou
+ *      a iteracao, ou -1 em caso de erro.
+*/
+int rptable_iterate(c_rptable_t *rptable, char *prefix, char *pattern, int page_size,
+                    rtable_iter_t callback, void *arg);
+
+/**
+ * Obtem, por ordem das chaves, as entradas entre start e end
+ * (inclusive), lidas da cauda da cadeia.
+ * \param rptable
+ *      Apontador a estrutura c_rptable_t.
+ * \param start
+ *      Primeira chave do intervalo, NULL para comecar no inicio.
+ * \param end
+ *      Ultima chave do intervalo, NULL para ir ate ao fim.
+ * \param limit
+ *      Numero maximo de entradas, 0 para nao limitar.
+ * \return
+ *      Array de entry_t* terminada por NULL, que deve ser libertada
+ *      com rptable_free_entries(), ou NULL em caso de erro.
+*/
+struct entry_t **rptable_scan(c_rptable_t *rptable, char *start, char *end, int limit);
+
 /**
  * Liberta a memória alocada por rptable_get_table().
  * \param entries
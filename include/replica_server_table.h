@@ -18,14 +18,37 @@
 #define _REPLICA_SERVER_TABLE_H
 
 #include "data.h"
+#include "ring.h"
 #include "entry.h"
 #include "stats.h"
+#include "changelog.h"
 #include "zk_adaptor.h"
 #include "replica_table.h"
+#include "sdmessage.pb-c.h"
 #include "client_stub-private.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <zookeeper/zookeeper.h>
 
+#define RPTABLE_SYNC_PAGE 256       /* entradas pedidas por pagina da sincronizacao */
+
+/**
+ * Vista do servidor sobre as cadeias de uma instalacao
+ * particionada, usada para reencaminhar e migrar as chaves
+ * que o anel atribui a outras cadeias.
+*/
+struct rptable_shards_t {
+    char *chain;                /* nome da cadeia deste servidor */
+    char **names;               /* nomes das cadeias, terminado por NULL */
+    int n_chains;
+    int self;                   /* indice desta cadeia em names */
+    struct ring_t *ring;
+    struct rtable_t **heads;    /* ligacoes as cabecas das cadeias, abertas quando usadas */
+    unsigned int generation;    /* incrementado sempre que as cadeias mudam */
+    pthread_mutex_t lock;       /* protege os campos e as ligacoes em heads */
+};
+
 /**
  * Estrutura que contem dados para fazer comunicacao
  * com o ZooKeeper e invocar metodos sobre a tabela remota.
@@ -33,9 +56,17 @@
 typedef struct server_rptable_t {
     zhandle_t *handler;
     char *znode;
+    char *root;         /* no da cadeia a que o servidor pertence */
 
     char *rptable_socket;
     struct rtable_t *rtable;
+
+    _Atomic int is_head;    /* 1 se este servidor e a cabeca da cadeia, mudado pelo watcher */
+
+    struct rptable_shards_t *shards;    /* NULL se a cadeia e unica */
+
+    char *tail_socket;          /* cauda da cadeia, para as leituras de chaves */
+    struct rtable_t *tail;      /* com escritas em curso, aberta quando usada */
 } s_rptable_t;
 
 /**
@@ -81,7 +112,35 @@ s_rptable_t *rptable_connect(int sock, node_watcher watcher, failure_handler han
 s_rptable_t *rptable_connect_zksock(char* zksock, int sock, node_watcher watcher, failure_handler handler);
 
 /**
- * Sincroniza a tabela local com a tabela no servidor anterior.
+ * Estabelece ligacao a tabela replicada de uma das cadeias de
+ * uma instalacao particionada, registando o servidor no no
+ * RPTABLE_ZK_SHARDS_PATH/<chain>. Cada cadeia guarda as chaves
+ * que o anel de hash consistente lhe atribui.
+ * \param zksock
+ *      String que descreve o socket do servidor ZooKeeper.
+ * \param chain
+ *      Nome da cadeia, sem '/', ou NULL para a cadeia unica
+ *      em RPTABLE_ZK_ROOT_PATH.
+ * \param sock
+ *      Descritor do socket do servidor.
+ * \param watcher
+ *      Funcao que escuta dos eventos 
+ * \param handler
+ *      Funcao que faz o tratamento da falha da 
+ *      tabela replicada.
+ * \return
+ *      Apontador a s_rptable_t ou NULL em caso de erro.
+*/
+s_rptable_t *rptable_connect_chain(char* zksock, char* chain, int sock,
+                                   node_watcher watcher, failure_handler handler);
+
+/**
+ * Sincroniza a tabela local com a tabela no servidor anterior, copiada
+ * por paginas para cada resposta caber no limite das mensagens. As
+ * escritas aplicadas no servidor anterior durante a copia sao
+ * reencaminhadas e aplicadas logo, pelo que o servidor ja tem de
+ * atender ligacoes entre table_skel_sync_begin e table_skel_sync_end.
+ * A copia nao substitui as escritas e remocoes mais recentes.
  * \return
  *      0 (OK) ou -1 em caso de erro.
 */
@@ -110,6 +169,43 @@ int rptable_disconnect(s_rptable_t *rptable);
  */
 int rptable_put(s_rptable_t *rptable, char *key, struct data_t *value);
 
+/** 
+ * Função para adicionar um elemento na tabela com o instante
+ * de expiracao e a versao fixados pela cabeca da cadeia.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param key
+ *      Chave associada a entrada.
+ * \param data
+ *      Conteudo para ser colocado na entrada.
+ * \param expire_at
+ *      Instante de expiracao em ms (0 = sem expiracao).
+ * \param version
+ *      Versao da entrada.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_put_expire(s_rptable_t *rptable, char *key, struct data_t *value,
+                       unsigned long expire_at, uint64_t version);
+
+/**
+ * Função para adicionar varias entradas na tabela num so pedido,
+ * com os instantes de expiracao e as versoes fixados pela cabeca
+ * da cadeia.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param entries
+ *      Array de entradas terminada por NULL.
+ * \param expire_at
+ *      Instante de expiracao em ms de cada entrada (0 = sem expiracao).
+ * \param version
+ *      Versao de cada entrada.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_mput_expire(s_rptable_t *rptable, struct entry_t **entries, unsigned long *expire_at,
+                        uint64_t *version);
+
 /** 
  * Retorna o elemento da tabela com chave key, ou NULL caso não exista
  * ou se ocorrer algum erro.
@@ -130,10 +226,38 @@ struct data_t *rptable_get(s_rptable_t *rptable, char *key);
  *      Apontador a estrutura c_rptable_t.
  * \param key
  *      Chave da entrada para ser removida.
+ * \param version
+ *      Versao da remocao, fixada pela cabeca da cadeia.
  * \return 
  *      0 (OK) ou -1 em caso de erro.
  */
-int rptable_del(s_rptable_t *rptable, char *key);
+int rptable_del(s_rptable_t *rptable, char *key, uint64_t version);
+
+/**
+ * Função para remover varios elementos da tabela num so pedido.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param keys
+ *      Array de chaves terminada por NULL.
+ * \param version
+ *      Versao da remocao da primeira chave, fixada pela cabeca da
+ *      cadeia. As seguintes tem as versoes seguintes.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_mdel(s_rptable_t *rptable, char **keys, uint64_t version);
+
+/**
+ * Função para aplicar um lote de escritas num so pedido, com os
+ * instantes de expiracao e as versoes fixados pela cabeca da cadeia.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param batch
+ *      Lote de escritas.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+ */
+int rptable_batch(s_rptable_t *rptable, struct rtable_batch_t *batch);
 
 /**
  *  Retorna o número de elementos contidos na tabela ou -1 em caso de erro.
@@ -189,6 +313,145 @@ struct entry_t **rptable_get_table(s_rptable_t *rptable);
 */
 void rptable_free_entries(struct entry_t **entries);
 
+/**
+ * Define a durabilidade da escrita que a thread atual esta a
+ * executar, aplicada as escritas que propagar pela cadeia: com 1,
+ * a escrita e enviada ao servidor seguinte sem esperar pela
+ * resposta, com N > 1 o seguinte responde depois de N - 1
+ * servidores e com 0 depois de toda a cadeia.
+ * \param replicas
+ *      Servidores que aplicam a escrita antes da resposta, a
+ *      contar com este, ou 0 para toda a cadeia.
+*/
+void rptable_forward_durability(unsigned int replicas);
+
+/**
+ * Propaga a sequencia atual da cabeca ao servidor seguinte, depois
+ * de ler as respostas das escritas enviadas sem esperar. O sucesso
+ * confirma que as escritas anteriores chegaram a cauda.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param version
+ *      Ultima versao atribuida pela cabeca.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rptable_heartbeat(s_rptable_t *rptable, uint64_t version);
+
+/**
+ * Reenvia ao servidor seguinte, por ordem e esperando que cheguem a
+ * cauda, escritas que ele pode nao ter aplicado, depois de falhar
+ * uma enviada sem esperar.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param records
+ *      Escritas do registo, com as versoes atribuidas pela cabeca.
+ * \param n_records
+ *      Numero de escritas.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rptable_replay(s_rptable_t *rptable, struct changelog_record_t *records, int n_records);
+
+/**
+ * Indica se este servidor e a cauda da cadeia, ou seja, se nao
+ * tem nenhum servidor seguinte e as escritas que aplicou ja
+ * estao confirmadas.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \return
+ *      1 se e a cauda, 0 se nao e ou -1 em caso de erro.
+*/
+int rptable_is_tail(s_rptable_t *rptable);
+
+/**
+ * Envia um pedido de leitura a cauda da cadeia, que tem sempre
+ * a versao confirmada das chaves. Usado pelas outras replicas
+ * quando tem uma escrita em curso, ainda nao confirmada.
+ * A ligacao a cauda e aberta no primeiro pedido e partilhada
+ * pelas threads.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param msg
+ *      Pedido recebido do cliente.
+ * \return
+ *      Resposta da cauda, a libertar com message_t__free_unpacked(),
+ *      ou NULL em caso de erro.
+*/
+MessageT *rptable_tail_read(s_rptable_t *rptable, MessageT *msg);
+
+/**
+ * Indica se este servidor e a cabeca da cadeia, ou seja,
+ * se e o servidor que decide as expiracoes.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \return
+ *      1 se e a cabeca, 0 se nao e ou -1 em caso de erro.
+*/
+int rptable_is_head(s_rptable_t *rptable);
+
+/**
+ * Indica se a chave pertence a cadeia deste servidor. Sem 
+ * particoes todas as chaves pertencem a cadeia.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param key
+ *      Chave a verificar.
+ * \return
+ *      1 se pertence, 0 se pertence a outra cadeia ou -1 em
+ *      caso de erro.
+*/
+int rptable_owns(s_rptable_t *rptable, char *key);
+
+/**
+ * Retorna a geracao das cadeias, que muda sempre que uma cadeia
+ * e acrescentada ou retirada, 0 se nao ha particoes.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+*/
+unsigned int rptable_generation(s_rptable_t *rptable);
+
+/**
+ * Reencaminha o pedido, marcado como reencaminhado, para a 
+ * cabeca da cadeia dona da chave.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param key
+ *      Chave do pedido.
+ * \param msg
+ *      Pedido recebido.
+ * \return
+ *      Resposta da outra cabeca, que deve ser libertada com
+ *      message_t__free_unpacked(), ou NULL em caso de erro.
+*/
+MessageT *rptable_redirect(s_rptable_t *rptable, char *key, MessageT *msg);
+
+/**
+ * Envia as entradas para as cabecas das cadeias donas das 
+ * suas chaves com OP_MIGRATE. Ver rtable_migrate().
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param entries
+ *      Array de entradas terminada por NULL.
+ * \param expire_at
+ *      Instante de expiracao em ms de cada entrada (0 = sem expiracao).
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rptable_migrate(s_rptable_t *rptable, struct entry_t **entries, unsigned long *expire_at);
+
+/**
+ * Anuncia no ZooKeeper, em RPTABLE_ZK_MIGRATIONS_PATH, se a cadeia
+ * esta a migrar chaves, para os clientes lerem tambem as chaves 
+ * do dono anterior.
+ * \param rptable
+ *      Apontador a estrutura s_rptable_t.
+ * \param migrating
+ *      1 no inicio da migracao, 0 no fim.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int rptable_set_migrating(s_rptable_t *rptable, int migrating);
 
 /**
  * Funcao privada que faz tratamento dos eventos da ligacao
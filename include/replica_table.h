@@ -39,6 +39,8 @@ typedef void (*failure_handler)(int errcode);
 
 #define RPTABLE_ZK_DEFAULT_SOCKET "127.0.0.1:2181"
 #define RPTABLE_ZK_ROOT_PATH "/chain"
+#define RPTABLE_ZK_SHARDS_PATH "/shards"    /* uma cadeia por filho */
+#define RPTABLE_ZK_MIGRATIONS_PATH "/migrations"    /* cadeias a migrar chaves */
 #define RPTABLE_ZK_NODE_PREFIX "server"
 #define RPTABLE_ZK_DEFAULT_TIMEOUT 2000
 
@@ -0,0 +1,72 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que implementa um anel de hash consistente, usado para
+ * atribuir cada chave a uma das cadeias (particoes) do sistema.
+ *
+ * Cada cadeia ocupa RING_VNODES pontos do anel, calculados a partir
+ * do seu nome com hash_stable(), e uma chave pertence a cadeia do
+ * primeiro ponto a seguir ao hash da chave. Assim todos os processos
+ * com a mesma lista de cadeias constroem o mesmo anel, e acrescentar
+ * ou retirar uma cadeia so muda o dono de cerca de 1/n das chaves.
+ *
+ * O anel nao e alterado depois de criado, pode ser consultado por
+ * varias threads.
+*/
+
+#ifndef _RING_H
+#define _RING_H
+
+#include <stdint.h>
+
+#define RING_VNODES 64          /* pontos de cada cadeia no anel */
+
+/**
+ * Ponto do anel.
+*/
+struct ring_point_t {
+    uint64_t hash;              /* posicao no anel */
+    int node;                   /* indice da cadeia dona do ponto */
+};
+
+struct ring_t {
+    struct ring_point_t *points;    /* pontos ordenados por hash */
+    int n_points;
+    int n_nodes;                /* numero de cadeias */
+};
+
+/**
+ * Cria o anel das cadeias com os nomes dados.
+ * \param nodes
+ *      Nomes das cadeias, o indice de cada uma no array e o
+ *      valor retornado por ring_lookup().
+ * \param n_nodes
+ *      Numero de cadeias, maior que 0.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+struct ring_t *ring_create(char **nodes, int n_nodes);
+
+/**
+ * Destroi o anel.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int ring_destroy(struct ring_t *ring);
+
+/**
+ * Retorna a cadeia dona da chave.
+ * \param key
+ *      String terminada em '\0'.
+ * \return
+ *      Indice da cadeia em nodes ou -1 em caso de erro.
+*/
+int ring_lookup(struct ring_t *ring, const char *key);
+
+#endif
@@ -16,6 +16,8 @@ PROTOBUF_C__BEGIN_DECLS
 
 
 typedef struct _EntryT EntryT;
+typedef struct _SlabClassT SlabClassT;
+typedef struct _CursorT CursorT;
 typedef struct _StatsT StatsT;
 typedef struct _MessageT MessageT;
 
@@ -31,6 +33,44 @@ typedef enum _MessageT__Opcode {
   MESSAGE_T__OPCODE__OP_GETKEYS = 50,
   MESSAGE_T__OPCODE__OP_GETTABLE = 60,
   MESSAGE_T__OPCODE__OP_STATS = 70,
+  MESSAGE_T__OPCODE__OP_SCAN = 80,
+  MESSAGE_T__OPCODE__OP_MGET = 90,
+  MESSAGE_T__OPCODE__OP_MPUT = 100,
+  MESSAGE_T__OPCODE__OP_MDEL = 110,
+  MESSAGE_T__OPCODE__OP_INCR = 120,
+  MESSAGE_T__OPCODE__OP_APPEND = 130,
+  MESSAGE_T__OPCODE__OP_CAS = 140,
+  MESSAGE_T__OPCODE__OP_CPUT = 150,
+  MESSAGE_T__OPCODE__OP_CDEL = 160,
+  MESSAGE_T__OPCODE__OP_BATCH = 170,
+  /*
+   * Entradas de outra cadeia, so aplicadas se a chave nao existe 
+   */
+  MESSAGE_T__OPCODE__OP_MIGRATE = 180,
+  /*
+   * Sequencia da cabeca, propagada pela cadeia 
+   */
+  MESSAGE_T__OPCODE__OP_HEARTBEAT = 190,
+  /*
+   * Liga a ligacao as invalidacoes das chaves lidas com track_id 
+   */
+  MESSAGE_T__OPCODE__OP_TRACK = 200,
+  /*
+   * Enviada pelo servidor quando mudam chaves seguidas 
+   */
+  MESSAGE_T__OPCODE__OP_INVALIDATE = 210,
+  /*
+   * Subscreve as alteracoes de keys e prefixes nesta ligacao 
+   */
+  MESSAGE_T__OPCODE__OP_WATCH = 220,
+  /*
+   * Alteracao enviada pelo servidor a uma subscricao 
+   */
+  MESSAGE_T__OPCODE__OP_EVENT = 230,
+  /*
+   * Envia nesta ligacao as escritas aplicadas depois da sequencia version 
+   */
+  MESSAGE_T__OPCODE__OP_CHANGES = 240,
   MESSAGE_T__OPCODE__OP_ERROR = 99
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(MESSAGE_T__OPCODE)
 } MessageT__Opcode;
@@ -43,9 +83,30 @@ typedef enum _MessageT__CType {
   MESSAGE_T__C_TYPE__CT_KEYS = 50,
   MESSAGE_T__C_TYPE__CT_TABLE = 60,
   MESSAGE_T__C_TYPE__CT_STATS = 70,
-  MESSAGE_T__C_TYPE__CT_NONE = 80
+  MESSAGE_T__C_TYPE__CT_NONE = 80,
+  MESSAGE_T__C_TYPE__CT_RANGE = 90,
+  MESSAGE_T__C_TYPE__CT_CURSOR = 100,
+  /*
+   * Replica mais atrasada do que o limite da leitura, ou escritas do OP_CHANGES ja descartadas 
+   */
+  MESSAGE_T__C_TYPE__CT_STALE = 110
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(MESSAGE_T__C_TYPE)
 } MessageT__CType;
+typedef enum _MessageT__Consistency {
+  /*
+   * Versao confirmada 
+   */
+  MESSAGE_T__CONSISTENCY__READ_STRONG = 0,
+  /*
+   * Replica com no maximo max_lag ms de atraso 
+   */
+  MESSAGE_T__CONSISTENCY__READ_BOUNDED = 10,
+  /*
+   * Qualquer replica 
+   */
+  MESSAGE_T__CONSISTENCY__READ_ANY = 20
+    PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(MESSAGE_T__CONSISTENCY)
+} MessageT__Consistency;
 
 /* --- messages --- */
 
@@ -54,10 +115,64 @@ struct  _EntryT
   ProtobufCMessage base;
   char *key;
   ProtobufCBinaryData value;
+  /*
+   * Tempo de vida em ms (0 = sem expiracao) 
+   */
+  uint64_t ttl;
+  /*
+   * Instante de expiracao em ms, fixado pela cabeca 
+   */
+  uint64_t expire_at;
+  /*
+   * Versao da entrada, atribuida pela cabeca 
+   */
+  uint64_t version;
+  /*
+   * Remocao da chave num OP_BATCH 
+   */
+  protobuf_c_boolean deleted;
 };
 #define ENTRY_T__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&entry_t__descriptor) \
-    , (char *)protobuf_c_empty_string, {0,NULL} }
+    , (char *)protobuf_c_empty_string, {0,NULL}, 0, 0, 0, 0 }
+
+
+struct  _SlabClassT
+{
+  ProtobufCMessage base;
+  /*
+   * Tamanho dos objetos da classe 
+   */
+  uint32_t size;
+  /*
+   * Objetos em uso 
+   */
+  uint64_t used;
+  /*
+   * Objetos nas paginas reservadas 
+   */
+  uint64_t capacity;
+};
+#define SLAB_CLASS_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&slab_class_t__descriptor) \
+    , 0, 0, 0 }
+
+
+struct  _CursorT
+{
+  ProtobufCMessage base;
+  /*
+   * Lista onde continuar 
+   */
+  uint32_t bucket;
+  /*
+   * Primeiro hash por visitar na lista 
+   */
+  uint64_t position;
+};
+#define CURSOR_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&cursor_t__descriptor) \
+    , 0, 0 }
 
 
 struct  _StatsT
@@ -66,10 +181,33 @@ struct  _StatsT
   int32_t n_op;
   uint64_t time;
   int32_t n_clients;
+  /*
+   * Entradas removidas por falta de memoria 
+   */
+  uint64_t n_evicted;
+  /*
+   * Bytes ocupados pelas entradas da tabela 
+   */
+  uint64_t memory;
+  /*
+   * Ocupacao do alocador por classe 
+   */
+  size_t n_slabs;
+  SlabClassT **slabs;
+  /*
+   * Escritas por nivel de durabilidade 
+   */
+  size_t n_write_ops;
+  uint64_t *write_ops;
+  /*
+   * Tempo das escritas por nivel de durabilidade 
+   */
+  size_t n_write_time;
+  uint64_t *write_time;
 };
 #define STATS_T__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&stats_t__descriptor) \
-    , 0, 0, 0 }
+    , 0, 0, 0, 0, 0, 0,NULL, 0,NULL, 0,NULL }
 
 
 struct  _MessageT
@@ -90,10 +228,67 @@ struct  _MessageT
   char **keys;
   size_t n_entries;
   EntryT **entries;
+  /*
+   * Fim do intervalo do OP_SCAN (key e o inicio) 
+   */
+  char *end_key;
+  /*
+   * Maximo de entradas devolvidas, ou nos visitados com CT_CURSOR 
+   */
+  int32_t limit;
+  /*
+   * Filtro de OP_GETKEYS/OP_GETTABLE por prefixo 
+   */
+  char *prefix;
+  /*
+   * Filtro de OP_GETKEYS/OP_GETTABLE por padrao glob 
+   */
+  char *pattern;
+  /*
+   * Pagina de OP_GETKEYS/OP_GETTABLE, (0, 0) no fim 
+   */
+  CursorT *cursor;
+  /*
+   * Incremento do OP_INCR 
+   */
+  int64_t delta;
+  /*
+   * Valor esperado pelo OP_CAS 
+   */
+  ProtobufCBinaryData expected;
+  /*
+   * Versao devolvida pelo OP_GET e escritas, ou esperada por OP_CPUT/OP_CDEL, ou ultima escrita do OP_GETTABLE e antes do OP_CHANGES 
+   */
+  uint64_t version;
+  /*
+   * Pedido reencaminhado por outra cabeca, nao volta a ser reencaminhado 
+   */
+  protobuf_c_boolean forwarded;
+  /*
+   * Consistencia do OP_GET 
+   */
+  MessageT__Consistency consistency;
+  /*
+   * Atraso maximo em ms de uma leitura READ_BOUNDED 
+   */
+  uint64_t max_lag;
+  /*
+   * Servidores que aplicam uma escrita antes da resposta, 0 = todos 
+   */
+  uint32_t replicas;
+  /*
+   * Cliente a avisar quando a chave do OP_GET mudar 
+   */
+  uint64_t track_id;
+  /*
+   * Prefixos das chaves subscritas por OP_WATCH 
+   */
+  size_t n_prefixes;
+  char **prefixes;
 };
 #define MESSAGE_T__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&message_t__descriptor) \
-    , MESSAGE_T__OPCODE__OP_BAD, MESSAGE_T__C_TYPE__CT_BAD, NULL, (char *)protobuf_c_empty_string, {0,NULL}, 0, NULL, 0,NULL, 0,NULL }
+    , MESSAGE_T__OPCODE__OP_BAD, MESSAGE_T__C_TYPE__CT_BAD, NULL, (char *)protobuf_c_empty_string, {0,NULL}, 0, NULL, 0,NULL, 0,NULL, (char *)protobuf_c_empty_string, 0, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, NULL, 0, {0,NULL}, 0, 0, MESSAGE_T__CONSISTENCY__READ_STRONG, 0, 0, 0, 0,NULL }
 
 
 /* EntryT methods */
@@ -115,6 +310,44 @@ EntryT *
 void   entry_t__free_unpacked
                      (EntryT *message,
                       ProtobufCAllocator *allocator);
+/* SlabClassT methods */
+void   slab_class_t__init
+                     (SlabClassT         *message);
+size_t slab_class_t__get_packed_size
+                     (const SlabClassT   *message);
+size_t slab_class_t__pack
+                     (const SlabClassT   *message,
+                      uint8_t             *out);
+size_t slab_class_t__pack_to_buffer
+                     (const SlabClassT   *message,
+                      ProtobufCBuffer     *buffer);
+SlabClassT *
+       slab_class_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   slab_class_t__free_unpacked
+                     (SlabClassT *message,
+                      ProtobufCAllocator *allocator);
+/* CursorT methods */
+void   cursor_t__init
+                     (CursorT         *message);
+size_t cursor_t__get_packed_size
+                     (const CursorT   *message);
+size_t cursor_t__pack
+                     (const CursorT   *message,
+                      uint8_t             *out);
+size_t cursor_t__pack_to_buffer
+                     (const CursorT   *message,
+                      ProtobufCBuffer     *buffer);
+CursorT *
+       cursor_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   cursor_t__free_unpacked
+                     (CursorT *message,
+                      ProtobufCAllocator *allocator);
 /* StatsT methods */
 void   stats_t__init
                      (StatsT         *message);
@@ -158,6 +391,12 @@ void   message_t__free_unpacked
 typedef void (*EntryT_Closure)
                  (const EntryT *message,
                   void *closure_data);
+typedef void (*SlabClassT_Closure)
+                 (const SlabClassT *message,
+                  void *closure_data);
+typedef void (*CursorT_Closure)
+                 (const CursorT *message,
+                  void *closure_data);
 typedef void (*StatsT_Closure)
                  (const StatsT *message,
                   void *closure_data);
@@ -171,10 +410,13 @@ typedef void (*MessageT_Closure)
 /* --- descriptors --- */
 
 extern const ProtobufCMessageDescriptor entry_t__descriptor;
+extern const ProtobufCMessageDescriptor slab_class_t__descriptor;
+extern const ProtobufCMessageDescriptor cursor_t__descriptor;
 extern const ProtobufCMessageDescriptor stats_t__descriptor;
 extern const ProtobufCMessageDescriptor message_t__descriptor;
 extern const ProtobufCEnumDescriptor    message_t__opcode__descriptor;
 extern const ProtobufCEnumDescriptor    message_t__c_type__descriptor;
+extern const ProtobufCEnumDescriptor    message_t__consistency__descriptor;
 
 PROTOBUF_C__END_DECLS
 
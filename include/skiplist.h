@@ -0,0 +1,81 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que implementa uma skiplist de chaves, usada como
+ * índice ordenado da tabela. Cada nó guarda uma cópia da chave,
+ * reservada no alocador da tabela.
+ *
+ * A skiplist nao e thread-safe, tal como a tabela que a usa.
+*/
+
+#ifndef _SKIPLIST_H
+#define _SKIPLIST_H
+
+#include "slab.h"
+
+#define SKIPLIST_MAX_LEVEL 16   /* numero maximo de niveis */
+
+struct skip_node_t {
+    char *key;                  /* chave, guardada a seguir a next */
+    int level;                  /* numero de niveis do no */
+    struct skip_node_t *next[]; /* seguinte em cada nivel */
+};
+
+struct skiplist_t {
+    struct skip_node_t *head;   /* sentinela com todos os niveis */
+    int level;                  /* niveis em uso */
+    int size;                   /* numero de chaves */
+    long memory;                /* bytes ocupados pelos nos */
+    unsigned int seed;          /* estado do gerador dos niveis */
+    struct slab_t *slab;        /* alocador dos nos, NULL usa o malloc */
+};
+
+/**
+ * Cria uma skiplist vazia.
+ * \param slab
+ *      Alocador dos nos, NULL para usar o malloc.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+struct skiplist_t *skiplist_create(struct slab_t *slab);
+
+/**
+ * Destroi a skiplist, libertando todos os nos.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int skiplist_destroy(struct skiplist_t *list);
+
+/**
+ * Insere uma copia da chave na skiplist.
+ * \return
+ *      0 se a chave foi inserida, 1 se ja existia,
+ *      ou -1 em caso de erro.
+*/
+int skiplist_insert(struct skiplist_t *list, char *key);
+
+/**
+ * Remove a chave da skiplist.
+ * \return
+ *      0 se a chave foi removida, 1 se nao existia,
+ *      ou -1 em caso de erro.
+*/
+int skiplist_remove(struct skiplist_t *list, char *key);
+
+/**
+ * Procura o primeiro no com chave maior ou igual a key. Os nos
+ * seguintes, por ordem, obtem-se com node->next[0].
+ * \param key
+ *      Chave a procurar, NULL para obter o primeiro no.
+ * \return
+ *      O no (referencia na skiplist) ou NULL se nao existir.
+*/
+struct skip_node_t *skiplist_seek(struct skiplist_t *list, char *key);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que implementa um alocador por classes de tamanho (slab)
+ * para os objetos internos da tabela.
+ *
+ * Cada classe reserva paginas de SLAB_PAGE_SIZE bytes e divide-as
+ * em objetos do mesmo tamanho, os objetos libertados sao guardados
+ * numa lista livre da classe e reutilizados. Pedidos maiores que
+ * SLAB_MAX_SIZE sao servidos pelo malloc.
+ *
+ * O alocador nao e thread-safe, tal como a tabela que o usa.
+*/
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#define SLAB_PAGE_SIZE (64 * 1024)  /* tamanho de cada pagina */
+#define SLAB_MAX_SIZE 2048          /* maior objeto servido pelo slab */
+#define SLAB_N_CLASSES 20           /* numero de classes de tamanho */
+
+/**
+ * Classe de tamanho, com as paginas e os objetos livres.
+*/
+struct slab_class_t {
+    int size;               /* tamanho dos objetos da classe */
+    void *free_list;        /* objetos libertados */
+    void *pages;            /* paginas reservadas */
+    char *page_ptr;         /* proximo objeto por usar na ultima pagina */
+    char *page_end;         /* fim da ultima pagina */
+    long used;              /* objetos em uso */
+    long capacity;          /* objetos nas paginas reservadas */
+};
+
+/**
+ * Alocador com uma classe para cada tamanho.
+*/
+struct slab_t {
+    struct slab_class_t classes[SLAB_N_CLASSES];
+    long large;             /* objetos em uso servidos pelo malloc */
+};
+
+/**
+ * Cria um alocador sem paginas reservadas.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+struct slab_t *slab_create();
+
+/**
+ * Destroi o alocador, libertando todas as paginas. Os objetos
+ * servidos pelo malloc devem ser libertados antes com slab_free().
+ * \param slab
+ *      Alocador para ser destruido.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int slab_destroy(struct slab_t *slab);
+
+/**
+ * Reserva um objeto com pelo menos size bytes.
+ * \param slab
+ *      Alocador, se for NULL e usado o malloc.
+ * \param size
+ *      Tamanho do objeto.
+ * \return
+ *      Apontador ao objeto ou NULL em caso de erro.
+*/
+void *slab_alloc(struct slab_t *slab, int size);
+
+/**
+ * Liberta um objeto obtido com slab_alloc().
+ * \param slab
+ *      Alocador de onde veio o objeto.
+ * \param ptr
+ *      Objeto para ser libertado.
+ * \param size
+ *      Tamanho pedido quando o objeto foi reservado.
+*/
+void slab_free(struct slab_t *slab, void *ptr, int size);
+
+/**
+ * Retorna o numero de bytes realmente ocupados por um
+ * objeto de size bytes, isto e, o tamanho da sua classe.
+ * \param size
+ *      Tamanho do objeto.
+ * \return
+ *      Tamanho ocupado ou -1 em caso de erro.
+*/
+int slab_class_size(int size);
+
+/**
+ * Obtem a ocupacao de uma classe de tamanho.
+ * \param slab
+ *      Alocador.
+ * \param index
+ *      Indice da classe, entre 0 e SLAB_N_CLASSES - 1.
+ * \param size
+ *      Onde guardar o tamanho dos objetos da classe.
+ * \param used
+ *      Onde guardar o numero de objetos em uso.
+ * \param capacity
+ *      Onde guardar o numero de objetos nas paginas reservadas.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int slab_class_stats(struct slab_t *slab, int index, int *size, long *used, long *capacity);
+
+#endif
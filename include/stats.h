@@ -17,11 +17,32 @@
  * podem ser realizadas sobre ela.
 */
 
+// Niveis de durabilidade das escritas, contados em separado
+#define STATS_DURABILITY_ALL 0      /* resposta depois de toda a cadeia */
+#define STATS_DURABILITY_HEAD 1     /* resposta depois do primeiro servidor */
+#define STATS_DURABILITY_SOME 2     /* resposta depois de N servidores */
+#define STATS_DURABILITY_LEVELS 3
+
+/**
+ * Ocupacao de uma classe de tamanho do alocador da tabela.
+*/
+typedef struct slab_stats_t {
+    int size;           /* tamanho dos objetos da classe */
+    long used;          /* objetos em uso */
+    long capacity;      /* objetos nas paginas reservadas */
+} slab_stats_t;
+
 typedef struct statistics_t {
     // Dados
     int n_op;           /* n operacoes realizadas */
     long time_lasted;   /* tempo total demorou nas operacoes */
     int n_client;       /* n clientes conectados */
+    int n_evicted;      /* n entradas removidas por falta de memoria */
+    long memory;        /* bytes ocupados pelas entradas da tabela */
+    slab_stats_t *slabs;    /* ocupacao das classes do alocador */
+    int n_slabs;        /* n classes em slabs */
+    long write_ops[STATS_DURABILITY_LEVELS];    /* n escritas por durabilidade */
+    long write_time[STATS_DURABILITY_LEVELS];   /* tempo das escritas por durabilidade */
     // Controlo da concorrencia
     rwcctrl_t *cctrl;   /* controlo de concorrencia de leitura e escrita */
 } stats_t;
@@ -47,10 +68,14 @@ stats_t *stats_init();
  *      Tempo total gasto na realizacao das operacoes.
  * \param client
  *      Numero de clientes conectados.
+ * \param evicted
+ *      Numero de entradas removidas por falta de memoria.
+ * \param memory
+ *      Bytes ocupados pelas entradas da tabela.
  * \return
  *      Apontador a estrutura ou NULL em caso de erro.
 */
-stats_t *stats_init_args(int op, long time, int client);
+stats_t *stats_init_args(int op, long time, int client, int evicted, long memory);
 
 /**
  * Incrementa o numero de operacoes
@@ -99,6 +124,18 @@ int stats_inc_client(stats_t *stats);
 */
 int stats_dec_client(stats_t *stats);
 
+/**
+ * Incrementa o numero de entradas removidas
+ * por falta de memoria.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura sobre qual incrementar o numero.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_inc_evicted(stats_t *stats);
+
 /**
  * Regista o fim da execucao de uma operacao,
  * incrementando o n_op e adiciona ao time_lasted
@@ -114,6 +151,56 @@ int stats_dec_client(stats_t *stats);
 */
 int stats_op_finish(stats_t *stats, long time);
 
+/**
+ * Regista o fim de uma escrita, somando o tempo que
+ * demorou ao nivel de durabilidade pedido.
+ * \attention
+ *      Thread-safe
+ * \param stats
+ *      Estrutura sobre qual realizar a alteracao.
+ * \param level
+ *      STATS_DURABILITY_ALL, _HEAD ou _SOME.
+ * \param time
+ *      Tempo a ser adicionado.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_write_finish(stats_t *stats, int level, long time);
+
+/**
+ * Substitui o numero e o tempo das escritas de um
+ * nivel de durabilidade.
+ * \attention
+ *      Thread-safe
+ * \param stats
+ *      Estrutura sobre qual realizar a alteracao.
+ * \param level
+ *      STATS_DURABILITY_ALL, _HEAD ou _SOME.
+ * \param ops
+ *      Numero de escritas.
+ * \param time
+ *      Tempo total das escritas.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_set_write(stats_t *stats, int level, long ops, long time);
+
+/**
+ * Substitui a ocupacao das classes do alocador
+ * por uma copia das classes passadas.
+ * \attention
+ *      Thread-safe
+ * \param stats
+ *      Estrutura sobre qual realizar a alteracao.
+ * \param slabs
+ *      Array com a ocupacao de cada classe.
+ * \param n
+ *      Numero de classes na array.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_set_slabs(stats_t *stats, slab_stats_t *slabs, int n);
+
 /**
  * Duplica a estrutura e o seu conteúdo, fazendo
  * uma cópia profunda do objeto.
@@ -175,4 +262,70 @@ long stats_get_time_lasted(stats_t *stats);
 */
 int stats_get_n_client(stats_t *stats);
 
+/**
+ * Retorna o numero de entradas removidas por falta de memoria.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura stats_t.
+ * \return
+ *      Numero de entradas removidas, -1 em caso de erro.
+*/
+int stats_get_n_evicted(stats_t *stats);
+
+/**
+ * Retorna o numero de bytes ocupados pelas entradas da tabela.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura stats_t.
+ * \return
+ *      Numero de bytes, -1 em caso de erro.
+*/
+long stats_get_memory(stats_t *stats);
+
+/**
+ * Obtem o numero de classes do alocador guardadas.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura de onde obter o numero.
+ * \return 
+ *      Numero de classes ou -1 em caso de erro.
+*/
+int stats_get_n_slabs(stats_t *stats);
+
+/**
+ * Obtem a ocupacao de uma classe do alocador.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura de onde obter a ocupacao.
+ * \param index
+ *      Indice da classe, entre 0 e stats_get_n_slabs() - 1.
+ * \param slab
+ *      Onde guardar a ocupacao da classe.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_get_slab(stats_t *stats, int index, slab_stats_t *slab);
+
+/**
+ * Obtem o numero e o tempo total, em microsegundos, das
+ * escritas de um nivel de durabilidade.
+ * \attention
+ *      Thread-safe.
+ * \param stats
+ *      Estrutura de onde obter os valores.
+ * \param level
+ *      STATS_DURABILITY_ALL, _HEAD ou _SOME.
+ * \param ops
+ *      Onde guardar o numero de escritas.
+ * \param time
+ *      Onde guardar o tempo total.
+ * \return 
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int stats_get_write(stats_t *stats, int level, long *ops, long *time);
+
 #endif
\ No newline at end of file
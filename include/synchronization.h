@@ -53,6 +53,17 @@ int cctrl_destroy(rwcctrl_t *ctrl);
 */
 int read_begin(rwcctrl_t *ctrl);
 
+/**
+ * Tenta iniciar o processo de leitura sem esperar: se houver uma
+ * escrita em curso, retorna logo sem fazer lock.
+ * \param ctrl
+ *      Estrutura de controlo da concorrencia.
+ * \return 
+ *      0 se iniciou a leitura, 1 se ha uma escrita em curso
+ *      ou -1 em caso de erro.
+*/
+int read_try_begin(rwcctrl_t *ctrl);
+
 /**
  * Termina o processo de leitura, fazendo unlock nos mutexes adequados.
  * \param rwmutex
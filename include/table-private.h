@@ -2,14 +2,96 @@
 #define _TABLE_PRIVATE_H
 
 #include "list.h"
+#include "slab.h"
+#include "skiplist.h"
+
+#include <stdint.h>
 
 struct table_t {
 	struct list_t **lists;
+	struct slab_t *slab;	/* alocador partilhado pelas listas */
+	struct skiplist_t *index;	/* índice ordenado das chaves, opcional */
 	int size;
+	long memory;		/* bytes ocupados pelas entradas */
+	int clock_hand;		/* lista onde se encontra o ponteiro do CLOCK */
 };
 
 /* Função que calcula o índice da lista a partir da chave
  */
 int hash_code(char *key, int n);
 
+/* Função igual a table_put(), que guarda também a versão da entrada,
+ * atribuída pela cabeça da cadeia (table_put() guarda a versão 0).
+ * Retorna 0 (ok) ou -1 em caso de erro.
+ */
+int table_put_version(struct table_t *table, char *key, struct data_t *value,
+                      uint64_t version);
+
+/* Função que retorna a versão de uma entry obtida com table_lookup().
+ */
+uint64_t table_entry_version(struct entry_t *entry);
+
+/* Função igual a table_get(), mas que retorna a entry guardada na
+ * tabela em vez de uma cópia dos dados. A referência só é válida
+ * enquanto a tabela não for alterada.
+ * Retorna a entry ou NULL se a chave não existir ou em caso de erro.
+ */
+struct entry_t *table_lookup(struct table_t *table, char *key);
+
+/* Função que retorna a memória ocupada pelas entradas da tabela,
+ * incluindo chaves, valores e as estruturas de cada nó.
+ * Retorna o número de bytes ou -1 em caso de erro.
+ */
+long table_memory(struct table_t *table);
+
+/* Função que escolhe, segundo o algoritmo CLOCK, a entrada a ser
+ * removida para libertar memória. As entradas acedidas desde a última
+ * passagem do ponteiro têm uma segunda oportunidade.
+ * Retorna uma *CÓPIA* da chave escolhida ou NULL se a tabela estiver
+ * vazia ou em caso de erro.
+ */
+char *table_evict_key(struct table_t *table);
+
+/* Função que cria o índice ordenado das chaves da tabela, com as
+ * chaves já existentes. A partir daí o índice é mantido por
+ * table_put() e table_remove() e a sua memória faz parte de
+ * table_memory().
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_index_enable(struct table_t *table);
+
+/* Função que obtém, por ordem, as chaves entre start e end (inclusive).
+ * Um start ou end a NULL deixa o intervalo aberto desse lado e um
+ * limit maior que 0 limita o número de chaves devolvidas.
+ * Requer o índice ordenado (table_index_enable()).
+ * Retorna um array de char* com a cópia das chaves, terminado por NULL,
+ * ou NULL em caso de erro. Libertar com table_free_keys().
+ */
+char **table_scan(struct table_t *table, char *start, char *end, int limit);
+
+/* Função que obtém as chaves da tabela que começam por prefix e
+ * correspondem ao padrão glob pattern (ver fnmatch(3)). Um prefix ou
+ * pattern a NULL não filtra. Apenas as chaves que passam o filtro são
+ * copiadas. Com o índice ordenado e um prefixo, só é percorrido o
+ * intervalo do prefixo e as chaves são devolvidas por ordem.
+ * Retorna um array de char* com a cópia das chaves, terminado por NULL,
+ * ou NULL em caso de erro. Libertar com table_free_keys().
+ */
+char **table_match_keys(struct table_t *table, char *prefix, char *pattern);
+
+/* Função que obtém uma página de chaves a partir do cursor (bucket,
+ * position): a lista onde continuar e o primeiro hash ainda não
+ * visitado dessa lista. O cursor (0, 0) começa a iteração e, no fim de
+ * cada página, é atualizado para a seguinte, voltando a (0, 0) quando
+ * a tabela foi toda percorrida. Cada página visita cerca de count nós
+ * (mais se houver nós com o mesmo hash) e devolve os que passam o
+ * filtro de table_match_keys(), podendo ficar vazia.
+ * Como as listas estão ordenadas pelo hash, as chaves presentes durante
+ * toda a iteração são devolvidas pelo menos uma vez.
+ * Retorna um array de char* com a cópia das chaves, terminado por NULL,
+ * ou NULL em caso de erro. Libertar com table_free_keys().
+ */
+char **table_iterate(struct table_t *table, int *bucket, uint64_t *position,
+                     int count, char *prefix, char *pattern);
+
 #endif
\ No newline at end of file
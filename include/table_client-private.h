@@ -19,37 +19,103 @@
 // ==================================================================
 #define CLIENT_SHELL "\033[1;32mtable_client:~/\033[0m$ \033[?12;25h"
 
+// Numero maximo de chaves de mget/mdel, limitado pelo tamanho da linha
+#define CLIENT_MAX_KEYS 50
+
+// Numero de chaves percorridas no servidor por cada pagina de getkeys/gettable
+#define CLIENT_PAGE_SIZE 256
+
 // ==================================================================
 //                     Mensagens Auxiliares
 // ==================================================================
 #define AUX_HELP    "\033[0;33m[?] Help:\033[0m\n"\
                     "   `\033[4;93mp\033[0mut` <key> <value>     - Puts the key and value to the table\n"\
+                    "   `pute\033[4;93mx\033[0m` <key> <ttl> <value> - Puts the key and value, expiring after <ttl> ms\n"\
                     "   `\033[4;93mg\033[0met` <key>             - Retrieves the value associated with the key\n"\
+                    "   `getstale` <key> [<max lag>] - Retrieves the value from any replica, at most <max lag> ms stale\n"\
                     "   `\033[4;93md\033[0mel` <key>             - Deletes the value associated with the key\n"\
                     "   `\033[4;93ms\033[0mize`                  - Gets the number of elements in the table\n"\
                     "   `st\033[4;93ma\033[0mts`                 - Gets the statistics of the server\n"\
-                    "   `get\033[4;93mk\033[0meys`               - Retrieves all the keys contained in the table\n"\
-                    "   `get\033[4;93mt\033[0mable`              - Retrieves all the keys and values in the table\n"\
+                    "   `get\033[4;93mk\033[0meys` [<filter>]    - Retrieves the keys contained in the table\n"\
+                    "   `get\033[4;93mt\033[0mable` [<filter>]   - Retrieves the keys and values in the table\n"\
+                    "                              <filter> is a key prefix or a glob pattern (*, ?, [...])\n"\
+                    "   `sca\033[4;93mn\033[0m` <start> <end> [<limit>] - Retrieves the entries with keys from <start> to <end>, in order\n"\
+                    "   `incr`/`decr` <key> [<delta>] - Adds/subtracts <delta> (default 1) to the integer in the key\n"\
+                    "   `cput` <key> <version> <value> - Puts the value only if the key is at <version> (0 = absent)\n"\
+                    "   `cdel` <key> <version>     - Deletes the key only if it is at <version>\n"\
+                    "   `append` <key> <value>     - Appends the value to the one in the key\n"\
+                    "   `cas` <key> <expected> <value> - Replaces the value only if it is equal to <expected>\n"\
+                    "   `mget` <key> [<key> ...]   - Retrieves the values of several keys in one request\n"\
+                    "   `mdel` <key> [<key> ...]   - Deletes several keys in one request\n"\
+                    "   `durability` <replicas>    - Acknowledges writes after <replicas> servers (0 = whole chain)\n"\
+                    "   `pool` [<size>]            - Shows or sets the number of connections to each server\n"\
+                    "   `cache` [<entries>]        - Shows the local cache or sets its size (0 = disabled)\n"\
+                    "   `watch` <key> [<key> ...]  - Prints the changes of the keys (prefix* for a prefix)\n"\
+                    "   `unwatch`                  - Stops printing changes\n"\
+                    "   `follow` [<seq> [<chain>]] - Prints every write applied after <seq>, in order\n"\
+                    "   `unfollow`                 - Stops printing applied writes\n"\
                     "   `\033[4;93mq\033[0muit`                  - Closes the connection with the table and quits\n"\
                     "   `\033[4;93mh\033[0melp`                  - Shows all available commands and their usage\n"
                     // "   \033[4m \033[24m"
 
 #define AUX_GET "\033[0;33m[i] Info:\033[0m Key: %s\n"\
                 "   Value: %s\n"\
-                "   Length: %d\n"
+                "   Length: %d\n"\
+                "   Version: %lu\n"
                 
 #define AUX_SIZE "\033[0;33m[i] Info:\033[0m The table has %d entries.\n"
 
 #define AUX_STATS   "\033[0;33m[i] Info:\033[0m Stats:\n"\
                     "   Completed operations: %d\n"\
                     "   Total time used: %ld µsec\n"\
-                    "   Connected users: %d\n"
+                    "   Connected users: %d\n"\
+                    "   Evicted entries: %d\n"\
+                    "   Memory used: %ld bytes\n"
+#define AUX_STATS_SLABS "   Allocator size classes:\n"
+#define AUX_STATS_SLAB  "     %5d bytes: %ld/%ld used\n"
+#define AUX_STATS_WRITES "   Writes by durability:\n"
+#define AUX_STATS_WRITE "     %-6s %ld writes, %ld µsec average\n"
+
+#define AUX_POOL    "\033[0;33m[i] Info:\033[0m Connection pool:\n"\
+                    "   Connections per server: %d\n"\
+                    "   Open connections: %d (%d idle)\n"\
+                    "   Checkouts: %ld (%ld waited)\n"
+
+#define AUX_CACHE   "\033[0;33m[i] Info:\033[0m Local cache:\n"\
+                    "   Entries: %d/%d\n"\
+                    "   Hits: %ld, misses: %ld\n"\
+                    "   Invalidations: %ld, evictions: %ld\n"
+#define AUX_EVENT_PUT "\033[0;33m[i] Event:\033[0m %s = %.*s (version %lu)\n"
+#define AUX_EVENT_DEL "\033[0;33m[i] Event:\033[0m %s deleted\n"
+#define AUX_EVENT_DROPPED "\033[0;33m[i] Event:\033[0m %ld changes were dropped by the server\n"
+#define AUX_EVENT_CLOSED "\033[0;33m[i] Event:\033[0m The watch connection was closed\n"
+#define AUX_CHANGE_PUT "\033[0;33m[i] Change %lu:\033[0m %s = %.*s\n"
+#define AUX_CHANGE_DEL "\033[0;33m[i] Change %lu:\033[0m %s deleted\n"
+#define AUX_CHANGE_LOST "\033[0;33m[i] Change:\033[0m The server no longer has those writes, follow from %lu or later\n"
+#define AUX_CHANGE_CLOSED "\033[0;33m[i] Change:\033[0m The follow connection was closed\n"
+
+#define AUX_CACHE_OFF "\033[0;33m[i] Info:\033[0m The local cache is disabled.\n"
 
 #define AUX_GETKEYS "\033[0;33m[i] Info:\033[0m Keys:\n"
 #define AUX_GETKEYS_LINE "  %s\n"
 
 #define AUX_GETTABLE "\033[0;33m[i] Info:\033[0m Table:\n"
 #define AUX_GETTABLE_LINE   "   %s::%s\n"
+
+#define AUX_SCAN "\033[0;33m[i] Info:\033[0m Entries from %s to %s:\n"
+
+#define AUX_MDEL "\033[0;33m[i] Info:\033[0m %d of %d keys deleted.\n"
+
+#define AUX_INCR "\033[0;33m[i] Info:\033[0m %s = %ld\n"
+
+#define AUX_APPEND "\033[0;33m[i] Info:\033[0m The value of %s has %d bytes.\n"
+
+#define AUX_CAS_SWAPPED "\033[0;33m[i] Info:\033[0m The value of %s was replaced.\n"
+#define AUX_CPUT_WRITTEN "\033[0;33m[i] Info:\033[0m %s written, now at version %lu.\n"
+#define AUX_CDEL_REMOVED "\033[0;33m[i] Info:\033[0m %s removed at version %lu.\n"
+#define AUX_VERSION_MISMATCH "\033[0;33m[i] Info:\033[0m %s is at version %lu, nothing was changed.\n"
+
+#define AUX_CAS_FAILED  "\033[0;33m[i] Info:\033[0m The value of %s is not the expected one, nothing was changed.\n"
 // ==================================================================
 //                        Mensagens Erro
 // ==================================================================
@@ -62,6 +128,8 @@
 
 #define ERROR_MISSING_ARGS  "\033[0;31m[!] Error:\033[0m Missing %s while calling %s.\n"
 
+#define ERROR_TTL "\033[0;31m[!] Error:\033[0m The <ttl> should be a positive number of milliseconds.\n"
+
 #define ERROR_GET "\033[0;31m[!] Error:\033[0m Failed to retrieve the value or nothing associated with the key.\n"
 
 #define ERROR_DEL "\033[0;31m[!] Error:\033[0m Failed to delete the value associated with the key.\n"
@@ -73,6 +141,40 @@
 #define ERROR_GETKEYS "\033[0;31m[!] Error:\033[0m Failed to retrieve keys.\n"
 
 #define ERROR_GETTABLE  "\033[0;31m[!] Error:\033[0m Failed to retrieve table.\n"
+
+#define ERROR_LIMIT "\033[0;31m[!] Error:\033[0m The <limit> should be a positive number of entries.\n"
+
+#define ERROR_SCAN  "\033[0;31m[!] Error:\033[0m Failed to retrieve the entries in the range.\n"
+
+#define ERROR_MGET  "\033[0;31m[!] Error:\033[0m Failed to retrieve the values of the keys.\n"
+
+#define ERROR_MDEL  "\033[0;31m[!] Error:\033[0m Failed to delete the keys.\n"
+
+#define ERROR_DELTA "\033[0;31m[!] Error:\033[0m The <delta> should be an integer.\n"
+
+#define ERROR_INCR  "\033[0;31m[!] Error:\033[0m Failed to update the counter, the value may not be an integer.\n"
+
+#define ERROR_APPEND "\033[0;31m[!] Error:\033[0m Failed to append to the value.\n"
+
+#define ERROR_VERSION "\033[0;31m[!] Error:\033[0m The <version> should be a non-negative integer (positive for cdel).\n"
+
+#define ERROR_CPUT  "\033[0;31m[!] Error:\033[0m Failed to conditionally put the value.\n"
+
+#define ERROR_CDEL  "\033[0;31m[!] Error:\033[0m Failed to conditionally delete the key.\n"
+
+#define ERROR_CAS   "\033[0;31m[!] Error:\033[0m Failed to compare and swap the value.\n"
+
+#define ERROR_MAX_LAG "\033[0;31m[!] Error:\033[0m The <max lag> should be a non-negative number of milliseconds.\n"
+
+#define ERROR_DURABILITY "\033[0;31m[!] Error:\033[0m The <replicas> should be a non-negative integer.\n"
+
+#define ERROR_POOL_SIZE "\033[0;31m[!] Error:\033[0m The <size> should be a positive integer.\n"
+
+#define ERROR_WATCH "\033[0;31m[!] Error:\033[0m Failed to watch the keys.\n"
+
+#define ERROR_FOLLOW "\033[0;31m[!] Error:\033[0m The <seq> and <chain> should be non-negative integers and <chain> an existing chain.\n"
+
+#define ERROR_CACHE_SIZE "\033[0;31m[!] Error:\033[0m The <entries> should be a non-negative integer.\n"
 // ==================================================================
 //                      Mensagens Sucesso
 // ==================================================================
@@ -105,6 +207,22 @@ void inthandler();
 */
 int put(c_rptable_t *rtable, char *key, char* value);
 
+/**
+ * Coloca uma nova entrada com tempo de vida ou substitui
+ * a ja existente na tabela.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param ttl
+ *      Tempo de vida em milissegundos (0 = sem expiracao).
+ * \param value
+ *      Apontador para o valor a ser colocado.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int putex(c_rptable_t *rtable, char *key, unsigned long ttl, char* value);
 
 
 /**
@@ -119,6 +237,24 @@ int put(c_rptable_t *rtable, char *key, char* value);
 */
 int get(c_rptable_t *rtable, char *key);
 
+/**
+ * Pede a uma replica qualquer o valor associado a uma chave, com a
+ * consistencia dada.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param consistency
+ *      RTABLE_READ_STRONG, RTABLE_READ_BOUNDED ou RTABLE_READ_ANY.
+ * \param max_lag
+ *      Atraso maximo em ms de uma leitura RTABLE_READ_BOUNDED.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int get_consistency(c_rptable_t *rtable, char *key, enum rtable_consistency consistency,
+                    unsigned long max_lag);
+
 
 /**
  * Apaga uma entrada da tabela
@@ -153,23 +289,176 @@ int size(c_rptable_t *rtable);
 int stats(c_rptable_t *rtable);
 
 /**
- * Imprime todas as chaves contidas na tabela.
+ * Separa o filtro das chaves num prefixo ou, se tiver os
+ * caracteres especiais *, ? ou [, num padrao glob.
+ * \param filter
+ *      Filtro escrito pelo utilizador, pode ser NULL.
+ * \param prefix
+ *      Onde guardar o prefixo ou NULL.
+ * \param pattern
+ *      Onde guardar o padrao ou NULL.
+*/
+void split_filter(char *filter, char **prefix, char **pattern);
+
+/**
+ * Imprime as chaves contidas na tabela.
  * \param rtable
  *      Estrutura rtable_t que contem informacao da conexao.
+ * \param filter
+ *      Prefixo ou padrao glob das chaves, NULL para todas.
  * \return
  *      0 se a operacao foi concluida com sucesso, -1
  *      caso contrario.
 */  
-int getkeys(c_rptable_t *rtable);
+int getkeys(c_rptable_t *rtable, char *filter);
+
+/**
+ * Imprime as entradas da tabela.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param filter
+ *      Prefixo ou padrao glob das chaves, NULL para todas.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int gettable(c_rptable_t *rtable, char *filter);
+
+/**
+ * Imprime, por ordem das chaves, as entradas entre
+ * start e end (inclusive).
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param start
+ *      Primeira chave do intervalo.
+ * \param end
+ *      Ultima chave do intervalo.
+ * \param limit
+ *      Numero maximo de entradas, 0 para nao limitar.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int scan(c_rptable_t *rtable, char *start, char *end, int limit);
+
+/**
+ * Imprime, com um so pedido, as entradas das chaves que existem.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param keys
+ *      Array de chaves.
+ * \param n_keys
+ *      Numero de chaves.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int mget(c_rptable_t *rtable, char **keys, int n_keys);
+
+/**
+ * Apaga, com um so pedido, as chaves dadas.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param keys
+ *      Array de chaves terminada por NULL.
+ * \param n_keys
+ *      Numero de chaves.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int mdel(c_rptable_t *rtable, char **keys, int n_keys);
+
+/**
+ * Soma delta ao contador guardado na chave e imprime o resultado.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param delta
+ *      Valor a somar, negativo para subtrair.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int incr(c_rptable_t *rtable, char *key, long delta);
+
+/**
+ * Acrescenta um valor ao fim do valor guardado na chave.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param value
+ *      Apontador para o valor a acrescentar.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int append(c_rptable_t *rtable, char *key, char *value);
+
+/**
+ * Substitui o valor da chave apenas se for igual ao esperado.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param expected
+ *      Apontador para o valor esperado.
+ * \param value
+ *      Apontador para o novo valor.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int cas(c_rptable_t *rtable, char *key, char *expected, char *value);
+
+/**
+ * Coloca o valor na chave apenas se a versao guardada for a esperada.
+ * \param rtable
+ *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param expected
+ *      Versao esperada, 0 para exigir que a chave nao exista.
+ * \param value
+ *      Apontador para o valor.
+ * \return
+ *      0 se a operacao foi concluida com sucesso, -1
+ *      caso contrario.
+*/
+int cput(c_rptable_t *rtable, char *key, unsigned long expected, char *value);
 
 /**
- * Imprime todas as entradas da tabela.
+ * Apaga a chave apenas se a versao guardada for a esperada.
  * \param rtable
  *      Estrutura rtable_t que contem informacao da conexao.
+ * \param key
+ *      Apontador para a chave.
+ * \param expected
+ *      Versao esperada.
  * \return
  *      0 se a operacao foi concluida com sucesso, -1
  *      caso contrario.
 */
-int gettable(c_rptable_t *rtable);
+int cdel(c_rptable_t *rtable, char *key, unsigned long expected);
+
+/**
+ * Imprime um evento da subscricao, na thread que recebe os eventos.
+ * \param event
+ *      Evento recebido.
+ * \param arg
+ *      Nao usado.
+*/
+void print_event(struct rtable_event_t *event, void *arg);
+
+/**
+ * Imprime uma escrita aplicada, na thread que recebe as escritas.
+ * \param change
+ *      Escrita recebida.
+ * \param arg
+ *      Nao usado.
+*/
+void print_change(struct rtable_change_t *change, void *arg);
 
 #endif
\ No newline at end of file
@@ -1,12 +1,55 @@
 #ifndef _TABLE_SKEL_PRIVATE_H
 #define _TABLE_SKEL_PRIVATE_H
 
+#include "data.h"
+
+#include <stdint.h>
+
 // ==================================================================
 //                     Mensagens Auxiliares
 // ==================================================================
 
 #define AUX_INVOKE_GET "%s - %s: \n"
 
+// ==================================================================
+//                          Expiracao
+// ==================================================================
+
+#define EXPIRY_TICK_MS 100      /* periodo da recolha ativa em ms */
+#define EXPIRY_MAX_KEYS 64      /* maximo de chaves recolhidas por tick */
+
+#define MIGRATE_TICK_MS 500     /* periodo da verificacao das cadeias em ms */
+#define MIGRATE_PAGE 64         /* chaves visitadas por pagina da migracao */
+#define MIGRATE_BYTES_PER_SEC (4 * 1024 * 1024)   /* largura de banda da migracao */
+
+#define SYNC_TOMBSTONE_LISTS 64   /* listas das remocoes recebidas durante a copia */
+
+// ==================================================================
+//                    Leituras com atraso limitado
+// ==================================================================
+
+#define HEARTBEAT_MS 500        /* periodo da sequencia enviada pela cabeca em ms */
+
+// ==================================================================
+//                          Contadores
+// ==================================================================
+
+#define COUNTER_MAX_DIGITS 20   /* digitos e sinal de um inteiro de 64 bits */
+
+// ==================================================================
+//                       Lotes de escritas
+// ==================================================================
+
+/* Estado de uma chave antes de uma operacao de um OP_BATCH, usado
+ * para desfazer o lote se uma operacao falhar.
+ */
+struct batch_undo_t {
+    char *key;
+    struct data_t *data;    /* copia do valor, NULL se a chave nao existia */
+    long expire_at;         /* 0 = sem expiracao */
+    uint64_t version;
+};
+
 // Metodos thread-safe para imprimir
 
 /**
@@ -20,6 +20,89 @@ struct table_t *table_skel_init(int n_lists);
  */
 int table_skel_destroy(struct table_t *table);
 
+/* Inicia a thread que remove periodicamente as entradas expiradas
+ * da tabela. Apenas a cabeca da cadeia remove entradas, propagando
+ * as remocoes pela tabela replicada rptable.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_expiry_start(struct table_t *table, s_rptable_t *rptable);
+
+/* Numa instalação particionada, inicia a thread que, na cabeça da
+ * cadeia, envia às cadeias donas as chaves que o anel deixou de
+ * atribuir a esta cadeia, sempre que a lista de cadeias muda.
+ * Sem partições não faz nada.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_migration_start(struct table_t *table, s_rptable_t *rptable);
+
+/* Define o limite, em bytes, da memória ocupada pelas entradas da
+ * tabela (chaves, valores e estruturas dos nós). Quando uma escrita
+ * ultrapassa o limite, a cabeça da cadeia remove entradas pouco
+ * usadas e propaga as remoções. O valor 0 significa sem limite.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_set_maxmemory(long bytes);
+
+/* Marca o início da cópia inicial da tabela do servidor anterior.
+ * Durante a cópia, as escritas vindas da cadeia são aplicadas e as
+ * versões das remoções ficam registadas, e os pedidos dos clientes
+ * esperam pelo fim da cópia.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_sync_begin();
+
+/* Coloca na tabela uma entrada copiada do servidor anterior, com a
+ * versão e o instante de expiração (0 = sem expiração), se a cadeia
+ * ainda não trouxe uma escrita ou remoção da chave com versão igual
+ * ou maior.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_sync_entry(struct table_t *table, char *key, struct data_t *value,
+                          uint64_t version, unsigned long expire_at);
+
+/* Marca o fim da cópia inicial da tabela e deixa seguir os pedidos
+ * dos clientes que esperavam.
+ */
+void table_skel_sync_end();
+
+/* Durante a cópia inicial da tabela, bloqueia até ao fim da cópia
+ * os pedidos que não vêm do servidor anterior da cadeia.
+ */
+void table_skel_sync_wait(MessageT *msg);
+
+/* Regista a versao de uma entrada recebida na sincronizacao com a
+ * cadeia, para que as versoes atribuidas por este servidor, se passar
+ * a ser a cabeca, continuem a ser maiores que as ja existentes.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_set_version(unsigned long version);
+
+/* Atende um OP_TRACK recebido na ligação sockfd: regista a ligação
+ * como a que recebe as invalidações das chaves que o cliente tem em
+ * cache, responde e envia as invalidações até a ligação fechar. Deve
+ * ser chamada pela thread da ligação, que não recebe outros pedidos
+ * depois.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_track(int sockfd, MessageT *msg);
+
+/* Atende um OP_WATCH recebido na ligação sockfd: regista a
+ * subscrição das chaves e dos prefixos pedidos, responde e envia
+ * os eventos das alterações até a ligação fechar. Deve ser chamada
+ * pela thread da ligação, que não recebe outros pedidos depois.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_watch(int sockfd, MessageT *msg);
+
+/* Atende um OP_CHANGES recebido na ligação sockfd: responde e envia
+ * por ordem as escritas aplicadas com versão maior que a do pedido,
+ * e as seguintes à medida que são aplicadas, até a ligação fechar.
+ * Deve ser chamada pela thread da ligação, que não recebe outros
+ * pedidos depois.
+ * Retorna 0 (OK) ou -1 em caso de erro.
+ */
+int table_skel_changes(int sockfd, MessageT *msg);
+
 /* Executa nas tabelas table e rptable a operação indicada pelo opcode  
  * contido em msg e utiliza a mesma estrutura MessageT para devolver o 
  * resultado.
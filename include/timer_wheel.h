@@ -0,0 +1,137 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que implementa uma roda de temporizadores hierarquica
+ * usada para a expiracao das chaves com tempo de vida (TTL).
+ *
+ * Cada chave com TTL tem um temporizador, guardado numa das
+ * ranhuras da roda consoante a distancia ao instante atual, e
+ * num indice por chave que permite verificar ou cancelar a
+ * expiracao de uma chave em O(1).
+ *
+ * A roda nao e thread-safe, o acesso deve ser protegido pelo
+ * mesmo controlo de concorrencia que protege a tabela.
+*/
+
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#define WHEEL_LEVELS 4                      /* numero de niveis da roda */
+#define WHEEL_BITS 6                        /* bits do indice de cada nivel */
+#define WHEEL_SLOTS (1 << WHEEL_BITS)       /* ranhuras por nivel */
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+
+/**
+ * Temporizador associado a uma chave.
+*/
+struct wheel_timer_t {
+    char *key;                      /* chave que vai expirar */
+    long expire_at;                 /* instante de expiracao em ms */
+    long tick;                      /* tick em que o temporizador dispara */
+    struct wheel_timer_t *next;     /* seguinte na ranhura */
+    struct wheel_timer_t **pprev;   /* apontador que aponta para este */
+    struct wheel_timer_t *hnext;    /* seguinte no indice por chave */
+};
+
+/**
+ * Roda de temporizadores hierarquica, com WHEEL_LEVELS niveis de
+ * WHEEL_SLOTS ranhuras, o nivel n cobre WHEEL_SLOTS^(n+1) ticks.
+*/
+typedef struct timer_wheel_t {
+    long tick_ms;                   /* duracao de um tick em ms */
+    long current;                   /* tick atual */
+    struct wheel_timer_t *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    struct wheel_timer_t *due;      /* temporizadores vencidos por recolher */
+    struct wheel_timer_t **index;   /* indice por chave */
+    int index_size;                 /* numero de listas do indice */
+    int count;                      /* numero de temporizadores */
+} timer_wheel_t;
+
+/**
+ * Cria uma roda de temporizadores vazia.
+ * \param tick_ms
+ *      Duracao de um tick em milissegundos.
+ * \param now
+ *      Instante atual em milissegundos.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+timer_wheel_t *wheel_init(long tick_ms, long now);
+
+/**
+ * Destroi a roda, libertando todos os temporizadores.
+ * \param wheel
+ *      Roda para ser destruida.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int wheel_destroy(timer_wheel_t *wheel);
+
+/**
+ * Define o instante de expiracao de uma chave, substituindo
+ * o anterior caso a chave ja tenha um temporizador.
+ * \param wheel
+ *      Roda de temporizadores.
+ * \param key
+ *      Chave (e feita uma copia).
+ * \param expire_at
+ *      Instante de expiracao em milissegundos.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int wheel_set(timer_wheel_t *wheel, char *key, long expire_at);
+
+/**
+ * Remove o temporizador de uma chave.
+ * \param wheel
+ *      Roda de temporizadores.
+ * \param key
+ *      Chave cujo temporizador deve ser removido.
+ * \return
+ *      0 se removeu, 1 se a chave nao tinha temporizador
+ *      ou -1 em caso de erro.
+*/
+int wheel_cancel(timer_wheel_t *wheel, char *key);
+
+/**
+ * Retorna o instante de expiracao de uma chave.
+ * \param wheel
+ *      Roda de temporizadores.
+ * \param key
+ *      Chave a procurar.
+ * \return
+ *      Instante de expiracao em ms, 0 se a chave nao
+ *      tem temporizador ou -1 em caso de erro.
+*/
+long wheel_get(timer_wheel_t *wheel, char *key);
+
+/**
+ * Avanca a roda ate ao instante now e recolhe no maximo max
+ * chaves expiradas, removendo os seus temporizadores. As chaves
+ * vencidas que nao foram recolhidas ficam para a proxima chamada.
+ * \param wheel
+ *      Roda de temporizadores.
+ * \param now
+ *      Instante atual em milissegundos.
+ * \param max
+ *      Numero maximo de chaves a recolher.
+ * \return
+ *      Array de chaves terminado por NULL, que deve ser libertado
+ *      com wheel_free_keys(), ou NULL em caso de erro.
+*/
+char **wheel_advance(timer_wheel_t *wheel, long now, int max);
+
+/**
+ * Liberta a memoria do array obtido por wheel_advance().
+ * \param keys
+ *      Array de chaves.
+*/
+void wheel_free_keys(char **keys);
+
+#endif
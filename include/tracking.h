@@ -0,0 +1,130 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que guarda, no servidor, as chaves que cada cliente tem
+ * na sua cache local, para o avisar quando mudam.
+ *
+ * Um cliente liga uma ligacao propria as invalidacoes com OP_TRACK
+ * e um identificador escolhido por ele, e envia o mesmo
+ * identificador nos OP_GET das chaves que guarda. Quando uma dessas
+ * chaves muda, o servidor coloca-a na fila do cliente e esquece a
+ * chave, que so volta a ser seguida na proxima leitura. A thread da
+ * ligacao envia a fila num OP_INVALIDATE, por isso um cliente lento
+ * nao atrasa as escritas. Se a fila enche, as chaves na fila sao
+ * trocadas por um OP_INVALIDATE sem chaves, que pede ao cliente
+ * para esquecer toda a cache.
+ *
+ * O numero de chaves seguidas e limitado: quando o limite e
+ * ultrapassado, uma chave e invalidada nos clientes para dar lugar
+ * a nova. A estrutura e thread-safe.
+*/
+
+#ifndef _TRACKING_H
+#define _TRACKING_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define TRACKING_BUCKETS 4096       /* listas do indice por chave */
+#define TRACKING_MAX_KEYS 65536     /* chaves seguidas por omissao */
+#define TRACKING_QUEUE 1024         /* chaves na fila de um cliente */
+#define TRACKING_BATCH_BYTES 32768  /* bytes das chaves de um OP_INVALIDATE */
+#define TRACKING_IDLE_MS 1000       /* periodo da verificacao da ligacao sem avisos */
+
+/**
+ * Ligacao de um cliente as invalidacoes.
+*/
+struct tracking_client_t {
+    uint64_t id;                    /* identificador escolhido pelo cliente */
+    int sockfd;
+    char **queued;                  /* chaves por enviar, copiadas */
+    int n_queued;
+    int flush;                      /* 1 se a fila encheu e o cliente deve esquecer tudo */
+    int closed;                     /* 1 quando substituido ou o servidor termina */
+    pthread_cond_t changed;
+    struct tracking_client_t *next;
+};
+
+/**
+ * Chave seguida e os clientes que a tem na cache.
+*/
+struct tracking_key_t {
+    char *key;
+    uint64_t *ids;
+    int n_ids;
+    int capacity;
+    struct tracking_key_t *next;    /* seguinte na lista do indice */
+};
+
+struct tracking_t {
+    pthread_mutex_t lock;
+    struct tracking_client_t *clients;
+    struct tracking_key_t **buckets;    /* indice por hash da chave */
+    long n_keys;
+    long max_keys;
+    int evict_bucket;               /* proxima lista onde procurar uma chave a invalidar */
+};
+
+/**
+ * Cria a estrutura sem clientes.
+ * \param max_keys
+ *      Numero maximo de chaves seguidas, maior que 0.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+struct tracking_t *tracking_create(long max_keys);
+
+/**
+ * Termina as ligacoes dos clientes e esquece as chaves seguidas. A
+ * estrutura nao e libertada, porque as threads das ligacoes ainda a
+ * usam ate acordarem.
+*/
+void tracking_destroy(struct tracking_t *tracking);
+
+/**
+ * Regista a ligacao onde o cliente id recebe as invalidacoes,
+ * terminando a anterior se ja estava registado.
+ * \return
+ *      O cliente ou NULL em caso de erro.
+*/
+struct tracking_client_t *tracking_subscribe(struct tracking_t *tracking, uint64_t id, int sockfd);
+
+/**
+ * Envia as invalidacoes da fila do cliente pela sua ligacao ate a
+ * ligacao fechar, o cliente ser substituido ou o servidor terminar,
+ * e remove o cliente. As chaves que seguia sao esquecidas quando
+ * mudarem. Deve ser chamada pela thread da ligacao.
+ * \return
+ *      0 (OK) ou -1 se o cliente ja nao estava registado.
+*/
+int tracking_serve(struct tracking_t *tracking, struct tracking_client_t *client);
+
+/**
+ * Segue a chave para o cliente id. Deve ser chamada antes de ler o
+ * valor que o cliente vai guardar, para nenhuma escrita ficar por
+ * avisar.
+ * \return
+ *      0 (OK) ou -1 se o cliente nao esta registado ou em caso de
+ *      erro, caso em que o cliente nao deve guardar o valor.
+*/
+int tracking_track(struct tracking_t *tracking, const char *key, uint64_t id);
+
+/**
+ * Coloca as chaves na fila de cada cliente que as segue e deixa de
+ * as seguir. Nao espera pelo envio.
+ * \param keys
+ *      Chaves que mudaram.
+ * \param n_keys
+ *      Numero de chaves.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int tracking_invalidate(struct tracking_t *tracking, char **keys, int n_keys);
+
+#endif
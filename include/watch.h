@@ -0,0 +1,132 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Módulo que guarda, no servidor, as subscricoes das alteracoes de
+ * chaves e prefixos e as envia aos clientes.
+ *
+ * Uma ligacao que envia OP_WATCH fica reservada aos eventos: a sua
+ * thread passa a esperar pelos eventos da subscricao e a envia-los,
+ * para que uma escrita nunca espere por um cliente lento. Cada
+ * subscricao tem uma fila limitada. Quando a fila enche, os eventos
+ * seguintes sao descartados e o cliente recebe, depois dos que
+ * estavam na fila, um evento com o numero de eventos perdidos, para
+ * voltar a ler as chaves. A estrutura e thread-safe.
+*/
+
+#ifndef _WATCH_H
+#define _WATCH_H
+
+#include "data.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define WATCH_QUEUE 1024            /* eventos na fila de uma subscricao por omissao */
+#define WATCH_MAX_QUEUE 65536       /* maximo de eventos pedido por um cliente */
+#define WATCH_IDLE_MS 1000          /* periodo da verificacao da ligacao sem eventos */
+
+/**
+ * Alteracao de uma chave, a espera de ser enviada.
+*/
+struct watch_event_t {
+    char *key;
+    struct data_t *value;           /* NULL se a chave foi removida */
+    uint64_t version;
+    struct watch_event_t *next;
+};
+
+/**
+ * Subscricao de uma ligacao.
+*/
+struct watch_subscriber_t {
+    int sockfd;
+    char **keys;                    /* chaves subscritas, terminado por NULL */
+    char **prefixes;                /* prefixos subscritos, terminado por NULL */
+    struct watch_event_t *head;     /* fila dos eventos por enviar */
+    struct watch_event_t *tail;
+    int n_events;
+    int capacity;
+    long dropped;                   /* eventos descartados desde o ultimo aviso */
+    int closed;                     /* 1 quando o servidor termina */
+    pthread_cond_t changed;
+    struct watch_subscriber_t *next;
+};
+
+struct watch_t {
+    pthread_mutex_t lock;
+    struct watch_subscriber_t *subscribers;
+    int n_subscribers;
+};
+
+/**
+ * Cria a estrutura sem subscricoes.
+ * \return
+ *      Apontador a estrutura ou NULL em caso de erro.
+*/
+struct watch_t *watch_create();
+
+/**
+ * Termina as subscricoes. A estrutura nao e libertada, porque as
+ * threads das ligacoes ainda a usam ate acordarem.
+*/
+void watch_destroy(struct watch_t *watch);
+
+/**
+ * Regista uma subscricao das chaves e dos prefixos dados.
+ * \param sockfd
+ *      Ligacao onde os eventos sao enviados.
+ * \param keys
+ *      Chaves subscritas.
+ * \param n_keys
+ *      Numero de chaves.
+ * \param prefixes
+ *      Prefixos subscritos.
+ * \param n_prefixes
+ *      Numero de prefixos.
+ * \param capacity
+ *      Eventos que a fila guarda, 0 para WATCH_QUEUE.
+ * \return
+ *      A subscricao ou NULL em caso de erro.
+*/
+struct watch_subscriber_t *watch_subscribe(struct watch_t *watch, int sockfd,
+                                           char **keys, int n_keys,
+                                           char **prefixes, int n_prefixes, int capacity);
+
+/**
+ * Envia os eventos da subscricao pela sua ligacao ate a ligacao
+ * fechar ou o servidor terminar, e remove a subscricao. Deve ser
+ * chamada pela thread da ligacao.
+ * \return
+ *      0 (OK) ou -1 se a subscricao nao existe.
+*/
+int watch_serve(struct watch_t *watch, struct watch_subscriber_t *subscriber);
+
+/**
+ * Verifica se alguma subscricao segue a chave.
+ * \return
+ *      1 se a chave e seguida, 0 caso contrario.
+*/
+int watch_wanted(struct watch_t *watch, const char *key);
+
+/**
+ * Coloca o evento da alteracao da chave na fila de cada subscricao
+ * que a segue. Deve ser chamada com a tabela protegida contra
+ * escritas, para os eventos ficarem pela ordem das alteracoes.
+ * \param key
+ *      Chave alterada.
+ * \param value
+ *      Novo valor, copiado, ou NULL se a chave foi removida.
+ * \param version
+ *      Versao do novo valor.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int watch_publish(struct watch_t *watch, const char *key, struct data_t *value, uint64_t version);
+
+#endif
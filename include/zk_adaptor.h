@@ -57,6 +57,39 @@ int set_node_watcher(zhandle_t* handler, char* node, watcher_fn watcher);
 */
 int data_exists(zhandle_t *handler, char* rootpath, char* data);
 
+/**
+ * Retorna o caminho completo de um filho de um no.
+ * \param path
+ *      Caminho completo para o no.
+ * \param child
+ *      Nome do filho.
+ * \return
+ *      String alocada com o caminho ou NULL em caso de erro.
+*/
+char* get_child_path(char* path, char* child);
+
+/**
+ * Retorna os nomes dos filhos de um no, por ordem alfabetica,
+ * p.e. as cadeias de uma instalacao particionada.
+ * \param handler
+ *      ZooKeeper handler.
+ * \param path
+ *      Caminho completo para o no.
+ * \param watcher
+ *      Funcao que e chamada quando os filhos mudarem, pode
+ *      ser NULL.
+ * \return
+ *      Array de nomes terminado por NULL, vazio se o no nao
+ *      existe, ou NULL em caso de erro. Liberta-se com 
+ *      free_children().
+*/
+char** get_children(zhandle_t* handler, char* path, watcher_fn watcher);
+
+/**
+ * Liberta o array retornado por get_children().
+*/
+void free_children(char** children);
+
 // =========================================================
 //                  Operacoes do servidor
 // =========================================================
@@ -90,6 +123,29 @@ char* get_server_prefix();
 */
 int create_root(zhandle_t *handler, char *path);
 
+/**
+ * Cria um no efemero sem dados, que desaparece quando a
+ * sessao termina.
+ * \param handler
+ *      ZooKeeper handler.
+ * \param path
+ *      Caminho completo para o no, o pai tem de existir.
+ * \return 
+ *      0 (OK), 1 se o no ja existe ou -1 em caso de erro.
+*/
+int create_ephemeral(zhandle_t *handler, char *path);
+
+/**
+ * Remove um no sem filhos.
+ * \param handler
+ *      ZooKeeper handler.
+ * \param path
+ *      Caminho completo para o no.
+ * \return 
+ *      0 (OK), 1 se o no nao existe ou -1 em caso de erro.
+*/
+int delete_node(zhandle_t *handler, char *path);
+
 /**
  * Regista o servidor atual no ZooKeeper, criando um no 
  * efemero com o numero de sequencia e o prefixo, coloca  
@@ -100,10 +156,13 @@ int create_root(zhandle_t *handler, char *path);
  *      Caminho para o diretorio.
  * \param socket
  *      Socket do servidor.
+ * \param unix_path
+ *      Caminho do socket local do servidor, anunciado depois do
+ *      endereco no formato <ip>:<porto>;<caminho>, ou NULL.
  * \return 
  *      Nome do no criado ou NULL em caso de erro.
 */
-char* register_server(zhandle_t* handler, char* path, int socket);
+char* register_server(zhandle_t* handler, char* path, int socket, const char *unix_path);
 
 /**
  * Retorna o descritor do proximo servidor em string 
@@ -176,6 +235,22 @@ char* get_head_server(zhandle_t* handler, char* path, watcher_fn watcher);
 */
 char* get_tail_server(zhandle_t* handler, char* path, watcher_fn watcher);
 
+/**
+ * Retorna os sockets de todos os servidores da cadeia, da cabeca
+ * para a cauda, em strings no formato <ip>:<porto>.
+ * \param handler
+ *      ZooKeeper handler.
+ * \param path
+ *      Caminho ao no que contem os nos dos servidores.
+ * \param watcher
+ *      Funcao que e invocada quando houver alguma alteracao no no.
+ * \return
+ *      Array terminado por NULL, vazio se nao ha servidores, ou
+ *      NULL em caso de erro. Deve ser libertado com
+ *      free_children().
+*/
+char** get_servers(zhandle_t* handler, char* path, watcher_fn watcher);
+
 
 
 
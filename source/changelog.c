@@ -0,0 +1,299 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "changelog.h"
+#include "data.h"
+#include "network_server.h"
+#include "sdmessage.pb-c.h"
+
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct changelog_t *changelog_create(int max_records, long max_bytes) {
+    if (max_records <= 0 || max_bytes <= 0)
+        return NULL;
+    struct changelog_t *log = malloc(sizeof(struct changelog_t));
+    if (log == NULL)
+        return NULL;
+    log->records = malloc(max_records * sizeof(struct changelog_record_t));
+    if (log->records == NULL) {
+        free(log);
+        return NULL;
+    }
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->appended, NULL);
+    log->capacity = max_records;
+    log->first = 0;
+    log->n_records = 0;
+    log->bytes = 0;
+    log->max_bytes = max_bytes;
+    log->discarded = 0;
+    log->last = 0;
+    log->closed = 0;
+    return log;
+}
+
+void changelog_destroy(struct changelog_t *log) {
+    if (log == NULL)
+        return;
+    // As threads das ligacoes terminam no proximo acordar
+    pthread_mutex_lock(&log->lock);
+    log->closed = 1;
+    pthread_cond_broadcast(&log->appended);
+    pthread_mutex_unlock(&log->lock);
+}
+
+static long record_size(struct changelog_record_t *record) {
+    return strlen(record->key) + (record->value != NULL ? record->value->datasize : 0);
+}
+
+static void record_destroy(struct changelog_record_t *record) {
+    free(record->key);
+    if (record->value != NULL)
+        data_destroy(record->value);
+}
+
+/**
+ * Copia a chave e o valor de uma escrita.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+static int record_init(struct changelog_record_t *record, uint64_t sequence, const char *key,
+                       struct data_t *value, unsigned long expire_at) {
+    record->sequence = sequence;
+    record->expire_at = expire_at;
+    record->value = NULL;
+    if ((record->key = strdup(key)) == NULL)
+        return -1;
+    if (value != NULL && (record->value = data_dup(value)) == NULL) {
+        free(record->key);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Descarta a escrita mais antiga. Chamada com o lock.
+*/
+static void changelog_discard(struct changelog_t *log) {
+    struct changelog_record_t *record = &log->records[log->first];
+    log->discarded = record->sequence;
+    log->bytes -= record_size(record);
+    record_destroy(record);
+    log->first = (log->first + 1) % log->capacity;
+    log->n_records--;
+}
+
+int changelog_append(struct changelog_t *log, uint64_t sequence, const char *key,
+                     struct data_t *value, unsigned long expire_at) {
+    if (log == NULL || key == NULL)
+        return -1;
+    pthread_mutex_lock(&log->lock);
+    if (sequence <= log->last) {
+        pthread_mutex_unlock(&log->lock);
+        return 0;
+    }
+
+    struct changelog_record_t record;
+    if (record_init(&record, sequence, key, value, expire_at) == -1) {
+        // Quem ainda nao recebeu a escrita tem de voltar a ler a tabela
+        log->discarded = log->last = sequence;
+        pthread_cond_broadcast(&log->appended);
+        pthread_mutex_unlock(&log->lock);
+        return -1;
+    }
+    long size = record_size(&record);
+    while (log->n_records > 0 &&
+           (log->n_records == log->capacity || log->bytes + size > log->max_bytes))
+        changelog_discard(log);
+
+    log->records[(log->first + log->n_records) % log->capacity] = record;
+    log->n_records++;
+    log->bytes += size;
+    log->last = sequence;
+    pthread_cond_broadcast(&log->appended);
+    pthread_mutex_unlock(&log->lock);
+    return 0;
+}
+
+void changelog_truncate(struct changelog_t *log, uint64_t sequence) {
+    if (log == NULL)
+        return;
+    pthread_mutex_lock(&log->lock);
+    while (log->n_records > 0 && log->records[log->first].sequence <= sequence)
+        changelog_discard(log);
+    if (sequence > log->discarded)
+        log->discarded = sequence;
+    if (sequence > log->last)
+        log->last = sequence;
+    pthread_mutex_unlock(&log->lock);
+}
+
+/**
+ * Procura a primeira escrita com sequencia maior que after. Chamada
+ * com o lock.
+ * \return
+ *      A posicao da escrita a partir da mais antiga ou n_records se
+ *      nao ha nenhuma.
+*/
+static int changelog_find(struct changelog_t *log, uint64_t after) {
+    int low = 0, high = log->n_records;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (log->records[(log->first + middle) % log->capacity].sequence <= after)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * Envia um grupo de escritas numa mensagem.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+static int changelog_send(int sockfd, struct changelog_record_t *records, int n_records) {
+    EntryT entries[n_records];
+    EntryT *pentries[n_records];
+    for (int i = 0; i < n_records; i++) {
+        entry_t__init(&entries[i]);
+        entries[i].key = records[i].key;
+        entries[i].version = records[i].sequence;
+        entries[i].expire_at = records[i].expire_at;
+        if (records[i].value != NULL) {
+            entries[i].value.len = records[i].value->datasize;
+            entries[i].value.data = records[i].value->data;
+        } else {
+            entries[i].deleted = 1;
+        }
+        pentries[i] = &entries[i];
+    }
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_CHANGES;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    msg.n_entries = n_records;
+    msg.entries = pentries;
+    return network_send(sockfd, &msg);
+}
+
+/**
+ * Avisa o consumidor de que as escritas ate discarded ja nao estao
+ * no registo.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+static int changelog_send_lost(int sockfd, uint64_t discarded) {
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_CHANGES;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_STALE;
+    msg.version = discarded;
+    return network_send(sockfd, &msg);
+}
+
+/**
+ * Copia as escritas a partir da posicao dada, ate max_records e
+ * CHANGELOG_BATCH_BYTES. Chamada com o lock.
+ * \return
+ *      Numero de escritas copiadas.
+*/
+static int changelog_copy_from(struct changelog_t *log, int position,
+                               struct changelog_record_t *records, int max_records) {
+    int n_records = 0;
+    long bytes = 0;
+    for (; position < log->n_records && n_records < max_records; position++) {
+        struct changelog_record_t *record = &log->records[(log->first + position) % log->capacity];
+        long size = record_size(record);
+        if (n_records > 0 && bytes + size > CHANGELOG_BATCH_BYTES)
+            break;
+        if (record_init(&records[n_records], record->sequence, record->key,
+                        record->value, record->expire_at) == -1)
+            break;
+        n_records++;
+        bytes += size;
+    }
+    return n_records;
+}
+
+int changelog_serve(struct changelog_t *log, int sockfd, uint64_t after) {
+    if (log == NULL)
+        return -1;
+    uint64_t cursor = after;
+    int failed = 0;
+    pthread_mutex_lock(&log->lock);
+    while (!failed && !log->closed) {
+        // As escritas seguintes ao cursor foram descartadas entretanto
+        if (cursor < log->discarded) {
+            uint64_t discarded = log->discarded;
+            pthread_mutex_unlock(&log->lock);
+            return changelog_send_lost(sockfd, discarded);
+        }
+
+        int position = changelog_find(log, cursor);
+        if (position == log->n_records) {
+            // Sem escritas, verificar de vez em quando se o cliente saiu
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += CHANGELOG_IDLE_MS / 1000;
+            deadline.tv_nsec += (CHANGELOG_IDLE_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&log->appended, &log->lock, &deadline) == ETIMEDOUT &&
+                log->last <= cursor) {
+                pthread_mutex_unlock(&log->lock);
+                failed = network_peer_closed(sockfd);
+                pthread_mutex_lock(&log->lock);
+            }
+            continue;
+        }
+
+        // Copiar as escritas seguintes e envia-las fora do lock, que
+        // as escritas na tabela tambem usam
+        struct changelog_record_t batch[CHANGELOG_BATCH];
+        int n_batch = changelog_copy_from(log, position, batch, CHANGELOG_BATCH);
+        pthread_mutex_unlock(&log->lock);
+
+        failed = n_batch == 0 || changelog_send(sockfd, batch, n_batch) == -1;
+        if (n_batch > 0)
+            cursor = batch[n_batch - 1].sequence;
+        for (int i = 0; i < n_batch; i++)
+            record_destroy(&batch[i]);
+
+        pthread_mutex_lock(&log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+    return failed ? -1 : 0;
+}
+
+int changelog_copy(struct changelog_t *log, uint64_t after,
+                   struct changelog_record_t *records, int max_records) {
+    if (log == NULL || records == NULL || max_records <= 0)
+        return -1;
+    pthread_mutex_lock(&log->lock);
+    if (after < log->discarded) {
+        pthread_mutex_unlock(&log->lock);
+        return -1;
+    }
+    int position = changelog_find(log, after);
+    int n_records = changelog_copy_from(log, position, records, max_records);
+    int failed = n_records == 0 && position < log->n_records;
+    pthread_mutex_unlock(&log->lock);
+    return failed ? -1 : n_records;
+}
+
+void changelog_free_records(struct changelog_record_t *records, int n_records) {
+    for (int i = 0; records != NULL && i < n_records; i++)
+        record_destroy(&records[i]);
+}
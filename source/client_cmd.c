@@ -86,6 +86,11 @@ void print_suggestions(char *buffer, int buffersize) {
         printf(SUGG_PUT);
         printf("\033[u");
     } else
+    if (strcasecmp(buffer, "pute") == 0) {
+        printf("\033[s");
+        printf(SUGG_PUTEX);
+        printf("\033[u");
+    } else
     if (strcasecmp(buffer, "s") == 0) {
         printf("\033[s");
         printf(SUGG_SIZE);
@@ -125,6 +130,21 @@ void print_suggestions(char *buffer, int buffersize) {
         printf("\033[s");
         printf(SUGG_GTABLE);
         printf("\033[u");
+    } else
+    if (strcasecmp(buffer, "sc") == 0) {
+        printf("\033[s");
+        printf(SUGG_SCAN);
+        printf("\033[u");
+    } else
+    if (strcasecmp(buffer, "mg") == 0) {
+        printf("\033[s");
+        printf(SUGG_MGET);
+        printf("\033[u");
+    } else
+    if (strcasecmp(buffer, "md") == 0) {
+        printf("\033[s");
+        printf(SUGG_MDEL);
+        printf("\033[u");
     }
 }
 
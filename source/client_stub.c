@@ -14,8 +14,37 @@
 #include "stats.h"
 
 #include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/**
+ * Verifica se o endereco IPv4 e de uma interface desta maquina.
+ * \return
+ *      1 se o endereco e local, 0 caso contrario.
+*/
+static int address_is_local(const char *ip) {
+    struct in_addr address;
+    if (inet_pton(AF_INET, ip, &address) < 1)
+        return 0;
+    // Toda a rede 127.0.0.0/8 e da propria maquina
+    if ((ntohl(address.s_addr) >> 24) == 127)
+        return 1;
+
+    struct ifaddrs *ifaddr;
+    if (getifaddrs(&ifaddr) == -1)
+        return 0;
+    int local = 0;
+    for (struct ifaddrs *ifa = ifaddr; ifa != NULL && !local; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr != NULL && ifa->ifa_addr->sa_family == AF_INET)
+            local = ((struct sockaddr_in *) ifa->ifa_addr)->sin_addr.s_addr == address.s_addr;
+    }
+    freeifaddrs(ifaddr);
+    return local;
+}
 
 struct rtable_t *rtable_connect(char *address_port) {
     if (address_port == NULL)
@@ -24,6 +53,11 @@ struct rtable_t *rtable_connect(char *address_port) {
     // Fazer uma copia da string
     char address_dup[strlen(address_port) + 1];
     strcpy(address_dup, address_port);
+
+    // Separar o caminho do socket local anunciado pelo servidor
+    char *unix_path = strchr(address_dup, ';');
+    if (unix_path != NULL)
+        *unix_path++ = '\0';
     
     // Separar string em ip e porto
     char *ip = strtok(address_dup, ":");
@@ -46,9 +80,34 @@ struct rtable_t *rtable_connect(char *address_port) {
 
     table->server_address = ip_dup;
     table->server_port = atoi(port);
+    // O socket local so e usado se o servidor esta nesta maquina
+    table->unix_path = NULL;
+    if (unix_path != NULL && *unix_path != '\0' && address_is_local(ip))
+        table->unix_path = strdup(unix_path);
+    table->idle = NULL;
+    table->n_idle = 0;
+    table->n_open = 0;
+    table->pool_size = 1;
+    table->checkouts = 0;
+    table->waits = 0;
+    table->replicas = 0;
+    table->async = 0;
+    table->loop = NULL;
+    table->push = NULL;
+    table->push_arg = NULL;
+    table->invalidate = NULL;
+    table->invalidate_arg = NULL;
+    pthread_mutex_init(&table->pool_lock, NULL);
+    pthread_cond_init(&table->pool_released, NULL);
+    pthread_mutex_init(&table->loop_lock, NULL);
 
     // Estabelecer a ligacao
     if (network_connect(table) == -1) {
+        pthread_mutex_destroy(&table->loop_lock);
+        pthread_cond_destroy(&table->pool_released);
+        pthread_mutex_destroy(&table->pool_lock);
+        free(table->unix_path);
+        free(ip_dup);
         free(table);
         return NULL;
     }
@@ -58,12 +117,55 @@ struct rtable_t *rtable_connect(char *address_port) {
 
 int rtable_disconnect(struct rtable_t *rtable) {
     int result = network_close(rtable);
+    pthread_mutex_destroy(&rtable->loop_lock);
+    pthread_cond_destroy(&rtable->pool_released);
+    pthread_mutex_destroy(&rtable->pool_lock);
     free(rtable->server_address);
+    free(rtable->unix_path);
     free(rtable);
     return result;
 }
 
-int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
+/**
+ * Abre outra tabela remota ligada ao mesmo servidor, pelo mesmo
+ * caminho.
+ * \return
+ *      A nova tabela ou NULL em caso de erro.
+*/
+static struct rtable_t *rtable_reconnect(struct rtable_t *rtable) {
+    size_t unix_len = rtable->unix_path != NULL ? strlen(rtable->unix_path) + 1 : 0;
+    char address[strlen(rtable->server_address) + unix_len + 12];
+    sprintf(address, "%s:%d", rtable->server_address, rtable->server_port);
+    if (rtable->unix_path != NULL) {
+        strcat(address, ";");
+        strcat(address, rtable->unix_path);
+    }
+    return rtable_connect(address);
+}
+
+int rtable_set_pool_size(struct rtable_t *rtable, int size) {
+    return network_pool_resize(rtable, size);
+}
+
+int rtable_pool_stats(struct rtable_t *rtable, struct rtable_pool_stats_t *stats) {
+    if (rtable == NULL || stats == NULL)
+        return -1;
+    pthread_mutex_lock(&rtable->pool_lock);
+    stats->size = rtable->pool_size;
+    stats->open = rtable->n_open;
+    stats->idle = rtable->n_idle;
+    stats->checkouts = rtable->checkouts;
+    stats->waits = rtable->waits;
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return 0;
+}
+
+/**
+ * Envia o pedido OP_PUT com o tempo de vida ou o instante
+ * de expiracao e a versao da entrada.
+*/
+static int rtable_put_msg(struct rtable_t *rtable, struct entry_t *entry,
+                        unsigned long ttl, unsigned long expire_at, uint64_t version) {
     if (rtable == NULL || entry == NULL)
         return -1;
 
@@ -79,6 +181,9 @@ int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
     entryt.key = entry->key;
     entryt.value.len = entry->value->datasize;
     entryt.value.data = entry->value->data;
+    entryt.ttl = ttl;
+    entryt.expire_at = expire_at;
+    entryt.version = version;
 
     msg.entry = &entryt;
 
@@ -99,9 +204,44 @@ int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
     return 0;
 }
 
+int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
+    return rtable_put_msg(rtable, entry, 0, 0, 0);
+}
+
+int rtable_put_ttl(struct rtable_t *rtable, struct entry_t *entry, unsigned long ttl) {
+    return rtable_put_msg(rtable, entry, ttl, 0, 0);
+}
+
+int rtable_put_expire(struct rtable_t *rtable, struct entry_t *entry, unsigned long expire_at,
+                      uint64_t version) {
+    return rtable_put_msg(rtable, entry, 0, expire_at, version);
+}
+
+int rtable_set_durability(struct rtable_t *rtable, unsigned int replicas) {
+    if (rtable == NULL)
+        return -1;
+    pthread_mutex_lock(&rtable->pool_lock);
+    rtable->replicas = replicas;
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return 0;
+}
+
 struct data_t *rtable_get(struct rtable_t *rtable, char *key) {
+    return rtable_get_version(rtable, key, NULL);
+}
+
+struct data_t *rtable_get_version(struct rtable_t *rtable, char *key, unsigned long *version) {
+    return rtable_get_consistency(rtable, key, RTABLE_READ_STRONG, 0, version, NULL);
+}
+
+struct data_t *rtable_get_consistency(struct rtable_t *rtable, char *key,
+                                      enum rtable_consistency consistency,
+                                      unsigned long max_lag, unsigned long *version,
+                                      int *stale) {
     if (rtable == NULL || key == NULL)
         return NULL;
+    if (stale != NULL)
+        *stale = 0;
     
     // Inicializar a mensagem
     MessageT msg;
@@ -109,11 +249,30 @@ struct data_t *rtable_get(struct rtable_t *rtable, char *key) {
     msg.opcode = MESSAGE_T__OPCODE__OP_GET;
     msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
     msg.key = key;
+    switch (consistency) {
+        case RTABLE_READ_BOUNDED:
+            msg.consistency = MESSAGE_T__CONSISTENCY__READ_BOUNDED;
+            msg.max_lag = max_lag;
+            break;
+        case RTABLE_READ_ANY:
+            msg.consistency = MESSAGE_T__CONSISTENCY__READ_ANY;
+            break;
+        default:
+            msg.consistency = MESSAGE_T__CONSISTENCY__READ_STRONG;
+            break;
+    }
 
     // Enviar e receber a resposta
     MessageT *resp = network_send_receive(rtable, &msg);
     if (resp == NULL)
         return NULL;
+    // A replica recusou a leitura por estar demasiado atrasada
+    if (resp->c_type == MESSAGE_T__C_TYPE__CT_STALE) {
+        if (stale != NULL)
+            *stale = 1;
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
     if (resp->opcode != MESSAGE_T__OPCODE__OP_GET + 1) {
         message_t__free_unpacked(resp, NULL);
         return NULL;
@@ -138,6 +297,8 @@ struct data_t *rtable_get(struct rtable_t *rtable, char *key) {
         message_t__free_unpacked(resp, NULL);
         return NULL;
     }
+    if (version != NULL)
+        *version = resp->version;
     
     // Libertar a estrutura da resposta
     message_t__free_unpacked(resp, NULL);
@@ -145,8 +306,97 @@ struct data_t *rtable_get(struct rtable_t *rtable, char *key) {
     return result;
 }
 
+/**
+ * Destino do valor lido por rtable_get_into().
+*/
+struct get_into_t {
+    void *buf;
+    int size;
+    unsigned long *version;
+};
+
+/**
+ * Copia o valor da resposta de um OP_GET para o buffer do cliente,
+ * se couber.
+ * \return
+ *      O tamanho do valor ou -1 se a chave nao existe.
+*/
+static int get_into_handler(MessageT *resp, void *arg) {
+    struct get_into_t *into = (struct get_into_t *) arg;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_GET + 1)
+        return -1;
+    if (resp->c_type != MESSAGE_T__C_TYPE__CT_VALUE || resp->value.len > INT_MAX)
+        return -1;
+    int size = resp->value.len;
+    if (size <= into->size)
+        memcpy(into->buf, resp->value.data, size);
+    if (into->version != NULL)
+        *into->version = resp->version;
+    return size;
+}
+
+int rtable_get_into(struct rtable_t *rtable, char *key, void *buf, int size,
+                    unsigned long *version) {
+    if (rtable == NULL || key == NULL || size < 0 || (buf == NULL && size > 0))
+        return -1;
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_GET;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    msg.consistency = MESSAGE_T__CONSISTENCY__READ_STRONG;
+
+    struct get_into_t into = {buf, size, version};
+    return network_send_receive_with(rtable, &msg, get_into_handler, &into);
+}
+
+struct data_t *rtable_get_track(struct rtable_t *rtable, char *key, uint64_t id,
+                                unsigned long *version, int *tracked) {
+    if (rtable == NULL || key == NULL || tracked == NULL)
+        return NULL;
+    *tracked = 0;
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_GET;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    msg.track_id = id;
+
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_GET + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_VALUE) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    // Copiar o conteudo para a estrutura data_t
+    struct data_t *result = NULL;
+    void *data = malloc(resp->value.len);
+    if (data != NULL) {
+        memcpy(data, resp->value.data, resp->value.len);
+        if ((result = data_create(resp->value.len, data)) == NULL)
+            free(data);
+    }
+    if (result != NULL) {
+        if (version != NULL)
+            *version = resp->version;
+        // O servidor so devolve o id se seguiu a chave antes de a ler
+        *tracked = id != 0 && resp->track_id == id;
+    }
+    message_t__free_unpacked(resp, NULL);
+    return result;
+}
+
 //gajo
 int rtable_del(struct rtable_t *rtable, char *key) {
+    return rtable_del_version(rtable, key, 0);
+}
+
+int rtable_del_version(struct rtable_t *rtable, char *key, uint64_t version) {
     if (rtable == NULL || key == NULL)
         return -1;
 
@@ -156,6 +406,7 @@ int rtable_del(struct rtable_t *rtable, char *key) {
     msg.opcode = MESSAGE_T__OPCODE__OP_DEL;
     msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
     msg.key = key;
+    msg.version = version;
 
     // Enviar e receber resposta
     MessageT *resp = network_send_receive(rtable, &msg);
@@ -174,219 +425,826 @@ int rtable_del(struct rtable_t *rtable, char *key) {
     return 0;
 }
 
-//gajo
-int rtable_size(struct rtable_t *rtable) {
-    if (rtable == NULL)
+/**
+ * Envia o pedido OP_MPUT ou OP_MIGRATE com o tempo de vida ou os
+ * instantes de expiracao e as versoes das entradas.
+ * \return
+ *      O resultado da resposta, 0 se nao tem resultado, ou -1 em
+ *      caso de erro.
+*/
+static int rtable_mput_msg(struct rtable_t *rtable, MessageT__Opcode opcode, struct entry_t **entries,
+                           unsigned long ttl, unsigned long *expire_at, uint64_t *version) {
+    if (rtable == NULL || entries == NULL)
+        return -1;
+
+    int n = 0;
+    while (entries[n] != NULL)
+        n++;
+    if (n == 0)
         return -1;
 
+    // As EntryT apontam para as chaves e dados das entradas
+    EntryT *entriest = malloc(n * sizeof(EntryT));
+    EntryT **entriesptr = malloc(n * sizeof(EntryT *));
+    if (entriest == NULL || entriesptr == NULL) {
+        free(entriest);
+        free(entriesptr);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        entry_t__init(&entriest[i]);
+        entriest[i].key = entries[i]->key;
+        entriest[i].value.len = entries[i]->value->datasize;
+        entriest[i].value.data = entries[i]->value->data;
+        entriest[i].ttl = ttl;
+        entriest[i].expire_at = expire_at != NULL ? expire_at[i] : 0;
+        entriest[i].version = version != NULL ? version[i] : 0;
+        entriesptr[i] = &entriest[i];
+    }
+
     // Inicializar a mensagem
     MessageT msg;
     message_t__init(&msg);
-    msg.opcode = MESSAGE_T__OPCODE__OP_SIZE;
-    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
-    
+    msg.opcode = opcode;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    msg.n_entries = n;
+    msg.entries = entriesptr;
+
     // Enviar e receber resposta
     MessageT *resp = network_send_receive(rtable, &msg);
+    free(entriesptr);
+    free(entriest);
     if (resp == NULL)
         return -1;
-    if (resp->opcode != MESSAGE_T__OPCODE__OP_SIZE + 1) {
-        message_t__free_unpacked(resp, NULL);
-        return -1;
-    }
-    if (resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+    if (resp->opcode != opcode + 1 ||
+        (resp->c_type != MESSAGE_T__C_TYPE__CT_NONE &&
+         resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT)) {
         message_t__free_unpacked(resp, NULL);
         return -1;
     }
-    // Salva-guarda o resultado
-    int size = resp->result;
-    // Libertar a mensagem de resposta
+    int result = resp->c_type == MESSAGE_T__C_TYPE__CT_RESULT ? resp->result : 0;
     message_t__free_unpacked(resp, NULL);
-    return size;
-    
+
+    return result;
 }
 
-struct statistics_t *rtable_stats(struct rtable_t *rtable) {
+int rtable_mput(struct rtable_t *rtable, struct entry_t **entries, unsigned long ttl) {
+    return rtable_mput_msg(rtable, MESSAGE_T__OPCODE__OP_MPUT, entries, ttl, NULL, NULL) == -1 ? -1 : 0;
+}
+
+int rtable_mput_expire(struct rtable_t *rtable, struct entry_t **entries, unsigned long *expire_at,
+                       uint64_t *version) {
+    if (expire_at == NULL || version == NULL)
+        return -1;
+    return rtable_mput_msg(rtable, MESSAGE_T__OPCODE__OP_MPUT, entries, 0, expire_at, version) == -1 ? -1 : 0;
+}
+
+int rtable_migrate(struct rtable_t *rtable, struct entry_t **entries, unsigned long *expire_at) {
+    if (expire_at == NULL)
+        return -1;
+    return rtable_mput_msg(rtable, MESSAGE_T__OPCODE__OP_MIGRATE, entries, 0, expire_at, NULL);
+}
+
+int rtable_heartbeat(struct rtable_t *rtable, uint64_t version) {
     if (rtable == NULL)
-        return NULL;
+        return -1;
 
     // Inicializar a mensagem
     MessageT msg;
     message_t__init(&msg);
-    msg.opcode = MESSAGE_T__OPCODE__OP_STATS;
+    msg.opcode = MESSAGE_T__OPCODE__OP_HEARTBEAT;
     msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.version = version;
 
     // Enviar e receber resposta
     MessageT *resp = network_send_receive(rtable, &msg);
     if (resp == NULL)
-        return NULL;
-    if (resp->opcode != MESSAGE_T__OPCODE__OP_STATS + 1 ||
-        resp->c_type != MESSAGE_T__C_TYPE__CT_STATS) {
-        message_t__free_unpacked(resp, NULL);
-        return NULL;
-    }
+        return -1;
+    int result = resp->opcode == MESSAGE_T__OPCODE__OP_HEARTBEAT + 1 ? 0 : -1;
+    message_t__free_unpacked(resp, NULL);
+    return result;
+}
 
-    // Inicializar a estrutura
-    struct statistics_t* stats = stats_init_args(resp->stats->n_op,
-                                                 resp->stats->time,
-                                                 resp->stats->n_clients);
-    if (stats == NULL) {
+int rtable_mdel(struct rtable_t *rtable, char **keys) {
+    return rtable_mdel_version(rtable, keys, 0);
+}
+
+int rtable_mdel_version(struct rtable_t *rtable, char **keys, uint64_t version) {
+    if (rtable == NULL || keys == NULL || keys[0] == NULL)
+        return -1;
+
+    int n_keys = 0;
+    while (keys[n_keys] != NULL)
+        n_keys++;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_MDEL;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEYS;
+    msg.n_keys = n_keys;
+    msg.keys = keys;
+    msg.version = version;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_MDEL + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
         message_t__free_unpacked(resp, NULL);
-        return NULL;
+        return -1;
     }
-
+    int result = resp->result;
     message_t__free_unpacked(resp, NULL);
 
-    return stats;
+    return result;
 }
 
-char **rtable_get_keys(struct rtable_t *rtable) {
-    if (rtable == NULL)
-        return NULL;
+int rtable_put_if_version(struct rtable_t *rtable, struct entry_t *entry,
+                          unsigned long expected, unsigned long *version) {
+    if (rtable == NULL || entry == NULL || entry->key == NULL || entry->value == NULL)
+        return -1;
 
     // Inicializar a mensagem
     MessageT msg;
     message_t__init(&msg);
-    msg.opcode = MESSAGE_T__OPCODE__OP_GETKEYS;
-    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.opcode = MESSAGE_T__OPCODE__OP_CPUT;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+    msg.version = expected;
+
+    EntryT entryt;
+    entry_t__init(&entryt);
+    entryt.key = entry->key;
+    entryt.value.len = entry->value->datasize;
+    entryt.value.data = entry->value->data;
+    msg.entry = &entryt;
 
     // Enviar e receber resposta
     MessageT *resp = network_send_receive(rtable, &msg);
     if (resp == NULL)
-        return NULL;
-    if (resp->opcode != MESSAGE_T__OPCODE__OP_GETKEYS + 1 ||
-        resp->c_type != MESSAGE_T__C_TYPE__CT_KEYS) {
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_CPUT + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
         message_t__free_unpacked(resp, NULL);
-        return NULL;
+        return -1;
     }
+    int result = resp->result;
+    if (version != NULL)
+        *version = resp->version;
+    message_t__free_unpacked(resp, NULL);
 
-    // Alocar espaco para apontadores de strings
-    int numkeys = resp->n_keys;
-    if (numkeys < 0)
-        return NULL;
-    char **reskeylist = (char**) malloc((numkeys + 1) * sizeof(char*));
-    if (reskeylist == NULL) {
-        message_t__free_unpacked(resp, NULL);
-        return NULL;
-    }
-    // Colocar NULL terminator no fim
-    reskeylist[numkeys] = NULL;
+    return result;
+}
 
-    char **keysptr = resp->keys;
-    // Iterar pela array de apontadores de strings
-    for (int i = 0; i < numkeys; i++) {
-        // Duplicar cada string
-        reskeylist[i] = strdup(keysptr[i]);
-        if (reskeylist[i] == NULL) {
-            /* Libertar espaco de strings anteriores */
-            for (int j = i - 1; j >= 0; j--)
-                free(reskeylist[j]);
-            /* Libertar array de apontadores */
-            free(reskeylist);
-            message_t__free_unpacked(resp, NULL);
-            return NULL;
-        }
-    }
+int rtable_del_if_version(struct rtable_t *rtable, char *key, unsigned long expected,
+                          unsigned long *version) {
+    if (rtable == NULL || key == NULL || expected == 0)
+        return -1;
 
-    message_t__free_unpacked(resp, NULL);
-    return reskeylist;
-}
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_CDEL;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    msg.version = expected;
 
-void rtable_free_keys(char **keys) {
-    if (keys == NULL)
-        return;
-    int index = 0;
-    char *ptr = NULL;
-    ptr = keys[index];
-    // Iterar pelo cada apontador
-    while (ptr != NULL) {
-        free(keys[index]);
-        index++;
-        ptr = keys[index];
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_CDEL + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
     }
-    free(keys);
+    int result = resp->result;
+    if (version != NULL)
+        *version = resp->version;
+    message_t__free_unpacked(resp, NULL);
+
+    return result;
 }
 
-struct entry_t **rtable_get_table(struct rtable_t *rtable) {
-    if (rtable == NULL)
-        return NULL;
-    
+int rtable_incr(struct rtable_t *rtable, char *key, long delta, long *value) {
+    if (rtable == NULL || key == NULL || value == NULL)
+        return -1;
+
     // Inicializar a mensagem
     MessageT msg;
     message_t__init(&msg);
-    msg.opcode = MESSAGE_T__OPCODE__OP_GETTABLE;
-    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.opcode = MESSAGE_T__OPCODE__OP_INCR;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    msg.delta = delta;
 
     // Enviar e receber resposta
     MessageT *resp = network_send_receive(rtable, &msg);
     if (resp == NULL)
-        return NULL;
-    if (resp->opcode != MESSAGE_T__OPCODE__OP_GETTABLE + 1 ||
-        resp->c_type != MESSAGE_T__C_TYPE__CT_TABLE) {
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_INCR + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_VALUE ||
+        resp->value.len == 0 || resp->value.len >= 32) {
         message_t__free_unpacked(resp, NULL);
-        return NULL;
+        return -1;
     }
 
-    // Allocar espaco para array de apontadores
-    int numentries = resp->n_entries;
-    if (numentries < 0) {
-        message_t__free_unpacked(resp, NULL);
-        return NULL;
-    }
-    struct entry_t **resentrlist = malloc((numentries + 1) * sizeof(struct entry_t*));
-    if (resentrlist == NULL) {
-        message_t__free_unpacked(resp, NULL);
-        return NULL;
+    // O resultado vem em decimal, tal como fica guardado
+    char buf[32];
+    memcpy(buf, resp->value.data, resp->value.len);
+    buf[resp->value.len] = '\0';
+    message_t__free_unpacked(resp, NULL);
+
+    char *end = NULL;
+    *value = strtol(buf, &end, 10);
+    return *end == '\0' ? 0 : -1;
+}
+
+int rtable_decr(struct rtable_t *rtable, char *key, long delta, long *value) {
+    if (delta == LONG_MIN)
+        return -1;
+    return rtable_incr(rtable, key, -delta, value);
+}
+
+int rtable_append(struct rtable_t *rtable, struct entry_t *entry) {
+    if (rtable == NULL || entry == NULL || entry->key == NULL || entry->value == NULL)
+        return -1;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_APPEND;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+
+    EntryT entryt;
+    entry_t__init(&entryt);
+    entryt.key = entry->key;
+    entryt.value.len = entry->value->datasize;
+    entryt.value.data = entry->value->data;
+    msg.entry = &entryt;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_APPEND + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
+    }
+    int result = resp->result;
+    message_t__free_unpacked(resp, NULL);
+
+    return result;
+}
+
+int rtable_cas(struct rtable_t *rtable, struct entry_t *entry, struct data_t *expected) {
+    if (rtable == NULL || entry == NULL || entry->key == NULL ||
+        entry->value == NULL || expected == NULL)
+        return -1;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_CAS;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+    msg.expected.len = expected->datasize;
+    msg.expected.data = expected->data;
+
+    EntryT entryt;
+    entry_t__init(&entryt);
+    entryt.key = entry->key;
+    entryt.value.len = entry->value->datasize;
+    entryt.value.data = entry->value->data;
+    msg.entry = &entryt;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_CAS + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
+    }
+    int result = resp->result;
+    message_t__free_unpacked(resp, NULL);
+
+    return result;
+}
+
+struct rtable_batch_t *rtable_batch_create() {
+    struct rtable_batch_t *batch = malloc(sizeof(struct rtable_batch_t));
+    if (batch == NULL)
+        return NULL;
+    batch->ops = NULL;
+    batch->n_ops = 0;
+    batch->capacity = 0;
+    return batch;
+}
+
+/**
+ * Acrescenta ao lote uma operacao sobre uma copia da chave.
+ * \return
+ *      A EntryT da operacao ou NULL em caso de erro.
+*/
+static EntryT *batch_add(struct rtable_batch_t *batch, char *key) {
+    if (batch->n_ops == batch->capacity) {
+        int capacity = batch->capacity == 0 ? 8 : batch->capacity * 2;
+        EntryT **ops = realloc(batch->ops, capacity * sizeof(EntryT *));
+        if (ops == NULL)
+            return NULL;
+        batch->ops = ops;
+        batch->capacity = capacity;
+    }
+
+    EntryT *op = malloc(sizeof(EntryT));
+    if (op == NULL)
+        return NULL;
+    entry_t__init(op);
+    op->key = strdup(key);
+    if (op->key == NULL) {
+        free(op);
+        return NULL;
+    }
+    batch->ops[batch->n_ops++] = op;
+    return op;
+}
+
+int rtable_batch_put(struct rtable_batch_t *batch, struct entry_t *entry, unsigned long ttl) {
+    if (batch == NULL || entry == NULL || entry->key == NULL || entry->value == NULL ||
+        entry->value->datasize <= 0)
+        return -1;
+
+    void *content = malloc(entry->value->datasize);
+    if (content == NULL)
+        return -1;
+    EntryT *op = batch_add(batch, entry->key);
+    if (op == NULL) {
+        free(content);
+        return -1;
+    }
+    memcpy(content, entry->value->data, entry->value->datasize);
+    op->value.len = entry->value->datasize;
+    op->value.data = content;
+    op->ttl = ttl;
+    return 0;
+}
+
+int rtable_batch_del(struct rtable_batch_t *batch, char *key) {
+    if (batch == NULL || key == NULL)
+        return -1;
+
+    EntryT *op = batch_add(batch, key);
+    if (op == NULL)
+        return -1;
+    op->deleted = 1;
+    return 0;
+}
+
+int rtable_batch_commit(struct rtable_t *rtable, struct rtable_batch_t *batch) {
+    if (rtable == NULL || batch == NULL || batch->n_ops == 0)
+        return -1;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_BATCH;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    msg.n_entries = batch->n_ops;
+    msg.entries = batch->ops;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_BATCH + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
+    }
+    message_t__free_unpacked(resp, NULL);
+
+    return 0;
+}
+
+void rtable_batch_destroy(struct rtable_batch_t *batch) {
+    if (batch == NULL)
+        return;
+    for (int i = 0; i < batch->n_ops; i++)
+        entry_t__free_unpacked(batch->ops[i], NULL);
+    free(batch->ops);
+    free(batch);
+}
+
+//gajo
+int rtable_size(struct rtable_t *rtable) {
+    if (rtable == NULL)
+        return -1;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_SIZE;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return -1;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_SIZE + 1) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
+    }
+    if (resp->c_type != MESSAGE_T__C_TYPE__CT_RESULT) {
+        message_t__free_unpacked(resp, NULL);
+        return -1;
     }
+    // Salva-guarda o resultado
+    int size = resp->result;
+    // Libertar a mensagem de resposta
+    message_t__free_unpacked(resp, NULL);
+    return size;
     
+}
+
+struct statistics_t *rtable_stats(struct rtable_t *rtable) {
+    if (rtable == NULL)
+        return NULL;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_STATS;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_STATS + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_STATS) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    // Inicializar a estrutura
+    struct statistics_t* stats = stats_init_args(resp->stats->n_op,
+                                                 resp->stats->time,
+                                                 resp->stats->n_clients,
+                                                 resp->stats->n_evicted,
+                                                 resp->stats->memory);
+    if (stats == NULL) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    // Copiar a ocupacao das classes do alocador
+    int n_slabs = resp->stats->n_slabs;
+    slab_stats_t slabs[n_slabs + 1];
+    for (int i = 0; i < n_slabs; i++) {
+        slabs[i].size = resp->stats->slabs[i]->size;
+        slabs[i].used = resp->stats->slabs[i]->used;
+        slabs[i].capacity = resp->stats->slabs[i]->capacity;
+    }
+    if (stats_set_slabs(stats, slabs, n_slabs) == -1) {
+        stats_destroy(stats);
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    // Escritas por nivel de durabilidade, ausentes em servidores antigos
+    for (int i = 0; i < STATS_DURABILITY_LEVELS && i < resp->stats->n_write_ops
+                    && i < resp->stats->n_write_time; i++)
+        stats_set_write(stats, i, resp->stats->write_ops[i], resp->stats->write_time[i]);
+
+    message_t__free_unpacked(resp, NULL);
+
+    return stats;
+}
+
+/**
+ * Copia as keys da resposta para uma array de char*
+ * terminada por NULL.
+*/
+static char **keys_unpack(MessageT *resp) {
+    // Alocar espaco para apontadores de strings
+    int numkeys = resp->n_keys;
+    if (numkeys < 0)
+        return NULL;
+    char **reskeylist = (char**) malloc((numkeys + 1) * sizeof(char*));
+    if (reskeylist == NULL)
+        return NULL;
+    // Colocar NULL terminator no fim
+    reskeylist[numkeys] = NULL;
+
+    char **keysptr = resp->keys;
+    // Iterar pela array de apontadores de strings
+    for (int i = 0; i < numkeys; i++) {
+        // Duplicar cada string
+        reskeylist[i] = strdup(keysptr[i]);
+        if (reskeylist[i] == NULL) {
+            /* Libertar espaco de strings anteriores */
+            for (int j = i - 1; j >= 0; j--)
+                free(reskeylist[j]);
+            /* Libertar array de apontadores */
+            free(reskeylist);
+            return NULL;
+        }
+    }
+    return reskeylist;
+}
+
+char **rtable_get_keys(struct rtable_t *rtable) {
+    return rtable_get_keys_filter(rtable, NULL, NULL);
+}
+
+char **rtable_get_keys_filter(struct rtable_t *rtable, char *prefix, char *pattern) {
+    if (rtable == NULL)
+        return NULL;
+
+    // Inicializar a mensagem, campos vazios nao filtram
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_GETKEYS;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.prefix = prefix != NULL ? prefix : "";
+    msg.pattern = pattern != NULL ? pattern : "";
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_GETKEYS + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_KEYS) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    char **keys = keys_unpack(resp);
+    message_t__free_unpacked(resp, NULL);
+    return keys;
+}
+
+/**
+ * Pede uma pagina de OP_GETKEYS ou OP_GETTABLE a partir do
+ * cursor e avanca o cursor com o que veio na resposta.
+ * \return
+ *      A resposta, com o c_type esperado, ou NULL em caso de erro.
+*/
+static MessageT *page_send_receive(struct rtable_t *rtable, MessageT__Opcode opcode,
+                                   MessageT__CType c_type, struct rtable_cursor_t *cursor,
+                                   int count, char *prefix, char *pattern) {
+    if (rtable == NULL || cursor == NULL || count <= 0)
+        return NULL;
+
+    CursorT msg_cursor;
+    cursor_t__init(&msg_cursor);
+    msg_cursor.bucket = cursor->bucket;
+    msg_cursor.position = cursor->position;
+
+    // Inicializar a mensagem, campos vazios nao filtram
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = opcode;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_CURSOR;
+    msg.cursor = &msg_cursor;
+    msg.limit = count;
+    msg.prefix = prefix != NULL ? prefix : "";
+    msg.pattern = pattern != NULL ? pattern : "";
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != opcode + 1 || resp->c_type != c_type || resp->cursor == NULL) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    cursor->bucket = resp->cursor->bucket;
+    cursor->position = resp->cursor->position;
+    return resp;
+}
+
+char **rtable_get_keys_page(struct rtable_t *rtable, struct rtable_cursor_t *cursor,
+                            int count, char *prefix, char *pattern) {
+    MessageT *resp = page_send_receive(rtable, MESSAGE_T__OPCODE__OP_GETKEYS,
+                                       MESSAGE_T__C_TYPE__CT_KEYS, cursor,
+                                       count, prefix, pattern);
+    if (resp == NULL)
+        return NULL;
+
+    char **keys = keys_unpack(resp);
+    message_t__free_unpacked(resp, NULL);
+    return keys;
+}
+
+void rtable_free_keys(char **keys) {
+    if (keys == NULL)
+        return;
+    int index = 0;
+    char *ptr = NULL;
+    ptr = keys[index];
+    // Iterar pelo cada apontador
+    while (ptr != NULL) {
+        free(keys[index]);
+        index++;
+        ptr = keys[index];
+    }
+    free(keys);
+}
+
+/**
+ * Converte as EntryT da resposta numa array de entry_t*
+ * terminada por NULL.
+*/
+static struct entry_t **entries_unpack(MessageT *resp) {
+    int numentries = resp->n_entries;
+    struct entry_t **resentrlist = malloc((numentries + 1) * sizeof(struct entry_t*));
+    if (resentrlist == NULL)
+        return NULL;
+
     EntryT **entriesptr = resp->entries;
+    int i;
     // Iterar pela array de apontadores de entries
-    for (int i = 0; i < numentries; i++) {
+    for (i = 0; i < numentries; i++) {
         // Alocar espaco para o conteudo e copia-lo
         void *contentptr = malloc(entriesptr[i]->value.len);
-        if (contentptr == NULL) {
-            for (int j = i-1; j >= 0; j--)
-                entry_destroy(resentrlist[i]);
-            free(resentrlist);
-            message_t__free_unpacked(resp, NULL);
-            return NULL;
-        }
+        if (contentptr == NULL)
+            goto err_entries;
         memcpy(contentptr, entriesptr[i]->value.data, entriesptr[i]->value.len);
 
         // Criar estrutura data_t
         struct data_t *dataptr = data_create(entriesptr[i]->value.len, contentptr);
         if (dataptr == NULL) {
-            // Libertar o espaco do conteudo 
-            free(contentptr); 
-            // Libertar entry_t anteriores
-            for (int j = i - 1; j >= 0; j--)
-                entry_destroy(resentrlist[i]);
-            // Libertar array de apontadores
-            free(resentrlist);
-            message_t__free_unpacked(resp, NULL);
-            return NULL;
+            free(contentptr);
+            goto err_entries;
         }
 
         // Criar estrutura entry_t
-        struct entry_t *entryptr = entry_create(strdup(entriesptr[i]->key), dataptr);
+        char *keyptr = strdup(entriesptr[i]->key);
+        struct entry_t *entryptr = entry_create(keyptr, dataptr);
         if (entryptr == NULL) {
-            /* Libertar data_t */
+            free(keyptr);
             data_destroy(dataptr);
-            /* Libertar entry_t anteriores */
-            for (int j = i-1; j >= 0; j--)
-                entry_destroy(resentrlist[i]);
-            /* Libertar array de apontadores*/
-            free(resentrlist);
-            message_t__free_unpacked(resp, NULL);
-            return NULL;
+            goto err_entries;
         }
 
         resentrlist[i] = entryptr;
     }
     // Colocar NULL terminator no fim
     resentrlist[numentries] = NULL;
+    return resentrlist;
+
+err_entries:
+    // Libertar entry_t anteriores
+    for (int j = i - 1; j >= 0; j--)
+        entry_destroy(resentrlist[j]);
+    free(resentrlist);
+    return NULL;
+}
+
+struct entry_t **rtable_mget(struct rtable_t *rtable, char **keys, int n_keys) {
+    if (rtable == NULL || keys == NULL || n_keys < 0)
+        return NULL;
+
+    // Inicializar a mensagem
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_MGET;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEYS;
+    msg.n_keys = n_keys;
+    msg.keys = keys;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_MGET + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_TABLE) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
 
+    struct entry_t **entries = entries_unpack(resp);
     message_t__free_unpacked(resp, NULL);
-    return resentrlist;
+    return entries;
+}
+
+struct entry_t **rtable_get_table(struct rtable_t *rtable) {
+    return rtable_get_table_filter(rtable, NULL, NULL);
+}
+
+/**
+ * Pede as entradas da tabela filtradas e guarda em version, se nao
+ * for NULL, a versao da ultima escrita incluida na copia.
+*/
+static struct entry_t **get_table(struct rtable_t *rtable, char *prefix, char *pattern,
+                                  unsigned long *version) {
+    if (rtable == NULL)
+        return NULL;
+    
+    // Inicializar a mensagem, campos vazios nao filtram
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_GETTABLE;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.prefix = prefix != NULL ? prefix : "";
+    msg.pattern = pattern != NULL ? pattern : "";
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_GETTABLE + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_TABLE) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    struct entry_t **entries = entries_unpack(resp);
+    if (version != NULL)
+        *version = resp->version;
+    message_t__free_unpacked(resp, NULL);
+    return entries;
+}
+
+struct entry_t **rtable_get_table_filter(struct rtable_t *rtable, char *prefix, char *pattern) {
+    return get_table(rtable, prefix, pattern, NULL);
+}
+
+struct entry_t **rtable_get_table_version(struct rtable_t *rtable, unsigned long *version) {
+    if (version == NULL)
+        return NULL;
+    return get_table(rtable, NULL, NULL, version);
+}
+
+struct entry_t **rtable_get_table_page(struct rtable_t *rtable, struct rtable_cursor_t *cursor,
+                                       int count, char *prefix, char *pattern) {
+    MessageT *resp = page_send_receive(rtable, MESSAGE_T__OPCODE__OP_GETTABLE,
+                                       MESSAGE_T__C_TYPE__CT_TABLE, cursor,
+                                       count, prefix, pattern);
+    if (resp == NULL)
+        return NULL;
+
+    struct entry_t **entries = entries_unpack(resp);
+    message_t__free_unpacked(resp, NULL);
+    return entries;
+}
+
+int rtable_iterate(struct rtable_t *rtable, char *prefix, char *pattern, int page_size,
+                   rtable_iter_t callback, void *arg) {
+    if (rtable == NULL || page_size <= 0 || callback == NULL)
+        return -1;
+
+    struct rtable_cursor_t cursor = {0, 0, 0};
+    do {
+        struct entry_t **entries = rtable_get_table_page(rtable, &cursor, page_size,
+                                                         prefix, pattern);
+        if (entries == NULL)
+            return -1;
+
+        for (int i = 0; entries[i] != NULL; i++) {
+            int result = callback(entries[i], arg);
+            if (result != 0) {
+                rtable_free_entries(entries);
+                return result;
+            }
+        }
+        rtable_free_entries(entries);
+    } while (cursor.bucket != 0 || cursor.position != 0);
+
+    return 0;
+}
+
+struct entry_t **rtable_scan(struct rtable_t *rtable, char *start, char *end, int limit) {
+    if (rtable == NULL || limit < 0)
+        return NULL;
+
+    // Inicializar a mensagem, chaves vazias deixam o intervalo aberto
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_SCAN;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_RANGE;
+    msg.key = start != NULL ? start : "";
+    msg.end_key = end != NULL ? end : "";
+    msg.limit = limit;
+
+    // Enviar e receber resposta
+    MessageT *resp = network_send_receive(rtable, &msg);
+    if (resp == NULL)
+        return NULL;
+    if (resp->opcode != MESSAGE_T__OPCODE__OP_SCAN + 1 ||
+        resp->c_type != MESSAGE_T__C_TYPE__CT_TABLE) {
+        message_t__free_unpacked(resp, NULL);
+        return NULL;
+    }
+
+    struct entry_t **entries = entries_unpack(resp);
+    message_t__free_unpacked(resp, NULL);
+    return entries;
 }
 
 void rtable_free_entries(struct entry_t **entries) {
@@ -398,4 +1256,374 @@ void rtable_free_entries(struct entry_t **entries) {
         index++;
     }
     free(entries);
-}
\ No newline at end of file
+}
+/**
+ * Recebe a resposta de um pedido assincrono no ciclo de eventos,
+ * guarda o resultado no pedido e chama a sua callback.
+*/
+static void future_complete(MessageT *resp, void *arg) {
+    struct rtable_future_t *future = (struct rtable_future_t *) arg;
+    future->result = -1;
+    if (resp != NULL && resp->opcode == future->opcode + 1) {
+        if (future->opcode != MESSAGE_T__OPCODE__OP_GET)
+            future->result = 0;
+        else if (resp->c_type == MESSAGE_T__C_TYPE__CT_VALUE) {
+            // Copiar o conteudo para a estrutura data_t
+            void *data = malloc(resp->value.len);
+            if (data != NULL) {
+                memcpy(data, resp->value.data, resp->value.len);
+                future->data = data_create(resp->value.len, data);
+                if (future->data == NULL)
+                    free(data);
+            }
+            future->version = resp->version;
+            future->result = future->data == NULL ? -1 : 0;
+        }
+    }
+    if (resp != NULL)
+        message_t__free_unpacked(resp, NULL);
+
+    if (future->callback != NULL)
+        future->callback(future, future->arg);
+
+    // So depois da callback o pedido pode ser libertado
+    pthread_mutex_lock(&future->lock);
+    future->done = 1;
+    pthread_cond_broadcast(&future->completed);
+    pthread_mutex_unlock(&future->lock);
+}
+
+/**
+ * Cria o pedido assincrono e envia a mensagem.
+ * \return
+ *      O pedido ou NULL em caso de erro.
+*/
+static struct rtable_future_t *future_submit(struct rtable_t *rtable, MessageT *msg,
+                                             rtable_callback_t callback, void *arg) {
+    struct rtable_future_t *future = malloc(sizeof(struct rtable_future_t));
+    if (future == NULL)
+        return NULL;
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->completed, NULL);
+    future->done = 0;
+    future->opcode = msg->opcode;
+    future->result = -1;
+    future->data = NULL;
+    future->version = 0;
+    future->callback = callback;
+    future->arg = arg;
+
+    if (network_submit(rtable, msg, future_complete, future) == -1) {
+        pthread_cond_destroy(&future->completed);
+        pthread_mutex_destroy(&future->lock);
+        free(future);
+        return NULL;
+    }
+    return future;
+}
+
+struct rtable_future_t *rtable_get_async(struct rtable_t *rtable, char *key,
+                                         rtable_callback_t callback, void *arg) {
+    if (rtable == NULL || key == NULL)
+        return NULL;
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_GET;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    return future_submit(rtable, &msg, callback, arg);
+}
+
+struct rtable_future_t *rtable_put_async(struct rtable_t *rtable, struct entry_t *entry,
+                                         rtable_callback_t callback, void *arg) {
+    if (rtable == NULL || entry == NULL)
+        return NULL;
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_PUT;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+
+    EntryT entryt;
+    entry_t__init(&entryt);
+    entryt.key = entry->key;
+    entryt.value.len = entry->value->datasize;
+    entryt.value.data = entry->value->data;
+    msg.entry = &entryt;
+    return future_submit(rtable, &msg, callback, arg);
+}
+
+struct rtable_future_t *rtable_del_async(struct rtable_t *rtable, char *key,
+                                         rtable_callback_t callback, void *arg) {
+    if (rtable == NULL || key == NULL)
+        return NULL;
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_DEL;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    msg.key = key;
+    return future_submit(rtable, &msg, callback, arg);
+}
+
+/**
+ * Entrega a rtable->invalidate as chaves de um OP_INVALIDATE, no
+ * ciclo de eventos.
+*/
+static void track_push(MessageT *msg, void *arg) {
+    struct rtable_t *rtable = (struct rtable_t *) arg;
+    if (msg == NULL)
+        rtable->invalidate(NULL, 0, rtable->invalidate_arg);
+    else if (msg->opcode == MESSAGE_T__OPCODE__OP_INVALIDATE && msg->c_type == MESSAGE_T__C_TYPE__CT_NONE)
+        rtable->invalidate(NULL, -1, rtable->invalidate_arg);
+    else if (msg->opcode == MESSAGE_T__OPCODE__OP_INVALIDATE)
+        rtable->invalidate(msg->keys, msg->n_keys, rtable->invalidate_arg);
+}
+
+int rtable_track(struct rtable_t *rtable, uint64_t id, rtable_invalidate_t invalidate, void *arg) {
+    if (rtable == NULL || id == 0 || invalidate == NULL)
+        return -1;
+    // O ciclo de eventos e criado no primeiro pedido com a funcao
+    pthread_mutex_lock(&rtable->loop_lock);
+    rtable->invalidate = invalidate;
+    rtable->invalidate_arg = arg;
+    rtable->push = track_push;
+    rtable->push_arg = rtable;
+    pthread_mutex_unlock(&rtable->loop_lock);
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_TRACK;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.track_id = id;
+
+    struct rtable_future_t *future = future_submit(rtable, &msg, NULL, NULL);
+    if (future == NULL)
+        return -1;
+    int result = rtable_future_wait(future);
+    rtable_future_destroy(future);
+    return result;
+}
+
+int rtable_future_poll(struct rtable_future_t *future) {
+    if (future == NULL)
+        return -1;
+    pthread_mutex_lock(&future->lock);
+    int done = future->done;
+    pthread_mutex_unlock(&future->lock);
+    return done;
+}
+
+int rtable_future_wait(struct rtable_future_t *future) {
+    if (future == NULL)
+        return -1;
+    pthread_mutex_lock(&future->lock);
+    while (!future->done)
+        pthread_cond_wait(&future->completed, &future->lock);
+    pthread_mutex_unlock(&future->lock);
+    return future->result;
+}
+
+int rtable_future_result(struct rtable_future_t *future) {
+    return future == NULL ? -1 : future->result;
+}
+
+struct data_t *rtable_future_data(struct rtable_future_t *future, unsigned long *version) {
+    if (future == NULL)
+        return NULL;
+    struct data_t *data = future->data;
+    future->data = NULL;
+    if (version != NULL)
+        *version = future->version;
+    return data;
+}
+
+void rtable_future_destroy(struct rtable_future_t *future) {
+    if (future == NULL)
+        return;
+    rtable_future_wait(future);
+    if (future->data != NULL)
+        data_destroy(future->data);
+    pthread_cond_destroy(&future->completed);
+    pthread_mutex_destroy(&future->lock);
+    free(future);
+}
+
+/**
+ * Entrega a callback da subscricao um OP_EVENT recebido no ciclo de
+ * eventos, ou RTABLE_EVENT_CLOSED quando a ligacao termina.
+*/
+static void watch_push(MessageT *msg, void *arg) {
+    struct rtable_watch_t *watch = (struct rtable_watch_t *) arg;
+    struct rtable_event_t event = {RTABLE_EVENT_CLOSED, NULL, NULL, 0, 0};
+    struct data_t value;
+    if (msg != NULL) {
+        if (msg->opcode != MESSAGE_T__OPCODE__OP_EVENT)
+            return;
+        switch (msg->c_type) {
+            case MESSAGE_T__C_TYPE__CT_ENTRY:
+                if (msg->entry == NULL)
+                    return;
+                // O valor aponta para a mensagem, valido durante a callback
+                value.datasize = msg->entry->value.len;
+                value.data = msg->entry->value.data;
+                event.type = RTABLE_EVENT_PUT;
+                event.key = msg->entry->key;
+                event.value = &value;
+                event.version = msg->entry->version;
+                break;
+
+            case MESSAGE_T__C_TYPE__CT_KEY:
+                event.type = RTABLE_EVENT_DEL;
+                event.key = msg->key;
+                event.version = msg->version;
+                break;
+
+            case MESSAGE_T__C_TYPE__CT_RESULT:
+                event.type = RTABLE_EVENT_DROPPED;
+                event.dropped = msg->result;
+                break;
+
+            default:
+                return;
+        }
+    }
+    watch->callback(&event, watch->arg);
+}
+
+struct rtable_watch_t *rtable_watch(struct rtable_t *rtable, char **keys, char **prefixes,
+                                    int queue_size, rtable_watch_callback_t callback, void *arg) {
+    if (rtable == NULL || callback == NULL || queue_size < 0)
+        return NULL;
+    int n_keys = 0, n_prefixes = 0;
+    while (keys != NULL && keys[n_keys] != NULL)
+        n_keys++;
+    while (prefixes != NULL && prefixes[n_prefixes] != NULL)
+        n_prefixes++;
+    if (n_keys + n_prefixes == 0)
+        return NULL;
+
+    struct rtable_watch_t *watch = malloc(sizeof(struct rtable_watch_t));
+    if (watch == NULL)
+        return NULL;
+    watch->callback = callback;
+    watch->arg = arg;
+
+    // Ligacao propria, o servidor so envia eventos nela depois da resposta
+    if ((watch->rtable = rtable_reconnect(rtable)) == NULL) {
+        free(watch);
+        return NULL;
+    }
+    pthread_mutex_lock(&watch->rtable->loop_lock);
+    watch->rtable->push = watch_push;
+    watch->rtable->push_arg = watch;
+    pthread_mutex_unlock(&watch->rtable->loop_lock);
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_WATCH;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEYS;
+    msg.n_keys = n_keys;
+    msg.keys = keys;
+    msg.n_prefixes = n_prefixes;
+    msg.prefixes = prefixes;
+    msg.limit = queue_size;
+
+    struct rtable_future_t *future = future_submit(watch->rtable, &msg, NULL, NULL);
+    int result = future == NULL ? -1 : rtable_future_wait(future);
+    rtable_future_destroy(future);
+    if (result == -1) {
+        rtable_unwatch(watch);
+        return NULL;
+    }
+    return watch;
+}
+
+void rtable_unwatch(struct rtable_watch_t *watch) {
+    if (watch == NULL)
+        return;
+    rtable_disconnect(watch->rtable);
+    free(watch);
+}
+
+/**
+ * Entrega a callback da rececao as escritas de um OP_CHANGES recebido
+ * no ciclo de eventos, ou RTABLE_CHANGE_CLOSED quando a ligacao termina.
+*/
+static void changes_push(MessageT *msg, void *arg) {
+    struct rtable_changes_t *changes = (struct rtable_changes_t *) arg;
+    struct rtable_change_t change = {RTABLE_CHANGE_CLOSED, 0, NULL, NULL, 0};
+    if (msg == NULL) {
+        changes->callback(&change, changes->arg);
+        return;
+    }
+    if (msg->opcode != MESSAGE_T__OPCODE__OP_CHANGES)
+        return;
+
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_STALE) {
+        change.type = RTABLE_CHANGE_LOST;
+        change.sequence = msg->version;
+        changes->callback(&change, changes->arg);
+        return;
+    }
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_TABLE)
+        return;
+    for (size_t i = 0; i < msg->n_entries; i++) {
+        EntryT *entryt = msg->entries[i];
+        if (entryt == NULL || entryt->key == NULL)
+            continue;
+        // O valor aponta para a mensagem, valido durante a callback
+        struct data_t value = {entryt->value.len, entryt->value.data};
+        change.type = entryt->deleted ? RTABLE_CHANGE_DEL : RTABLE_CHANGE_PUT;
+        change.sequence = entryt->version;
+        change.key = entryt->key;
+        change.value = entryt->deleted ? NULL : &value;
+        change.expire_at = entryt->expire_at;
+        changes->callback(&change, changes->arg);
+    }
+}
+
+struct rtable_changes_t *rtable_changes(struct rtable_t *rtable, unsigned long after,
+                                        rtable_changes_callback_t callback, void *arg) {
+    if (rtable == NULL || callback == NULL)
+        return NULL;
+
+    struct rtable_changes_t *changes = malloc(sizeof(struct rtable_changes_t));
+    if (changes == NULL)
+        return NULL;
+    changes->callback = callback;
+    changes->arg = arg;
+
+    // Ligacao propria, o servidor so envia escritas nela depois da resposta
+    if ((changes->rtable = rtable_reconnect(rtable)) == NULL) {
+        free(changes);
+        return NULL;
+    }
+    pthread_mutex_lock(&changes->rtable->loop_lock);
+    changes->rtable->push = changes_push;
+    changes->rtable->push_arg = changes;
+    pthread_mutex_unlock(&changes->rtable->loop_lock);
+
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_CHANGES;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.version = after;
+
+    struct rtable_future_t *future = future_submit(changes->rtable, &msg, NULL, NULL);
+    int result = future == NULL ? -1 : rtable_future_wait(future);
+    rtable_future_destroy(future);
+    if (result == -1) {
+        rtable_changes_close(changes);
+        return NULL;
+    }
+    return changes;
+}
+
+void rtable_changes_close(struct rtable_changes_t *changes) {
+    if (changes == NULL)
+        return;
+    rtable_disconnect(changes->rtable);
+    free(changes);
+}
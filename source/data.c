@@ -0,0 +1,61 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "data.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct data_t *data_create(int size, void *data) {
+    if (size <= 0 || data == NULL)
+        return NULL;
+
+    struct data_t *new_data = malloc(sizeof(struct data_t));
+    if (new_data == NULL)
+        return NULL;
+
+    new_data->datasize = size;
+    new_data->data = data;
+    return new_data;
+}
+
+int data_destroy(struct data_t *data) {
+    if (data == NULL)
+        return -1;
+    free(data->data);
+    free(data);
+    return 0;
+}
+
+struct data_t *data_dup(struct data_t *data) {
+    if (data == NULL || data->datasize <= 0 || data->data == NULL)
+        return NULL;
+
+    struct data_t *new_data = malloc(sizeof(struct data_t));
+    if (new_data == NULL)
+        return NULL;
+    new_data->datasize = data->datasize;
+
+    // Copiar o conteudo
+    new_data->data = malloc(data->datasize);
+    if (new_data->data == NULL) {
+        free(new_data);
+        return NULL;
+    }
+    memcpy(new_data->data, data->data, data->datasize);
+    return new_data;
+}
+
+int data_replace(struct data_t *data, int new_size, void *new_data) {
+    if (data == NULL || new_size <= 0 || new_data == NULL)
+        return -1;
+    data->datasize = new_size;
+    free(data->data);
+    data->data = new_data;
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "data.h"
+#include "entry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct entry_t *entry_create(char *key, struct data_t *data) {
+    if (key == NULL || data == NULL)
+        return NULL;
+
+    struct entry_t *entry = malloc(sizeof(struct entry_t));
+    if (entry == NULL)
+        return NULL;
+
+    entry->key = key;
+    entry->value = data;
+    return entry;
+}
+
+int entry_destroy(struct entry_t *entry) {
+    if (entry == NULL ||
+        entry->key == NULL ||
+        entry->value == NULL ||
+        entry->value->data == NULL)
+        return -1;
+
+    free(entry->key);
+    if (data_destroy(entry->value) == -1) {
+        free(entry);
+        return -1;
+    }
+    free(entry);
+    return 0;
+}
+
+struct entry_t *entry_dup(struct entry_t *entry) {
+    if (entry == NULL ||
+        entry->key == NULL ||
+        entry->value == NULL ||
+        entry->value->data == NULL ||
+        entry->value->datasize <= 0)
+        return NULL;
+
+    struct entry_t *new_entry = malloc(sizeof(struct entry_t));
+    if (new_entry == NULL)
+        return NULL;
+
+    // Duplicar a chave
+    new_entry->key = strdup(entry->key);
+    if (new_entry->key == NULL) {
+        free(new_entry);
+        return NULL;
+    }
+
+    // Duplicar o valor
+    new_entry->value = data_dup(entry->value);
+    if (new_entry->value == NULL) {
+        free(new_entry->key);
+        free(new_entry);
+        return NULL;
+    }
+    return new_entry;
+}
+
+int entry_replace(struct entry_t *entry, char *new_key, struct data_t *new_value) {
+    if (entry == NULL || new_key == NULL || new_value == NULL)
+        return -1;
+    if (data_destroy(entry->value) == -1)
+        return -1;
+    free(entry->key);
+    entry->value = new_value;
+    entry->key = new_key;
+    return 0;
+}
+
+int entry_compare(struct entry_t *entry1, struct entry_t *entry2) {
+    if (entry1 == NULL || entry2 == NULL ||
+        entry1->key == NULL || entry2->key == NULL)
+        return -2;
+
+    int result = strcmp(entry1->key, entry2->key);
+    if (result < 0)
+        return -1;
+    if (result > 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "hash.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+// Constantes do wyhash
+static const uint64_t secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+static uint64_t seed;
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Multiplica a por b em 128 bits e junta as duas metades.
+*/
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/**
+ * Escolhe a semente a partir do /dev/urandom ou, se nao estiver
+ * disponivel, do tempo e do pid.
+*/
+static void seed_init() {
+    uint64_t value = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd == -1 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        value = ((uint64_t) tv.tv_sec << 20) ^ tv.tv_usec ^ ((uint64_t) getpid() << 40);
+    }
+    if (fd != -1)
+        close(fd);
+    seed = mix(value ^ secret[0], secret[1]);
+}
+
+/**
+ * Calcula o hash dos bytes a partir da semente s.
+*/
+static uint64_t wyhash(const void *data, size_t len, uint64_t s) {
+    const uint8_t *p = data;
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        // Tres cadeias independentes para blocos de 48 bytes
+        if (i > 48) {
+            uint64_t s1 = s, s2 = s;
+            do {
+                s = mix(read64(p) ^ secret[1], read64(p + 8) ^ s);
+                s1 = mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ s1);
+                s2 = mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            s ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            s = mix(read64(p) ^ secret[1], read64(p + 8) ^ s);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= s;
+    __uint128_t r = (__uint128_t) a * b;
+    a = (uint64_t) r;
+    b = (uint64_t) (r >> 64);
+    return mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+uint64_t hash_bytes(const void *data, size_t len) {
+    pthread_once(&seed_once, seed_init);
+    return wyhash(data, len, seed);
+}
+
+uint64_t hash_stable(const void *data, size_t len) {
+    return wyhash(data, len, secret[2]);
+}
+
+uint64_t hash_key(const char *key) {
+    return hash_bytes(key, strlen(key));
+}
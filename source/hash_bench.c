@@ -0,0 +1,188 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+/**
+ * Microbenchmark que compara a funcao de hash antiga da tabela
+ * (soma dos caracteres) com hash_key(), medindo o tempo de calculo,
+ * a distribuicao pelas listas e o tempo de procura nas listas.
+ *
+ * Uso: ./binary/hash_bench [<n chaves> [<n listas>]]
+*/
+
+#include "hash.h"
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define DEFAULT_KEYS 50000
+#define DEFAULT_LISTS 1031
+
+// Chave numa lista simulada da tabela
+struct bench_node_t {
+    uint64_t hash;
+    char *key;
+};
+
+struct bench_list_t {
+    struct bench_node_t *nodes;
+    int size;
+};
+
+/**
+ * Funcao de hash usada anteriormente pela tabela.
+*/
+static uint64_t old_hash(const char *key) {
+    int sum = 0;
+    while (*key != '\0') {
+        sum += *key;
+        key++;
+    }
+    return sum;
+}
+
+static uint64_t new_hash(const char *key) {
+    return hash_key(key);
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Distribui as chaves pelas listas segundo a funcao de hash.
+*/
+static struct bench_list_t *build(char **keys, int n_keys, int n_lists,
+                                  uint64_t (*hash)(const char *)) {
+    struct bench_list_t *lists = calloc(n_lists, sizeof(struct bench_list_t));
+    int *count = calloc(n_lists, sizeof(int));
+    if (lists == NULL || count == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (int i = 0; i < n_keys; i++)
+        count[hash(keys[i]) % n_lists]++;
+    for (int i = 0; i < n_lists; i++) {
+        lists[i].nodes = malloc((count[i] + 1) * sizeof(struct bench_node_t));
+        if (lists[i].nodes == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < n_keys; i++) {
+        uint64_t h = hash(keys[i]);
+        struct bench_list_t *list = &lists[h % n_lists];
+        list->nodes[list->size].hash = h;
+        list->nodes[list->size].key = keys[i];
+        list->size++;
+    }
+    free(count);
+    return lists;
+}
+
+static void destroy(struct bench_list_t *lists, int n_lists) {
+    for (int i = 0; i < n_lists; i++)
+        free(lists[i].nodes);
+    free(lists);
+}
+
+/**
+ * Mede o tempo de calculo do hash de todas as chaves.
+*/
+static double bench_hash(char **keys, int n_keys, uint64_t (*hash)(const char *)) {
+    volatile uint64_t sink = 0;
+    double start = now_sec();
+    for (int i = 0; i < n_keys; i++)
+        sink ^= hash(keys[i]);
+    (void) sink;
+    return now_sec() - start;
+}
+
+/**
+ * Mede o tempo de procura de todas as chaves. Com cached, os
+ * hashes guardados sao comparados antes das chaves.
+*/
+static double bench_lookup(char **keys, int n_keys, struct bench_list_t *lists,
+                           int n_lists, uint64_t (*hash)(const char *), int cached) {
+    long found = 0;
+    double start = now_sec();
+    for (int i = 0; i < n_keys; i++) {
+        uint64_t h = hash(keys[i]);
+        struct bench_list_t *list = &lists[h % n_lists];
+        for (int j = 0; j < list->size; j++) {
+            if ((!cached || list->nodes[j].hash == h) &&
+                strcmp(list->nodes[j].key, keys[i]) == 0) {
+                found++;
+                break;
+            }
+        }
+    }
+    double elapsed = now_sec() - start;
+    if (found != n_keys)
+        fprintf(stderr, "Found %ld of %d keys\n", found, n_keys);
+    return elapsed;
+}
+
+static void report(const char *name, char **keys, int n_keys, int n_lists,
+                   uint64_t (*hash)(const char *), int cached) {
+    struct bench_list_t *lists = build(keys, n_keys, n_lists, hash);
+
+    int used = 0, longest = 0;
+    double probes = 0;
+    for (int i = 0; i < n_lists; i++) {
+        if (lists[i].size > 0)
+            used++;
+        if (lists[i].size > longest)
+            longest = lists[i].size;
+        // Numero medio de nos visitados numa procura com sucesso
+        probes += (double) lists[i].size * (lists[i].size + 1) / 2;
+    }
+
+    double t_hash = bench_hash(keys, n_keys, hash);
+    double t_lookup = bench_lookup(keys, n_keys, lists, n_lists, hash, cached);
+
+    printf("%-22s %8.1f ns/hash %10.1f ns/get %6d/%d lists %7d longest %9.1f probes\n",
+           name, t_hash * 1e9 / n_keys, t_lookup * 1e9 / n_keys,
+           used, n_lists, longest, probes / n_keys);
+    destroy(lists, n_lists);
+}
+
+int main(int argc, char **argv) {
+    int n_keys = argc > 1 ? atoi(argv[1]) : DEFAULT_KEYS;
+    int n_lists = argc > 2 ? atoi(argv[2]) : DEFAULT_LISTS;
+    if (n_keys <= 0 || n_lists <= 0) {
+        printf("Usage: %s [<n keys> [<n lists>]]\n", argv[0]);
+        return -1;
+    }
+
+    // Chaves curtas, como no uso normal da tabela
+    char **keys = malloc(n_keys * sizeof(char *));
+    if (keys == NULL) {
+        perror("malloc");
+        return -1;
+    }
+    for (int i = 0; i < n_keys; i++) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "user:%d", i);
+        keys[i] = strdup(buf);
+    }
+
+    printf("%d keys, %d lists\n", n_keys, n_lists);
+    report("sum of chars", keys, n_keys, n_lists, old_hash, 0);
+    report("hash_key", keys, n_keys, n_lists, new_hash, 0);
+    report("hash_key + cached", keys, n_keys, n_lists, new_hash, 1);
+
+    for (int i = 0; i < n_keys; i++)
+        free(keys[i]);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,344 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "data.h"
+#include "entry.h"
+#include "hash.h"
+#include "list.h"
+#include "list-private.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NODE_HEADER ((int) offsetof(struct node_t, inline_data))
+
+/**
+ * Retorna o deslocamento do valor em inline_data, a seguir a
+ * chave se esta estiver no no.
+*/
+static int value_offset(char *key) {
+    int len = strlen(key);
+    return len < NODE_KEY_INLINE ? len + 1 : 0;
+}
+
+/**
+ * Retorna o numero de bytes de dados que cabem dentro do no.
+*/
+static int value_capacity(struct node_t *node) {
+    return node->size - NODE_HEADER - value_offset(node->entry.key);
+}
+
+static int key_is_inline(struct node_t *node) {
+    return strlen(node->entry.key) < NODE_KEY_INLINE;
+}
+
+// Sem espaco para dados, inline_data + offset ja esta fora do no
+static int value_is_inline(struct node_t *node) {
+    return value_capacity(node) > 0 &&
+        node->data.data == node->inline_data + value_offset(node->entry.key);
+}
+
+/**
+ * Copia os dados para o no, dentro dele se couberem, substituindo
+ * os dados anteriores.
+*/
+static int node_set_data(struct list_t *list, struct node_t *node, struct data_t *value) {
+    void *content;
+    if (value->datasize <= NODE_VALUE_INLINE && value->datasize <= value_capacity(node))
+        content = node->inline_data + value_offset(node->entry.key);
+    else if ((content = slab_alloc(list->slab, value->datasize)) == NULL)
+        return -1;
+
+    if (node->data.data != NULL && !value_is_inline(node))
+        slab_free(list->slab, node->data.data, node->data.datasize);
+    memcpy(content, value->data, value->datasize);
+    node->data.data = content;
+    node->data.datasize = value->datasize;
+    return 0;
+}
+
+/**
+ * Liberta o no e a chave e os dados guardados fora dele.
+*/
+static void node_free(struct list_t *list, struct node_t *node) {
+    if (!value_is_inline(node))
+        slab_free(list->slab, node->data.data, node->data.datasize);
+    if (!key_is_inline(node))
+        slab_free(list->slab, node->entry.key, strlen(node->entry.key) + 1);
+    slab_free(list->slab, node, node->size);
+}
+
+/**
+ * Cria um no com copias da chave e dos dados.
+*/
+static struct node_t *node_create(struct list_t *list, char *key, uint64_t hash,
+                                  struct data_t *value, uint64_t version) {
+    int len = strlen(key);
+    int size = NODE_HEADER + value_offset(key);
+    if (value->datasize <= NODE_VALUE_INLINE)
+        size += value->datasize;
+
+    struct node_t *node = slab_alloc(list->slab, size);
+    if (node == NULL)
+        return NULL;
+    node->next = NULL;
+    node->hash = hash;
+    node->version = version;
+    node->size = size;
+    atomic_init(&node->referenced, 1);
+
+    // Chave
+    if (len < NODE_KEY_INLINE)
+        node->entry.key = node->inline_data;
+    else if ((node->entry.key = slab_alloc(list->slab, len + 1)) == NULL)
+        goto err_key;
+    memcpy(node->entry.key, key, len + 1);
+
+    // Dados
+    node->entry.value = &node->data;
+    node->data.data = NULL;
+    if (node_set_data(list, node, value) == -1)
+        goto err_data;
+    return node;
+
+err_data:
+    if (!key_is_inline(node))
+        slab_free(list->slab, node->entry.key, len + 1);
+err_key:
+    slab_free(list->slab, node, size);
+    return NULL;
+}
+
+/**
+ * Procura a posicao da chave na lista. Retorna a ligacao onde a
+ * chave esta ou deve ser inserida e indica em found se foi encontrada.
+*/
+static struct node_t **node_find(struct list_t *list, char *key, uint64_t hash, int *found) {
+    struct node_t **it = &list->head;
+    *found = 0;
+    while (*it != NULL && (*it)->hash <= hash) {
+        // So comparar as chaves quando os hashes sao iguais
+        if ((*it)->hash == hash) {
+            int cmp = strcmp((*it)->entry.key, key);
+            if (cmp == 0) {
+                *found = 1;
+                break;
+            }
+            if (cmp > 0)
+                break;
+        }
+        it = &(*it)->next;
+    }
+    return it;
+}
+
+long node_memory(struct node_t *node) {
+    if (node == NULL)
+        return -1;
+    long memory = slab_class_size(node->size);
+    if (!key_is_inline(node))
+        memory += slab_class_size(strlen(node->entry.key) + 1);
+    if (!value_is_inline(node))
+        memory += slab_class_size(node->data.datasize);
+    return memory;
+}
+
+struct list_t *list_create() {
+    struct list_t *list = malloc(sizeof(struct list_t));
+    if (list == NULL)
+        return NULL;
+    list->head = NULL;
+    list->slab = NULL;
+    list->memory = 0;
+    list->size = 0;
+    return list;
+}
+
+int list_destroy(struct list_t *list) {
+    if (list == NULL)
+        return -1;
+
+    while (list->size != 0) {
+        if (list->head == NULL)
+            return -1;
+        struct node_t *node = list->head;
+        list->head = list->head->next;
+        list->size--;
+        list->memory -= node_memory(node);
+        node_free(list, node);
+    }
+
+    if (list->head != NULL)
+        return -1;
+    free(list);
+    return 0;
+}
+
+int list_put(struct list_t *list, char *key, uint64_t hash, struct data_t *value,
+             uint64_t version) {
+    if (list == NULL || key == NULL || value == NULL ||
+        value->datasize <= 0 || value->data == NULL)
+        return -1;
+
+    // Procurar a posicao da chave, a lista esta ordenada
+    int found;
+    struct node_t **it = node_find(list, key, hash, &found);
+
+    // Se ja existe, substituir os dados
+    if (found) {
+        struct node_t *node = *it;
+        long old_memory = node_memory(node);
+        if (value->datasize <= NODE_VALUE_INLINE &&
+            value->datasize > value_capacity(node)) {
+            // O valor e curto mas ja nao cabe no no, trocar por um maior
+            struct node_t *new_node = node_create(list, key, hash, value, version);
+            if (new_node == NULL)
+                return -1;
+            new_node->next = node->next;
+            *it = new_node;
+            node_free(list, node);
+            node = new_node;
+        } else if (node_set_data(list, node, value) == -1) {
+            return -1;
+        }
+        node->version = version;
+        atomic_store_explicit(&node->referenced, 1, memory_order_relaxed);
+        list->memory += node_memory(node) - old_memory;
+        return 1;
+    }
+
+    struct node_t *node = node_create(list, key, hash, value, version);
+    if (node == NULL)
+        return -1;
+    node->next = *it;
+    *it = node;
+
+    list->size++;
+    list->memory += node_memory(node);
+    return 0;
+}
+
+int list_add(struct list_t *list, struct entry_t *entry) {
+    if (list == NULL || entry == NULL)
+        return -1;
+
+    // A lista guarda uma copia, a entry recebida e libertada
+    int result = list_put(list, entry->key, hash_key(entry->key), entry->value, 0);
+    if (result == -1)
+        return -1;
+    entry_destroy(entry);
+    return result;
+}
+
+int list_remove(struct list_t *list, char *key) {
+    if (list == NULL || key == NULL)
+        return -1;
+    return list_delete(list, key, hash_key(key));
+}
+
+int list_delete(struct list_t *list, char *key, uint64_t hash) {
+    if (list == NULL || list->size == 0 || key == NULL)
+        return -1;
+
+    int found;
+    struct node_t **it = node_find(list, key, hash, &found);
+
+    // Nao encontrou
+    if (!found)
+        return 1;
+
+    struct node_t *node = *it;
+    *it = node->next;
+    list->size--;
+    list->memory -= node_memory(node);
+    node_free(list, node);
+    return 0;
+}
+
+struct entry_t *list_get(struct list_t *list, char *key) {
+    if (list == NULL || key == NULL)
+        return NULL;
+    return list_find(list, key, hash_key(key));
+}
+
+struct entry_t *list_find(struct list_t *list, char *key, uint64_t hash) {
+    if (list == NULL || list->size == 0 || key == NULL)
+        return NULL;
+
+    int found;
+    struct node_t *node = *node_find(list, key, hash, &found);
+    if (!found)
+        return NULL;
+
+    // Marcar o no como referenciado para o CLOCK, so com o lock de
+    // leitura partilhado com outros leitores
+    atomic_store_explicit(&node->referenced, 1, memory_order_relaxed);
+    return &node->entry;
+}
+
+uint64_t list_entry_version(struct entry_t *entry) {
+    if (entry == NULL)
+        return 0;
+    // A entry esta dentro do no
+    struct node_t *node = (struct node_t *) ((char *) entry - offsetof(struct node_t, entry));
+    return node->version;
+}
+
+struct entry_t *list_clock_victim(struct list_t *list) {
+    if (list == NULL)
+        return NULL;
+
+    for (struct node_t *it = list->head; it != NULL; it = it->next) {
+        if (!atomic_load_explicit(&it->referenced, memory_order_relaxed))
+            return &it->entry;
+        // Dar uma segunda oportunidade ao no
+        atomic_store_explicit(&it->referenced, 0, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+int list_size(struct list_t *list) {
+    if (list == NULL)
+        return -1;
+    return list->size;
+}
+
+char **list_get_keys(struct list_t *list) {
+    if (list == NULL || list->size == 0)
+        return NULL;
+
+    char **keys = malloc((list->size + 1) * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    struct node_t *it = list->head;
+    int i;
+    for (i = 0; i < list->size; i++) {
+        keys[i] = strdup(it->entry.key);
+        if (keys[i] == NULL) {
+            // Libertar as chaves copiadas anteriormente
+            for (int j = i - 1; j >= 0; j--)
+                free(keys[j]);
+            free(keys);
+            return NULL;
+        }
+        it = it->next;
+    }
+    keys[i] = NULL;
+    return keys;
+}
+
+int list_free_keys(char **keys) {
+    if (keys == NULL)
+        return -1;
+    for (int i = 0; keys[i] != NULL; i++)
+        free(keys[i]);
+    free(keys);
+    return 0;
+}
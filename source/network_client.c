@@ -15,30 +15,64 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 
-int network_connect(struct rtable_t *rtable) {
-    if (rtable == NULL)
+/**
+ * Abre uma ligacao ao socket local do servidor, sem mensagens de
+ * erro porque a ligacao TCP e tentada a seguir.
+ * \return
+ *      O descritor do socket ou -1 em caso de erro.
+*/
+static int network_open_unix(const char *path) {
+    struct sockaddr_un server;
+    if (strlen(path) >= sizeof(server.sun_path))
+        return -1;
+    int skt = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (skt < 0)
         return -1;
+    memset(&server, 0, sizeof(server));
+    server.sun_family = AF_UNIX;
+    strcpy(server.sun_path, path);
+    if (connect(skt, (struct sockaddr*)&server, sizeof(server)) < 0) {
+        close(skt);
+        return -1;
+    }
+    return skt;
+}
 
+/**
+ * Abre uma nova ligacao ao servidor da tabela, pelo socket local
+ * se o servidor esta nesta maquina.
+ * \return
+ *      O descritor do socket ou -1 em caso de erro.
+*/
+static int network_open(struct rtable_t *rtable) {
     struct sockaddr_in server;
 
+    if (rtable->unix_path != NULL) {
+        int skt = network_open_unix(rtable->unix_path);
+        if (skt != -1)
+            return skt;
+    }
+
     // Criar socket
     int skt = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
     if (skt < 0) {
         printf(ERROR_SOCKET);
         return -1;
     }
-    rtable->sockfd = skt;
-    
+
     server.sin_family = AF_INET;
     server.sin_port = htons(rtable->server_port);
-    
+
 
     // Converter o endereco IP para o formato binario
     if (inet_pton(AF_INET, rtable->server_address, &server.sin_addr) < 1) {
@@ -46,73 +80,642 @@ int network_connect(struct rtable_t *rtable) {
         close(skt);
         return -1;
     }
-    
+
     // Estabelecer ligacao
     if (connect(skt, (struct sockaddr*)&server, sizeof(server)) < 0) {
         printf(ERROR_CONNECT);
         close(skt);
         return -1;
     }
-    
+
+    return skt;
+}
+
+/**
+ * Inicializa a ligacao aberta no socket, ainda sem buffers.
+*/
+static void conn_init(struct rtable_conn_t *conn, int sockfd) {
+    conn->sockfd = sockfd;
+    conn->pending = 0;
+    conn->out = conn->in = NULL;
+    conn->out_size = conn->in_size = 0;
+    conn->arena.base = NULL;
+    conn->arena.size = conn->arena.used = conn->arena.missing = 0;
+    conn->next = NULL;
+}
+
+/**
+ * Fecha o socket e liberta os buffers da ligacao.
+ * \return
+ *      0 (OK) ou -1 se o socket nao fechou.
+*/
+static int conn_close(struct rtable_conn_t *conn) {
+    int result = close(conn->sockfd);
+    free(conn->out);
+    free(conn->in);
+    free(conn->arena.base);
+    return result;
+}
+
+/**
+ * Garante que o buffer tem pelo menos size bytes. O conteudo nao e
+ * preservado quando o buffer cresce.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+static int buffer_reserve(uint8_t **buffer, size_t *capacity, size_t size) {
+    if (size <= *capacity)
+        return 0;
+    size_t new_capacity = *capacity == 0 ? NETWORK_BUFFER : *capacity;
+    while (new_capacity < size)
+        new_capacity *= 2;
+    free(*buffer);
+    if ((*buffer = malloc(new_capacity)) == NULL) {
+        *capacity = 0;
+        return -1;
+    }
+    *capacity = new_capacity;
     return 0;
 }
 
-MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg) {
-    if (rtable == NULL || msg == NULL)
+/**
+ * Reserva memoria para a de-serializacao na arena. Quando a arena
+ * nao chega, reserva a parte e conta o que faltou, para a arena
+ * crescer antes da resposta seguinte.
+*/
+static void *arena_alloc(void *allocator_data, size_t size) {
+    struct rtable_arena_t *arena = (struct rtable_arena_t *) allocator_data;
+    size_t aligned = (size + NETWORK_ARENA_ALIGN - 1) & ~(size_t) (NETWORK_ARENA_ALIGN - 1);
+    if (aligned <= arena->size - arena->used) {
+        void *pointer = arena->base + arena->used;
+        arena->used += aligned;
+        return pointer;
+    }
+    arena->missing += aligned;
+    return malloc(size);
+}
+
+/**
+ * Liberta so o que foi reservado fora da arena, que e esvaziada de
+ * uma vez com arena_reset().
+*/
+static void arena_free(void *allocator_data, void *pointer) {
+    struct rtable_arena_t *arena = (struct rtable_arena_t *) allocator_data;
+    uintptr_t address = (uintptr_t) pointer;
+    uintptr_t base = (uintptr_t) arena->base;
+    if (address < base || address >= base + arena->size)
+        free(pointer);
+}
+
+/**
+ * Esvazia a arena depois de a resposta ser libertada, aumentando-a
+ * se a resposta nao coube.
+*/
+static void arena_reset(struct rtable_arena_t *arena) {
+    if (arena->missing > 0)
+        buffer_reserve(&arena->base, &arena->size, arena->used + arena->missing);
+    arena->used = 0;
+    arena->missing = 0;
+}
+
+int network_connect(struct rtable_t *rtable) {
+    if (rtable == NULL)
+        return -1;
+
+    struct rtable_conn_t *conn = malloc(sizeof(struct rtable_conn_t));
+    if (conn == NULL)
+        return -1;
+    int sockfd = network_open(rtable);
+    if (sockfd == -1) {
+        free(conn);
+        return -1;
+    }
+    conn_init(conn, sockfd);
+
+    // A primeira ligacao fica livre no conjunto
+    pthread_mutex_lock(&rtable->pool_lock);
+    conn->next = rtable->idle;
+    rtable->idle = conn;
+    rtable->n_idle++;
+    rtable->n_open++;
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return 0;
+}
+
+/**
+ * Obtem uma ligacao livre do conjunto, abrindo uma nova se ainda
+ * nao ha pool_size abertas, ou esperando que outra thread devolva
+ * uma. A ligacao so e usada pela thread que a obteve ate ser
+ * devolvida com network_checkin().
+ * \return
+ *      A ligacao ou NULL em caso de erro.
+*/
+static struct rtable_conn_t *network_checkout(struct rtable_t *rtable) {
+    pthread_mutex_lock(&rtable->pool_lock);
+    rtable->checkouts++;
+    if (rtable->idle == NULL && rtable->n_open >= rtable->pool_size)
+        rtable->waits++;
+    while (rtable->idle == NULL && rtable->n_open >= rtable->pool_size)
+        pthread_cond_wait(&rtable->pool_released, &rtable->pool_lock);
+
+    struct rtable_conn_t *conn = rtable->idle;
+    if (conn != NULL) {
+        rtable->idle = conn->next;
+        rtable->n_idle--;
+        pthread_mutex_unlock(&rtable->pool_lock);
+        return conn;
+    }
+    // Reservar o lugar da nova ligacao e abri-la fora do lock
+    rtable->n_open++;
+    pthread_mutex_unlock(&rtable->pool_lock);
+
+    conn = malloc(sizeof(struct rtable_conn_t));
+    int sockfd = conn == NULL ? -1 : network_open(rtable);
+    if (sockfd == -1) {
+        free(conn);
+        pthread_mutex_lock(&rtable->pool_lock);
+        rtable->n_open--;
+        pthread_cond_signal(&rtable->pool_released);
+        pthread_mutex_unlock(&rtable->pool_lock);
         return NULL;
+    }
+    conn_init(conn, sockfd);
+    return conn;
+}
+
+/**
+ * Devolve a ligacao ao conjunto. Uma ligacao que falhou, ou que
+ * esta a mais depois de o conjunto diminuir, e fechada.
+*/
+static void network_checkin(struct rtable_t *rtable, struct rtable_conn_t *conn, int failed) {
+    pthread_mutex_lock(&rtable->pool_lock);
+    if (failed || rtable->n_open > rtable->pool_size) {
+        rtable->n_open--;
+        conn_close(conn);
+        free(conn);
+    } else {
+        conn->next = rtable->idle;
+        rtable->idle = conn;
+        rtable->n_idle++;
+    }
+    pthread_cond_signal(&rtable->pool_released);
+    pthread_mutex_unlock(&rtable->pool_lock);
+}
 
-    // Obter o tamanho da mensagem
+int network_pool_resize(struct rtable_t *rtable, int size) {
+    if (rtable == NULL || size < 1)
+        return -1;
+    pthread_mutex_lock(&rtable->pool_lock);
+    rtable->pool_size = size;
+    // As ligacoes livres a mais sao fechadas ja, as em uso quando voltarem
+    while (rtable->n_open > rtable->pool_size && rtable->idle != NULL) {
+        struct rtable_conn_t *conn = rtable->idle;
+        rtable->idle = conn->next;
+        rtable->n_idle--;
+        rtable->n_open--;
+        conn_close(conn);
+        free(conn);
+    }
+    pthread_cond_broadcast(&rtable->pool_released);
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return 0;
+}
+
+/**
+ * Serializa e envia o pedido, sem esperar pela resposta.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+static int network_send(struct rtable_conn_t *conn, MessageT *msg) {
+    // Obter o tamanho da mensagem, que tem de caber nos 16 bits
+    // do tamanho enviado
     size_t msgsize = message_t__get_packed_size(msg);
+    if (msgsize > MESSAGE_MAX_SIZE) {
+        printf(ERROR_SEND_TOO_BIG);
+        return -1;
+    }
 
-    // Alocar espaco para o buffer
-    uint8_t *buffer = (uint8_t *) malloc(msgsize);
-    if (buffer == NULL) {
-        return NULL;
+    // Reutilizar o buffer da ligacao, so cresce se nao chegar
+    if (buffer_reserve(&conn->out, &conn->out_size, msgsize) == -1) {
+        return -1;
     }
+    uint8_t *buffer = conn->out;
     // Serializar a mensagem para o buffer
     message_t__pack(msg, buffer);
     // Escrever o tamanho
     unsigned short msgsize_bign = htons(msgsize);
-    if (write_all(rtable->sockfd, &msgsize_bign, sizeof(msgsize_bign)) != sizeof(msgsize_bign)) {
+    if (write_all(conn->sockfd, &msgsize_bign, sizeof(msgsize_bign)) != sizeof(msgsize_bign)) {
         printf(ERROR_SEND_SIZE);
-        free(buffer);
-        return NULL;
+        return -1;
     }
     // Escrever o buffer
-    if (write_all(rtable->sockfd, (void *)buffer, msgsize) != msgsize) {
+    if (write_all(conn->sockfd, (void *)buffer, msgsize) != msgsize) {
         printf(ERROR_SEND_MSG);
-        free(buffer);
-        return NULL;
+        return -1;
     }
-    free(buffer);
+    return 0;
+}
 
+/**
+ * Espera pela proxima resposta do servidor.
+ * \param allocator
+ *      Memoria onde a resposta e de-serializada, NULL para a reservar
+ *      com malloc.
+ * \return
+ *      A mensagem de-serializada ou NULL em caso de erro.
+*/
+static MessageT *network_receive(struct rtable_conn_t *conn, ProtobufCAllocator *allocator) {
     // Ler o tamanho da resposta
     uint16_t respsize_bign = 0;
-    if (read_all(rtable->sockfd, &respsize_bign, sizeof(respsize_bign)) != sizeof(respsize_bign)) {
+    if (read_all(conn->sockfd, &respsize_bign, sizeof(respsize_bign)) != sizeof(respsize_bign)) {
         printf(ERROR_READ_SIZE);
-        free(buffer);
         return NULL;
     }
 
     unsigned short respsize = ntohs(respsize_bign);
-    // Alocar espaco para a resposta
-    uint8_t *respbuffer = malloc(respsize);
-    if (respbuffer == NULL) {
+    // Reutilizar o buffer da ligacao, so cresce se nao chegar
+    if (buffer_reserve(&conn->in, &conn->in_size, respsize) == -1) {
         return NULL;
     }
+    uint8_t *respbuffer = conn->in;
     // Ler a resposta
-    if (read_all(rtable->sockfd, respbuffer, respsize) != respsize) {
+    if (read_all(conn->sockfd, respbuffer, respsize) != respsize) {
         printf(ERROR_READ_MSG);
-        free(respbuffer);
         return NULL;
     }
     // Deserializar a mensagem
-    MessageT *msgptr = message_t__unpack(NULL, respsize, respbuffer);
-    free(respbuffer);
+    return message_t__unpack(allocator, respsize, respbuffer);
+}
+
+/**
+ * Le as respostas dos pedidos enviados sem esperar ate ficarem
+ * no maximo keep por ler. As respostas chegam pela ordem dos
+ * pedidos, por isso tem de ser lidas antes da de um novo pedido.
+ * \return
+ *      0 (OK), 1 se algum desses pedidos falhou no servidor ou
+ *      -1 se a ligacao falhou.
+*/
+static int network_drain(struct rtable_conn_t *conn, int keep) {
+    // As respostas so sao verificadas, a arena chega
+    ProtobufCAllocator allocator = {arena_alloc, arena_free, &conn->arena};
+    int result = 0;
+    while (conn->pending > keep) {
+        MessageT *resp = network_receive(conn, &allocator);
+        if (resp == NULL) {
+            arena_reset(&conn->arena);
+            conn->pending = 0;
+            return -1;
+        }
+        conn->pending--;
+        if (resp->opcode == MESSAGE_T__OPCODE__OP_ERROR) {
+            printf(ERROR_DEFERRED);
+            result = 1;
+        }
+        message_t__free_unpacked(resp, &allocator);
+        arena_reset(&conn->arena);
+    }
+    return result;
+}
+
+/**
+ * Cria a resposta de sucesso de um pedido enviado sem esperar,
+ * igual a que o servidor envia a uma escrita: sem conteudo para
+ * as de uma so chave e com um resultado para as restantes.
+*/
+static MessageT *network_deferred_ack(MessageT *msg) {
+    MessageT *ack = malloc(sizeof(MessageT));
+    if (ack == NULL)
+        return NULL;
+    message_t__init(ack);
+    ack->opcode = msg->opcode + 1;
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_ENTRY || msg->c_type == MESSAGE_T__C_TYPE__CT_KEY ||
+        msg->c_type == MESSAGE_T__C_TYPE__CT_NONE)
+        ack->c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    else
+        ack->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+    return ack;
+}
+
+MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg) {
+    if (rtable == NULL || msg == NULL)
+        return NULL;
+
+    // Durabilidade pedida para as escritas
+    pthread_mutex_lock(&rtable->pool_lock);
+    if (rtable->replicas != 0)
+        msg->replicas = rtable->replicas;
+    int async = rtable->async;
+    pthread_mutex_unlock(&rtable->pool_lock);
+
+    struct rtable_conn_t *conn = network_checkout(rtable);
+    if (conn == NULL)
+        return NULL;
+
+    // Ler primeiro as respostas pendentes, sem deixar acumular
+    // mais do que NETWORK_MAX_PENDING
+    int drained = network_drain(conn, async ? NETWORK_MAX_PENDING - 1 : 0);
+    if (drained != 0) {
+        network_checkin(rtable, conn, drained == -1);
+        return NULL;
+    }
+    if (network_send(conn, msg) == -1) {
+        network_checkin(rtable, conn, 1);
+        return NULL;
+    }
+
+    // Sem esperar, a resposta e lida por um pedido seguinte
+    if (async) {
+        conn->pending++;
+        network_checkin(rtable, conn, 0);
+        return network_deferred_ack(msg);
+    }
+    MessageT *resp = network_receive(conn, NULL);
+    network_checkin(rtable, conn, resp == NULL);
+    return resp;
+}
+
+int network_flush(struct rtable_t *rtable) {
+    if (rtable == NULL)
+        return -1;
+    // Retirar as ligacoes livres do conjunto e ler fora do lock
+    pthread_mutex_lock(&rtable->pool_lock);
+    struct rtable_conn_t *conns = rtable->idle;
+    rtable->idle = NULL;
+    rtable->n_idle = 0;
+    pthread_mutex_unlock(&rtable->pool_lock);
+
+    int result = 0;
+    while (conns != NULL) {
+        struct rtable_conn_t *conn = conns;
+        conns = conn->next;
+        int drained = network_drain(conn, 0);
+        if (drained != 0)
+            result = -1;
+        network_checkin(rtable, conn, drained == -1);
+    }
+    return result;
+}
+
+int network_send_receive_with(struct rtable_t *rtable, MessageT *msg,
+                              network_handler_t handler, void *arg) {
+    if (rtable == NULL || msg == NULL || handler == NULL)
+        return -1;
+
+    // Durabilidade pedida para as escritas
+    pthread_mutex_lock(&rtable->pool_lock);
+    if (rtable->replicas != 0)
+        msg->replicas = rtable->replicas;
+    pthread_mutex_unlock(&rtable->pool_lock);
+
+    struct rtable_conn_t *conn = network_checkout(rtable);
+    if (conn == NULL)
+        return -1;
+
+    // A resposta e sempre esperada, as pendentes sao lidas antes
+    int drained = network_drain(conn, 0);
+    if (drained != 0) {
+        network_checkin(rtable, conn, drained == -1);
+        return -1;
+    }
+    if (network_send(conn, msg) == -1) {
+        network_checkin(rtable, conn, 1);
+        return -1;
+    }
+
+    // De-serializar na arena e tratar a resposta antes de devolver
+    // a ligacao, que outra thread pode voltar a usar
+    ProtobufCAllocator allocator = {arena_alloc, arena_free, &conn->arena};
+    MessageT *resp = network_receive(conn, &allocator);
+    if (resp == NULL) {
+        arena_reset(&conn->arena);
+        network_checkin(rtable, conn, 1);
+        return -1;
+    }
+    int result = handler(resp, arg);
+    message_t__free_unpacked(resp, &allocator);
+    arena_reset(&conn->arena);
+    network_checkin(rtable, conn, 0);
+    return result;
+}
+
+/**
+ * Ciclo de eventos da ligacao dos pedidos assincronos: le as
+ * respostas pela ordem dos pedidos e entrega cada uma ao seu
+ * pedido. Quando a ligacao falha ou e fechada, os pedidos por
+ * responder terminam com erro.
+*/
+static void *network_loop(void *arg) {
+    struct rtable_loop_t *loop = (struct rtable_loop_t *) arg;
+    while (1) {
+        MessageT *resp = network_receive(&loop->conn, NULL);
+
+        // Enviada pelo servidor sem pedido (invalidacao, evento ou escritas)
+        if (resp != NULL && (resp->opcode == MESSAGE_T__OPCODE__OP_INVALIDATE ||
+                             resp->opcode == MESSAGE_T__OPCODE__OP_EVENT ||
+                             resp->opcode == MESSAGE_T__OPCODE__OP_CHANGES)) {
+            if (loop->push != NULL)
+                loop->push(resp, loop->push_arg);
+            message_t__free_unpacked(resp, NULL);
+            continue;
+        }
+
+        pthread_mutex_lock(&loop->lock);
+        struct rtable_request_t *request = loop->head;
+        if (resp == NULL) {
+            // Terminar todos os pedidos por responder
+            loop->closed = 1;
+            loop->head = loop->tail = NULL;
+        } else if (request != NULL) {
+            loop->head = request->next;
+            if (loop->head == NULL)
+                loop->tail = NULL;
+            request->next = NULL;
+        }
+        pthread_mutex_unlock(&loop->lock);
+
+        // Resposta sem pedido a espera, ninguem a liberta
+        if (resp != NULL && request == NULL) {
+            message_t__free_unpacked(resp, NULL);
+            continue;
+        }
+
+        // A resposta e entregue fora do lock, a callback pode submeter
+        while (request != NULL) {
+            struct rtable_request_t *next = request->next;
+            request->done(resp, request->arg);
+            free(request);
+            request = next;
+        }
+        if (resp == NULL)
+            break;
+    }
+
+    // Deixam de chegar mensagens do servidor
+    if (loop->push != NULL)
+        loop->push(NULL, loop->push_arg);
+
+    // A ligacao pode ser substituida a partir de agora
+    pthread_mutex_lock(&loop->lock);
+    loop->finished = 1;
+    pthread_mutex_unlock(&loop->lock);
+    return NULL;
+}
+
+/**
+ * Fecha a ligacao dos pedidos assincronos, terminando os pedidos
+ * por responder com erro, e espera pelo fim do ciclo de eventos.
+*/
+static void network_loop_destroy(struct rtable_loop_t *loop) {
+    shutdown(loop->conn.sockfd, SHUT_RDWR);
+    // Esperar pelo envio em curso, que falha com a ligacao fechada
+    pthread_mutex_lock(&loop->send_lock);
+    pthread_mutex_unlock(&loop->send_lock);
+    pthread_join(loop->thread, NULL);
+    conn_close(&loop->conn);
+    pthread_mutex_destroy(&loop->lock);
+    pthread_mutex_destroy(&loop->send_lock);
+    free(loop);
+}
+
+/**
+ * Abre a ligacao dos pedidos assincronos e inicia o seu ciclo de
+ * eventos.
+ * \return
+ *      A estrutura do ciclo ou NULL em caso de erro.
+*/
+static struct rtable_loop_t *network_loop_create(struct rtable_t *rtable) {
+    struct rtable_loop_t *loop = malloc(sizeof(struct rtable_loop_t));
+    if (loop == NULL)
+        return NULL;
+    int sockfd = network_open(rtable);
+    if (sockfd == -1) {
+        free(loop);
+        return NULL;
+    }
+    conn_init(&loop->conn, sockfd);
+    loop->head = loop->tail = NULL;
+    loop->closed = 0;
+    loop->finished = 0;
+    loop->push = rtable->push;
+    loop->push_arg = rtable->push_arg;
+    pthread_mutex_init(&loop->lock, NULL);
+    pthread_mutex_init(&loop->send_lock, NULL);
+    if (pthread_create(&loop->thread, NULL, network_loop, loop) != 0) {
+        conn_close(&loop->conn);
+        pthread_mutex_destroy(&loop->lock);
+        pthread_mutex_destroy(&loop->send_lock);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+int network_submit(struct rtable_t *rtable, MessageT *msg, network_done_t done, void *arg) {
+    if (rtable == NULL || msg == NULL || done == NULL)
+        return -1;
+    struct rtable_request_t *request = malloc(sizeof(struct rtable_request_t));
+    if (request == NULL)
+        return -1;
+    request->done = done;
+    request->arg = arg;
+    request->next = NULL;
+
+    // Durabilidade pedida para as escritas
+    pthread_mutex_lock(&rtable->pool_lock);
+    if (rtable->replicas != 0)
+        msg->replicas = rtable->replicas;
+    pthread_mutex_unlock(&rtable->pool_lock);
+
+    // Abrir a ligacao no primeiro pedido, ou de novo depois de a
+    // anterior falhar e terminar os seus pedidos
+    pthread_mutex_lock(&rtable->loop_lock);
+    struct rtable_loop_t *loop = rtable->loop;
+    if (loop != NULL) {
+        pthread_mutex_lock(&loop->lock);
+        int finished = loop->finished;
+        pthread_mutex_unlock(&loop->lock);
+        if (finished) {
+            network_loop_destroy(loop);
+            loop = rtable->loop = NULL;
+        }
+    }
+    if (loop == NULL)
+        loop = rtable->loop = network_loop_create(rtable);
+    // O ciclo so e destruido por quem tem loop_lock, depois do envio
+    if (loop != NULL)
+        pthread_mutex_lock(&loop->send_lock);
+    pthread_mutex_unlock(&rtable->loop_lock);
+    if (loop == NULL) {
+        free(request);
+        return -1;
+    }
+
+    // Colocar na fila antes de enviar, com o envio ordenado, para a
+    // fila ter a ordem pela qual os pedidos chegam ao servidor. O
+    // lock da fila nao e mantido no envio: o ciclo de eventos precisa
+    // dele a cada resposta, e o servidor so le o pedido seguinte
+    // depois de enviar as respostas anteriores
+    int result = -1;
+    pthread_mutex_lock(&loop->lock);
+    if (!loop->closed) {
+        if (loop->tail == NULL)
+            loop->head = request;
+        else
+            loop->tail->next = request;
+        loop->tail = request;
+        result = 0;
+    }
+    pthread_mutex_unlock(&loop->lock);
+
+    if (result == 0 && network_send(&loop->conn, msg) == -1) {
+        // A ligacao ficou a meio de um pedido, o ciclo termina os
+        // restantes com erro
+        shutdown(loop->conn.sockfd, SHUT_RDWR);
+        pthread_mutex_lock(&loop->lock);
+        struct rtable_request_t **prequest = &loop->head;
+        struct rtable_request_t *previous = NULL;
+        while (*prequest != NULL && *prequest != request) {
+            previous = *prequest;
+            prequest = &previous->next;
+        }
+        // Se ja nao esta na fila, o ciclo ja a terminou com erro
+        if (*prequest == request) {
+            *prequest = request->next;
+            if (loop->tail == request)
+                loop->tail = previous;
+            result = -1;
+        }
+        pthread_mutex_unlock(&loop->lock);
+    }
+    pthread_mutex_unlock(&loop->send_lock);
 
-    return msgptr;
+    if (result == -1)
+        free(request);
+    return result;
 }
 
 int network_close(struct rtable_t *rtable) {
-    return close(rtable->sockfd);
-}
\ No newline at end of file
+    if (rtable == NULL)
+        return -1;
+    int result = 0;
+
+    // Os pedidos assincronos por responder terminam com erro
+    pthread_mutex_lock(&rtable->loop_lock);
+    struct rtable_loop_t *loop = rtable->loop;
+    rtable->loop = NULL;
+    pthread_mutex_unlock(&rtable->loop_lock);
+    if (loop != NULL)
+        network_loop_destroy(loop);
+    pthread_mutex_lock(&rtable->pool_lock);
+    while (rtable->idle != NULL) {
+        struct rtable_conn_t *conn = rtable->idle;
+        rtable->idle = conn->next;
+        if (conn_close(conn) == -1)
+            result = -1;
+        free(conn);
+    }
+    rtable->n_idle = 0;
+    rtable->n_open = 0;
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return result;
+}
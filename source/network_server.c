@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 
@@ -38,6 +40,10 @@ pthread_mutex_t printmutex;
 // Identificador da thread main
 pthread_t mainthread;
 
+// Socket AF_UNIX dos clientes da mesma maquina, -1 se nao ha
+int unix_socket = -1;
+char unix_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+
 /**
  * Funcao auxiliar para imprimir, adicionando a estampilha de tempo
  * e o socket do cliente.
@@ -57,7 +63,7 @@ void network_server_print(char* ip, int port, const char *msg, ...) {
     pthread_mutex_lock(&printmutex);
     printf("\033[1A\033[2K\r");
     
-    if (id == mainthread)
+    if (id == mainthread || ip == NULL)
         printf("%s - main: ", timeString);
     else 
         printf("%s - \033[4;36m%s\033[0m-\033[4;32m%hu\033[0m: ", timeString, ip, port);
@@ -121,6 +127,53 @@ int network_server_init(short port) {
     return server_socket;
 }
 
+int network_server_init_unix(const char *path) {
+    struct sockaddr_un server;
+    if (path == NULL || strlen(path) >= sizeof(server.sun_path))
+        return -1;
+
+    // Criar um socket
+    int server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_socket < 0) {
+        perror("Error while creating socket\n");
+        return -1;
+    }
+
+    memset(&server, 0, sizeof(server));
+    server.sun_family = AF_UNIX;
+    strcpy(server.sun_path, path);
+
+    // O socket deixado por um servidor anterior impede o bind, mas
+    // outro ficheiro com o mesmo nome nao e apagado
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    // Ligar o socket ao caminho
+    if (bind(server_socket, (struct sockaddr*) &server, sizeof(server)) < 0) {
+        perror("Error while binding!\n");
+        close(server_socket);
+        return -1;
+    }
+
+    // Colocar o socket no modo de escuta
+    if (listen(server_socket, 0) < 0) {
+        perror("Error while listening to the socket!\n");
+        close(server_socket);
+        unlink(path);
+        return -1;
+    }
+
+    strcpy(unix_path, path);
+    unix_socket = server_socket;
+    printf("Server local socket ready.\n");
+    return server_socket;
+}
+
+const char *network_server_unix_path() {
+    return unix_socket == -1 ? NULL : unix_path;
+}
+
 /**
  * Funcao que vai ser executacao por cada thread.
 */
@@ -133,28 +186,63 @@ void *thread_loop(void *arg) {
     free(arg);
 
     // Obter o endereco ip a partir do file descriptor
-    struct sockaddr_in clientaddr;
-    socklen_t addr_size = sizeof(struct sockaddr_in);
-    int res = getpeername(sock, (struct sockaddr *)&clientaddr, &addr_size);
-    char ip[20];
-    if (res >= 0)
-        strcpy(ip, inet_ntoa(clientaddr.sin_addr));
-    unsigned  port = ntohs(clientaddr.sin_port);
+    struct sockaddr_storage peeraddr;
+    socklen_t addr_size = sizeof(peeraddr);
+    int res = getpeername(sock, (struct sockaddr *)&peeraddr, &addr_size);
+    char ip[20] = "local";
+    unsigned port = 0;
+    // Os clientes do socket local nao tem ip nem porto
+    if (res >= 0 && peeraddr.ss_family == AF_INET) {
+        struct sockaddr_in *clientaddr = (struct sockaddr_in *) &peeraddr;
+        strcpy(ip, inet_ntoa(clientaddr->sin_addr));
+        port = ntohs(clientaddr->sin_port);
+    }
     network_server_print(ip, port, "Client connection estabilished!\n");
 
     // Recebe pedidos do cliente usando a função network_receive
     MessageT *request = network_receive(sock);
     while (request != NULL) {
         network_server_print(ip, port, "Request received.\n");
+        // Durante a copia inicial da tabela so seguem as escritas da cadeia
+        table_skel_sync_wait(request);
+        // Uma subscricao reserva a ligacao aos eventos ate fechar, o
+        // pedido das escritas aplicadas ao envio delas e o das chaves
+        // seguidas ao envio das invalidacoes
+        if (request->opcode == MESSAGE_T__OPCODE__OP_WATCH) {
+            table_skel_watch(sock, request);
+            message_t__free_unpacked(request, NULL);
+            break;
+        }
+        if (request->opcode == MESSAGE_T__OPCODE__OP_CHANGES) {
+            table_skel_changes(sock, request);
+            message_t__free_unpacked(request, NULL);
+            break;
+        }
+        if (request->opcode == MESSAGE_T__OPCODE__OP_TRACK) {
+            table_skel_track(sock, request);
+            message_t__free_unpacked(request, NULL);
+            break;
+        }
         // Processa a mensagem na tabela
         if (invoke(request, hashtable, replicatedtable) == -1) {
             message_t__free_unpacked(request, NULL);
             break;
         }
-        // Enviar a resposta ao cliente
-        if (network_send(sock, request) == -1) {
+        // Enviar a resposta ao cliente. Uma resposta maior que o limite
+        // das mensagens e trocada por um erro, o cliente pode pedir menos
+        int sent;
+        if (message_t__get_packed_size(request) > MESSAGE_MAX_SIZE) {
+            MessageT error;
+            message_t__init(&error);
+            error.opcode = MESSAGE_T__OPCODE__OP_ERROR;
+            error.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+            sent = network_send(sock, &error);
+        } else {
+            sent = network_send(sock, request);
+        }
+        if (sent == -1) {
             message_t__free_unpacked(request, NULL);
-            continue;
+            break;
         }
         network_server_print(ip, port, "Answer sent.\n");
         message_t__free_unpacked(request, NULL);
@@ -168,22 +256,27 @@ void *thread_loop(void *arg) {
 }
 
 
-int network_main_loop(int listening_socket, struct table_t *table, s_rptable_t *rptable) {
-    if (table == NULL)
-        return -1;
-    
-    network_server_print(NULL, 0, "Server ready.\n");
-    struct sockaddr_in client;
+/**
+ * Aceita as ligacoes do socket de escuta e lanca uma thread para
+ * cada cliente, ate o socket ser fechado.
+ * \return
+ *      -1 quando deixa de aceitar ligacoes.
+*/
+static int network_accept_loop(int listening_socket) {
+    struct sockaddr_storage client;
     socklen_t size_client = sizeof(client);
     int connsockfd;
-    signal(SIGPIPE, SIG_IGN);
-    hashtable = table;
-    replicatedtable = rptable;
 
     // O loop principal continua a aceitar conexões de clientes
     while ((connsockfd = accept(listening_socket, (struct sockaddr *)&client, &size_client)) != -1) {
-        char *ip = inet_ntoa(client.sin_addr);
-        network_server_print(NULL, 0, "Client connecting from ip \033[4;36m%s\033[0m, port \033[4;32m%hu\033[0m\n", ip, htons(client.sin_port));
+        if (client.ss_family == AF_INET) {
+            struct sockaddr_in *clientaddr = (struct sockaddr_in *) &client;
+            char *ip = inet_ntoa(clientaddr->sin_addr);
+            network_server_print(NULL, 0, "Client connecting from ip \033[4;36m%s\033[0m, port \033[4;32m%hu\033[0m\n", ip, htons(clientaddr->sin_port));
+        } else {
+            network_server_print(NULL, 0, "Client connecting from the local socket\n");
+        }
+        size_client = sizeof(client);
 
         in_port_t *sock = malloc(sizeof(in_port_t));
         if (sock == NULL) {
@@ -203,6 +296,34 @@ int network_main_loop(int listening_socket, struct table_t *table, s_rptable_t *
     return -1;
 }
 
+/**
+ * Thread que aceita as ligacoes do socket local.
+*/
+static void *unix_accept_loop(void *arg) {
+    network_accept_loop(unix_socket);
+    return NULL;
+}
+
+int network_main_loop(int listening_socket, struct table_t *table, s_rptable_t *rptable) {
+    if (table == NULL)
+        return -1;
+    
+    network_server_print(NULL, 0, "Server ready.\n");
+    signal(SIGPIPE, SIG_IGN);
+    hashtable = table;
+    replicatedtable = rptable;
+
+    // As ligacoes locais sao aceites numa thread propria
+    if (unix_socket != -1) {
+        pthread_t thr;
+        if (pthread_create(&thr, NULL, &unix_accept_loop, NULL) != 0)
+            network_server_print(NULL, 0, "Error creating thread for the local socket!");
+        else
+            pthread_detach(thr);
+    }
+    return network_accept_loop(listening_socket);
+}
+
 MessageT *network_receive(int client_socket) {
     unsigned short resqsize_bign; 
 
@@ -230,8 +351,11 @@ MessageT *network_receive(int client_socket) {
 }
 
 int network_send(int client_socket, MessageT *msg) {
-    // Obter o tamanho da resposta
+    // Obter o tamanho da resposta, que tem de caber nos 16 bits do
+    // tamanho enviado
     int msgsize = message_t__get_packed_size(msg); 
+    if (msgsize > MESSAGE_MAX_SIZE)
+        return -1;
     unsigned short msgsize_bign = htons((short)msgsize); 
 
     // Enviar o tamanho da resposta
@@ -256,11 +380,24 @@ int network_send(int client_socket, MessageT *msg) {
     return 0;
 }
 
+int network_peer_closed(int client_socket) {
+    char byte;
+    ssize_t n = recv(client_socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
 int network_server_close(int socket) {
-    int result;
+    int result = 0;
     if (pthread_mutex_destroy(&printmutex) != 0)
         result = -1;
     if (close(socket) != 0)
         result = -1;
+    // Fechar tambem o socket local e apagar o seu caminho
+    if (unix_socket != -1) {
+        if (close(unix_socket) != 0)
+            result = -1;
+        unlink(unix_path);
+        unix_socket = -1;
+    }
     return result;
 }
\ No newline at end of file
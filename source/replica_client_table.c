@@ -7,6 +7,8 @@
 */
 
 #include "data.h"
+#include "hash.h"
+#include "ring.h"
 #include "entry.h"
 #include "table.h"
 #include "client_stub.h"
@@ -18,13 +20,869 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 // Funcoes para fazer call-back
 node_watcher rptable_watcher = NULL;
 failure_handler rptable_fhandler = NULL;
 
+/**
+ * Retorna a posicao, nas cadeias atuais, da cadeia que guardava a
+ * chave antes da ultima mudanca das cadeias, se for diferente da
+ * dona atual, ou -1 se a chave nao mudou de dono, se nao ha uma
+ * migracao pendente ou se essa cadeia saiu.
+*/
+static int rptable_prev_chain(c_rptable_t *rptable, char *key) {
+    if (rptable->ring == NULL || rptable->prev_ring == NULL)
+        return -1;
+    int prev = ring_lookup(rptable->prev_ring, key);
+    int index = ring_lookup(rptable->ring, key);
+    if (prev == -1 || index == -1 || strcmp(rptable->prev_names[prev], rptable->chains[index].name) == 0)
+        return -1;
+    for (int i = 0; i < rptable->n_chains; i++)
+        if (strcmp(rptable->prev_names[prev], rptable->chains[i].name) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * Retorna a ligacao a cabeca da cadeia index, ou NULL se nao
+ * estiver ligado a essa cadeia.
+*/
+static struct rtable_t *rptable_writer_at(c_rptable_t *rptable, int index) {
+    struct rtable_t *rtable = NULL;
+    if (rptable->ring == NULL) {
+        if (rptable->rptable_wsocket != NULL)
+            rtable = rptable->rtable_w;
+    } else if (index != -1) {
+        rtable = rptable->chains[index].rtable_w;
+    }
+    // A ligacao pode ter sido refeita depois de mudar a cabeca
+    if (rtable != NULL)
+        rtable_set_durability(rtable, rptable->durability);
+    return rtable;
+}
+
+/**
+ * Retorna a ligacao a cabeca da cadeia que recebe as escritas da
+ * chave, ou NULL se nao estiver ligado a essa cadeia. Durante uma
+ * migracao e a cabeca do dono anterior, que migra a chave, se ainda
+ * a tem, antes de reencaminhar a escrita ao novo dono, para a
+ * escrita ser feita sobre o valor atual.
+*/
+static struct rtable_t *rptable_writer(c_rptable_t *rptable, char *key) {
+    if (rptable->ring == NULL)
+        return rptable_writer_at(rptable, 0);
+    int index = rptable_prev_chain(rptable, key);
+    return rptable_writer_at(rptable, index != -1 ? index : ring_lookup(rptable->ring, key));
+}
+
+/**
+ * Retorna a ligacao a cauda da cadeia que guarda a chave, ou
+ * NULL se nao estiver ligado a essa cadeia.
+*/
+static struct rtable_t *rptable_reader(c_rptable_t *rptable, char *key) {
+    if (rptable->ring == NULL)
+        return rptable->rptable_rsocket == NULL ? NULL : rptable->rtable_r;
+    int index = ring_lookup(rptable->ring, key);
+    return index == -1 ? NULL : rptable->chains[index].rtable_r;
+}
+
+/**
+ * Retorna o numero de cadeias, 1 se a instalacao nao e particionada.
+*/
+static int rptable_n_chains(c_rptable_t *rptable) {
+    return rptable->ring == NULL ? 1 : rptable->n_chains;
+}
+
+/**
+ * Retorna a ligacao a cauda da cadeia index, ou NULL se nao
+ * estiver ligado a essa cadeia.
+*/
+static struct rtable_t *rptable_reader_at(c_rptable_t *rptable, int index) {
+    if (rptable->ring == NULL)
+        return rptable->rptable_rsocket == NULL ? NULL : rptable->rtable_r;
+    return rptable->chains[index].rtable_r;
+}
+
+/**
+ * Fecha as ligacoes as replicas de uma cadeia.
+*/
+static void replicas_destroy(struct rptable_replicas_t *replicas) {
+    for (int i = 0; i < replicas->n_replicas; i++)
+        if (replicas->rtables[i] != NULL)
+            rtable_disconnect(replicas->rtables[i]);
+    free_children(replicas->sockets);
+    free(replicas->rtables);
+    replicas->sockets = NULL;
+    replicas->rtables = NULL;
+    replicas->n_replicas = 0;
+}
+
+/**
+ * Le os servidores da cadeia em path e liga-se a cada um,
+ * reaproveitando as ligacoes aos servidores que continuam.
+ * Uma replica a que nao consegue ligar fica a NULL e nao e lida.
+ * \return
+ *      0 (OK) ou -1 em caso de erro, sem alterar as replicas.
+*/
+static int replicas_refresh(zhandle_t *handler, char *path, struct rptable_replicas_t *replicas) {
+    char **sockets = get_servers(handler, path, zknode_watcher);
+    if (sockets == NULL)
+        return -1;
+    int n_replicas = 0;
+    while (sockets[n_replicas] != NULL)
+        n_replicas++;
+    struct rtable_t **rtables = calloc(n_replicas + 1, sizeof(struct rtable_t *));
+    if (rtables == NULL) {
+        free_children(sockets);
+        return -1;
+    }
+
+    for (int i = 0; i < n_replicas; i++) {
+        // Manter a ligacao se o servidor ja estava na cadeia
+        for (int j = 0; j < replicas->n_replicas && rtables[i] == NULL; j++) {
+            if (replicas->rtables[j] != NULL && strcmp(replicas->sockets[j], sockets[i]) == 0) {
+                rtables[i] = replicas->rtables[j];
+                replicas->rtables[j] = NULL;
+            }
+        }
+        if (rtables[i] == NULL)
+            rtables[i] = rtable_connect(sockets[i]);
+    }
+
+    replicas_destroy(replicas);
+    replicas->sockets = sockets;
+    replicas->rtables = rtables;
+    replicas->n_replicas = n_replicas;
+    return 0;
+}
+
+/**
+ * Escolhe, de forma rotativa, a replica que serve a proxima
+ * leitura de uma chave, ou fallback se nao ha nenhuma ligada.
+*/
+static struct rtable_t *replicas_next(struct rptable_replicas_t *replicas, struct rtable_t *fallback) {
+    for (int i = 0; i < replicas->n_replicas; i++) {
+        // Varias threads podem ler ao mesmo tempo
+        unsigned int next = __sync_fetch_and_add(&replicas->next, 1);
+        struct rtable_t *rtable = replicas->rtables[next % replicas->n_replicas];
+        if (rtable != NULL)
+            return rtable;
+    }
+    return fallback;
+}
+
+/**
+ * Retorna a ligacao a uma das replicas da cadeia que guarda a
+ * chave, para as leituras de uma so chave, ou NULL se nao estiver
+ * ligado a essa cadeia.
+*/
+static struct rtable_t *rptable_replica(c_rptable_t *rptable, char *key) {
+    struct rtable_t *tail = rptable_reader(rptable, key);
+    if (rptable->ring == NULL)
+        return replicas_next(&rptable->replicas, tail);
+    int index = ring_lookup(rptable->ring, key);
+    return index == -1 ? NULL : replicas_next(&rptable->chains[index].replicas, tail);
+}
+
+/**
+ * Chama visit para cada ligacao a um servidor, nas cadeias e
+ * nas replicas.
+*/
+static void rptable_visit(c_rptable_t *rptable, void (*visit)(struct rtable_t *, void *), void *arg) {
+    struct rtable_t *rtables[2] = {rptable->rtable_w, rptable->rtable_r};
+    struct rptable_replicas_t *replicas = &rptable->replicas;
+    for (int c = 0; c < rptable_n_chains(rptable); c++) {
+        if (rptable->ring != NULL) {
+            rtables[0] = rptable->chains[c].rtable_w;
+            rtables[1] = rptable->chains[c].rtable_r;
+            replicas = &rptable->chains[c].replicas;
+        }
+        for (int i = 0; i < 2; i++)
+            if (rtables[i] != NULL)
+                visit(rtables[i], arg);
+        for (int i = 0; i < replicas->n_replicas; i++)
+            if (replicas->rtables[i] != NULL)
+                visit(replicas->rtables[i], arg);
+    }
+}
+
+static void pool_resize(struct rtable_t *rtable, void *arg) {
+    rtable_set_pool_size(rtable, *(int *) arg);
+}
+
+static void pool_sum(struct rtable_t *rtable, void *arg) {
+    struct rtable_pool_stats_t *total = arg, stats;
+    if (rtable_pool_stats(rtable, &stats) == -1)
+        return;
+    total->open += stats.open;
+    total->idle += stats.idle;
+    total->checkouts += stats.checkouts;
+    total->waits += stats.waits;
+}
+
+/**
+ * Retorna o valor da chave na cache, ou NULL se nao estiver.
+ * Chamada com o lock da cache.
+*/
+static struct rptable_cached_t *cache_lookup(struct rptable_cache_t *cache, char *key) {
+    struct rptable_cached_t *cached = cache->buckets[hash_key(key) % cache->n_buckets];
+    while (cached != NULL && strcmp(cached->key, key) != 0)
+        cached = cached->next;
+    return cached;
+}
+
+/**
+ * Retira o valor da lista LRU. Chamada com o lock da cache.
+*/
+static void cache_unlink(struct rptable_cache_t *cache, struct rptable_cached_t *cached) {
+    if (cached->newer != NULL)
+        cached->newer->older = cached->older;
+    else
+        cache->newest = cached->older;
+    if (cached->older != NULL)
+        cached->older->newer = cached->newer;
+    else
+        cache->oldest = cached->newer;
+    cached->newer = cached->older = NULL;
+}
+
+/**
+ * Passa o valor para o inicio da lista LRU. Chamada com o lock
+ * da cache.
+*/
+static void cache_touch(struct rptable_cache_t *cache, struct rptable_cached_t *cached) {
+    if (cache->newest == cached)
+        return;
+    if (cached->newer != NULL || cached->older != NULL || cache->oldest == cached)
+        cache_unlink(cache, cached);
+    cached->older = cache->newest;
+    if (cache->newest != NULL)
+        cache->newest->newer = cached;
+    cache->newest = cached;
+    if (cache->oldest == NULL)
+        cache->oldest = cached;
+}
+
+/**
+ * Remove e liberta o valor. Chamada com o lock da cache.
+*/
+static void cache_remove(struct rptable_cache_t *cache, struct rptable_cached_t *cached) {
+    struct rptable_cached_t **pnext = &cache->buckets[hash_key(cached->key) % cache->n_buckets];
+    while (*pnext != cached)
+        pnext = &(*pnext)->next;
+    *pnext = cached->next;
+    cache_unlink(cache, cached);
+    cache->n_entries--;
+    if (cached->data != NULL)
+        data_destroy(cached->data);
+    free(cached->key);
+    free(cached);
+}
+
+/**
+ * Remove todos os valores. Chamada com o lock da cache.
+*/
+static void cache_clear(struct rptable_cache_t *cache) {
+    while (cache->oldest != NULL)
+        cache_remove(cache, cache->oldest);
+}
+
+/**
+ * Reserva o lugar da chave para a leitura fill, removendo o valor
+ * usado ha mais tempo se a cache esta cheia. Chamada com o lock da
+ * cache.
+ * \return
+ *      O lugar, ainda sem valor, ou NULL em caso de erro.
+*/
+static struct rptable_cached_t *cache_reserve(struct rptable_cache_t *cache, char *key,
+                                              unsigned long fill) {
+    if (cache->n_entries >= cache->max_entries && cache->oldest != NULL) {
+        cache_remove(cache, cache->oldest);
+        cache->evictions++;
+    }
+    struct rptable_cached_t *cached = calloc(1, sizeof(struct rptable_cached_t));
+    if (cached == NULL)
+        return NULL;
+    if ((cached->key = strdup(key)) == NULL) {
+        free(cached);
+        return NULL;
+    }
+    cached->fill = fill;
+    int bucket = hash_key(key) % cache->n_buckets;
+    cached->next = cache->buckets[bucket];
+    cache->buckets[bucket] = cached;
+    cache->n_entries++;
+    cache_touch(cache, cached);
+    return cached;
+}
+
+/**
+ * Recebe, no ciclo de eventos de um tracker, as chaves que mudaram
+ * na cauda. Se a cauda perdeu avisos, a cache e esvaziada. Se a
+ * ligacao falhou, os avisos seguintes perdem-se e a cache e
+ * esvaziada, deixando de ser usada nessa cadeia ate os trackers
+ * serem refeitos.
+*/
+static void cache_invalidated(char **keys, int n_keys, void *arg) {
+    struct rptable_tracker_t *tracker = (struct rptable_tracker_t *) arg;
+    struct rptable_cache_t *cache = tracker->cache;
+    pthread_mutex_lock(&cache->lock);
+    if (keys == NULL) {
+        if (n_keys == 0)
+            tracker->live = 0;
+        cache_clear(cache);
+    }
+    for (int i = 0; keys != NULL && i < n_keys; i++) {
+        struct rptable_cached_t *cached = cache_lookup(cache, keys[i]);
+        if (cached == NULL)
+            continue;
+        if (cached->data != NULL)
+            cache->invalidations++;
+        cache_remove(cache, cached);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * Fecha as ligacoes dos trackers e liberta o array. Chamada sem o
+ * lock da cache, que o ciclo de eventos de cada um pode estar a
+ * pedir.
+*/
+static void trackers_destroy(struct rptable_tracker_t *trackers, int n_trackers) {
+    for (int i = 0; i < n_trackers; i++)
+        if (trackers[i].rtable != NULL)
+            rtable_disconnect(trackers[i].rtable);
+    free(trackers);
+}
+
+/**
+ * Esvazia a cache e refaz os trackers, ligando-se a cauda atual de
+ * cada cadeia. Uma cadeia cujo tracker nao liga nao usa a cache.
+ * Chamada dentro da seccao critica de escrita da tabela.
+*/
+static void cache_track(c_rptable_t *rptable) {
+    struct rptable_cache_t *cache = rptable->cache;
+    pthread_mutex_lock(&cache->lock);
+    struct rptable_tracker_t *old = cache->trackers;
+    int n_old = cache->n_trackers;
+    cache->trackers = NULL;
+    cache->n_trackers = 0;
+    pthread_mutex_unlock(&cache->lock);
+    trackers_destroy(old, n_old);
+
+    int n_trackers = rptable_n_chains(rptable);
+    struct rptable_tracker_t *trackers = calloc(n_trackers, sizeof(struct rptable_tracker_t));
+    for (int i = 0; trackers != NULL && i < n_trackers; i++) {
+        char *socket = rptable->ring == NULL ? rptable->rptable_rsocket : rptable->chains[i].rsocket;
+        trackers[i].cache = cache;
+        if (socket == NULL || (trackers[i].rtable = rtable_connect(socket)) == NULL)
+            continue;
+        // Marcada antes do pedido, para uma falha logo a seguir a desmarcar
+        pthread_mutex_lock(&cache->lock);
+        trackers[i].live = 1;
+        pthread_mutex_unlock(&cache->lock);
+        if (rtable_track(trackers[i].rtable, cache->id, cache_invalidated, &trackers[i]) == -1) {
+            pthread_mutex_lock(&cache->lock);
+            trackers[i].live = 0;
+            pthread_mutex_unlock(&cache->lock);
+        }
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache_clear(cache);
+    cache->trackers = trackers;
+    cache->n_trackers = trackers == NULL ? 0 : n_trackers;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * Fecha os trackers e liberta a cache.
+*/
+static void cache_destroy(struct rptable_cache_t *cache) {
+    if (cache == NULL)
+        return;
+    trackers_destroy(cache->trackers, cache->n_trackers);
+    cache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
+
+/**
+ * Cria a cache sem valores nem trackers.
+ * \return
+ *      A cache ou NULL em caso de erro.
+*/
+static struct rptable_cache_t *cache_create(int max_entries) {
+    struct rptable_cache_t *cache = calloc(1, sizeof(struct rptable_cache_t));
+    if (cache == NULL)
+        return NULL;
+    cache->n_buckets = max_entries;
+    if ((cache->buckets = calloc(cache->n_buckets, sizeof(struct rptable_cached_t *))) == NULL) {
+        free(cache);
+        return NULL;
+    }
+    cache->max_entries = max_entries;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    // Identificador aleatorio, para os servidores distinguirem os clientes
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uintptr_t address = (uintptr_t) cache;
+    cache->id = hash_bytes(&now, sizeof(now)) ^ hash_bytes(&address, sizeof(address));
+    if (cache->id == 0)
+        cache->id = 1;
+    return cache;
+}
+
+/**
+ * Esquece as chaves escritas pelo cliente, para uma leitura depois
+ * da escrita nao devolver o valor anterior antes de chegar o aviso
+ * da cauda. Tambem descarta as leituras dessas chaves em curso.
+*/
+static void cache_forget(c_rptable_t *rptable, char **keys, int n_keys) {
+    struct rptable_cache_t *cache = rptable->cache;
+    if (cache == NULL)
+        return;
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < n_keys; i++) {
+        struct rptable_cached_t *cached = keys[i] == NULL ? NULL : cache_lookup(cache, keys[i]);
+        if (cached != NULL)
+            cache_remove(cache, cached);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * Le a chave da cache ou, se nao estiver, da cauda da sua cadeia,
+ * guardando o valor se a cauda passou a segui-la e nenhum aviso
+ * chegou entretanto.
+ * \param data
+ *      Onde guardar o valor, NULL se a chave nao existe.
+ * \return
+ *      1 se a leitura foi feita ou 0 se a cache nao pode ser usada
+ *      para a chave.
+*/
+static int cache_read(c_rptable_t *rptable, char *key, struct data_t **data, unsigned long *version) {
+    struct rptable_cache_t *cache = rptable->cache;
+    if (cache == NULL || rptable->prev_ring != NULL)
+        return 0;
+    int index = rptable->ring == NULL ? 0 : ring_lookup(rptable->ring, key);
+    struct rtable_t *tail = rptable_reader(rptable, key);
+    if (index == -1 || tail == NULL)
+        return 0;
+
+    pthread_mutex_lock(&cache->lock);
+    if (index >= cache->n_trackers || !cache->trackers[index].live) {
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+    struct rptable_cached_t *cached = cache_lookup(cache, key);
+    if (cached != NULL && cached->data != NULL) {
+        cache_touch(cache, cached);
+        *data = data_dup(cached->data);
+        if (*data != NULL) {
+            cache->hits++;
+            if (version != NULL)
+                *version = cached->version;
+            pthread_mutex_unlock(&cache->lock);
+            return 1;
+        }
+    }
+    cache->misses++;
+    // Outra thread ja esta a ler a chave, esta le sem guardar
+    unsigned long fill = 0;
+    if (cached == NULL && cache_reserve(cache, key, cache->fills + 1) != NULL)
+        fill = ++cache->fills;
+    pthread_mutex_unlock(&cache->lock);
+
+    unsigned long read_version = 0;
+    int tracked = 0;
+    *data = rtable_get_track(tail, key, cache->id, &read_version, &tracked);
+    if (version != NULL)
+        *version = read_version;
+
+    if (fill == 0)
+        return 1;
+    pthread_mutex_lock(&cache->lock);
+    // O lugar desaparece se a chave mudou ou foi removida entretanto
+    cached = cache_lookup(cache, key);
+    if (cached != NULL && cached->fill == fill) {
+        struct data_t *copy = *data != NULL && tracked ? data_dup(*data) : NULL;
+        if (copy == NULL) {
+            cache_remove(cache, cached);
+        } else {
+            cached->data = copy;
+            cached->version = read_version;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return 1;
+}
+
+/**
+ * Copia o valor guardado na cache para buf, sem reservar memoria.
+ * Uma falta nao reserva lugar para a chave, porque guardar o valor
+ * lido obrigaria a copia-lo.
+ * \return
+ *      O tamanho do valor ou -1 se nao esta na cache.
+*/
+static int cache_read_into(c_rptable_t *rptable, char *key, void *buf, int size,
+                           unsigned long *version) {
+    struct rptable_cache_t *cache = rptable->cache;
+    if (cache == NULL || rptable->prev_ring != NULL)
+        return -1;
+    int index = rptable->ring == NULL ? 0 : ring_lookup(rptable->ring, key);
+    if (index == -1)
+        return -1;
+
+    int result = -1;
+    pthread_mutex_lock(&cache->lock);
+    struct rptable_cached_t *cached = NULL;
+    if (index < cache->n_trackers && cache->trackers[index].live)
+        cached = cache_lookup(cache, key);
+    if (cached != NULL && cached->data != NULL) {
+        cache_touch(cache, cached);
+        result = cached->data->datasize;
+        if (result <= size)
+            memcpy(buf, cached->data->data, result);
+        if (version != NULL)
+            *version = cached->version;
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+/**
+ * Fecha as ligacoes das cadeias e liberta o array.
+*/
+static void chains_destroy(struct rptable_chain_t *chains, int n_chains) {
+    if (chains == NULL)
+        return;
+    for (int i = 0; i < n_chains; i++) {
+        replicas_destroy(&chains[i].replicas);
+        free(chains[i].name);
+        free(chains[i].wsocket);
+        free(chains[i].rsocket);
+        if (chains[i].rtable_w != NULL)
+            rtable_disconnect(chains[i].rtable_w);
+        if (chains[i].rtable_r != NULL)
+            rtable_disconnect(chains[i].rtable_r);
+    }
+    free(chains);
+}
+
+/**
+ * Liga-se ao servidor socket, obtido do ZooKeeper, guardando a
+ * ligacao em new_socket e new_rtable. Se a ligacao antiga for ao 
+ * mesmo servidor, passa-a para a nova em vez de abrir outra.
+ * Se socket nao for valido ou a ligacao falhar, a nova fica a
+ * NULL e os pedidos a essa cadeia falham ate a proxima mudanca.
+*/
+static void chain_link(char *socket, char **old_socket, struct rtable_t **old_rtable,
+                       char **new_socket, struct rtable_t **new_rtable) {
+    *new_socket = NULL;
+    *new_rtable = NULL;
+    if (socket == NULL || socket == ZDATA_NOT_FOUND)
+        return;
+
+    // Manter a ligacao se o servidor nao mudou
+    if (*old_socket != NULL && *old_rtable != NULL && strcmp(*old_socket, socket) == 0) {
+        free(socket);
+        *new_socket = *old_socket;
+        *new_rtable = *old_rtable;
+        *old_socket = NULL;
+        *old_rtable = NULL;
+        return;
+    }
+
+    if ((*new_rtable = rtable_connect(socket)) == NULL) {
+        free(socket);
+        return;
+    }
+    *new_socket = socket;
+}
+
+/**
+ * Liberta o anel anterior a ultima mudanca das cadeias.
+*/
+static void prev_ring_destroy(c_rptable_t *table) {
+    if (table->prev_ring == NULL)
+        return;
+    ring_destroy(table->prev_ring);
+    free_children(table->prev_names);
+    table->prev_ring = NULL;
+    table->prev_names = NULL;
+    table->migration_seen = 0;
+}
+
+/**
+ * Le as cadeias em RPTABLE_ZK_SHARDS_PATH, liga-se a cabeca e a
+ * cauda de cada uma e reconstroi o anel, reaproveitando as 
+ * ligacoes que nao mudaram. Coloca watchers no no das particoes
+ * e no de cada cadeia.
+ * \return
+ *      0 (OK) ou -1 em caso de erro, sem alterar a estrutura.
+*/
+static int shards_refresh(c_rptable_t *table) {
+    char **names = get_children(table->handler, RPTABLE_ZK_SHARDS_PATH, zknode_watcher);
+    if (names == NULL)
+        return -1;
+    int n_chains = 0;
+    while (names[n_chains] != NULL)
+        n_chains++;
+    if (n_chains == 0) {
+        free_children(names);
+        return -1;
+    }
+
+    struct rptable_chain_t *chains = calloc(n_chains, sizeof(struct rptable_chain_t));
+    struct ring_t *ring = ring_create(names, n_chains);
+    if (chains == NULL || ring == NULL) {
+        free(chains);
+        ring_destroy(ring);
+        free_children(names);
+        return -1;
+    }
+
+    for (int i = 0; i < n_chains; i++) {
+        // Procurar a cadeia nas ligacoes atuais
+        struct rptable_chain_t none = {NULL, NULL, NULL, NULL, NULL, {NULL, NULL, 0, 0}};
+        struct rptable_chain_t *old = &none;
+        for (int j = 0; j < table->n_chains; j++)
+            if (strcmp(table->chains[j].name, names[i]) == 0)
+                old = &table->chains[j];
+
+        chains[i].name = names[i];
+        char *path = get_child_path(RPTABLE_ZK_SHARDS_PATH, names[i]);
+        if (path == NULL)
+            continue;
+        chain_link(get_head_server(table->handler, path, zknode_watcher),
+                   &old->wsocket, &old->rtable_w, &chains[i].wsocket, &chains[i].rtable_w);
+        chain_link(get_tail_server(table->handler, path, zknode_watcher),
+                   &old->rsocket, &old->rtable_r, &chains[i].rsocket, &chains[i].rtable_r);
+        chains[i].replicas = old->replicas;
+        old->replicas = none.replicas;
+        replicas_refresh(table->handler, path, &chains[i].replicas);
+        free(path);
+    }
+    // Os nomes passaram para as cadeias
+    free(names);
+
+    // Se as cadeias mudaram, guardar o anel anterior para as leituras
+    // das chaves que ainda nao chegaram ao novo dono
+    int changed = table->ring != NULL && table->n_chains != n_chains;
+    for (int i = 0; table->ring != NULL && !changed && i < n_chains; i++)
+        changed = strcmp(table->chains[i].name, chains[i].name) != 0;
+    if (changed) {
+        char **prev_names = calloc(table->n_chains + 1, sizeof(char *));
+        if (prev_names != NULL) {
+            prev_ring_destroy(table);
+            for (int i = 0; i < table->n_chains; i++) {
+                prev_names[i] = table->chains[i].name;
+                table->chains[i].name = NULL;
+            }
+            table->prev_ring = table->ring;
+            table->prev_names = prev_names;
+            table->migration_seen = 0;
+            table->ring = NULL;
+        }
+    }
+
+    // Fechar as ligacoes que deixaram de ser usadas
+    chains_destroy(table->chains, table->n_chains);
+    ring_destroy(table->ring);
+    table->chains = chains;
+    table->n_chains = n_chains;
+    table->ring = ring;
+
+    // O anel anterior deixa de ser preciso quando termina a primeira
+    // migracao depois da mudanca
+    char **migrations = get_children(table->handler, RPTABLE_ZK_MIGRATIONS_PATH, zknode_watcher);
+    if (migrations != NULL) {
+        if (migrations[0] != NULL)
+            table->migration_seen = 1;
+        else if (table->migration_seen)
+            prev_ring_destroy(table);
+        free_children(migrations);
+    }
+    return 0;
+}
+
+/**
+ * Retorna a ligacao a cauda da cadeia que guardava a chave antes
+ * da ultima mudanca das cadeias, se for diferente da atual, ou NULL
+ * se a chave nao mudou de dono ou nao ha uma migracao pendente. Uma
+ * cadeia que saiu ja nao pode ser lida.
+*/
+static struct rtable_t *rptable_prev_reader(c_rptable_t *rptable, char *key) {
+    int index = rptable_prev_chain(rptable, key);
+    return index == -1 ? NULL : rptable->chains[index].rtable_r;
+}
+
+/**
+ * Acrescenta os elementos do array more, terminado por NULL, ao
+ * fim do array, tambem terminado por NULL. Os elementos passam
+ * para o array retornado e more e libertado.
+ * \return
+ *      O array aumentado ou NULL em caso de erro, deixando
+ *      array e more intactos.
+*/
+static void **array_concat(void **array, void **more) {
+    int n = 0, m = 0;
+    while (array[n] != NULL)
+        n++;
+    while (more[m] != NULL)
+        m++;
+    void **result = realloc(array, (n + m + 1) * sizeof(void *));
+    if (result == NULL)
+        return NULL;
+    memcpy(result + n, more, (m + 1) * sizeof(void *));
+    free(more);
+    return result;
+}
+
+static int slab_size_compare(const void *a, const void *b) {
+    return ((const slab_stats_t *) a)->size - ((const slab_stats_t *) b)->size;
+}
+
+/**
+ * Soma as estatisticas de dois servidores.
+ * \return
+ *      Nova estrutura ou NULL em caso de erro.
+*/
+static struct statistics_t *stats_sum(struct statistics_t *a, struct statistics_t *b) {
+    struct statistics_t *sum = stats_init_args(stats_get_n_op(a) + stats_get_n_op(b),
+                                    stats_get_time_lasted(a) + stats_get_time_lasted(b),
+                                    stats_get_n_client(a) + stats_get_n_client(b),
+                                    stats_get_n_evicted(a) + stats_get_n_evicted(b),
+                                    stats_get_memory(a) + stats_get_memory(b));
+    if (sum == NULL)
+        return NULL;
+
+    // Cada servidor so envia as classes do alocador que usa, por isso
+    // as classes sao juntadas pelo tamanho dos objetos
+    int n_a = stats_get_n_slabs(a), n_b = stats_get_n_slabs(b);
+    if (n_a < 0 || n_b < 0) {
+        stats_destroy(sum);
+        return NULL;
+    }
+    slab_stats_t slabs[n_a + n_b + 1];
+    int n_slabs = 0;
+    for (int i = 0; i < n_a; i++)
+        if (stats_get_slab(a, i, &slabs[n_slabs]) == 0)
+            n_slabs++;
+    for (int i = 0; i < n_b; i++) {
+        slab_stats_t other;
+        if (stats_get_slab(b, i, &other) == -1)
+            continue;
+        int j = 0;
+        while (j < n_slabs && slabs[j].size != other.size)
+            j++;
+        if (j == n_slabs) {
+            slabs[n_slabs++] = other;
+        } else {
+            slabs[j].used += other.used;
+            slabs[j].capacity += other.capacity;
+        }
+    }
+    qsort(slabs, n_slabs, sizeof(slab_stats_t), slab_size_compare);
+    if (stats_set_slabs(sum, slabs, n_slabs) == -1) {
+        stats_destroy(sum);
+        return NULL;
+    }
+
+    for (int i = 0; i < STATS_DURABILITY_LEVELS; i++) {
+        long ops_a, time_a, ops_b, time_b;
+        stats_get_write(a, i, &ops_a, &time_a);
+        stats_get_write(b, i, &ops_b, &time_b);
+        stats_set_write(sum, i, ops_a + ops_b, time_a + time_b);
+    }
+    return sum;
+}
+
+static int entry_key_compare(const void *a, const void *b) {
+    return strcmp((*(struct entry_t * const *) a)->key, (*(struct entry_t * const *) b)->key);
+}
+
+/* Entrada retornada por uma cadeia, que pode ja nao ser a dona */
+struct chain_entry_t {
+    struct entry_t *entry;
+    int owned;
+};
+
+static int chain_entry_compare(const void *a, const void *b) {
+    const struct chain_entry_t *x = a, *y = b;
+    int result = strcmp(x->entry->key, y->entry->key);
+    // A entrada da cadeia dona fica primeiro
+    return result != 0 ? result : y->owned - x->owned;
+}
+
+/**
+ * Junta num so array, terminado por NULL, as entradas retornadas por
+ * cada cadeia, libertando os arrays das cadeias. Durante uma migracao
+ * o dono anterior pode ainda ter uma chave que o novo dono ja recebeu
+ * ou escreveu, e fica so a entrada da cadeia dona. Nesse caso as
+ * entradas ficam por ordem das chaves.
+ * \return
+ *      O array ou NULL em caso de erro, libertando as entradas.
+*/
+static struct entry_t **chains_merge(c_rptable_t *rptable, struct entry_t ***per_chain, int n_chains) {
+    int n = 0, strays = 0;
+    for (int c = 0; c < n_chains; c++)
+        for (int i = 0; per_chain[c][i] != NULL; i++, n++)
+            if (rptable->ring != NULL && ring_lookup(rptable->ring, per_chain[c][i]->key) != c)
+                strays++;
+    struct entry_t **entries = malloc((n + 1) * sizeof(struct entry_t *));
+    struct chain_entry_t *sorted = strays == 0 ? NULL : malloc(n * sizeof(struct chain_entry_t));
+    if (entries == NULL || (strays > 0 && sorted == NULL)) {
+        free(entries);
+        free(sorted);
+        for (int c = 0; c < n_chains; c++)
+            rtable_free_entries(per_chain[c]);
+        return NULL;
+    }
+
+    n = 0;
+    for (int c = 0; c < n_chains; c++) {
+        for (int i = 0; per_chain[c][i] != NULL; i++, n++) {
+            if (sorted == NULL) {
+                entries[n] = per_chain[c][i];
+                continue;
+            }
+            sorted[n].entry = per_chain[c][i];
+            sorted[n].owned = ring_lookup(rptable->ring, per_chain[c][i]->key) == c;
+        }
+        free(per_chain[c]);
+    }
+
+    if (sorted != NULL) {
+        qsort(sorted, n, sizeof(struct chain_entry_t), chain_entry_compare);
+        int kept = 0;
+        for (int i = 0; i < n; i++) {
+            if (kept > 0 && strcmp(entries[kept - 1]->key, sorted[i].entry->key) == 0)
+                entry_destroy(sorted[i].entry);
+            else
+                entries[kept++] = sorted[i].entry;
+        }
+        n = kept;
+        free(sorted);
+    }
+    entries[n] = NULL;
+    return entries;
+}
+
 c_rptable_t *rptable_connect(node_watcher watcher, failure_handler handler) {
-    if (watcher == NULL || handler == NULL)
+    return rptable_connect_zksock(RPTABLE_ZK_DEFAULT_SOCKET, watcher, handler);
+}
+
+c_rptable_t *rptable_connect_zksock(char* zksock, node_watcher watcher, failure_handler handler) {
+    if (zksock == NULL || watcher == NULL || handler == NULL)
         return NULL;
 
     c_rptable_t *table_ptr = malloc(sizeof(c_rptable_t));
@@ -32,14 +890,30 @@ c_rptable_t *rptable_connect(node_watcher watcher, failure_handler handler) {
         goto err_rptable_malloc;
 
     // Iniciar a estrutura
-    c_rptable_t table = {NULL, NULL, NULL, NULL, NULL};
+    c_rptable_t table = {NULL, NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL, 0,
+                         {NULL, NULL, 0, 0}, 0, NULL, 1, NULL};
+    if ((table.cctrl = cctrl_init()) == NULL)
+        goto err_cctrl_init;
 
     zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
 
     // Iniciar o ZooKeeper
-    if ((table.handler = zookeeper_init(RPTABLE_ZK_DEFAULT_SOCKET, 
+    if ((table.handler = zookeeper_init(zksock, 
                     zkconnection_watcher, RPTABLE_ZK_DEFAULT_TIMEOUT, 0, NULL, 0)) == NULL)
         goto err_zk_init;
+
+    // Se ha cadeias no no das particoes, a instalacao e particionada
+    char **shards = get_children(table.handler, RPTABLE_ZK_SHARDS_PATH, NULL);
+    if (shards == NULL)
+        goto err_rtable_wsocket;
+    int sharded = shards[0] != NULL;
+    free_children(shards);
+
+    if (sharded) {
+        if (shards_refresh(&table) == -1)
+            goto err_rtable_wsocket;
+        goto connected;
+    }
     
     // Colocar watcher ao no raiz
     set_node_watcher(table.handler, RPTABLE_ZK_ROOT_PATH, zknode_watcher);
@@ -73,6 +947,10 @@ c_rptable_t *rptable_connect(node_watcher watcher, failure_handler handler) {
             goto err_rtable_r_con;
     }
 
+    // Sem as outras replicas as leituras ficam todas na cauda
+    replicas_refresh(table.handler, RPTABLE_ZK_ROOT_PATH, &table.replicas);
+
+    connected:
     // Copiar para o buffer
     memcpy(table_ptr, &table, sizeof(c_rptable_t));
 
@@ -91,181 +969,789 @@ c_rptable_t *rptable_connect(node_watcher watcher, failure_handler handler) {
     err_rtable_wsocket:
     zookeeper_close(table.handler);
     err_zk_init:
+    cctrl_destroy(table.cctrl);
+    err_cctrl_init:
     free(table_ptr);
     err_rptable_malloc:
     return NULL;
 }
 
-c_rptable_t *rptable_connect_zksock(char* zksock, node_watcher watcher, failure_handler handler) {
-    if (watcher == NULL || handler == NULL)
-        return NULL;
+int rptable_disconnect(c_rptable_t *rptable) {
+    if (rptable == NULL)
+        return -1;
+    int res = 0;
 
-    c_rptable_t *table_ptr = malloc(sizeof(c_rptable_t));
-    if (table_ptr == NULL)
-        goto err_rptable_malloc;
+    if(rptable->handler != NULL)
+        zookeeper_close(rptable->handler);
+    else 
+        res = -1;
+    cctrl_destroy(rptable->cctrl);
+    cache_destroy(rptable->cache);
 
-    // Iniciar a estrutura
-    c_rptable_t table = {NULL, NULL, NULL, NULL, NULL};
+    // Numa instalacao particionada as ligacoes estao nas cadeias
+    if (rptable->ring != NULL) {
+        chains_destroy(rptable->chains, rptable->n_chains);
+        ring_destroy(rptable->ring);
+        prev_ring_destroy(rptable);
+        free(rptable);
+        return res;
+    }
 
-    zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
+    if (rptable->rptable_wsocket != NULL)
+        free(rptable->rptable_wsocket);
+    else 
+        res = -1;
+    
+    if (rptable->rptable_rsocket != NULL)
+        free(rptable->rptable_rsocket);
+    else 
+        res = -1;
+    
+    if (rptable->rtable_w != NULL)
+        rtable_disconnect(rptable->rtable_w);
+    else 
+        res = -1;
+    
+    if (rptable->rtable_r != NULL)
+        rtable_disconnect(rptable->rtable_r);
+    else 
+        res = -1;
 
-    // Iniciar o ZooKeeper
-    if ((table.handler = zookeeper_init(zksock, 
-                    zkconnection_watcher, RPTABLE_ZK_DEFAULT_TIMEOUT, 0, NULL, 0)) == NULL)
-        goto err_zk_init;
+    replicas_destroy(&rptable->replicas);
     
-    // Colocar watcher ao no raiz
-    set_node_watcher(table.handler, RPTABLE_ZK_ROOT_PATH, zknode_watcher);
+    free(rptable);
+    return res;
+}
+
+int rptable_put(c_rptable_t *rptable, char *key, struct data_t *value) {
+    return rptable_put_ttl(rptable, key, value, 0);
+}
+
+static int rptable_put_ttl_unlocked(c_rptable_t *rptable, char *key, struct data_t *value, unsigned long ttl) {
+    if (rptable == NULL || key == NULL || value == NULL)
+        return -1;
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
+        return -1;
+    
+    char *key_dup = strdup(key);
+    if (key_dup == NULL)
+        return -1;
+    struct data_t *value_dup = data_dup(value);
+    if (value_dup == NULL) {
+        free(key_dup);
+        return -1;
+    }
+    struct entry_t *entry = entry_create(key_dup, value_dup);
+    if (entry == NULL) {
+        data_destroy(value_dup);
+        free(key_dup);
+        return -1;
+    }
+    int res = rtable_put_ttl(rtable, entry, ttl);
+    entry_destroy(entry);
+    return res;
+}
+
+int rptable_put_ttl(c_rptable_t *rptable, char *key, struct data_t *value, unsigned long ttl) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_put_ttl_unlocked(rptable, key, value, ttl);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+struct data_t *rptable_get(c_rptable_t *rptable, char *key) {
+    return rptable_get_version(rptable, key, NULL);
+}
+
+struct data_t *rptable_get_version(c_rptable_t *rptable, char *key, unsigned long *version) {
+    return rptable_get_consistency(rptable, key, RTABLE_READ_STRONG, 0, version);
+}
+
+struct rtable_future_t *rptable_get_async(c_rptable_t *rptable, char *key,
+                                          rtable_callback_t callback, void *arg) {
+    if (rptable == NULL || key == NULL)
+        return NULL;
+    // Os pedidos em curso terminam com erro se o watcher fechar a ligacao
+    read_begin(rptable->cctrl);
+    struct rtable_t *rtable = rptable_replica(rptable, key);
+    struct rtable_future_t *future = rtable == NULL ? NULL :
+                                     rtable_get_async(rtable, key, callback, arg);
+    read_end(rptable->cctrl);
+    return future;
+}
+
+struct rtable_future_t *rptable_put_async(c_rptable_t *rptable, char *key, struct data_t *value,
+                                          rtable_callback_t callback, void *arg) {
+    if (rptable == NULL || key == NULL || value == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    struct entry_t entry = {key, value};
+    struct rtable_future_t *future = rtable == NULL ? NULL :
+                                     rtable_put_async(rtable, &entry, callback, arg);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return future;
+}
+
+struct rtable_future_t *rptable_del_async(c_rptable_t *rptable, char *key,
+                                          rtable_callback_t callback, void *arg) {
+    if (rptable == NULL || key == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    struct rtable_future_t *future = rtable == NULL ? NULL :
+                                     rtable_del_async(rtable, key, callback, arg);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return future;
+}
+
+int rptable_set_durability(c_rptable_t *rptable, unsigned int replicas) {
+    if (rptable == NULL)
+        return -1;
+    rptable->durability = replicas;
+    return 0;
+}
+
+int rptable_set_pool_size(c_rptable_t *rptable, int size) {
+    if (rptable == NULL || size < 1)
+        return -1;
+    // As ligacoes feitas depois pelos watchers recebem o mesmo tamanho
+    write_begin(rptable->cctrl);
+    rptable->pool_size = size;
+    rptable_visit(rptable, pool_resize, &size);
+    write_end(rptable->cctrl);
+    return 0;
+}
+
+int rptable_pool_stats(c_rptable_t *rptable, struct rtable_pool_stats_t *stats) {
+    if (rptable == NULL || stats == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    struct rtable_pool_stats_t total = {rptable->pool_size, 0, 0, 0, 0};
+    rptable_visit(rptable, pool_sum, &total);
+    read_end(rptable->cctrl);
+    *stats = total;
+    return 0;
+}
+
+int rptable_cache_enable(c_rptable_t *rptable, int max_entries) {
+    if (rptable == NULL || max_entries < 0)
+        return -1;
+    struct rptable_cache_t *cache = NULL;
+    if (max_entries > 0 && (cache = cache_create(max_entries)) == NULL)
+        return -1;
+
+    // Nenhuma leitura usa a cache anterior enquanto e substituida
+    write_begin(rptable->cctrl);
+    cache_destroy(rptable->cache);
+    rptable->cache = cache;
+    if (cache != NULL)
+        cache_track(rptable);
+    write_end(rptable->cctrl);
+    return 0;
+}
+
+int rptable_cache_stats(c_rptable_t *rptable, struct rptable_cache_stats_t *stats) {
+    if (rptable == NULL || stats == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    struct rptable_cache_t *cache = rptable->cache;
+    if (cache != NULL) {
+        pthread_mutex_lock(&cache->lock);
+        stats->hits = cache->hits;
+        stats->misses = cache->misses;
+        stats->invalidations = cache->invalidations;
+        stats->evictions = cache->evictions;
+        stats->entries = cache->n_entries;
+        stats->max_entries = cache->max_entries;
+        pthread_mutex_unlock(&cache->lock);
+    }
+    read_end(rptable->cctrl);
+    return cache == NULL ? -1 : 0;
+}
+
+struct rptable_watch_t *rptable_watch(c_rptable_t *rptable, char **keys, char **prefixes,
+                                      int queue_size, rtable_watch_callback_t callback, void *arg) {
+    if (rptable == NULL || callback == NULL)
+        return NULL;
+    int n_keys = 0;
+    while (keys != NULL && keys[n_keys] != NULL)
+        n_keys++;
+    int has_prefixes = prefixes != NULL && prefixes[0] != NULL;
+    if (n_keys == 0 && !has_prefixes)
+        return NULL;
+
+    struct rptable_watch_t *watch = malloc(sizeof(struct rptable_watch_t));
+    if (watch == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    watch->n_watches = rptable_n_chains(rptable);
+    watch->watches = calloc(watch->n_watches, sizeof(struct rtable_watch_t *));
+    int result = watch->watches == NULL ? -1 : 0;
+    for (int c = 0; result == 0 && c < watch->n_watches; c++) {
+        // Cada cadeia recebe as chaves que guarda e todos os prefixos
+        char *group[n_keys + 1];
+        int n = 0;
+        for (int i = 0; i < n_keys; i++)
+            if (rptable->ring == NULL || ring_lookup(rptable->ring, keys[i]) == c)
+                group[n++] = keys[i];
+        group[n] = NULL;
+        if (n == 0 && !has_prefixes)
+            continue;
+        struct rtable_t *tail = rptable_reader_at(rptable, c);
+        if (tail == NULL ||
+            (watch->watches[c] = rtable_watch(tail, group, prefixes, queue_size, callback, arg)) == NULL)
+            result = -1;
+    }
+    read_end(rptable->cctrl);
+
+    if (result == -1) {
+        rptable_unwatch(watch);
+        return NULL;
+    }
+    return watch;
+}
+
+void rptable_unwatch(struct rptable_watch_t *watch) {
+    if (watch == NULL)
+        return;
+    for (int i = 0; watch->watches != NULL && i < watch->n_watches; i++)
+        rtable_unwatch(watch->watches[i]);
+    free(watch->watches);
+    free(watch);
+}
+
+int rptable_chains(c_rptable_t *rptable) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int n_chains = rptable_n_chains(rptable);
+    read_end(rptable->cctrl);
+    return n_chains;
+}
+
+struct entry_t **rptable_get_table_version(c_rptable_t *rptable, int chain, unsigned long *version) {
+    if (rptable == NULL || chain < 0 || version == NULL)
+        return NULL;
+    struct entry_t **entries = NULL;
+    read_begin(rptable->cctrl);
+    if (chain < rptable_n_chains(rptable)) {
+        struct rtable_t *tail = rptable_reader_at(rptable, chain);
+        if (tail != NULL)
+            entries = rtable_get_table_version(tail, version);
+    }
+    read_end(rptable->cctrl);
+    return entries;
+}
+
+struct rtable_changes_t *rptable_changes(c_rptable_t *rptable, int chain, unsigned long after,
+                                         rtable_changes_callback_t callback, void *arg) {
+    if (rptable == NULL || chain < 0 || callback == NULL)
+        return NULL;
+    struct rtable_changes_t *changes = NULL;
+    read_begin(rptable->cctrl);
+    if (chain < rptable_n_chains(rptable)) {
+        struct rtable_t *tail = rptable_reader_at(rptable, chain);
+        if (tail != NULL)
+            changes = rtable_changes(tail, after, callback, arg);
+    }
+    read_end(rptable->cctrl);
+    return changes;
+}
+
+static struct data_t *rptable_get_consistency_unlocked(c_rptable_t *rptable, char *key,
+                                                       enum rtable_consistency consistency,
+                                                       unsigned long max_lag, unsigned long *version) {
+    if (rptable == NULL || key == NULL)
+        return NULL;
+    struct data_t *data;
+    if (cache_read(rptable, key, &data, version))
+        return data;
+
+    struct rtable_t *rtable = rptable_replica(rptable, key);
+    if (rtable == NULL)
+        return NULL;
+    int stale;
+    data = rtable_get_consistency(rtable, key, consistency, max_lag,
+                                                 version, &stale);
+
+    // A replica esta demasiado atrasada, a cauda tem a versao confirmada
+    struct rtable_t *tail = rptable_reader(rptable, key);
+    if (stale && tail != NULL)
+        data = rtable_get_version(tail, key, version);
+
+    // Durante uma migracao a chave pode ainda estar no dono anterior
+    struct rtable_t *prev = data == NULL ? rptable_prev_reader(rptable, key) : NULL;
+    if (prev != NULL)
+        data = rtable_get_version(prev, key, version);
+    return data;
+}
+
+struct data_t *rptable_get_consistency(c_rptable_t *rptable, char *key,
+                                       enum rtable_consistency consistency,
+                                       unsigned long max_lag, unsigned long *version) {
+    if (rptable == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct data_t *result = rptable_get_consistency_unlocked(rptable, key, consistency,
+                                                             max_lag, version);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+int rptable_get_into(c_rptable_t *rptable, char *key, void *buf, int size, unsigned long *version) {
+    if (rptable == NULL || key == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = cache_read_into(rptable, key, buf, size, version);
+    if (result != -1) {
+        read_end(rptable->cctrl);
+        return result;
+    }
+
+    // Repartida pelas replicas como rptable_get(), que so respondem
+    // com a versao confirmada pela cauda
+    struct rtable_t *rtable = rptable_replica(rptable, key);
+    if (rtable != NULL)
+        result = rtable_get_into(rtable, key, buf, size, version);
+
+    // Durante uma migracao a chave pode ainda estar no dono anterior
+    struct rtable_t *prev = result == -1 ? rptable_prev_reader(rptable, key) : NULL;
+    if (prev != NULL)
+        result = rtable_get_into(prev, key, buf, size, version);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_put_if_version_unlocked(c_rptable_t *rptable, char *key, struct data_t *value,
+                                           unsigned long expected, unsigned long *version) {
+    if (rptable == NULL || key == NULL || value == NULL)
+        return -1;
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
+        return -1;
+    struct entry_t entry = {key, value};
+    return rtable_put_if_version(rtable, &entry, expected, version);
+}
+
+int rptable_put_if_version(c_rptable_t *rptable, char *key, struct data_t *value,
+                           unsigned long expected, unsigned long *version) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_put_if_version_unlocked(rptable, key, value, expected, version);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_del_if_version_unlocked(c_rptable_t *rptable, char *key, unsigned long expected,
+                                           unsigned long *version) {
+    if (rptable == NULL || key == NULL)
+        return -1;
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
+        return -1;
+    return rtable_del_if_version(rtable, key, expected, version);
+}
+
+int rptable_del_if_version(c_rptable_t *rptable, char *key, unsigned long expected,
+                           unsigned long *version) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_del_if_version_unlocked(rptable, key, expected, version);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_del_unlocked(c_rptable_t *rptable, char *key) {
+    if (rptable == NULL || key == NULL)
+        return -1;
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
+        return -1;
+    return rtable_del(rtable, key);
+}
 
-    // Obter o socket do servidor na cabeca
-    table.rptable_wsocket = get_head_server(table.handler, 
-                    RPTABLE_ZK_ROOT_PATH, zknode_watcher);
-    
-    // Se nao ha nenhum servidor ativo
-    if (table.rptable_wsocket == ZDATA_NOT_FOUND || table.rptable_wsocket == NULL)
-        goto err_rtable_wsocket;
-    
-    // Obter o socket do servidor na cauda
-    table.rptable_rsocket = get_tail_server(table.handler,
-                    RPTABLE_ZK_ROOT_PATH, zknode_watcher);
+int rptable_del(c_rptable_t *rptable, char *key) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_del_unlocked(rptable, key);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
 
-    if (table.rptable_rsocket == ZDATA_NOT_FOUND || table.rptable_rsocket == NULL)
-        goto err_rtable_rsocket;
+static struct entry_t **rptable_mget_unlocked(c_rptable_t *rptable, char **keys, int n_keys) {
+    if (rptable == NULL || keys == NULL || n_keys <= 0)
+        return NULL;
+    if (rptable->ring == NULL) {
+        if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+            return NULL;
+        return rtable_mget(rptable->rtable_r, keys, n_keys);
+    }
 
-    // Se ha algum servidor na cabeca
-    if (table.rptable_wsocket != NULL) {
-        // Se ocorrer erro enquanto tentar ligar
-        if ((table.rtable_w = rtable_connect(table.rptable_wsocket)) == NULL)
-            goto err_rtable_w_con;
+    // Pedir a cada cadeia, num so pedido, as chaves que guarda
+    int owner[n_keys], prev[n_keys];
+    for (int i = 0; i < n_keys; i++) {
+        owner[i] = ring_lookup(rptable->ring, keys[i]);
+        prev[i] = rptable_prev_chain(rptable, keys[i]);
     }
+    char *group[n_keys + 1];
+    struct entry_t **result = calloc(n_keys + 1, sizeof(struct entry_t *));
+    if (result == NULL)
+        return NULL;
+    int n_result = 0;
+    for (int round = 0; round < 2; round++) {
+        int n_found = n_result;
+        for (int c = 0; c < rptable->n_chains; c++) {
+            // Durante uma migracao, as chaves que o novo dono nao tem
+            // podem ainda estar no dono anterior
+            int n = 0;
+            for (int i = 0; i < n_keys; i++) {
+                if (round == 0 ? owner[i] != c : prev[i] != c)
+                    continue;
+                int found = 0;
+                for (int j = 0; round == 1 && j < n_found && !found; j++)
+                    found = strcmp(result[j]->key, keys[i]) == 0;
+                if (!found)
+                    group[n++] = keys[i];
+            }
+            if (n == 0)
+                continue;
+            group[n] = NULL;
 
-    // Se ha algum servidor na cauda
-    if (table.rptable_rsocket != NULL) {
-        // Se ocorrer erro enquanto tentar ligar
-        if ((table.rtable_r = rtable_connect(table.rptable_rsocket)) == NULL)
-            goto err_rtable_r_con;
+            struct entry_t **entries = rptable->chains[c].rtable_r == NULL ? NULL :
+                                       rtable_mget(rptable->chains[c].rtable_r, group, n);
+            if (entries == NULL) {
+                rtable_free_entries(result);
+                return NULL;
+            }
+            for (int i = 0; entries[i] != NULL; i++)
+                result[n_result++] = entries[i];
+            free(entries);
+        }
     }
+    return result;
+}
 
-    // Copiar para o buffer
-    memcpy(table_ptr, &table, sizeof(c_rptable_t));
+struct entry_t **rptable_mget(c_rptable_t *rptable, char **keys, int n_keys) {
+    if (rptable == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct entry_t **result = rptable_mget_unlocked(rptable, keys, n_keys);
+    read_end(rptable->cctrl);
+    return result;
+}
 
-    // Guardar as funcoes para fazer call-back
-    rptable_watcher = watcher;
-    rptable_fhandler = handler;
+static int rptable_mput_unlocked(c_rptable_t *rptable, struct entry_t **entries, unsigned long ttl) {
+    if (rptable == NULL || entries == NULL)
+        return -1;
+    if (rptable->ring == NULL) {
+        if (rptable->rptable_wsocket == NULL || rptable->rtable_w == NULL)
+            return -1;
+        rtable_set_durability(rptable->rtable_w, rptable->durability);
+        return rtable_mput(rptable->rtable_w, entries, ttl);
+    }
 
-    return table_ptr;
+    // Cada cadeia recebe as suas entradas num so pedido. Durante uma
+    // migracao, as chaves que mudaram de dono vao uma a uma a cabeca
+    // do dono anterior, que as reencaminha como as escritas de uma so
+    // chave
+    int n_entries = 0;
+    while (entries[n_entries] != NULL)
+        n_entries++;
+    int owner[n_entries];
+    for (int i = 0; i < n_entries; i++)
+        owner[i] = rptable_prev_chain(rptable, entries[i]->key) != -1 ? -1 :
+                   ring_lookup(rptable->ring, entries[i]->key);
+    struct entry_t *group[n_entries + 1];
+    for (int i = 0; i < n_entries; i++) {
+        if (owner[i] != -1)
+            continue;
+        struct entry_t *single[] = {entries[i], NULL};
+        struct rtable_t *rtable = rptable_writer(rptable, entries[i]->key);
+        if (rtable == NULL || rtable_mput(rtable, single, ttl) == -1)
+            return -1;
+    }
+    for (int c = 0; c < rptable->n_chains; c++) {
+        int n = 0;
+        for (int i = 0; i < n_entries; i++)
+            if (owner[i] == c)
+                group[n++] = entries[i];
+        if (n == 0)
+            continue;
+        group[n] = NULL;
+        struct rtable_t *rtable = rptable_writer_at(rptable, c);
+        if (rtable == NULL || rtable_mput(rtable, group, ttl) == -1)
+            return -1;
+    }
+    return 0;
+}
 
-    err_rtable_r_con:
-    rtable_disconnect(table.rtable_w);
-    err_rtable_w_con:
-    free(table.rptable_rsocket);
-    err_rtable_rsocket:
-    free(table.rptable_wsocket);
-    err_rtable_wsocket:
-    zookeeper_close(table.handler);
-    err_zk_init:
-    free(table_ptr);
-    err_rptable_malloc:
-    return NULL;
+int rptable_mput(c_rptable_t *rptable, struct entry_t **entries, unsigned long ttl) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_mput_unlocked(rptable, entries, ttl);
+    for (int i = 0; rptable->cache != NULL && entries != NULL && entries[i] != NULL; i++)
+        cache_forget(rptable, &entries[i]->key, 1);
+    read_end(rptable->cctrl);
+    return result;
 }
 
-int rptable_disconnect(c_rptable_t *rptable) {
+static int rptable_mdel_unlocked(c_rptable_t *rptable, char **keys) {
+    if (rptable == NULL || keys == NULL)
+        return -1;
+    if (rptable->ring == NULL) {
+        if (rptable->rptable_wsocket == NULL || rptable->rtable_w == NULL)
+            return -1;
+        rtable_set_durability(rptable->rtable_w, rptable->durability);
+        return rtable_mdel(rptable->rtable_w, keys);
+    }
+
+    // Cada cadeia recebe as suas chaves num so pedido e, durante uma
+    // migracao, as que mudaram de dono vao uma a uma ao dono anterior
+    int n_keys = 0;
+    while (keys[n_keys] != NULL)
+        n_keys++;
+    int owner[n_keys];
+    for (int i = 0; i < n_keys; i++)
+        owner[i] = rptable_prev_chain(rptable, keys[i]) != -1 ? -1 :
+                   ring_lookup(rptable->ring, keys[i]);
+    char *group[n_keys + 1];
+    int removed = 0;
+    for (int i = 0; i < n_keys; i++) {
+        if (owner[i] != -1)
+            continue;
+        char *single[] = {keys[i], NULL};
+        struct rtable_t *rtable = rptable_writer(rptable, keys[i]);
+        int result = rtable == NULL ? -1 : rtable_mdel(rtable, single);
+        if (result == -1)
+            return -1;
+        removed += result;
+    }
+    for (int c = 0; c < rptable->n_chains; c++) {
+        int n = 0;
+        for (int i = 0; i < n_keys; i++)
+            if (owner[i] == c)
+                group[n++] = keys[i];
+        if (n == 0)
+            continue;
+        group[n] = NULL;
+        struct rtable_t *rtable = rptable_writer_at(rptable, c);
+        int result = rtable == NULL ? -1 : rtable_mdel(rtable, group);
+        if (result == -1)
+            return -1;
+        removed += result;
+    }
+    return removed;
+}
+
+int rptable_mdel(c_rptable_t *rptable, char **keys) {
     if (rptable == NULL)
         return -1;
-    int res = 0;
+    read_begin(rptable->cctrl);
+    int result = rptable_mdel_unlocked(rptable, keys);
+    for (int i = 0; rptable->cache != NULL && keys != NULL && keys[i] != NULL; i++)
+        cache_forget(rptable, &keys[i], 1);
+    read_end(rptable->cctrl);
+    return result;
+}
 
-    if(rptable->handler != NULL)
-        zookeeper_close(rptable->handler);
-    else 
-        res = -1;
+static int rptable_incr_unlocked(c_rptable_t *rptable, char *key, long delta, long *value) {
+    if (rptable == NULL || key == NULL || value == NULL)
+        return -1;
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
+        return -1;
+    return rtable_incr(rtable, key, delta, value);
+}
 
-    if (rptable->rptable_wsocket != NULL)
-        free(rptable->rptable_wsocket);
-    else 
-        res = -1;
-    
-    if (rptable->rptable_rsocket != NULL)
-        free(rptable->rptable_rsocket);
-    else 
-        res = -1;
-    
-    if (rptable->rtable_w != NULL)
-        rtable_disconnect(rptable->rtable_w);
-    else 
-        res = -1;
-    
-    if (rptable->rtable_r != NULL)
-        rtable_disconnect(rptable->rtable_r);
-    else 
-        res = -1;
-    
-    free(rptable);
-    return res;
+int rptable_incr(c_rptable_t *rptable, char *key, long delta, long *value) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_incr_unlocked(rptable, key, delta, value);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
 }
 
-int rptable_put(c_rptable_t *rptable, char *key, struct data_t *value) {
+static int rptable_append_unlocked(c_rptable_t *rptable, char *key, struct data_t *value) {
     if (rptable == NULL || key == NULL || value == NULL)
         return -1;
-    if (rptable->rptable_wsocket == NULL || rptable->rtable_w == NULL)
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
         return -1;
-    
-    char *key_dup = strdup(key);
-    if (key_dup == NULL)
+    struct entry_t entry = {key, value};
+    return rtable_append(rtable, &entry);
+}
+
+int rptable_append(c_rptable_t *rptable, char *key, struct data_t *value) {
+    if (rptable == NULL)
         return -1;
-    struct data_t *value_dup = data_dup(value);
-    if (value_dup == NULL) {
-        free(key_dup);
+    read_begin(rptable->cctrl);
+    int result = rptable_append_unlocked(rptable, key, value);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_cas_unlocked(c_rptable_t *rptable, char *key, struct data_t *expected, struct data_t *value) {
+    if (rptable == NULL || key == NULL || expected == NULL || value == NULL)
         return -1;
-    }
-    struct entry_t *entry = entry_create(key_dup, value_dup);
-    if (entry == NULL) {
-        data_destroy(value_dup);
-        free(key_dup);
+    struct rtable_t *rtable = rptable_writer(rptable, key);
+    if (rtable == NULL)
         return -1;
-    }
-    int res = rtable_put(rptable->rtable_w, entry);
-    entry_destroy(entry);
-    return res;
+    struct entry_t entry = {key, value};
+    return rtable_cas(rtable, &entry, expected);
 }
 
-struct data_t *rptable_get(c_rptable_t *rptable, char *key) {
-    if (rptable == NULL || key == NULL)
-        return NULL;
-    if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
-        return NULL;
-    return rtable_get(rptable->rtable_r, key);
+int rptable_cas(c_rptable_t *rptable, char *key, struct data_t *expected, struct data_t *value) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_cas_unlocked(rptable, key, expected, value);
+    cache_forget(rptable, &key, 1);
+    read_end(rptable->cctrl);
+    return result;
 }
 
-int rptable_del(c_rptable_t *rptable, char *key) {
-    if (rptable == NULL || key == NULL)
+static int rptable_batch_commit_unlocked(c_rptable_t *rptable, struct rtable_batch_t *batch) {
+    if (rptable == NULL || batch == NULL || batch->n_ops == 0)
         return -1;
-    if (rptable->rptable_wsocket == NULL || rptable->rtable_w == NULL)
+
+    // So ha atomicidade dentro de uma cadeia, e o lote vai sempre a
+    // dona, mesmo durante uma migracao
+    int chain = 0;
+    if (rptable->ring != NULL) {
+        chain = ring_lookup(rptable->ring, batch->ops[0]->key);
+        for (int i = 1; i < batch->n_ops; i++)
+            if (ring_lookup(rptable->ring, batch->ops[i]->key) != chain)
+                return -1;
+    }
+    struct rtable_t *rtable = rptable_writer_at(rptable, chain);
+    if (rtable == NULL)
         return -1;
-    return rtable_del(rptable->rtable_w, key);
+    return rtable_batch_commit(rtable, batch);
 }
 
-int rptable_size(c_rptable_t *rptable) {
+int rptable_batch_commit(c_rptable_t *rptable, struct rtable_batch_t *batch) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_batch_commit_unlocked(rptable, batch);
+    for (int i = 0; rptable->cache != NULL && batch != NULL && i < batch->n_ops; i++)
+        cache_forget(rptable, &batch->ops[i]->key, 1);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_size_unlocked(c_rptable_t *rptable) {
     if (rptable == NULL)
         return -1;
-    if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+    int size = 0;
+    for (int c = 0; c < rptable_n_chains(rptable); c++) {
+        struct rtable_t *rtable = rptable_reader_at(rptable, c);
+        int result = rtable == NULL ? -1 : rtable_size(rtable);
+        if (result == -1)
+            return -1;
+        size += result;
+    }
+    return size;
+}
+
+int rptable_size(c_rptable_t *rptable) {
+    if (rptable == NULL)
         return -1;
-    return rtable_size(rptable->rtable_r);
+    read_begin(rptable->cctrl);
+    int result = rptable_size_unlocked(rptable);
+    read_end(rptable->cctrl);
+    return result;
 }
 
-struct statistics_t *rptable_stats(c_rptable_t *rptable) {
+static struct statistics_t *rptable_stats_unlocked(c_rptable_t *rptable) {
     if (rptable == NULL)
         return NULL;
-    if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+    struct statistics_t *total = NULL;
+    for (int c = 0; c < rptable_n_chains(rptable); c++) {
+        struct rtable_t *rtable = rptable_reader_at(rptable, c);
+        struct statistics_t *stats = rtable == NULL ? NULL : rtable_stats(rtable);
+        if (stats == NULL) {
+            if (total != NULL)
+                stats_destroy(total);
+            return NULL;
+        }
+        if (total == NULL) {
+            total = stats;
+            continue;
+        }
+        // Somar as estatisticas das caudas de todas as cadeias
+        struct statistics_t *sum = stats_sum(total, stats);
+        stats_destroy(total);
+        stats_destroy(stats);
+        if ((total = sum) == NULL)
+            return NULL;
+    }
+    return total;
+}
+
+struct statistics_t *rptable_stats(c_rptable_t *rptable) {
+    if (rptable == NULL)
         return NULL;
-    return rtable_stats(rptable->rtable_r);
+    read_begin(rptable->cctrl);
+    struct statistics_t *result = rptable_stats_unlocked(rptable);
+    read_end(rptable->cctrl);
+    return result;
 }
 
 char **rptable_get_keys(c_rptable_t *rptable) {
+    return rptable_get_keys_filter(rptable, NULL, NULL);
+}
+
+static char **rptable_get_keys_filter_unlocked(c_rptable_t *rptable, char *prefix, char *pattern) {
     if (rptable == NULL)
         return NULL;
-    if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+    char **keys = NULL;
+    for (int c = 0; c < rptable_n_chains(rptable); c++) {
+        struct rtable_t *rtable = rptable_reader_at(rptable, c);
+        char **more = rtable == NULL ? NULL : rtable_get_keys_filter(rtable, prefix, pattern);
+        if (more == NULL) {
+            rtable_free_keys(keys);
+            return NULL;
+        }
+        if (keys == NULL) {
+            keys = more;
+            continue;
+        }
+        char **all = (char **) array_concat((void **) keys, (void **) more);
+        if (all == NULL) {
+            rtable_free_keys(more);
+            rtable_free_keys(keys);
+            return NULL;
+        }
+        keys = all;
+    }
+    return keys;
+}
+
+char **rptable_get_keys_filter(c_rptable_t *rptable, char *prefix, char *pattern) {
+    if (rptable == NULL)
         return NULL;
-    return rtable_get_keys(rptable->rtable_r);
+    read_begin(rptable->cctrl);
+    char **result = rptable_get_keys_filter_unlocked(rptable, prefix, pattern);
+    read_end(rptable->cctrl);
+    return result;
 }
 
 void rptable_free_keys(char **keys) {
@@ -275,11 +1761,160 @@ void rptable_free_keys(char **keys) {
 }
 
 struct entry_t **rptable_get_table(c_rptable_t *rptable) {
+    return rptable_get_table_filter(rptable, NULL, NULL);
+}
+
+static struct entry_t **rptable_get_table_filter_unlocked(c_rptable_t *rptable, char *prefix, char *pattern) {
+    if (rptable == NULL)
+        return NULL;
+    int n_chains = rptable_n_chains(rptable);
+    struct entry_t **per_chain[n_chains];
+    for (int c = 0; c < n_chains; c++) {
+        struct rtable_t *rtable = rptable_reader_at(rptable, c);
+        per_chain[c] = rtable == NULL ? NULL : rtable_get_table_filter(rtable, prefix, pattern);
+        if (per_chain[c] == NULL) {
+            for (int i = 0; i < c; i++)
+                rtable_free_entries(per_chain[i]);
+            return NULL;
+        }
+    }
+    return chains_merge(rptable, per_chain, n_chains);
+}
+
+struct entry_t **rptable_get_table_filter(c_rptable_t *rptable, char *prefix, char *pattern) {
+    if (rptable == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct entry_t **result = rptable_get_table_filter_unlocked(rptable, prefix, pattern);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+/**
+ * Passa o cursor a cadeia seguinte quando a pagina terminou de
+ * percorrer a atual, ou volta a zero depois da ultima.
+*/
+static void cursor_next_chain(c_rptable_t *rptable, struct rtable_cursor_t *cursor) {
+    if (cursor->bucket != 0 || cursor->position != 0)
+        return;
+    cursor->chain = cursor->chain + 1 < rptable_n_chains(rptable) ? cursor->chain + 1 : 0;
+}
+
+static char **rptable_get_keys_page_unlocked(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                                             int count, char *prefix, char *pattern) {
+    if (rptable == NULL || cursor == NULL || cursor->chain >= rptable_n_chains(rptable))
+        return NULL;
+    struct rtable_t *rtable = rptable_reader_at(rptable, cursor->chain);
+    if (rtable == NULL)
+        return NULL;
+    char **keys = rtable_get_keys_page(rtable, cursor, count, prefix, pattern);
+    if (keys != NULL)
+        cursor_next_chain(rptable, cursor);
+    return keys;
+}
+
+char **rptable_get_keys_page(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                             int count, char *prefix, char *pattern) {
+    if (rptable == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    char **result = rptable_get_keys_page_unlocked(rptable, cursor, count, prefix, pattern);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static struct entry_t **rptable_get_table_page_unlocked(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                                                        int count, char *prefix, char *pattern) {
+    if (rptable == NULL || cursor == NULL || cursor->chain >= rptable_n_chains(rptable))
+        return NULL;
+    struct rtable_t *rtable = rptable_reader_at(rptable, cursor->chain);
+    if (rtable == NULL)
+        return NULL;
+    struct entry_t **entries = rtable_get_table_page(rtable, cursor, count, prefix, pattern);
+    if (entries != NULL)
+        cursor_next_chain(rptable, cursor);
+    return entries;
+}
+
+struct entry_t **rptable_get_table_page(c_rptable_t *rptable, struct rtable_cursor_t *cursor,
+                                        int count, char *prefix, char *pattern) {
+    if (rptable == NULL)
+        return NULL;
+    read_begin(rptable->cctrl);
+    struct entry_t **result = rptable_get_table_page_unlocked(rptable, cursor, count,
+                                                              prefix, pattern);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static int rptable_iterate_unlocked(c_rptable_t *rptable, char *prefix, char *pattern, int page_size,
+                                    rtable_iter_t callback, void *arg) {
+    if (rptable == NULL)
+        return -1;
+    for (int c = 0; c < rptable_n_chains(rptable); c++) {
+        struct rtable_t *rtable = rptable_reader_at(rptable, c);
+        if (rtable == NULL)
+            return -1;
+        int result = rtable_iterate(rtable, prefix, pattern, page_size, callback, arg);
+        if (result != 0)
+            return result;
+    }
+    return 0;
+}
+
+int rptable_iterate(c_rptable_t *rptable, char *prefix, char *pattern, int page_size,
+                    rtable_iter_t callback, void *arg) {
+    if (rptable == NULL)
+        return -1;
+    read_begin(rptable->cctrl);
+    int result = rptable_iterate_unlocked(rptable, prefix, pattern, page_size, callback, arg);
+    read_end(rptable->cctrl);
+    return result;
+}
+
+static struct entry_t **rptable_scan_unlocked(c_rptable_t *rptable, char *start, char *end, int limit) {
     if (rptable == NULL)
         return NULL;
-    if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+    if (rptable->ring == NULL) {
+        if (rptable->rptable_rsocket == NULL || rptable->rtable_r == NULL)
+            return NULL;
+        return rtable_scan(rptable->rtable_r, start, end, limit);
+    }
+
+    // Cada cadeia retorna ate limit entradas, ordenadas, do intervalo
+    struct entry_t **per_chain[rptable->n_chains];
+    for (int c = 0; c < rptable->n_chains; c++) {
+        struct rtable_t *rtable = rptable->chains[c].rtable_r;
+        per_chain[c] = rtable == NULL ? NULL : rtable_scan(rtable, start, end, limit);
+        if (per_chain[c] == NULL) {
+            for (int i = 0; i < c; i++)
+                rtable_free_entries(per_chain[i]);
+            return NULL;
+        }
+    }
+    struct entry_t **entries = chains_merge(rptable, per_chain, rptable->n_chains);
+    if (entries == NULL)
+        return NULL;
+
+    // Juntar por ordem das chaves e ficar com as primeiras limit
+    int n = 0;
+    while (entries[n] != NULL)
+        n++;
+    qsort(entries, n, sizeof(struct entry_t *), entry_key_compare);
+    for (int i = limit; limit > 0 && i < n; i++) {
+        entry_destroy(entries[i]);
+        entries[i] = NULL;
+    }
+    return entries;
+}
+
+struct entry_t **rptable_scan(c_rptable_t *rptable, char *start, char *end, int limit) {
+    if (rptable == NULL)
         return NULL;
-    return rtable_get_table(rptable->rtable_r);
+    read_begin(rptable->cctrl);
+    struct entry_t **result = rptable_scan_unlocked(rptable, start, end, limit);
+    read_end(rptable->cctrl);
+    return result;
 }
 
 void rptable_free_entries(struct entry_t **entries) {
@@ -297,21 +1932,24 @@ void zkconnection_watcher(zhandle_t *zzh, int type, int state, const char *path,
 	}
 }
 
-void zknode_watcher(zhandle_t *zzh, int type, int state, const char *path, void* context) {
-    if (state != ZOO_CONNECTED_STATE) {
-        rptable_fhandler(ZKCONNECTION_LOST);
-        return;
-    }
-    if (type != ZOO_CHILD_EVENT)
-        return;
-    
-    c_rptable_t *table = rptable_watcher();
-    if (table == NULL || table->handler == NULL || 
+/**
+ * Volta a ler os servidores do ZooKeeper e liga-se aos que mudaram.
+ * Deve ser chamada dentro da seccao critica de escrita da tabela.
+ * \return
+ *      0 (OK) ou o codigo do erro para o failure_handler.
+*/
+static int rptable_refresh(c_rptable_t *table) {
+    // Numa instalacao particionada qualquer mudanca volta a ler as cadeias
+    if (table->ring != NULL)
+        return shards_refresh(table) == -1 ? RPTABLE_CONNECTION_FAILED : 0;
+
+    if (table->handler == NULL || 
         table->rptable_wsocket == NULL || table->rtable_w == NULL ||
-        table->rptable_rsocket == NULL || table->rtable_r == NULL) {
-        rptable_fhandler(RPTABLE_INVALID_ARG);
-        return;
-    }
+        table->rptable_rsocket == NULL || table->rtable_r == NULL)
+        return RPTABLE_INVALID_ARG;
+
+    // Acompanhar as replicas que entram e saem da cadeia
+    replicas_refresh(table->handler, RPTABLE_ZK_ROOT_PATH, &table->replicas);
     
     // Tentar obter o descritor do proximo servidor
     char *next_headtable = get_head_server(table->handler, RPTABLE_ZK_ROOT_PATH, 
@@ -322,44 +1960,64 @@ void zknode_watcher(zhandle_t *zzh, int type, int state, const char *path, void*
 
     // Se nao foi encontrado algum dos servidores
     if (next_headtable == NULL || next_headtable == ZDATA_NOT_FOUND || 
-        next_tailtable == NULL || next_tailtable == ZDATA_NOT_FOUND) {
-        rptable_fhandler(RPTABLE_CONNECTION_FAILED);
-        return;
-    }
+        next_tailtable == NULL || next_tailtable == ZDATA_NOT_FOUND)
+        return RPTABLE_CONNECTION_FAILED;
     
     // Se o novo servidor na cabeca for diferente do atual
     if (strcmp(next_headtable, table->rptable_wsocket) != 0) {
         free(table->rptable_wsocket);
         rtable_disconnect(table->rtable_w);
+        free(next_tailtable);
 
         table->rptable_wsocket = next_headtable;
         // Se nao conseguir ligar ao novo servidor
-        if ((table->rtable_w = rtable_connect(next_headtable)) == NULL) {
-            free(next_headtable);
-            free(next_tailtable);
-            rptable_fhandler(RPTABLE_CONNECTION_FAILED);
-        }
-        free(next_tailtable);
-        return;
+        if ((table->rtable_w = rtable_connect(next_headtable)) == NULL)
+            return RPTABLE_CONNECTION_FAILED;
+        return 0;
     }
     
     // Se o novo servidor na cauda for diferente do atual
     if (strcmp(next_tailtable, table->rptable_rsocket) != 0) {
         free(table->rptable_rsocket);
         rtable_disconnect(table->rtable_r);
+        free(next_headtable);
 
         table->rptable_rsocket = next_tailtable;
         // Se nao conseguir ligar ao novo servidor
-        if ((table->rtable_r = rtable_connect(next_tailtable)) == NULL) {
-            free(next_headtable);
-            free(next_tailtable);
-            rptable_fhandler(RPTABLE_CONNECTION_FAILED);
-        }
-        free(next_headtable);
-        return;
+        if ((table->rtable_r = rtable_connect(next_tailtable)) == NULL)
+            return RPTABLE_CONNECTION_FAILED;
+        return 0;
     }
 
     free(next_headtable);
     free(next_tailtable);
-    return;
-}
\ No newline at end of file
+    return 0;
+}
+
+void zknode_watcher(zhandle_t *zzh, int type, int state, const char *path, void* context) {
+    if (state != ZOO_CONNECTED_STATE) {
+        rptable_fhandler(ZKCONNECTION_LOST);
+        return;
+    }
+    if (type != ZOO_CHILD_EVENT)
+        return;
+    
+    c_rptable_t *table = rptable_watcher();
+    if (table == NULL) {
+        rptable_fhandler(RPTABLE_INVALID_ARG);
+        return;
+    }
+
+    // Esperar que terminem os pedidos que usam as ligacoes atuais
+    write_begin(table->cctrl);
+    int error = rptable_refresh(table);
+    // As novas ligacoes recebem o tamanho do conjunto
+    rptable_visit(table, pool_resize, &table->pool_size);
+    // A cauda pode ter mudado, os valores guardados deixam de ser avisados
+    if (table->cache != NULL)
+        cache_track(table);
+    write_end(table->cctrl);
+
+    if (error != 0)
+        rptable_fhandler(error);
+}
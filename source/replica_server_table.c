@@ -12,6 +12,9 @@
 #include "client_stub.h"
 #include "replica_table.h"
 #include "table-private.h"
+#include "table_skel.h"
+#include "network_client.h"
+#include "network_server.h"
 #include "replica_server_table.h"
 #include "client_stub-private.h"
 
@@ -23,72 +26,172 @@
 node_watcher rptable_watcher = NULL;
 failure_handler rptable_fhandler = NULL;
 
-s_rptable_t *rptable_connect(int sock, node_watcher watcher, failure_handler handler) {
-    if (sock < 0 || watcher == NULL || handler == NULL)
-        return NULL;
+// Protege a ligacao a cauda, partilhada pelas threads de leitura
+pthread_mutex_t tail_lock = PTHREAD_MUTEX_INITIALIZER;
 
-    s_rptable_t *table_ptr = malloc(sizeof(s_rptable_t));
-    if (table_ptr == NULL)
-        goto err_rptable_malloc;
+// Durabilidade da escrita que a thread esta a executar, 0 = toda a cadeia
+__thread unsigned int forward_replicas = 0;
 
-    // Iniciar a estrutura
-    s_rptable_t table = {NULL, NULL, NULL, NULL};
+/**
+ * Verifica se o servidor e a cabeca da cadeia, isto e,
+ * se nao tem nenhum servidor anterior.
+ * \return
+ *      1 se e a cabeca, 0 se nao e ou -1 em caso de erro.
+*/
+static int rptable_check_head(s_rptable_t *rptable) {
+    char *prev_server_sock = get_prev_server(rptable->handler, rptable->root,
+                            rptable->znode, zknode_watcher);
+    if (prev_server_sock == NULL)
+        return -1;
+    if (prev_server_sock == ZDATA_NOT_FOUND)
+        return 1;
+    free(prev_server_sock);
+    return 0;
+}
 
-    zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
+/**
+ * Liberta a vista das cadeias, fechando as ligacoes as cabecas.
+*/
+static void shards_destroy(struct rptable_shards_t *shards) {
+    if (shards == NULL)
+        return;
+    for (int i = 0; shards->heads != NULL && i < shards->n_chains; i++)
+        if (shards->heads[i] != NULL)
+            rtable_disconnect(shards->heads[i]);
+    free(shards->heads);
+    free_children(shards->names);
+    ring_destroy(shards->ring);
+    free(shards->chain);
+    pthread_mutex_destroy(&shards->lock);
+    free(shards);
+}
 
-    // Iniciar o ZooKeeper
-    if ((table.handler = zookeeper_init(RPTABLE_ZK_DEFAULT_SOCKET, 
-                    zkconnection_watcher, RPTABLE_ZK_DEFAULT_TIMEOUT, 0, NULL, 0)) == NULL)
-        goto err_zk_init;
+/**
+ * Le as cadeias em RPTABLE_ZK_SHARDS_PATH, colocando um watcher no
+ * no, e reconstroi o anel. As ligacoes as cabecas sao fechadas,
+ * voltam a ser abertas quando forem precisas.
+ * \return
+ *      0 (OK) ou -1 em caso de erro, sem alterar a vista.
+*/
+static int shards_refresh(s_rptable_t *rptable) {
+    struct rptable_shards_t *shards = rptable->shards;
+    char **names = get_children(rptable->handler, RPTABLE_ZK_SHARDS_PATH, zknode_watcher);
+    if (names == NULL)
+        return -1;
+    int n_chains = 0, self = -1;
+    for (; names[n_chains] != NULL; n_chains++)
+        if (strcmp(names[n_chains], shards->chain) == 0)
+            self = n_chains;
+
+    // A cadeia deste servidor tem de estar no anel
+    struct ring_t *ring = self == -1 ? NULL : ring_create(names, n_chains);
+    struct rtable_t **heads = calloc(n_chains, sizeof(struct rtable_t *));
+    if (ring == NULL || heads == NULL) {
+        ring_destroy(ring);
+        free(heads);
+        free_children(names);
+        return -1;
+    }
 
-    // Definir o prefixo do no
-    set_server_prefix(RPTABLE_ZK_NODE_PREFIX);
-    
-    // Criar o no raiz
-    if (create_root(table.handler, RPTABLE_ZK_ROOT_PATH) < 0)
-        goto err_zk_create_root;
+    pthread_mutex_lock(&shards->lock);
+    int changed = shards->n_chains != n_chains;
+    for (int i = 0; !changed && i < n_chains; i++)
+        changed = strcmp(shards->names[i], names[i]) != 0;
+    for (int i = 0; shards->heads != NULL && i < shards->n_chains; i++)
+        if (shards->heads[i] != NULL)
+            rtable_disconnect(shards->heads[i]);
+    free(shards->heads);
+    free_children(shards->names);
+    ring_destroy(shards->ring);
+    shards->names = names;
+    shards->n_chains = n_chains;
+    shards->self = self;
+    shards->ring = ring;
+    shards->heads = heads;
+    if (changed)
+        shards->generation++;
+    pthread_mutex_unlock(&shards->lock);
+    return 0;
+}
 
-    // Criar um no efemero no zk
-    if ((table.znode = register_server(table.handler, 
-                    RPTABLE_ZK_ROOT_PATH, sock)) == NULL)
-        goto err_zk_reg_server;
-    
-    // Colocar watcher ao no raiz
-    set_node_watcher(table.handler, RPTABLE_ZK_ROOT_PATH, zknode_watcher);
+/**
+ * Retorna a ligacao a cabeca da cadeia index, abrindo-a se
+ * ainda nao existir. Deve ser chamada com o lock das cadeias.
+ * \return
+ *      A ligacao ou NULL em caso de erro.
+*/
+static struct rtable_t *shards_head(s_rptable_t *rptable, int index) {
+    struct rptable_shards_t *shards = rptable->shards;
+    if (shards->heads[index] != NULL)
+        return shards->heads[index];
 
-    // Obter o socket do servidor seguinte
-    table.rptable_socket = get_next_server(table.handler, 
-                    RPTABLE_ZK_ROOT_PATH, table.znode, zknode_watcher);
-    
-    // Se ha algum servidor seguinte
-    if (table.rptable_socket != NULL) {
-        // Se ocorrer erro enquanto tentar ligar
-        if ((table.rtable = rtable_connect(table.rptable_socket)) == NULL)
-            goto err_rtable_con;
-    }
+    char *path = get_child_path(RPTABLE_ZK_SHARDS_PATH, shards->names[index]);
+    if (path == NULL)
+        return NULL;
+    char *socket = get_head_server(rptable->handler, path, NULL);
+    free(path);
+    if (socket == NULL || socket == ZDATA_NOT_FOUND)
+        return NULL;
+    shards->heads[index] = rtable_connect(socket);
+    free(socket);
+    return shards->heads[index];
+}
 
-    // Copiar para o buffer
-    memcpy(table_ptr, &table, sizeof(s_rptable_t));
+/**
+ * Fecha a ligacao a cabeca da cadeia index depois de um erro,
+ * a cabeca pode ter mudado. Deve ser chamada com o lock das cadeias.
+*/
+static void shards_head_failed(s_rptable_t *rptable, int index) {
+    struct rptable_shards_t *shards = rptable->shards;
+    if (shards->heads[index] != NULL)
+        rtable_disconnect(shards->heads[index]);
+    shards->heads[index] = NULL;
+}
 
-    // Guardar as funcoes para fazer call-back
-    rptable_watcher = watcher;
-    rptable_fhandler = handler;
+/**
+ * Retorna a ligacao ao servidor seguinte, preparada para o pedido
+ * que vai ser enviado. Uma escrita que so precisa deste servidor e
+ * enviada sem esperar pela resposta, e uma que precisa de N pede
+ * N - 1 ao seguinte. Os restantes pedidos esperam pela resposta.
+ * Deve ser chamada dentro da seccao critica de escrita.
+*/
+static struct rtable_t *next_server(s_rptable_t *rptable, int write) {
+    struct rtable_t *rtable = rptable->rtable;
+    unsigned int replicas = write ? forward_replicas : 0;
+    pthread_mutex_lock(&rtable->pool_lock);
+    rtable->async = replicas == 1;
+    rtable->replicas = replicas > 1 ? replicas - 1 : replicas;
+    pthread_mutex_unlock(&rtable->pool_lock);
+    return rtable;
+}
 
-    return table_ptr;
+/**
+ * Fecha a ligacao a cauda, para ser aberta de novo no proximo
+ * pedido que a use.
+*/
+static void tail_reset(s_rptable_t *rptable) {
+    pthread_mutex_lock(&tail_lock);
+    if (rptable->tail != NULL)
+        rtable_disconnect(rptable->tail);
+    free(rptable->tail_socket);
+    rptable->tail = NULL;
+    rptable->tail_socket = NULL;
+    pthread_mutex_unlock(&tail_lock);
+}
 
-    err_rtable_con:
-    free(table.rptable_socket);
-    err_zk_reg_server:
-    zookeeper_close(table.handler);
-    err_zk_create_root:
-    err_zk_init:
-    free(table_ptr);
-    err_rptable_malloc:
-    return NULL;
+s_rptable_t *rptable_connect(int sock, node_watcher watcher, failure_handler handler) {
+    return rptable_connect_chain(RPTABLE_ZK_DEFAULT_SOCKET, NULL, sock, watcher, handler);
 }
 
 s_rptable_t *rptable_connect_zksock(char* zksock, int sock, node_watcher watcher, failure_handler handler) {
-    if (sock < 0 || watcher == NULL || handler == NULL)
+    return rptable_connect_chain(zksock, NULL, sock, watcher, handler);
+}
+
+s_rptable_t *rptable_connect_chain(char* zksock, char* chain, int sock,
+                                   node_watcher watcher, failure_handler handler) {
+    if (zksock == NULL || sock < 0 || watcher == NULL || handler == NULL)
+        return NULL;
+    if (chain != NULL && (chain[0] == '\0' || strchr(chain, '/') != NULL))
         return NULL;
 
     s_rptable_t *table_ptr = malloc(sizeof(s_rptable_t));
@@ -96,7 +199,13 @@ s_rptable_t *rptable_connect_zksock(char* zksock, int sock, node_watcher watcher
         goto err_rptable_malloc;
 
     // Iniciar a estrutura
-    s_rptable_t table = {NULL, NULL, NULL, NULL};
+    s_rptable_t table = {NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL, NULL};
+
+    // Sem particoes a cadeia e o no raiz de sempre
+    table.root = chain == NULL ? strdup(RPTABLE_ZK_ROOT_PATH) :
+                                 get_child_path(RPTABLE_ZK_SHARDS_PATH, chain);
+    if (table.root == NULL)
+        goto err_root;
 
     zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
 
@@ -108,21 +217,38 @@ s_rptable_t *rptable_connect_zksock(char* zksock, int sock, node_watcher watcher
     // Definir o prefixo do no
     set_server_prefix(RPTABLE_ZK_NODE_PREFIX);
     
-    // Criar o no raiz
-    if (create_root(table.handler, RPTABLE_ZK_ROOT_PATH) < 0)
+    // Criar o no raiz, as cadeias particionadas ficam dentro do no das particoes
+    if (chain != NULL && create_root(table.handler, RPTABLE_ZK_SHARDS_PATH) < 0)
+        goto err_zk_create_root;
+    if (create_root(table.handler, table.root) < 0)
         goto err_zk_create_root;
 
     // Criar um no efemero no zk
     if ((table.znode = register_server(table.handler, 
-                    RPTABLE_ZK_ROOT_PATH, sock)) == NULL)
+                    table.root, sock, network_server_unix_path())) == NULL)
         goto err_zk_reg_server;
+
+    // Ler as cadeias da instalacao particionada
+    if (chain != NULL) {
+        if (create_root(table.handler, RPTABLE_ZK_MIGRATIONS_PATH) < 0)
+            goto err_zk_shards;
+        if ((table.shards = calloc(1, sizeof(struct rptable_shards_t))) == NULL)
+            goto err_zk_shards;
+        pthread_mutex_init(&table.shards->lock, NULL);
+        if ((table.shards->chain = strdup(chain)) == NULL || shards_refresh(&table) == -1)
+            goto err_zk_shards;
+    }
     
     // Colocar watcher ao no raiz
-    set_node_watcher(table.handler, RPTABLE_ZK_ROOT_PATH, zknode_watcher);
+    set_node_watcher(table.handler, table.root, zknode_watcher);
+
+    // Verificar se e a cabeca da cadeia
+    if ((table.is_head = rptable_check_head(&table)) == -1)
+        goto err_zk_head;
 
     // Obter o socket do servidor seguinte
     table.rptable_socket = get_next_server(table.handler, 
-                    RPTABLE_ZK_ROOT_PATH, table.znode, zknode_watcher);
+                    table.root, table.znode, zknode_watcher);
     
     // Se ha algum servidor seguinte
     if (table.rptable_socket != NULL) {
@@ -142,23 +268,53 @@ s_rptable_t *rptable_connect_zksock(char* zksock, int sock, node_watcher watcher
 
     err_rtable_con:
     free(table.rptable_socket);
+    err_zk_head:
+    err_zk_shards:
+    shards_destroy(table.shards);
+    free(table.znode);
     err_zk_reg_server:
-    zookeeper_close(table.handler);
     err_zk_create_root:
+    zookeeper_close(table.handler);
     err_zk_init:
+    free(table.root);
+    err_root:
     free(table_ptr);
     err_rptable_malloc:
     return NULL;
 }
 
+/**
+ * Coloca na tabela local as entradas de uma pagina copiada do
+ * servidor anterior, com as versoes e os instantes de expiracao. As
+ * entradas que a cadeia ja trouxe com versao igual ou maior ficam
+ * como estao.
+ * \param version
+ *      Maior versao vista ate agora, atualizada com as da pagina.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+static int sync_entries(struct table_t *table, MessageT *resp, uint64_t *version) {
+    // Iterar pela array de entries
+    for (int i = 0; i < resp->n_entries; i++) {
+        EntryT *it_entry = resp->entries[i];
+        struct data_t data = {it_entry->value.len, it_entry->value.data};
+        if (table_skel_sync_entry(table, it_entry->key, &data, it_entry->version,
+                                  it_entry->expire_at) == -1)
+            return -1;
+        if (it_entry->version > *version)
+            *version = it_entry->version;
+    }
+    return 0;
+}
+
 int rptable_sync(s_rptable_t *rptable, struct table_t *table) {
     if (rptable == NULL || table == NULL)
         return -1;
-    if (rptable->handler == NULL || rptable->znode == NULL)
+    if (rptable->handler == NULL || rptable->znode == NULL || rptable->root == NULL)
         return -1;
     
     // Obter o descritor de socket do servidor anterior
-    char *prev_server_sock = get_prev_server(rptable->handler, RPTABLE_ZK_ROOT_PATH,
+    char *prev_server_sock = get_prev_server(rptable->handler, rptable->root,
                             rptable->znode, zknode_watcher);
     // Se ocorreu um erro
     if (prev_server_sock == NULL)
@@ -176,52 +332,60 @@ int rptable_sync(s_rptable_t *rptable, struct table_t *table) {
     }
     free(prev_server_sock);
 
-    // Obter a lista de entries
-    struct entry_t **entries = rtable_get_table(prev_server);
-    if (entries == NULL) {
-        rtable_disconnect(prev_server);
-        return -1;
-    }
-
-    // Iterar pela array de entries
-    int index = 0;
-    struct entry_t *it_entry = entries[index];
-    while (it_entry != NULL) {
-        // Duplicar a chave
-        char *key = strdup(it_entry->key);
-        if (key == NULL) {
-            rtable_free_entries(entries);
-            rtable_disconnect(prev_server);
-            return -1;
+    // Pedir a tabela diretamente, para obter tambem os instantes de
+    // expiracao das entradas, por paginas que cabem numa mensagem. O
+    // servidor anterior responde com erro a uma pagina grande demais,
+    // que e pedida de novo com menos entradas
+    CursorT cursor;
+    cursor_t__init(&cursor);
+    int limit = RPTABLE_SYNC_PAGE;
+    uint64_t version = 0;
+    while (1) {
+        MessageT msg;
+        message_t__init(&msg);
+        msg.opcode = MESSAGE_T__OPCODE__OP_GETTABLE;
+        msg.c_type = MESSAGE_T__C_TYPE__CT_CURSOR;
+        msg.cursor = &cursor;
+        msg.limit = limit;
+        msg.prefix = "";
+        msg.pattern = "";
+
+        MessageT *resp = network_send_receive(prev_server, &msg);
+        if (resp == NULL)
+            goto err_sync;
+        if (resp->opcode == MESSAGE_T__OPCODE__OP_ERROR && limit > 1) {
+            message_t__free_unpacked(resp, NULL);
+            limit /= 2;
+            continue;
         }
-
-        // Duplicar o valor
-        struct data_t *data = data_dup(it_entry->value);
-        if (data == NULL) {
-            free(key);
-            rtable_free_entries(entries);
-            rtable_disconnect(prev_server);
-            return -1;
+        if (resp->opcode != MESSAGE_T__OPCODE__OP_GETTABLE + 1 ||
+            resp->c_type != MESSAGE_T__C_TYPE__CT_TABLE || resp->cursor == NULL ||
+            sync_entries(table, resp, &version) == -1) {
+            message_t__free_unpacked(resp, NULL);
+            goto err_sync;
         }
-
-        // Se ocorrer erro
-        if (table_put(table, key, data) == -1) {
-            data_destroy(data);
-            free(key);
-            rtable_free_entries(entries);
-            rtable_disconnect(prev_server);
-            return -1;
-        }
-
-        data_destroy(data);
-        free(key);
-
-        index++;
-        it_entry = entries[index];
+        if (resp->version > version)
+            version = resp->version;
+        cursor.bucket = resp->cursor->bucket;
+        cursor.position = resp->cursor->position;
+        message_t__free_unpacked(resp, NULL);
+        limit = RPTABLE_SYNC_PAGE;
+        // O cursor volta a zero depois da ultima pagina
+        if (cursor.bucket == 0 && cursor.position == 0)
+            break;
     }
-    rtable_free_entries(entries);
+
+    // As remocoes tambem tem versoes, a copia inclui as escritas ate
+    // a maior versao das paginas, que o registo das escritas nao tem.
+    // Continua a sequencia das versoes se passar a ser a cabeca
+    if (table_skel_set_version(version) == -1)
+        goto err_sync;
     rtable_disconnect(prev_server);
     return 0;
+
+    err_sync:
+    rtable_disconnect(prev_server);
+    return -1;
 }
 
 int rptable_disconnect(s_rptable_t *rptable) {
@@ -239,17 +403,28 @@ int rptable_disconnect(s_rptable_t *rptable) {
     else 
         res = -1;
 
+    if (rptable->root != NULL)
+        free(rptable->root);
+
     if (rptable->rptable_socket != NULL)
         free(rptable->rptable_socket);
 
     if (rptable->rtable != NULL)
         rtable_disconnect(rptable->rtable);
 
+    shards_destroy(rptable->shards);
+    tail_reset(rptable);
+
     free(rptable);
     return res;
 }
 
 int rptable_put(s_rptable_t *rptable, char *key, struct data_t *value) {
+    return rptable_put_expire(rptable, key, value, 0, 0);
+}
+
+int rptable_put_expire(s_rptable_t *rptable, char *key, struct data_t *value,
+                       unsigned long expire_at, uint64_t version) {
     if (rptable == NULL || key == NULL || value == NULL)
         return -1;
     if (rptable->rtable == NULL)
@@ -269,43 +444,68 @@ int rptable_put(s_rptable_t *rptable, char *key, struct data_t *value) {
         free(key_dup);
         return -1;
     }
-    int res = rtable_put(rptable->rtable, entry);
+    int res = rtable_put_expire(next_server(rptable, 1), entry, expire_at, version);
     entry_destroy(entry);
     return res;
 }
 
+int rptable_mput_expire(s_rptable_t *rptable, struct entry_t **entries, unsigned long *expire_at,
+                        uint64_t *version) {
+    if (rptable == NULL || entries == NULL || expire_at == NULL || version == NULL)
+        return -1;
+    if (rptable->rtable == NULL)
+        return 0;
+    return rtable_mput_expire(next_server(rptable, 1), entries, expire_at, version);
+}
+
 struct data_t *rptable_get(s_rptable_t *rptable, char *key) {
     if (rptable == NULL || key == NULL)
         return NULL;
     if (rptable->rtable == NULL)
         return NULL;
-    return rtable_get(rptable->rtable, key);
+    return rtable_get(next_server(rptable, 0), key);
 }
 
-int rptable_del(s_rptable_t *rptable, char *key) {
+int rptable_del(s_rptable_t *rptable, char *key, uint64_t version) {
     if (rptable == NULL || key == NULL)
         return -1;
     if (rptable->rtable == NULL)
         return 0;
-    return rtable_del(rptable->rtable, key);
+    return rtable_del_version(next_server(rptable, 1), key, version);
+}
+
+int rptable_mdel(s_rptable_t *rptable, char **keys, uint64_t version) {
+    if (rptable == NULL || keys == NULL)
+        return -1;
+    if (rptable->rtable == NULL)
+        return 0;
+    return rtable_mdel_version(next_server(rptable, 1), keys, version) == -1 ? -1 : 0;
+}
+
+int rptable_batch(s_rptable_t *rptable, struct rtable_batch_t *batch) {
+    if (rptable == NULL || batch == NULL)
+        return -1;
+    if (rptable->rtable == NULL)
+        return 0;
+    return rtable_batch_commit(next_server(rptable, 1), batch);
 }
 
 int rptable_size(s_rptable_t *rptable) {
     if (rptable == NULL || rptable->rtable == NULL)
         return -1;
-    return rtable_size(rptable->rtable);
+    return rtable_size(next_server(rptable, 0));
 }
 
 struct statistics_t *rptable_stats(s_rptable_t *rptable) {
     if (rptable == NULL || rptable->rtable == NULL)
         return NULL;
-    return rtable_stats(rptable->rtable);
+    return rtable_stats(next_server(rptable, 0));
 }
 
 char **rptable_get_keys(s_rptable_t *rptable) {
     if (rptable == NULL || rptable->rtable == NULL)
         return NULL;
-    return rtable_get_keys(rptable->rtable);
+    return rtable_get_keys(next_server(rptable, 0));
 }
 
 void rptable_free_keys(char **keys) {
@@ -317,7 +517,7 @@ void rptable_free_keys(char **keys) {
 struct entry_t **rptable_get_table(s_rptable_t *rptable) {
     if (rptable == NULL || rptable->rtable == NULL)
         return NULL;
-    return rtable_get_table(rptable->rtable);
+    return rtable_get_table(next_server(rptable, 0));
 }
 
 void rptable_free_entries(struct entry_t **entries) {
@@ -326,6 +526,184 @@ void rptable_free_entries(struct entry_t **entries) {
     rtable_free_entries(entries);
 }
 
+int rptable_heartbeat(s_rptable_t *rptable, uint64_t version) {
+    if (rptable == NULL)
+        return -1;
+    if (rptable->rtable == NULL)
+        return 0;
+    // As escritas enviadas sem esperar tem de chegar antes da sequencia,
+    // para a resposta confirmar que estao na cauda
+    struct rtable_t *rtable = next_server(rptable, 0);
+    if (network_flush(rtable) == -1)
+        return -1;
+    return rtable_heartbeat(rtable, version);
+}
+
+int rptable_replay(s_rptable_t *rptable, struct changelog_record_t *records, int n_records) {
+    if (rptable == NULL || records == NULL || n_records < 0)
+        return -1;
+    if (rptable->rtable == NULL)
+        return 0;
+    // As respostas das escritas enviadas sem esperar ja nao interessam,
+    // as que falharam estao entre as reenviadas
+    struct rtable_t *rtable = next_server(rptable, 0);
+    network_flush(rtable);
+    for (int i = 0; i < n_records; i++) {
+        struct changelog_record_t *record = &records[i];
+        int result;
+        if (record->value != NULL) {
+            struct entry_t entry = {record->key, record->value};
+            result = rtable_put_expire(rtable, &entry, record->expire_at, record->sequence);
+        } else {
+            result = rtable_del_version(rtable, record->key, record->sequence);
+        }
+        if (result == -1)
+            return -1;
+    }
+    return 0;
+}
+
+void rptable_forward_durability(unsigned int replicas) {
+    forward_replicas = replicas;
+}
+
+int rptable_is_tail(s_rptable_t *rptable) {
+    if (rptable == NULL)
+        return -1;
+    return rptable->rptable_socket == NULL;
+}
+
+MessageT *rptable_tail_read(s_rptable_t *rptable, MessageT *msg) {
+    if (rptable == NULL || msg == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&tail_lock);
+    if (rptable->tail == NULL) {
+        char *socket = get_tail_server(rptable->handler, rptable->root, NULL);
+        if (socket == NULL || socket == ZDATA_NOT_FOUND) {
+            pthread_mutex_unlock(&tail_lock);
+            return NULL;
+        }
+        if ((rptable->tail = rtable_connect(socket)) == NULL) {
+            free(socket);
+            pthread_mutex_unlock(&tail_lock);
+            return NULL;
+        }
+        rptable->tail_socket = socket;
+    }
+
+    MessageT *resp = network_send_receive(rptable->tail, msg);
+    pthread_mutex_unlock(&tail_lock);
+    // Se a cauda falhou, a ligacao e aberta de novo no proximo pedido
+    if (resp == NULL)
+        tail_reset(rptable);
+    return resp;
+}
+
+int rptable_is_head(s_rptable_t *rptable) {
+    if (rptable == NULL)
+        return -1;
+    return atomic_load(&rptable->is_head);
+}
+
+int rptable_owns(s_rptable_t *rptable, char *key) {
+    if (rptable == NULL || key == NULL)
+        return -1;
+    if (rptable->shards == NULL)
+        return 1;
+    pthread_mutex_lock(&rptable->shards->lock);
+    int owner = ring_lookup(rptable->shards->ring, key);
+    int self = rptable->shards->self;
+    pthread_mutex_unlock(&rptable->shards->lock);
+    if (owner == -1)
+        return -1;
+    return owner == self;
+}
+
+unsigned int rptable_generation(s_rptable_t *rptable) {
+    if (rptable == NULL || rptable->shards == NULL)
+        return 0;
+    pthread_mutex_lock(&rptable->shards->lock);
+    unsigned int generation = rptable->shards->generation;
+    pthread_mutex_unlock(&rptable->shards->lock);
+    return generation;
+}
+
+MessageT *rptable_redirect(s_rptable_t *rptable, char *key, MessageT *msg) {
+    if (rptable == NULL || key == NULL || msg == NULL || rptable->shards == NULL)
+        return NULL;
+    struct rptable_shards_t *shards = rptable->shards;
+
+    pthread_mutex_lock(&shards->lock);
+    int owner = ring_lookup(shards->ring, key);
+    struct rtable_t *head = owner == -1 || owner == shards->self ? NULL : 
+                            shards_head(rptable, owner);
+    if (head == NULL) {
+        pthread_mutex_unlock(&shards->lock);
+        return NULL;
+    }
+
+    // A outra cabeca trata o pedido mesmo que a sua vista seja diferente
+    msg->forwarded = 1;
+    MessageT *resp = network_send_receive(head, msg);
+    if (resp == NULL)
+        shards_head_failed(rptable, owner);
+    pthread_mutex_unlock(&shards->lock);
+    return resp;
+}
+
+int rptable_migrate(s_rptable_t *rptable, struct entry_t **entries, unsigned long *expire_at) {
+    if (rptable == NULL || entries == NULL || expire_at == NULL || rptable->shards == NULL)
+        return -1;
+    struct rptable_shards_t *shards = rptable->shards;
+
+    int n = 0;
+    while (entries[n] != NULL)
+        n++;
+    struct entry_t *group[n + 1];
+    unsigned long group_expire_at[n + 1];
+
+    pthread_mutex_lock(&shards->lock);
+    int owner[n];
+    for (int i = 0; i < n; i++)
+        owner[i] = ring_lookup(shards->ring, entries[i]->key);
+
+    // Um pedido para cada cadeia dona de alguma das entradas
+    for (int c = 0; c < shards->n_chains; c++) {
+        int n_group = 0;
+        for (int i = 0; i < n; i++) {
+            if (owner[i] != c)
+                continue;
+            group[n_group] = entries[i];
+            group_expire_at[n_group++] = expire_at[i];
+        }
+        if (n_group == 0 || c == shards->self)
+            continue;
+        group[n_group] = NULL;
+
+        struct rtable_t *head = shards_head(rptable, c);
+        if (head == NULL || rtable_migrate(head, group, group_expire_at) == -1) {
+            shards_head_failed(rptable, c);
+            pthread_mutex_unlock(&shards->lock);
+            return -1;
+        }
+    }
+    pthread_mutex_unlock(&shards->lock);
+    return 0;
+}
+
+int rptable_set_migrating(s_rptable_t *rptable, int migrating) {
+    if (rptable == NULL || rptable->shards == NULL)
+        return -1;
+    char *path = get_child_path(RPTABLE_ZK_MIGRATIONS_PATH, rptable->shards->chain);
+    if (path == NULL)
+        return -1;
+    int result = migrating ? create_ephemeral(rptable->handler, path) :
+                             delete_node(rptable->handler, path);
+    free(path);
+    return result == -1 ? -1 : 0;
+}
+
 
 void zkconnection_watcher(zhandle_t *zzh, int type, int state, const char *path, void* context) {
 	if (type == ZOO_SESSION_EVENT) {
@@ -345,13 +723,33 @@ void zknode_watcher(zhandle_t *zzh, int type, int state, const char *path, void*
         return;
     
     s_rptable_t *table = rptable_watcher();
-    if (table == NULL || table->handler == NULL || table->znode == NULL) {
+
+    // Mudaram as cadeias da instalacao particionada
+    if (table != NULL && table->shards != NULL && path != NULL &&
+        strcmp(path, RPTABLE_ZK_SHARDS_PATH) == 0) {
+        if (shards_refresh(table) == -1)
+            rptable_fhandler(RPTABLE_CONNECTION_FAILED);
+        return;
+    }
+
+    if (table == NULL || table->handler == NULL || table->znode == NULL || table->root == NULL) {
+        rptable_fhandler(RPTABLE_INVALID_ARG);
+        return;
+    }
+
+    // Se o servidor anterior saiu, este pode ter passado a cabeca
+    int is_head = rptable_check_head(table);
+    if (is_head == -1) {
         rptable_fhandler(RPTABLE_INVALID_ARG);
         return;
     }
+    table->is_head = is_head;
+
+    // A cauda pode ter mudado
+    tail_reset(table);
     
     // Tentar obter o descritor do proximo servidor
-    char *next_table = get_next_server(table->handler, RPTABLE_ZK_ROOT_PATH, 
+    char *next_table = get_next_server(table->handler, table->root, 
                                 table->znode, zknode_watcher);
 
     // Se nao foi encontrado nenhum servidor seguinte 
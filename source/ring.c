@@ -0,0 +1,84 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "ring.h"
+#include "hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int point_compare(const void *a, const void *b) {
+    const struct ring_point_t *pa = a, *pb = b;
+    if (pa->hash != pb->hash)
+        return pa->hash < pb->hash ? -1 : 1;
+    // Desempatar pela cadeia para o anel nao depender do qsort
+    return pa->node - pb->node;
+}
+
+struct ring_t *ring_create(char **nodes, int n_nodes) {
+    if (nodes == NULL || n_nodes <= 0)
+        return NULL;
+
+    struct ring_t *ring = malloc(sizeof(struct ring_t));
+    if (ring == NULL)
+        return NULL;
+    ring->n_nodes = n_nodes;
+    ring->n_points = n_nodes * RING_VNODES;
+    ring->points = malloc(ring->n_points * sizeof(struct ring_point_t));
+    if (ring->points == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    // Os pontos de cada cadeia sao os hashes de "<nome>#<i>"
+    for (int i = 0; i < n_nodes; i++) {
+        if (nodes[i] == NULL) {
+            ring_destroy(ring);
+            return NULL;
+        }
+        int len = strlen(nodes[i]);
+        char vnode[len + 16];
+        for (int v = 0; v < RING_VNODES; v++) {
+            int vlen = snprintf(vnode, sizeof(vnode), "%s#%d", nodes[i], v);
+            struct ring_point_t *point = &ring->points[i * RING_VNODES + v];
+            point->hash = hash_stable(vnode, vlen);
+            point->node = i;
+        }
+    }
+    qsort(ring->points, ring->n_points, sizeof(struct ring_point_t), point_compare);
+    return ring;
+}
+
+int ring_destroy(struct ring_t *ring) {
+    if (ring == NULL)
+        return -1;
+    free(ring->points);
+    free(ring);
+    return 0;
+}
+
+int ring_lookup(struct ring_t *ring, const char *key) {
+    if (ring == NULL || key == NULL)
+        return -1;
+
+    // Procurar o primeiro ponto com hash maior ou igual ao da chave
+    uint64_t hash = hash_stable(key, strlen(key));
+    int low = 0, high = ring->n_points;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (ring->points[mid].hash < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    // Depois do ultimo ponto volta ao inicio do anel
+    if (low == ring->n_points)
+        low = 0;
+    return ring->points[low].node;
+}
@@ -52,6 +52,96 @@ void   entry_t__free_unpacked
   assert(message->base.descriptor == &entry_t__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   slab_class_t__init
+                     (SlabClassT         *message)
+{
+  static const SlabClassT init_value = SLAB_CLASS_T__INIT;
+  *message = init_value;
+}
+size_t slab_class_t__get_packed_size
+                     (const SlabClassT *message)
+{
+  assert(message->base.descriptor == &slab_class_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t slab_class_t__pack
+                     (const SlabClassT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &slab_class_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t slab_class_t__pack_to_buffer
+                     (const SlabClassT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &slab_class_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+SlabClassT *
+       slab_class_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (SlabClassT *)
+     protobuf_c_message_unpack (&slab_class_t__descriptor,
+                                allocator, len, data);
+}
+void   slab_class_t__free_unpacked
+                     (SlabClassT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &slab_class_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   cursor_t__init
+                     (CursorT         *message)
+{
+  static const CursorT init_value = CURSOR_T__INIT;
+  *message = init_value;
+}
+size_t cursor_t__get_packed_size
+                     (const CursorT *message)
+{
+  assert(message->base.descriptor == &cursor_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t cursor_t__pack
+                     (const CursorT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &cursor_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t cursor_t__pack_to_buffer
+                     (const CursorT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &cursor_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+CursorT *
+       cursor_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (CursorT *)
+     protobuf_c_message_unpack (&cursor_t__descriptor,
+                                allocator, len, data);
+}
+void   cursor_t__free_unpacked
+                     (CursorT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &cursor_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 void   stats_t__init
                      (StatsT         *message)
 {
@@ -142,7 +232,7 @@ void   message_t__free_unpacked
   assert(message->base.descriptor == &message_t__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
-static const ProtobufCFieldDescriptor entry_t__field_descriptors[2] =
+static const ProtobufCFieldDescriptor entry_t__field_descriptors[6] =
 {
   {
     "key",
@@ -168,15 +258,67 @@ static const ProtobufCFieldDescriptor entry_t__field_descriptors[2] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "ttl",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(EntryT, ttl),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "expire_at",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(EntryT, expire_at),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "version",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(EntryT, version),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "deleted",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(EntryT, deleted),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned entry_t__field_indices_by_name[] = {
+  5,   /* field[5] = deleted */
+  3,   /* field[3] = expire_at */
   0,   /* field[0] = key */
+  2,   /* field[2] = ttl */
   1,   /* field[1] = value */
+  4,   /* field[4] = version */
 };
 static const ProtobufCIntRange entry_t__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 2 }
+  { 0, 6 }
 };
 const ProtobufCMessageDescriptor entry_t__descriptor =
 {
@@ -186,14 +328,129 @@ const ProtobufCMessageDescriptor entry_t__descriptor =
   "EntryT",
   "",
   sizeof(EntryT),
-  2,
+  6,
   entry_t__field_descriptors,
   entry_t__field_indices_by_name,
   1,  entry_t__number_ranges,
   (ProtobufCMessageInit) entry_t__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor stats_t__field_descriptors[3] =
+static const ProtobufCFieldDescriptor slab_class_t__field_descriptors[3] =
+{
+  {
+    "size",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(SlabClassT, size),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "used",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(SlabClassT, used),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "capacity",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(SlabClassT, capacity),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned slab_class_t__field_indices_by_name[] = {
+  2,   /* field[2] = capacity */
+  0,   /* field[0] = size */
+  1,   /* field[1] = used */
+};
+static const ProtobufCIntRange slab_class_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 3 }
+};
+const ProtobufCMessageDescriptor slab_class_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "slab_class_t",
+  "SlabClassT",
+  "SlabClassT",
+  "",
+  sizeof(SlabClassT),
+  3,
+  slab_class_t__field_descriptors,
+  slab_class_t__field_indices_by_name,
+  1,  slab_class_t__number_ranges,
+  (ProtobufCMessageInit) slab_class_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor cursor_t__field_descriptors[2] =
+{
+  {
+    "bucket",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(CursorT, bucket),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "position",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(CursorT, position),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned cursor_t__field_indices_by_name[] = {
+  0,   /* field[0] = bucket */
+  1,   /* field[1] = position */
+};
+static const ProtobufCIntRange cursor_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 2 }
+};
+const ProtobufCMessageDescriptor cursor_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "cursor_t",
+  "CursorT",
+  "CursorT",
+  "",
+  sizeof(CursorT),
+  2,
+  cursor_t__field_descriptors,
+  cursor_t__field_indices_by_name,
+  1,  cursor_t__number_ranges,
+  (ProtobufCMessageInit) cursor_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor stats_t__field_descriptors[8] =
 {
   {
     "n_op",
@@ -231,16 +488,81 @@ static const ProtobufCFieldDescriptor stats_t__field_descriptors[3] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "n_evicted",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatsT, n_evicted),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "memory",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatsT, memory),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "slabs",
+    6,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(StatsT, n_slabs),
+    offsetof(StatsT, slabs),
+    &slab_class_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "write_ops",
+    7,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_UINT64,
+    offsetof(StatsT, n_write_ops),
+    offsetof(StatsT, write_ops),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "write_time",
+    8,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_UINT64,
+    offsetof(StatsT, n_write_time),
+    offsetof(StatsT, write_time),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned stats_t__field_indices_by_name[] = {
+  4,   /* field[4] = memory */
   2,   /* field[2] = n_clients */
+  3,   /* field[3] = n_evicted */
   0,   /* field[0] = n_op */
+  5,   /* field[5] = slabs */
   1,   /* field[1] = time */
+  6,   /* field[6] = write_ops */
+  7,   /* field[7] = write_time */
 };
 static const ProtobufCIntRange stats_t__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 3 }
+  { 0, 8 }
 };
 const ProtobufCMessageDescriptor stats_t__descriptor =
 {
@@ -250,14 +572,14 @@ const ProtobufCMessageDescriptor stats_t__descriptor =
   "StatsT",
   "",
   sizeof(StatsT),
-  3,
+  8,
   stats_t__field_descriptors,
   stats_t__field_indices_by_name,
   1,  stats_t__number_ranges,
   (ProtobufCMessageInit) stats_t__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[9] =
+static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[26] =
 {
   { "OP_BAD", "MESSAGE_T__OPCODE__OP_BAD", 0 },
   { "OP_PUT", "MESSAGE_T__OPCODE__OP_PUT", 10 },
@@ -267,22 +589,56 @@ static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[9] =
   { "OP_GETKEYS", "MESSAGE_T__OPCODE__OP_GETKEYS", 50 },
   { "OP_GETTABLE", "MESSAGE_T__OPCODE__OP_GETTABLE", 60 },
   { "OP_STATS", "MESSAGE_T__OPCODE__OP_STATS", 70 },
+  { "OP_SCAN", "MESSAGE_T__OPCODE__OP_SCAN", 80 },
+  { "OP_MGET", "MESSAGE_T__OPCODE__OP_MGET", 90 },
   { "OP_ERROR", "MESSAGE_T__OPCODE__OP_ERROR", 99 },
+  { "OP_MPUT", "MESSAGE_T__OPCODE__OP_MPUT", 100 },
+  { "OP_MDEL", "MESSAGE_T__OPCODE__OP_MDEL", 110 },
+  { "OP_INCR", "MESSAGE_T__OPCODE__OP_INCR", 120 },
+  { "OP_APPEND", "MESSAGE_T__OPCODE__OP_APPEND", 130 },
+  { "OP_CAS", "MESSAGE_T__OPCODE__OP_CAS", 140 },
+  { "OP_CPUT", "MESSAGE_T__OPCODE__OP_CPUT", 150 },
+  { "OP_CDEL", "MESSAGE_T__OPCODE__OP_CDEL", 160 },
+  { "OP_BATCH", "MESSAGE_T__OPCODE__OP_BATCH", 170 },
+  { "OP_MIGRATE", "MESSAGE_T__OPCODE__OP_MIGRATE", 180 },
+  { "OP_HEARTBEAT", "MESSAGE_T__OPCODE__OP_HEARTBEAT", 190 },
+  { "OP_TRACK", "MESSAGE_T__OPCODE__OP_TRACK", 200 },
+  { "OP_INVALIDATE", "MESSAGE_T__OPCODE__OP_INVALIDATE", 210 },
+  { "OP_WATCH", "MESSAGE_T__OPCODE__OP_WATCH", 220 },
+  { "OP_EVENT", "MESSAGE_T__OPCODE__OP_EVENT", 230 },
+  { "OP_CHANGES", "MESSAGE_T__OPCODE__OP_CHANGES", 240 },
 };
 static const ProtobufCIntRange message_t__opcode__value_ranges[] = {
-{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{99, 8},{0, 9}
+{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{90, 9},{99, 10},{110, 12},{120, 13},{130, 14},{140, 15},{150, 16},{160, 17},{170, 18},{180, 19},{190, 20},{200, 21},{210, 22},{220, 23},{230, 24},{240, 25},{0, 26}
 };
-static const ProtobufCEnumValueIndex message_t__opcode__enum_values_by_name[9] =
+static const ProtobufCEnumValueIndex message_t__opcode__enum_values_by_name[26] =
 {
+  { "OP_APPEND", 14 },
   { "OP_BAD", 0 },
+  { "OP_BATCH", 18 },
+  { "OP_CAS", 15 },
+  { "OP_CDEL", 17 },
+  { "OP_CHANGES", 25 },
+  { "OP_CPUT", 16 },
   { "OP_DEL", 3 },
-  { "OP_ERROR", 8 },
+  { "OP_ERROR", 10 },
+  { "OP_EVENT", 24 },
   { "OP_GET", 2 },
   { "OP_GETKEYS", 5 },
   { "OP_GETTABLE", 6 },
+  { "OP_HEARTBEAT", 20 },
+  { "OP_INCR", 13 },
+  { "OP_INVALIDATE", 22 },
+  { "OP_MDEL", 12 },
+  { "OP_MGET", 9 },
+  { "OP_MIGRATE", 19 },
+  { "OP_MPUT", 11 },
   { "OP_PUT", 1 },
+  { "OP_SCAN", 8 },
   { "OP_SIZE", 4 },
   { "OP_STATS", 7 },
+  { "OP_TRACK", 21 },
+  { "OP_WATCH", 23 },
 };
 const ProtobufCEnumDescriptor message_t__opcode__descriptor =
 {
@@ -291,15 +647,15 @@ const ProtobufCEnumDescriptor message_t__opcode__descriptor =
   "Opcode",
   "MessageT__Opcode",
   "",
-  9,
+  26,
   message_t__opcode__enum_values_by_number,
-  9,
+  26,
   message_t__opcode__enum_values_by_name,
-  9,
+  25,
   message_t__opcode__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
-static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[9] =
+static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[12] =
 {
   { "CT_BAD", "MESSAGE_T__C_TYPE__CT_BAD", 0 },
   { "CT_ENTRY", "MESSAGE_T__C_TYPE__CT_ENTRY", 10 },
@@ -310,18 +666,24 @@ static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[9] =
   { "CT_TABLE", "MESSAGE_T__C_TYPE__CT_TABLE", 60 },
   { "CT_STATS", "MESSAGE_T__C_TYPE__CT_STATS", 70 },
   { "CT_NONE", "MESSAGE_T__C_TYPE__CT_NONE", 80 },
+  { "CT_RANGE", "MESSAGE_T__C_TYPE__CT_RANGE", 90 },
+  { "CT_CURSOR", "MESSAGE_T__C_TYPE__CT_CURSOR", 100 },
+  { "CT_STALE", "MESSAGE_T__C_TYPE__CT_STALE", 110 },
 };
 static const ProtobufCIntRange message_t__c_type__value_ranges[] = {
-{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{0, 9}
+{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{90, 9},{100, 10},{110, 11},{0, 12}
 };
-static const ProtobufCEnumValueIndex message_t__c_type__enum_values_by_name[9] =
+static const ProtobufCEnumValueIndex message_t__c_type__enum_values_by_name[12] =
 {
   { "CT_BAD", 0 },
+  { "CT_CURSOR", 10 },
   { "CT_ENTRY", 1 },
   { "CT_KEY", 2 },
   { "CT_KEYS", 5 },
   { "CT_NONE", 8 },
+  { "CT_RANGE", 9 },
   { "CT_RESULT", 4 },
+  { "CT_STALE", 11 },
   { "CT_STATS", 7 },
   { "CT_TABLE", 6 },
   { "CT_VALUE", 3 },
@@ -333,15 +695,45 @@ const ProtobufCEnumDescriptor message_t__c_type__descriptor =
   "C_type",
   "MessageT__CType",
   "",
-  9,
+  12,
   message_t__c_type__enum_values_by_number,
-  9,
+  12,
   message_t__c_type__enum_values_by_name,
-  9,
+  12,
   message_t__c_type__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
-static const ProtobufCFieldDescriptor message_t__field_descriptors[9] =
+static const ProtobufCEnumValue message_t__consistency__enum_values_by_number[3] =
+{
+  { "READ_STRONG", "MESSAGE_T__CONSISTENCY__READ_STRONG", 0 },
+  { "READ_BOUNDED", "MESSAGE_T__CONSISTENCY__READ_BOUNDED", 10 },
+  { "READ_ANY", "MESSAGE_T__CONSISTENCY__READ_ANY", 20 },
+};
+static const ProtobufCIntRange message_t__consistency__value_ranges[] = {
+{0, 0},{10, 1},{20, 2},{0, 3}
+};
+static const ProtobufCEnumValueIndex message_t__consistency__enum_values_by_name[3] =
+{
+  { "READ_ANY", 2 },
+  { "READ_BOUNDED", 1 },
+  { "READ_STRONG", 0 },
+};
+const ProtobufCEnumDescriptor message_t__consistency__descriptor =
+{
+  PROTOBUF_C__ENUM_DESCRIPTOR_MAGIC,
+  "message_t.Consistency",
+  "Consistency",
+  "MessageT__Consistency",
+  "",
+  3,
+  message_t__consistency__enum_values_by_number,
+  3,
+  message_t__consistency__enum_values_by_name,
+  3,
+  message_t__consistency__value_ranges,
+  NULL,NULL,NULL,NULL   /* reserved[1234] */
+};
+static const ProtobufCFieldDescriptor message_t__field_descriptors[23] =
 {
   {
     "opcode",
@@ -451,22 +843,204 @@ static const ProtobufCFieldDescriptor message_t__field_descriptors[9] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "end_key",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, end_key),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "limit",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_SINT32,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, limit),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "prefix",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, prefix),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "pattern",
+    13,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, pattern),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "cursor",
+    14,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, cursor),
+    &cursor_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "delta",
+    15,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_SINT64,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, delta),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "expected",
+    16,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, expected),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "version",
+    17,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, version),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "forwarded",
+    18,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, forwarded),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "consistency",
+    19,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_ENUM,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, consistency),
+    &message_t__consistency__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "max_lag",
+    20,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, max_lag),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "replicas",
+    21,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, replicas),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "track_id",
+    22,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, track_id),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "prefixes",
+    23,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_STRING,
+    offsetof(MessageT, n_prefixes),
+    offsetof(MessageT, prefixes),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned message_t__field_indices_by_name[] = {
   1,   /* field[1] = c_type */
+  18,   /* field[18] = consistency */
+  13,   /* field[13] = cursor */
+  14,   /* field[14] = delta */
+  9,   /* field[9] = end_key */
   8,   /* field[8] = entries */
   2,   /* field[2] = entry */
+  15,   /* field[15] = expected */
+  17,   /* field[17] = forwarded */
   3,   /* field[3] = key */
   7,   /* field[7] = keys */
+  10,   /* field[10] = limit */
+  19,   /* field[19] = max_lag */
   0,   /* field[0] = opcode */
+  12,   /* field[12] = pattern */
+  11,   /* field[11] = prefix */
+  22,   /* field[22] = prefixes */
+  20,   /* field[20] = replicas */
   5,   /* field[5] = result */
   6,   /* field[6] = stats */
+  21,   /* field[21] = track_id */
   4,   /* field[4] = value */
+  16,   /* field[16] = version */
 };
 static const ProtobufCIntRange message_t__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 9 }
+  { 0, 23 }
 };
 const ProtobufCMessageDescriptor message_t__descriptor =
 {
@@ -476,7 +1050,7 @@ const ProtobufCMessageDescriptor message_t__descriptor =
   "MessageT",
   "",
   sizeof(MessageT),
-  9,
+  23,
   message_t__field_descriptors,
   message_t__field_indices_by_name,
   1,  message_t__number_ranges,
@@ -0,0 +1,156 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "skiplist.h"
+
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Retorna o numero de bytes de um no com level niveis e a chave key.
+*/
+static int node_size(int level, char *key) {
+    return sizeof(struct skip_node_t) + level * sizeof(struct skip_node_t *) +
+           (key == NULL ? 0 : strlen(key) + 1);
+}
+
+static struct skip_node_t *node_create(struct skiplist_t *list, int level, char *key) {
+    struct skip_node_t *node = slab_alloc(list->slab, node_size(level, key));
+    if (node == NULL)
+        return NULL;
+    node->level = level;
+    for (int i = 0; i < level; i++)
+        node->next[i] = NULL;
+    // A chave fica a seguir aos apontadores
+    node->key = NULL;
+    if (key != NULL) {
+        node->key = (char *) &node->next[level];
+        strcpy(node->key, key);
+    }
+    return node;
+}
+
+static void node_free(struct skiplist_t *list, struct skip_node_t *node) {
+    slab_free(list->slab, node, node_size(node->level, node->key));
+}
+
+/**
+ * Sorteia o numero de niveis de um novo no, cada nivel
+ * tem 1/4 da probabilidade do anterior.
+*/
+static int random_level(struct skiplist_t *list) {
+    int level = 1;
+    while (level < SKIPLIST_MAX_LEVEL && (rand_r(&list->seed) & 3) == 0)
+        level++;
+    return level;
+}
+
+/**
+ * Preenche update com o ultimo no antes de key em cada nivel.
+*/
+static void find_prev(struct skiplist_t *list, char *key, struct skip_node_t **update) {
+    struct skip_node_t *it = list->head;
+    for (int i = list->level - 1; i >= 0; i--) {
+        while (it->next[i] != NULL && strcmp(it->next[i]->key, key) < 0)
+            it = it->next[i];
+        update[i] = it;
+    }
+}
+
+struct skiplist_t *skiplist_create(struct slab_t *slab) {
+    struct skiplist_t *list = malloc(sizeof(struct skiplist_t));
+    if (list == NULL)
+        return NULL;
+    list->slab = slab;
+    list->level = 1;
+    list->size = 0;
+    list->memory = 0;
+    list->seed = time(NULL);
+    list->head = node_create(list, SKIPLIST_MAX_LEVEL, NULL);
+    if (list->head == NULL) {
+        free(list);
+        return NULL;
+    }
+    return list;
+}
+
+int skiplist_destroy(struct skiplist_t *list) {
+    if (list == NULL)
+        return -1;
+    struct skip_node_t *it = list->head;
+    while (it != NULL) {
+        struct skip_node_t *next = it->next[0];
+        node_free(list, it);
+        it = next;
+    }
+    free(list);
+    return 0;
+}
+
+int skiplist_insert(struct skiplist_t *list, char *key) {
+    if (list == NULL || key == NULL)
+        return -1;
+
+    struct skip_node_t *update[SKIPLIST_MAX_LEVEL];
+    find_prev(list, key, update);
+    struct skip_node_t *found = update[0]->next[0];
+    if (found != NULL && strcmp(found->key, key) == 0)
+        return 1;
+
+    int level = random_level(list);
+    struct skip_node_t *node = node_create(list, level, key);
+    if (node == NULL)
+        return -1;
+
+    // Os novos niveis comecam na sentinela
+    for (int i = list->level; i < level; i++)
+        update[i] = list->head;
+    if (level > list->level)
+        list->level = level;
+
+    for (int i = 0; i < level; i++) {
+        node->next[i] = update[i]->next[i];
+        update[i]->next[i] = node;
+    }
+    list->size++;
+    list->memory += slab_class_size(node_size(level, key));
+    return 0;
+}
+
+int skiplist_remove(struct skiplist_t *list, char *key) {
+    if (list == NULL || key == NULL)
+        return -1;
+
+    struct skip_node_t *update[SKIPLIST_MAX_LEVEL];
+    find_prev(list, key, update);
+    struct skip_node_t *node = update[0]->next[0];
+    if (node == NULL || strcmp(node->key, key) != 0)
+        return 1;
+
+    for (int i = 0; i < node->level; i++)
+        update[i]->next[i] = node->next[i];
+    while (list->level > 1 && list->head->next[list->level - 1] == NULL)
+        list->level--;
+
+    list->size--;
+    list->memory -= slab_class_size(node_size(node->level, node->key));
+    node_free(list, node);
+    return 0;
+}
+
+struct skip_node_t *skiplist_seek(struct skiplist_t *list, char *key) {
+    if (list == NULL)
+        return NULL;
+    if (key == NULL)
+        return list->head->next[0];
+
+    struct skip_node_t *update[SKIPLIST_MAX_LEVEL];
+    find_prev(list, key, update);
+    return update[0]->next[0];
+}
@@ -0,0 +1,142 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "slab.h"
+
+#include <stdlib.h>
+
+#define SLAB_ALIGN 16           /* alinhamento dos objetos */
+
+// Tamanhos das classes, multiplos do alinhamento
+static const int class_sizes[SLAB_N_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    768, 1024, 1536, 2048
+};
+
+/**
+ * Retorna o indice da menor classe onde cabe um objeto de size
+ * bytes ou -1 se for maior que SLAB_MAX_SIZE.
+*/
+static int class_index(int size) {
+    if (size <= 128)
+        return size <= 16 ? 0 : (size + SLAB_ALIGN - 1) / SLAB_ALIGN - 1;
+    for (int i = 8; i < SLAB_N_CLASSES; i++) {
+        if (size <= class_sizes[i])
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Reserva uma nova pagina para a classe. O inicio da pagina
+ * guarda o apontador para a pagina anterior.
+*/
+static int class_grow(struct slab_class_t *class) {
+    char *page = malloc(SLAB_PAGE_SIZE);
+    if (page == NULL)
+        return -1;
+    *(void **) page = class->pages;
+    class->pages = page;
+    class->page_ptr = page + SLAB_ALIGN;
+    class->page_end = page + SLAB_PAGE_SIZE;
+    class->capacity += (SLAB_PAGE_SIZE - SLAB_ALIGN) / class->size;
+    return 0;
+}
+
+struct slab_t *slab_create() {
+    struct slab_t *slab = calloc(1, sizeof(struct slab_t));
+    if (slab == NULL)
+        return NULL;
+    for (int i = 0; i < SLAB_N_CLASSES; i++)
+        slab->classes[i].size = class_sizes[i];
+    return slab;
+}
+
+int slab_destroy(struct slab_t *slab) {
+    if (slab == NULL)
+        return -1;
+    for (int i = 0; i < SLAB_N_CLASSES; i++) {
+        void *page = slab->classes[i].pages;
+        while (page != NULL) {
+            void *prev = *(void **) page;
+            free(page);
+            page = prev;
+        }
+    }
+    free(slab);
+    return 0;
+}
+
+void *slab_alloc(struct slab_t *slab, int size) {
+    if (size <= 0)
+        return NULL;
+
+    int index = class_index(size);
+    if (slab == NULL || index == -1) {
+        void *ptr = malloc(size);
+        if (ptr != NULL && slab != NULL)
+            slab->large++;
+        return ptr;
+    }
+
+    struct slab_class_t *class = &slab->classes[index];
+
+    // Reutilizar um objeto libertado
+    if (class->free_list != NULL) {
+        void *ptr = class->free_list;
+        class->free_list = *(void **) ptr;
+        class->used++;
+        return ptr;
+    }
+
+    // Usar o proximo objeto da ultima pagina
+    if (class->page_ptr == NULL || class->page_ptr + class->size > class->page_end) {
+        if (class_grow(class) == -1)
+            return NULL;
+    }
+    void *ptr = class->page_ptr;
+    class->page_ptr += class->size;
+    class->used++;
+    return ptr;
+}
+
+void slab_free(struct slab_t *slab, void *ptr, int size) {
+    if (ptr == NULL)
+        return;
+
+    int index = class_index(size);
+    if (slab == NULL || index == -1) {
+        if (slab != NULL)
+            slab->large--;
+        free(ptr);
+        return;
+    }
+
+    struct slab_class_t *class = &slab->classes[index];
+    *(void **) ptr = class->free_list;
+    class->free_list = ptr;
+    class->used--;
+}
+
+int slab_class_size(int size) {
+    if (size <= 0)
+        return -1;
+    int index = class_index(size);
+    return index == -1 ? size : class_sizes[index];
+}
+
+int slab_class_stats(struct slab_t *slab, int index, int *size, long *used, long *capacity) {
+    if (slab == NULL || index < 0 || index >= SLAB_N_CLASSES ||
+        size == NULL || used == NULL || capacity == NULL)
+        return -1;
+    *size = slab->classes[index].size;
+    *used = slab->classes[index].used;
+    *capacity = slab->classes[index].capacity;
+    return 0;
+}
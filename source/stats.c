@@ -32,7 +32,7 @@ stats_t *stats_init() {
         
     
     // Inicializar a estrutura
-    stats_t stats = {0, 0, 0, ctrl};
+    stats_t stats = {0, 0, 0, 0, 0, NULL, 0, {0}, {0}, ctrl};
 
     // Copiar para o espaco alocado
     memcpy(statsptr, &stats, sizeof(stats_t));
@@ -40,7 +40,7 @@ stats_t *stats_init() {
     return statsptr;
 }
 
-stats_t *stats_init_args(int op, long time, int client) {
+stats_t *stats_init_args(int op, long time, int client, int evicted, long memory) {
     // Obter a estrutura para a gestao de concorrencia
     rwcctrl_t *ctrl = cctrl_init();
     if (ctrl == NULL)
@@ -54,7 +54,7 @@ stats_t *stats_init_args(int op, long time, int client) {
     }
     
     // Inicializar a estrutura
-    stats_t stats = {op, time, client, ctrl};
+    stats_t stats = {op, time, client, evicted, memory, NULL, 0, {0}, {0}, ctrl};
 
     // Copiar para o espaco alocado
     memcpy(statsptr, &stats, sizeof(stats_t));
@@ -100,6 +100,15 @@ int stats_dec_client(stats_t *stats) {
     return 0;
 }
 
+int stats_inc_evicted(stats_t *stats) {
+    if (stats == NULL || stats->cctrl == NULL)
+        return -1;
+    write_begin(stats->cctrl);
+    stats->n_evicted++;
+    write_end(stats->cctrl);
+    return 0;
+}
+
 int stats_op_finish(stats_t *stats, long time) {
     if (stats == NULL || stats->cctrl == NULL)
         return -1;
@@ -110,12 +119,63 @@ int stats_op_finish(stats_t *stats, long time) {
     return 0;
 }
 
+int stats_write_finish(stats_t *stats, int level, long time) {
+    if (stats == NULL || stats->cctrl == NULL ||
+        level < 0 || level >= STATS_DURABILITY_LEVELS)
+        return -1;
+    write_begin(stats->cctrl);
+    stats->write_ops[level]++;
+    stats->write_time[level] += time;
+    write_end(stats->cctrl);
+    return 0;
+}
+
+int stats_set_write(stats_t *stats, int level, long ops, long time) {
+    if (stats == NULL || stats->cctrl == NULL ||
+        level < 0 || level >= STATS_DURABILITY_LEVELS)
+        return -1;
+    write_begin(stats->cctrl);
+    stats->write_ops[level] = ops;
+    stats->write_time[level] = time;
+    write_end(stats->cctrl);
+    return 0;
+}
+
+int stats_set_slabs(stats_t *stats, slab_stats_t *slabs, int n) {
+    if (stats == NULL || stats->cctrl == NULL || n < 0 ||
+        (slabs == NULL && n > 0))
+        return -1;
+
+    slab_stats_t *copy = NULL;
+    if (n > 0) {
+        copy = malloc(n * sizeof(slab_stats_t));
+        if (copy == NULL)
+            return -1;
+        memcpy(copy, slabs, n * sizeof(slab_stats_t));
+    }
+
+    write_begin(stats->cctrl);
+    free(stats->slabs);
+    stats->slabs = copy;
+    stats->n_slabs = n;
+    write_end(stats->cctrl);
+    return 0;
+}
+
 stats_t *stats_dup(stats_t *stats) {
     if (stats == NULL || stats->cctrl == NULL)
         return NULL;
     stats_t *new_stats = NULL;
     read_begin(stats->cctrl);
-    new_stats = stats_init_args(stats->n_op, stats->time_lasted, stats->n_client);
+    new_stats = stats_init_args(stats->n_op, stats->time_lasted, stats->n_client,
+                                stats->n_evicted, stats->memory);
+    if (new_stats != NULL &&
+        stats_set_slabs(new_stats, stats->slabs, stats->n_slabs) == -1) {
+        stats_destroy(new_stats);
+        new_stats = NULL;
+    }
+    for (int i = 0; new_stats != NULL && i < STATS_DURABILITY_LEVELS; i++)
+        stats_set_write(new_stats, i, stats->write_ops[i], stats->write_time[i]);
     read_end(stats->cctrl);
     if (new_stats == NULL)
         return NULL;
@@ -128,6 +188,7 @@ int stats_destroy(stats_t *stats) {
     int result = 0;
     if (cctrl_destroy(stats->cctrl) != 0)
         result = -1;
+    free(stats->slabs);
     free(stats);
     return result;
 }
@@ -167,4 +228,64 @@ int stats_get_n_client(stats_t *stats) {
     read_end(stats->cctrl);
 
     return num_client < 0 ? -1 : num_client;
-}
\ No newline at end of file
+}
+
+int stats_get_n_evicted(stats_t *stats) {
+    if (stats == NULL || stats->cctrl == NULL)
+        return -1;
+    
+    read_begin(stats->cctrl);
+    int num_evicted = stats->n_evicted;
+    read_end(stats->cctrl);
+
+    return num_evicted < 0 ? -1 : num_evicted;
+}
+
+long stats_get_memory(stats_t *stats) {
+    if (stats == NULL || stats->cctrl == NULL)
+        return -1;
+
+    read_begin(stats->cctrl);
+    long memory = stats->memory;
+    read_end(stats->cctrl);
+
+    return memory < 0 ? -1 : memory;
+}
+
+int stats_get_n_slabs(stats_t *stats) {
+    if (stats == NULL || stats->cctrl == NULL)
+        return -1;
+
+    read_begin(stats->cctrl);
+    int num_slabs = stats->n_slabs;
+    read_end(stats->cctrl);
+
+    return num_slabs;
+}
+
+int stats_get_slab(stats_t *stats, int index, slab_stats_t *slab) {
+    if (stats == NULL || stats->cctrl == NULL || slab == NULL)
+        return -1;
+
+    int result = -1;
+    read_begin(stats->cctrl);
+    if (index >= 0 && index < stats->n_slabs) {
+        *slab = stats->slabs[index];
+        result = 0;
+    }
+    read_end(stats->cctrl);
+
+    return result;
+}
+
+int stats_get_write(stats_t *stats, int level, long *ops, long *time) {
+    if (stats == NULL || stats->cctrl == NULL || ops == NULL || time == NULL ||
+        level < 0 || level >= STATS_DURABILITY_LEVELS)
+        return -1;
+
+    read_begin(stats->cctrl);
+    *ops = stats->write_ops[level];
+    *time = stats->write_time[level];
+    read_end(stats->cctrl);
+    return 0;
+}
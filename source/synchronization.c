@@ -87,6 +87,24 @@ int read_begin(rwcctrl_t *ctrl) {
     
 }
 
+int read_try_begin(rwcctrl_t *ctrl) {
+    if (ctrl == NULL 
+        || ctrl->num_readers < 0 
+        || ctrl->num_writers < 0 
+        || ctrl->rwcond == NULL
+        || ctrl->rwmutex == NULL)
+        return -1;
+    pthread_mutex_lock(ctrl->rwmutex);
+    // Se ha escritor nao espera
+    if (ctrl->num_writers > 0) {
+        pthread_mutex_unlock(ctrl->rwmutex);
+        return 1;
+    }
+    ctrl->num_readers++;
+    pthread_mutex_unlock(ctrl->rwmutex);
+    return 0;
+}
+
 int read_end(rwcctrl_t *ctrl) {
     if (ctrl == NULL 
         || ctrl->num_readers < 0 
@@ -0,0 +1,378 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "data.h"
+#include "entry.h"
+#include "hash.h"
+#include "list.h"
+#include "table.h"
+#include "list-private.h"
+#include "table-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+
+int hash_code(char *key, int n) {
+    return hash_key(key) % n;
+}
+
+struct table_t *table_create(int n) {
+    if (n <= 0)
+        return NULL;
+
+    struct table_t *table = malloc(sizeof(struct table_t));
+    if (table == NULL)
+        return NULL;
+
+    table->lists = malloc(n * sizeof(struct list_t *));
+    if (table->lists == NULL) {
+        free(table);
+        return NULL;
+    }
+    table->slab = slab_create();
+    if (table->slab == NULL) {
+        free(table->lists);
+        free(table);
+        return NULL;
+    }
+    table->index = NULL;
+    table->size = n;
+    table->memory = 0;
+    table->clock_hand = 0;
+
+    for (int i = 0; i < n; i++) {
+        if ((table->lists[i] = list_create()) == NULL) {
+            // Libertar as listas criadas anteriormente
+            for (int j = i - 1; j >= 0; j--)
+                list_destroy(table->lists[j]);
+            slab_destroy(table->slab);
+            free(table->lists);
+            free(table);
+            return NULL;
+        }
+        // Todas as listas partilham o alocador da tabela
+        table->lists[i]->slab = table->slab;
+    }
+    return table;
+}
+
+int table_destroy(struct table_t *table) {
+    if (table == NULL)
+        return -1;
+    for (int i = 0; i < table->size; i++) {
+        if (table->lists[i] != NULL && list_destroy(table->lists[i]) == -1)
+            return -1;
+    }
+    skiplist_destroy(table->index);
+    slab_destroy(table->slab);
+    free(table->lists);
+    free(table);
+    return 0;
+}
+
+/**
+ * Retorna a memoria ocupada pelo indice ordenado.
+*/
+static long index_memory(struct table_t *table) {
+    return table->index == NULL ? 0 : table->index->memory;
+}
+
+int table_put(struct table_t *table, char *key, struct data_t *value) {
+    return table_put_version(table, key, value, 0);
+}
+
+int table_put_version(struct table_t *table, char *key, struct data_t *value,
+                      uint64_t version) {
+    if (table == NULL || key == NULL || value == NULL)
+        return -1;
+
+    // A lista guarda copias da chave e dos dados
+    uint64_t hash = hash_key(key);
+    struct list_t *list = table->lists[hash % table->size];
+    long old_memory = list->memory + index_memory(table);
+    int result = list_put(list, key, hash, value, version);
+    if (result == -1)
+        return -1;
+
+    // Uma chave nova tambem entra no indice
+    if (result == 0 && table->index != NULL &&
+        skiplist_insert(table->index, key) == -1) {
+        list_delete(list, key, hash);
+        return -1;
+    }
+    table->memory += list->memory + index_memory(table) - old_memory;
+    return 0;
+}
+
+struct data_t *table_get(struct table_t *table, char *key) {
+    if (table == NULL || key == NULL)
+        return NULL;
+
+    uint64_t hash = hash_key(key);
+    struct list_t *list = table->lists[hash % table->size];
+    struct entry_t *entry = list_find(list, key, hash);
+    if (entry == NULL)
+        return NULL;
+    return data_dup(entry->value);
+}
+
+struct entry_t *table_lookup(struct table_t *table, char *key) {
+    if (table == NULL || key == NULL)
+        return NULL;
+
+    uint64_t hash = hash_key(key);
+    return list_find(table->lists[hash % table->size], key, hash);
+}
+
+uint64_t table_entry_version(struct entry_t *entry) {
+    return list_entry_version(entry);
+}
+
+int table_remove(struct table_t *table, char *key) {
+    if (table == NULL || key == NULL)
+        return -1;
+
+    uint64_t hash = hash_key(key);
+    struct list_t *list = table->lists[hash % table->size];
+    long old_memory = list->memory + index_memory(table);
+    int result = list_delete(list, key, hash);
+    if (result == 0 && table->index != NULL)
+        skiplist_remove(table->index, key);
+    table->memory += list->memory + index_memory(table) - old_memory;
+    return result;
+}
+
+int table_size(struct table_t *table) {
+    if (table == NULL)
+        return -1;
+    int size = 0;
+    for (int i = 0; i < table->size; i++)
+        size += list_size(table->lists[i]);
+    return size;
+}
+
+char **table_get_keys(struct table_t *table) {
+    if (table == NULL)
+        return NULL;
+
+    int size = table_size(table);
+    char **keys = malloc((size + 1) * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    // Mover as chaves de cada lista para a array
+    int index = 0;
+    for (int i = 0; i < table->size; i++) {
+        char **list_keys = list_get_keys(table->lists[i]);
+        if (list_keys == NULL)
+            continue;
+        for (int j = 0; list_keys[j] != NULL; j++)
+            keys[index++] = list_keys[j];
+        free(list_keys);
+    }
+    keys[size] = NULL;
+    return keys;
+}
+
+int table_free_keys(char **keys) {
+    if (keys == NULL)
+        return -1;
+    for (int i = 0; keys[i] != NULL; i++)
+        free(keys[i]);
+    free(keys);
+    return 0;
+}
+
+long table_memory(struct table_t *table) {
+    if (table == NULL)
+        return -1;
+    return table->memory;
+}
+
+char *table_evict_key(struct table_t *table) {
+    if (table == NULL || table_size(table) <= 0)
+        return NULL;
+
+    // Na primeira volta os bits de referencia sao limpos,
+    // na segunda encontra-se necessariamente uma vitima
+    for (int i = 0; i <= 2 * table->size; i++) {
+        struct entry_t *victim = list_clock_victim(table->lists[table->clock_hand]);
+        table->clock_hand = (table->clock_hand + 1) % table->size;
+        if (victim != NULL)
+            return strdup(victim->key);
+    }
+    return NULL;
+}
+
+int table_index_enable(struct table_t *table) {
+    if (table == NULL)
+        return -1;
+    if (table->index != NULL)
+        return 0;
+
+    struct skiplist_t *index = skiplist_create(table->slab);
+    if (index == NULL)
+        return -1;
+    for (int i = 0; i < table->size; i++) {
+        for (struct node_t *it = table->lists[i]->head; it != NULL; it = it->next) {
+            if (skiplist_insert(index, it->entry.key) == -1) {
+                skiplist_destroy(index);
+                return -1;
+            }
+        }
+    }
+    table->index = index;
+    table->memory += index->memory;
+    return 0;
+}
+
+char **table_scan(struct table_t *table, char *start, char *end, int limit) {
+    if (table == NULL || table->index == NULL)
+        return NULL;
+
+    // Contar as chaves do intervalo
+    struct skip_node_t *first = skiplist_seek(table->index, start);
+    int count = 0;
+    for (struct skip_node_t *it = first; it != NULL; it = it->next[0]) {
+        if ((end != NULL && strcmp(it->key, end) > 0) ||
+            (limit > 0 && count == limit))
+            break;
+        count++;
+    }
+
+    char **keys = malloc((count + 1) * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    struct skip_node_t *it = first;
+    for (int i = 0; i < count; i++) {
+        keys[i] = strdup(it->key);
+        if (keys[i] == NULL) {
+            // Libertar as chaves copiadas anteriormente
+            for (int j = i - 1; j >= 0; j--)
+                free(keys[j]);
+            free(keys);
+            return NULL;
+        }
+        it = it->next[0];
+    }
+    keys[count] = NULL;
+    return keys;
+}
+
+/**
+ * Acrescenta uma copia da chave a array keys, com capacidade
+ * para *capacity chaves, aumentando-a quando esta cheia.
+*/
+static int keys_append(char ***keys, int *count, int *capacity, char *key) {
+    // Guardar sempre espaco para o NULL final
+    if (*count + 1 >= *capacity) {
+        int new_capacity = *capacity * 2;
+        char **new_keys = realloc(*keys, new_capacity * sizeof(char *));
+        if (new_keys == NULL)
+            return -1;
+        *keys = new_keys;
+        *capacity = new_capacity;
+    }
+    if (((*keys)[*count] = strdup(key)) == NULL)
+        return -1;
+    (*count)++;
+    return 0;
+}
+
+/**
+ * Verifica se a chave tem o prefixo e corresponde ao padrao.
+*/
+static int key_matches(char *key, char *prefix, char *pattern) {
+    if (prefix != NULL && strncmp(key, prefix, strlen(prefix)) != 0)
+        return 0;
+    return pattern == NULL || fnmatch(pattern, key, 0) == 0;
+}
+
+char **table_match_keys(struct table_t *table, char *prefix, char *pattern) {
+    if (table == NULL)
+        return NULL;
+
+    int count = 0, capacity = 16;
+    char **keys = malloc(capacity * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    if (table->index != NULL && prefix != NULL) {
+        // As chaves com o prefixo sao contiguas no indice
+        int prefix_len = strlen(prefix);
+        for (struct skip_node_t *it = skiplist_seek(table->index, prefix);
+             it != NULL && strncmp(it->key, prefix, prefix_len) == 0;
+             it = it->next[0]) {
+            if (key_matches(it->key, NULL, pattern) &&
+                keys_append(&keys, &count, &capacity, it->key) == -1)
+                goto err_keys;
+        }
+    } else {
+        for (int i = 0; i < table->size; i++) {
+            for (struct node_t *it = table->lists[i]->head; it != NULL; it = it->next) {
+                if (key_matches(it->entry.key, prefix, pattern) &&
+                    keys_append(&keys, &count, &capacity, it->entry.key) == -1)
+                    goto err_keys;
+            }
+        }
+    }
+    keys[count] = NULL;
+    return keys;
+
+err_keys:
+    keys[count] = NULL;
+    table_free_keys(keys);
+    return NULL;
+}
+
+char **table_iterate(struct table_t *table, int *bucket, uint64_t *position,
+                     int count, char *prefix, char *pattern) {
+    if (table == NULL || bucket == NULL || position == NULL || count <= 0 ||
+        *bucket < 0 || *bucket >= table->size)
+        return NULL;
+
+    int n_keys = 0, capacity = 16;
+    char **keys = malloc(capacity * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    int visited = 0;
+    uint64_t last_hash = 0;
+    for (int i = *bucket; i < table->size; i++) {
+        // Saltar os nos ja visitados da lista
+        struct node_t *it = table->lists[i]->head;
+        while (it != NULL && i == *bucket && it->hash < *position)
+            it = it->next;
+
+        for (; it != NULL; it = it->next) {
+            // Os nos com o mesmo hash ficam na mesma pagina
+            if (visited >= count && it->hash != last_hash) {
+                *bucket = i;
+                *position = it->hash;
+                keys[n_keys] = NULL;
+                return keys;
+            }
+            visited++;
+            last_hash = it->hash;
+            if (key_matches(it->entry.key, prefix, pattern) &&
+                keys_append(&keys, &n_keys, &capacity, it->entry.key) == -1) {
+                keys[n_keys] = NULL;
+                table_free_keys(keys);
+                return NULL;
+            }
+        }
+    }
+
+    // Fim da iteracao
+    *bucket = 0;
+    *position = 0;
+    keys[n_keys] = NULL;
+    return keys;
+}
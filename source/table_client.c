@@ -17,6 +17,7 @@
 #include "table_client-private.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -31,9 +32,17 @@
 
 c_rptable_t *connection;
 
+// Subscricao das alteracoes de chaves, NULL se nao ha
+struct rptable_watch_t *watching;
+
+// Rececao das escritas aplicadas, NULL se nao ha
+struct rtable_changes_t *following;
+
 void inthandler() {
     printf(SUCCESS_EXIT_TROLL);
     clear_history();
+    rptable_unwatch(watching);
+    rtable_changes_close(following);
     rptable_disconnect(connection);
     exit(0);
 }
@@ -115,6 +124,40 @@ int main(int argc, char *argv[]) {
                 goto end;
             printf(SUCCESS_OPERATION, "PUT");
 
+        } else 
+        if (strcasecmp(command, "x") == 0 ||
+            strcasecmp(command, "putex") == 0) {
+            
+            // Obter argumentos da operacao
+            char *key = strtok(NULL, " \n");
+            char *ttl = strtok(NULL, " \n");
+            char *value = strtok(NULL, "\n");
+            if (key == NULL) {
+                printf(ERROR_MISSING_ARGS, "<key>, <ttl> and <value>", "PUTEX");
+                goto end;
+            }
+            if (ttl == NULL) {
+                printf(ERROR_MISSING_ARGS, "<ttl> and <value>", "PUTEX");
+                goto end;
+            }
+            if (value == NULL) {
+                printf(ERROR_MISSING_ARGS, "<value>", "PUTEX");
+                goto end;
+            }
+
+            // Validar o tempo de vida
+            char *ttl_end = NULL;
+            long ttl_ms = strtol(ttl, &ttl_end, 10);
+            if (*ttl_end != '\0' || ttl_ms <= 0) {
+                printf(ERROR_TTL);
+                goto end;
+            }
+            
+            int result = putex(connection, key, ttl_ms, value);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, "PUTEX");
+
         } else 
         if (strcasecmp(command, "g") == 0 ||
             strcasecmp(command, "get") == 0) {
@@ -129,6 +172,85 @@ int main(int argc, char *argv[]) {
                 goto end;
             printf(SUCCESS_OPERATION, "GET");
         } else
+        if (strcasecmp(command, "getstale") == 0) {
+            char *key = strtok(NULL, " \n");
+            char *max_lag = strtok(NULL, " \n");
+            if (key == NULL) {
+                printf(ERROR_MISSING_ARGS, "<key>", "GETSTALE");
+                goto end;
+            }
+
+            // Sem limite do atraso serve qualquer replica
+            long max_lag_ms = 0;
+            if (max_lag != NULL) {
+                char *max_lag_end = NULL;
+                max_lag_ms = strtol(max_lag, &max_lag_end, 10);
+                if (*max_lag_end != '\0' || max_lag_ms < 0) {
+                    printf(ERROR_MAX_LAG);
+                    goto end;
+                }
+            }
+
+            int result = get_consistency(connection, key,
+                    max_lag == NULL ? RTABLE_READ_ANY : RTABLE_READ_BOUNDED, max_lag_ms);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, "GETSTALE");
+        } else
+        if (strcasecmp(command, "durability") == 0) {
+            char *replicas = strtok(NULL, " \n");
+            if (replicas == NULL) {
+                printf(ERROR_MISSING_ARGS, "<replicas>", "DURABILITY");
+                goto end;
+            }
+
+            char *replicas_end = NULL;
+            long n_replicas = strtol(replicas, &replicas_end, 10);
+            if (*replicas_end != '\0' || n_replicas < 0) {
+                printf(ERROR_DURABILITY);
+                goto end;
+            }
+            rptable_set_durability(connection, n_replicas);
+            printf(SUCCESS_OPERATION, "DURABILITY");
+        } else
+        if (strcasecmp(command, "pool") == 0) {
+            char *size = strtok(NULL, " \n");
+            if (size != NULL) {
+                char *size_end = NULL;
+                long pool_size = strtol(size, &size_end, 10);
+                if (*size_end != '\0' || pool_size < 1 || pool_size > INT_MAX ||
+                    rptable_set_pool_size(connection, pool_size) == -1) {
+                    printf(ERROR_POOL_SIZE);
+                    goto end;
+                }
+            }
+
+            struct rtable_pool_stats_t pool;
+            if (rptable_pool_stats(connection, &pool) == -1)
+                goto end;
+            printf(AUX_POOL, pool.size, pool.open, pool.idle, pool.checkouts, pool.waits);
+            printf(SUCCESS_OPERATION, "POOL");
+        } else
+        if (strcasecmp(command, "cache") == 0) {
+            char *entries = strtok(NULL, " \n");
+            if (entries != NULL) {
+                char *entries_end = NULL;
+                long max_entries = strtol(entries, &entries_end, 10);
+                if (*entries_end != '\0' || max_entries < 0 || max_entries > INT_MAX ||
+                    rptable_cache_enable(connection, max_entries) == -1) {
+                    printf(ERROR_CACHE_SIZE);
+                    goto end;
+                }
+            }
+
+            struct rptable_cache_stats_t cache;
+            if (rptable_cache_stats(connection, &cache) == -1)
+                printf(AUX_CACHE_OFF);
+            else
+                printf(AUX_CACHE, cache.entries, cache.max_entries, cache.hits, cache.misses,
+                       cache.invalidations, cache.evictions);
+            printf(SUCCESS_OPERATION, "CACHE");
+        } else
         if (strcasecmp(command, "d") == 0 ||
             strcasecmp(command, "del") == 0) {
             char *key = strtok(NULL, "\n");
@@ -158,21 +280,233 @@ int main(int argc, char *argv[]) {
         } else
         if (strcasecmp(command, "k") == 0 ||
             strcasecmp(command, "getkeys") == 0) {
-            int result = getkeys(connection);
+            int result = getkeys(connection, strtok(NULL, " \n"));
             if (result == -1)
                 goto end;
             printf(SUCCESS_OPERATION, "GETKEYS");
         } else
         if (strcasecmp(command, "t") == 0 ||
             strcasecmp(command, "gettable") == 0) {
-            int result = gettable(connection);
+            int result = gettable(connection, strtok(NULL, " \n"));
             if (result == -1)
                 goto end;
             printf(SUCCESS_OPERATION, "GETTABLE");
         } else
+        if (strcasecmp(command, "n") == 0 ||
+            strcasecmp(command, "scan") == 0) {
+            
+            // Obter argumentos da operacao
+            char *start = strtok(NULL, " \n");
+            char *end = strtok(NULL, " \n");
+            char *limit = strtok(NULL, " \n");
+            if (start == NULL) {
+                printf(ERROR_MISSING_ARGS, "<start> and <end>", "SCAN");
+                goto end;
+            }
+            if (end == NULL) {
+                printf(ERROR_MISSING_ARGS, "<end>", "SCAN");
+                goto end;
+            }
+
+            // Validar o limite
+            long limit_n = 0;
+            if (limit != NULL) {
+                char *limit_end = NULL;
+                limit_n = strtol(limit, &limit_end, 10);
+                if (*limit_end != '\0' || limit_n <= 0) {
+                    printf(ERROR_LIMIT);
+                    goto end;
+                }
+            }
+
+            int result = scan(connection, start, end, limit_n);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, "SCAN");
+        } else
+        if (strcasecmp(command, "incr") == 0 ||
+            strcasecmp(command, "decr") == 0) {
+            int is_incr = strcasecmp(command, "incr") == 0;
+            char *key = strtok(NULL, " \n");
+            char *delta = strtok(NULL, " \n");
+            if (key == NULL) {
+                printf(ERROR_MISSING_ARGS, "<key>", is_incr ? "INCR" : "DECR");
+                goto end;
+            }
+
+            // Validar o incremento, 1 por omissao
+            long delta_n = 1;
+            if (delta != NULL) {
+                char *delta_end = NULL;
+                errno = 0;
+                delta_n = strtol(delta, &delta_end, 10);
+                if (*delta_end != '\0' || errno != 0 || delta_n == LONG_MIN) {
+                    printf(ERROR_DELTA);
+                    goto end;
+                }
+            }
+
+            int result = incr(connection, key, is_incr ? delta_n : -delta_n);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, is_incr ? "INCR" : "DECR");
+        } else
+        if (strcasecmp(command, "cput") == 0 ||
+            strcasecmp(command, "cdel") == 0) {
+            int is_put = strcasecmp(command, "cput") == 0;
+            char *key = strtok(NULL, " \n");
+            char *version = strtok(NULL, " \n");
+            char *value = is_put ? strtok(NULL, "\n") : NULL;
+            if (key == NULL || version == NULL) {
+                printf(ERROR_MISSING_ARGS, is_put ? "<key>, <version> and <value>" : "<key> and <version>",
+                       is_put ? "CPUT" : "CDEL");
+                goto end;
+            }
+            if (is_put && value == NULL) {
+                printf(ERROR_MISSING_ARGS, "<value>", "CPUT");
+                goto end;
+            }
+
+            // Validar a versao
+            char *version_end = NULL;
+            errno = 0;
+            unsigned long version_n = strtoul(version, &version_end, 10);
+            if (*version_end != '\0' || errno != 0 || version[0] == '-' ||
+                (!is_put && version_n == 0)) {
+                printf(ERROR_VERSION);
+                goto end;
+            }
+
+            int result = is_put ? cput(connection, key, version_n, value) : cdel(connection, key, version_n);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, is_put ? "CPUT" : "CDEL");
+        } else
+        if (strcasecmp(command, "append") == 0) {
+            char *key = strtok(NULL, " \n");
+            char *value = strtok(NULL, "\n");
+            if (key == NULL) {
+                printf(ERROR_MISSING_ARGS, "<key> and <value>", "APPEND");
+                goto end;
+            }
+            if (value == NULL) {
+                printf(ERROR_MISSING_ARGS, "<value>", "APPEND");
+                goto end;
+            }
+
+            int result = append(connection, key, value);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, "APPEND");
+        } else
+        if (strcasecmp(command, "cas") == 0) {
+            char *key = strtok(NULL, " \n");
+            char *expected = strtok(NULL, " \n");
+            char *value = strtok(NULL, "\n");
+            if (key == NULL || expected == NULL) {
+                printf(ERROR_MISSING_ARGS, "<key>, <expected> and <value>", "CAS");
+                goto end;
+            }
+            if (value == NULL) {
+                printf(ERROR_MISSING_ARGS, "<value>", "CAS");
+                goto end;
+            }
+
+            int result = cas(connection, key, expected, value);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, "CAS");
+        } else
+        if (strcasecmp(command, "mget") == 0 ||
+            strcasecmp(command, "mdel") == 0) {
+            int is_get = strcasecmp(command, "mget") == 0;
+
+            // Obter as chaves da operacao
+            char *keys[CLIENT_MAX_KEYS + 1];
+            int n_keys = 0;
+            char *key = strtok(NULL, " \n");
+            while (key != NULL && n_keys < CLIENT_MAX_KEYS) {
+                keys[n_keys++] = key;
+                key = strtok(NULL, " \n");
+            }
+            keys[n_keys] = NULL;
+            if (n_keys == 0) {
+                printf(ERROR_MISSING_ARGS, "<key>", is_get ? "MGET" : "MDEL");
+                goto end;
+            }
+
+            int result = is_get ? mget(connection, keys, n_keys) : mdel(connection, keys, n_keys);
+            if (result == -1)
+                goto end;
+            printf(SUCCESS_OPERATION, is_get ? "MGET" : "MDEL");
+        } else
+        if (strcasecmp(command, "watch") == 0) {
+            // Uma chave terminada em * subscreve o prefixo
+            char *keys[CLIENT_MAX_KEYS + 1], *prefixes[CLIENT_MAX_KEYS + 1];
+            int n_keys = 0, n_prefixes = 0;
+            char *key = strtok(NULL, " \n");
+            while (key != NULL && n_keys + n_prefixes < CLIENT_MAX_KEYS) {
+                size_t len = strlen(key);
+                if (len > 0 && key[len - 1] == '*') {
+                    key[len - 1] = '\0';
+                    prefixes[n_prefixes++] = key;
+                } else {
+                    keys[n_keys++] = key;
+                }
+                key = strtok(NULL, " \n");
+            }
+            keys[n_keys] = NULL;
+            prefixes[n_prefixes] = NULL;
+            if (n_keys + n_prefixes == 0) {
+                printf(ERROR_MISSING_ARGS, "<key>", "WATCH");
+                goto end;
+            }
+
+            // A subscricao nova substitui a anterior
+            rptable_unwatch(watching);
+            watching = rptable_watch(connection, keys, prefixes, 0, print_event, NULL);
+            if (watching == NULL) {
+                printf(ERROR_WATCH);
+                goto end;
+            }
+            printf(SUCCESS_OPERATION, "WATCH");
+        } else
+        if (strcasecmp(command, "unwatch") == 0) {
+            rptable_unwatch(watching);
+            watching = NULL;
+            printf(SUCCESS_OPERATION, "UNWATCH");
+        } else
+        if (strcasecmp(command, "follow") == 0) {
+            char *seq = strtok(NULL, " \n");
+            char *chain = strtok(NULL, " \n");
+            char *seq_end = "", *chain_end = "";
+            unsigned long after = seq != NULL ? strtoul(seq, &seq_end, 10) : 0;
+            long index = chain != NULL ? strtol(chain, &chain_end, 10) : 0;
+            if (*seq_end != '\0' || (seq != NULL && seq[0] == '-') || *chain_end != '\0' ||
+                index < 0 || index >= rptable_chains(connection)) {
+                printf(ERROR_FOLLOW);
+                goto end;
+            }
+
+            // A rececao nova substitui a anterior
+            rtable_changes_close(following);
+            following = rptable_changes(connection, index, after, print_change, NULL);
+            if (following == NULL) {
+                printf(ERROR_FOLLOW);
+                goto end;
+            }
+            printf(SUCCESS_OPERATION, "FOLLOW");
+        } else
+        if (strcasecmp(command, "unfollow") == 0) {
+            rtable_changes_close(following);
+            following = NULL;
+            printf(SUCCESS_OPERATION, "UNFOLLOW");
+        } else
         if (strcasecmp(command, "q") == 0 ||
             strcasecmp(command, "quit") == 0) {
             clear_history();
+            rptable_unwatch(watching);
+            rtable_changes_close(following);
             rptable_disconnect(connection);
             printf(SUCCESS_EXIT);
             exit(0);
@@ -194,6 +528,10 @@ int main(int argc, char *argv[]) {
 
 
 int put(c_rptable_t *rtable, char *key, char* value) {
+    return putex(rtable, key, 0, value);
+}
+
+int putex(c_rptable_t *rtable, char *key, unsigned long ttl, char* value) {
     if (rtable == NULL || key == NULL || value == NULL)
         return -1;
     
@@ -224,7 +562,7 @@ int put(c_rptable_t *rtable, char *key, char* value) {
     }
 
     // Enviar para o servidor
-    int result = rptable_put(rtable, keyptr, dataptr);
+    int result = rptable_put_ttl(rtable, keyptr, dataptr, ttl);
     if (result == -1) {
         printf("Error while sending put request!\n");
         data_destroy(dataptr);
@@ -237,11 +575,17 @@ int put(c_rptable_t *rtable, char *key, char* value) {
 }
 
 int get(c_rptable_t *rtable, char *key) {
+    return get_consistency(rtable, key, RTABLE_READ_STRONG, 0);
+}
+
+int get_consistency(c_rptable_t *rtable, char *key, enum rtable_consistency consistency,
+                    unsigned long max_lag) {
     if (rtable == NULL || key == NULL)
         return -1;
     
     // Obter o valor
-    struct data_t *dataptr = rptable_get(rtable, key);
+    unsigned long version;
+    struct data_t *dataptr = rptable_get_consistency(rtable, key, consistency, max_lag, &version);
     if (dataptr == NULL) {
         printf(ERROR_GET);
         return -1;
@@ -254,7 +598,7 @@ int get(c_rptable_t *rtable, char *key) {
     // Copiar os caracteres para buffer
     memcpy(&data, dataptr->data, dataptr->datasize);
     // Imprimir o conteudo
-    printf(AUX_GET,key, data, dataptr->datasize);
+    printf(AUX_GET,key, data, dataptr->datasize, version);
     
     // Libertar o espaco
     data_destroy(dataptr);
@@ -298,56 +642,248 @@ int stats(c_rptable_t *rtable) {
         return -1;
     }
     printf(AUX_STATS, stats_get_n_op(stats), 
-        stats_get_time_lasted(stats), stats_get_n_client(stats));
+        stats_get_time_lasted(stats), stats_get_n_client(stats),
+        stats_get_n_evicted(stats), stats_get_memory(stats));
+
+    // Ocupacao das classes do alocador
+    int n_slabs = stats_get_n_slabs(stats);
+    if (n_slabs > 0)
+        printf(AUX_STATS_SLABS);
+    for (int i = 0; i < n_slabs; i++) {
+        slab_stats_t slab;
+        if (stats_get_slab(stats, i, &slab) == 0)
+            printf(AUX_STATS_SLAB, slab.size, slab.used, slab.capacity);
+    }
+
+    // Escritas por nivel de durabilidade
+    const char *levels[STATS_DURABILITY_LEVELS] = {"all", "head", "some"};
+    printf(AUX_STATS_WRITES);
+    for (int i = 0; i < STATS_DURABILITY_LEVELS; i++) {
+        long ops, time;
+        if (stats_get_write(stats, i, &ops, &time) == 0)
+            printf(AUX_STATS_WRITE, levels[i], ops, ops == 0 ? 0 : time / ops);
+    }
 
     stats_destroy(stats);
     return 0;
 }
 
-int getkeys(c_rptable_t *rtable) {
+/**
+ * Separa o filtro das chaves num prefixo ou, se tiver
+ * caracteres especiais, num padrao glob.
+*/
+void split_filter(char *filter, char **prefix, char **pattern) {
+    *prefix = NULL;
+    *pattern = NULL;
+    if (filter == NULL)
+        return;
+    if (strpbrk(filter, "*?[") != NULL)
+        *pattern = filter;
+    else
+        *prefix = filter;
+}
+
+int getkeys(c_rptable_t *rtable, char *filter) {
     if (rtable == NULL)
         return -1;
-    char** keys = NULL;
-    keys = rptable_get_keys(rtable);
-    if (keys == NULL) {
-        printf(ERROR_GETKEYS);
-        return -1;
-    }
+    char *prefix, *pattern;
+    split_filter(filter, &prefix, &pattern);
 
-    // Iterar pela array de apontadores de strings
-    int index = 0;
+    // Pedir as chaves em paginas ate o cursor voltar ao inicio
+    struct rtable_cursor_t cursor = {0, 0, 0};
     printf(AUX_GETKEYS);
-    while (keys[index] != NULL) {
-        char str[strlen(keys[index]) + 1];
-        str[strlen(keys[index])] = '\0';
-        memcpy(str, keys[index], strlen(keys[index]));
-        printf(AUX_GETKEYS_LINE, str);
-        index++;
-    }
+    do {
+        char **keys = rptable_get_keys_page(rtable, &cursor, CLIENT_PAGE_SIZE, prefix, pattern);
+        if (keys == NULL) {
+            printf(ERROR_GETKEYS);
+            return -1;
+        }
+        for (int index = 0; keys[index] != NULL; index++)
+            printf(AUX_GETKEYS_LINE, keys[index]);
+        rptable_free_keys(keys);
+    } while (cursor.bucket != 0 || cursor.position != 0 || cursor.chain != 0);
 
-    rptable_free_keys(keys);
+    return 0;
+}
 
+/**
+ * Imprime uma entrada obtida por rptable_iterate().
+*/
+static int print_entry(struct entry_t *entry, void *arg) {
+    char value[entry->value->datasize + 1];
+    value[entry->value->datasize] = '\0';
+    memcpy(value, entry->value->data, entry->value->datasize);
+    printf(AUX_GETTABLE_LINE, entry->key, value);
     return 0;
 }
 
-int gettable(c_rptable_t *rtable) {
+int gettable(c_rptable_t *rtable, char *filter) {
     if (rtable == NULL)
         return -1;
-    struct entry_t **entries = rptable_get_table(rtable);
-    if (entries == NULL) {
+    char *prefix, *pattern;
+    split_filter(filter, &prefix, &pattern);
+
+    // Pedir a tabela em paginas, para que nenhuma resposta seja demasiado grande
+    printf(AUX_GETTABLE);
+    if (rptable_iterate(rtable, prefix, pattern, CLIENT_PAGE_SIZE, print_entry, NULL) != 0) {
         printf(ERROR_GETTABLE);
         return -1;
     }
+    return 0;
+}
+
+int scan(c_rptable_t *rtable, char *start, char *end, int limit) {
+    if (rtable == NULL || start == NULL || end == NULL)
+        return -1;
+    struct entry_t **entries = rptable_scan(rtable, start, end, limit);
+    if (entries == NULL) {
+        printf(ERROR_SCAN);
+        return -1;
+    }
+
+    printf(AUX_SCAN, start, end);
+    for (int index = 0; entries[index] != NULL; index++) {
+        char value[(entries[index]->value->datasize) + 1];
+        value[entries[index]->value->datasize] = '\0';
+        memcpy(value, entries[index]->value->data, entries[index]->value->datasize);
+        printf(AUX_GETTABLE_LINE, entries[index]->key, value);
+    }
+    rptable_free_entries(entries);
+    return 0;
+}
+
+int mget(c_rptable_t *rtable, char **keys, int n_keys) {
+    if (rtable == NULL || keys == NULL)
+        return -1;
+    struct entry_t **entries = rptable_mget(rtable, keys, n_keys);
+    if (entries == NULL) {
+        printf(ERROR_MGET);
+        return -1;
+    }
 
-    int index = 0;
     printf(AUX_GETTABLE);
-    while (entries[index] != NULL) {
+    for (int index = 0; entries[index] != NULL; index++) {
         char value[(entries[index]->value->datasize) + 1];
         value[entries[index]->value->datasize] = '\0';
         memcpy(value, entries[index]->value->data, entries[index]->value->datasize);
         printf(AUX_GETTABLE_LINE, entries[index]->key, value);
-        index++;
     }
     rptable_free_entries(entries);
     return 0;
-}
\ No newline at end of file
+}
+
+int mdel(c_rptable_t *rtable, char **keys, int n_keys) {
+    if (rtable == NULL || keys == NULL)
+        return -1;
+    int result = rptable_mdel(rtable, keys);
+    if (result == -1) {
+        printf(ERROR_MDEL);
+        return -1;
+    }
+    printf(AUX_MDEL, result, n_keys);
+    return 0;
+}
+
+int incr(c_rptable_t *rtable, char *key, long delta) {
+    if (rtable == NULL || key == NULL)
+        return -1;
+    long value;
+    if (rptable_incr(rtable, key, delta, &value) == -1) {
+        printf(ERROR_INCR);
+        return -1;
+    }
+    printf(AUX_INCR, key, value);
+    return 0;
+}
+
+int append(c_rptable_t *rtable, char *key, char *value) {
+    if (rtable == NULL || key == NULL || value == NULL)
+        return -1;
+    struct data_t data = {strlen(value), value};
+    int size = rptable_append(rtable, key, &data);
+    if (size == -1) {
+        printf(ERROR_APPEND);
+        return -1;
+    }
+    printf(AUX_APPEND, key, size);
+    return 0;
+}
+
+int cas(c_rptable_t *rtable, char *key, char *expected, char *value) {
+    if (rtable == NULL || key == NULL || expected == NULL || value == NULL)
+        return -1;
+    struct data_t expected_data = {strlen(expected), expected};
+    struct data_t data = {strlen(value), value};
+    int result = rptable_cas(rtable, key, &expected_data, &data);
+    if (result == -1) {
+        printf(ERROR_CAS);
+        return -1;
+    }
+    printf(result == 1 ? AUX_CAS_SWAPPED : AUX_CAS_FAILED, key);
+    return 0;
+}
+
+int cput(c_rptable_t *rtable, char *key, unsigned long expected, char *value) {
+    if (rtable == NULL || key == NULL || value == NULL)
+        return -1;
+    struct data_t data = {strlen(value), value};
+    unsigned long version;
+    int result = rptable_put_if_version(rtable, key, &data, expected, &version);
+    if (result == -1) {
+        printf(ERROR_CPUT);
+        return -1;
+    }
+    printf(result == 1 ? AUX_CPUT_WRITTEN : AUX_VERSION_MISMATCH, key, version);
+    return 0;
+}
+
+int cdel(c_rptable_t *rtable, char *key, unsigned long expected) {
+    if (rtable == NULL || key == NULL)
+        return -1;
+    unsigned long version;
+    int result = rptable_del_if_version(rtable, key, expected, &version);
+    if (result == -1) {
+        printf(ERROR_CDEL);
+        return -1;
+    }
+    printf(result == 1 ? AUX_CDEL_REMOVED : AUX_VERSION_MISMATCH, key, version);
+    return 0;
+}
+
+void print_event(struct rtable_event_t *event, void *arg) {
+    switch (event->type) {
+        case RTABLE_EVENT_PUT:
+            printf(AUX_EVENT_PUT, event->key, event->value->datasize,
+                   (char *) event->value->data, event->version);
+            break;
+        case RTABLE_EVENT_DEL:
+            printf(AUX_EVENT_DEL, event->key);
+            break;
+        case RTABLE_EVENT_DROPPED:
+            printf(AUX_EVENT_DROPPED, event->dropped);
+            break;
+        case RTABLE_EVENT_CLOSED:
+            printf(AUX_EVENT_CLOSED);
+            break;
+    }
+    fflush(stdout);
+}
+
+void print_change(struct rtable_change_t *change, void *arg) {
+    switch (change->type) {
+        case RTABLE_CHANGE_PUT:
+            printf(AUX_CHANGE_PUT, change->sequence, change->key, change->value->datasize,
+                   (char *) change->value->data);
+            break;
+        case RTABLE_CHANGE_DEL:
+            printf(AUX_CHANGE_DEL, change->sequence, change->key);
+            break;
+        case RTABLE_CHANGE_LOST:
+            printf(AUX_CHANGE_LOST, change->sequence);
+            break;
+        case RTABLE_CHANGE_CLOSED:
+            printf(AUX_CHANGE_CLOSED);
+            break;
+    }
+    fflush(stdout);
+}
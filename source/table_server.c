@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -28,9 +29,9 @@ int sockt;
 s_rptable_t *repl_table;
 
 void inthandler() {
+    table_skel_destroy(table);
     rptable_disconnect(repl_table);
     network_server_close(sockt);
-    table_skel_destroy(table);
     exit(-1);
 }
 
@@ -42,10 +43,58 @@ void table_fhandler(int errcode) {
     inthandler();
 }
 
+/**
+ * Thread que atende os clientes, lancada antes da copia inicial da
+ * tabela para receber as escritas do servidor anterior.
+*/
+void *main_loop(void *arg) {
+    network_main_loop(sockt, table, repl_table);
+    return NULL;
+}
+
+/**
+ * Converte o limite de memoria em bytes, aceitando os 
+ * sufixos K, M e G.
+ * \return
+ *      Numero de bytes ou -1 em caso de erro.
+*/
+long parse_memory(char *str) {
+    char *end = NULL;
+    long bytes = strtol(str, &end, 10);
+    if (end == str || bytes < 0)
+        return -1;
+    switch (*end) {
+        case 'g': case 'G':
+            bytes *= 1024;
+        case 'm': case 'M':
+            bytes *= 1024;
+        case 'k': case 'K':
+            bytes *= 1024;
+            end++;
+        default:
+            break;
+    }
+    return *end == '\0' ? bytes : -1;
+}
+
 int main(int argc, char ** argv) {
-    if (argc != 3 && argc != 4) {
+    // Obter o caminho do socket local, a unica opcao
+    char *unix_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "u:")) != -1) {
+        if (opt != 'u') {
+            printf("Usage: [-u <unix socket>] <port> <table size> [<zookeeper ip>:<zookeeper port> [<maxmemory> [<chain>]]]\n");
+            return -1;
+        }
+        unix_path = optarg;
+    }
+    // Os argumentos seguintes ficam a partir de argv[1]
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if (argc < 3 || argc > 6) {
         printf("Wrong number of arguments!\n");
-        printf("Usage: <port> <table size> [<zookeeper ip>:<zookeeper port>]\n");
+        printf("Usage: [-u <unix socket>] <port> <table size> [<zookeeper ip>:<zookeeper port> [<maxmemory> [<chain>]]]\n");
         return -1;
     }
  
@@ -63,6 +112,13 @@ int main(int argc, char ** argv) {
         return -1;
     }
 
+    // Obter o limite de memoria
+    long maxmemory = 0;
+    if (argc >= 5 && (maxmemory = parse_memory(argv[4])) == -1) {
+        printf("Invalid maxmemory!\n");
+        return -1;
+    }
+
     // Definir o tratamento dos sinais
     signal(SIGPIPE, SIG_IGN);
     signal(SIGINT, inthandler);
@@ -73,16 +129,27 @@ int main(int argc, char ** argv) {
         return -1;
     }
 
+    // Inicializar o socket dos clientes da mesma maquina
+    if (unix_path != NULL && network_server_init_unix(unix_path) == -1) {
+        perror("Error while initializing local socket!");
+        network_server_close(sockt);
+        return -1;
+    }
+
     // Inicializar a tabela
     if ((table = table_skel_init(tablesize)) == NULL) {
         perror("Error while initializing table!");
         network_server_close(sockt);
         return -1;
     }
+    table_skel_set_maxmemory(maxmemory);
 
     // Inicializar a tabela replicada
     if (argc == 3)
         repl_table = rptable_connect(sockt, table_watcher, table_fhandler);
+    else if (argc == 6)
+        // Juntar-se a uma das cadeias da instalacao particionada
+        repl_table = rptable_connect_chain(argv[3], argv[5], sockt, table_watcher, table_fhandler);
     else 
         repl_table = rptable_connect_zksock(argv[3], sockt, table_watcher, table_fhandler);
     
@@ -93,19 +160,43 @@ int main(int argc, char ** argv) {
         return -1;
     }
 
-    // Sincronizar com a tabela anterior
-    if (rptable_sync(repl_table, table) == -1) {
-        perror("Error while initializing replicated table!");
+    // Atender ja as ligacoes: o servidor anterior reencaminha as
+    // escritas enquanto a tabela e copiada, com o lock de escrita, e
+    // a copia precisa do lock de leitura dele. Os pedidos dos clientes
+    // esperam pelo fim da copia
+    pthread_t main_thread;
+    if (table_skel_sync_begin() == -1 ||
+        pthread_create(&main_thread, NULL, main_loop, NULL) != 0) {
+        perror("Error while starting server!");
         rptable_disconnect(repl_table);
         table_skel_destroy(table);
         network_server_close(sockt);
         return -1;
     }
 
+    // Sincronizar com a tabela anterior
+    if (rptable_sync(repl_table, table) == -1) {
+        perror("Error while initializing replicated table!");
+        inthandler();
+    }
+    table_skel_sync_end();
+
+    // Iniciar a recolha das chaves expiradas
+    if (table_skel_expiry_start(table, repl_table) == -1) {
+        perror("Error while starting key expiry!");
+        inthandler();
+    }
+
+    // Iniciar a migracao das chaves entre cadeias
+    if (table_skel_migration_start(table, repl_table) == -1) {
+        perror("Error while starting key migration!");
+        inthandler();
+    }
+
     // Atender clientes (so nos dias uteis, das 9h ate as 16h)
-    network_main_loop(sockt, table, repl_table);
+    pthread_join(main_thread, NULL);
+    table_skel_destroy(table);
     rptable_disconnect(repl_table);
     network_server_close(sockt);
-    table_skel_destroy(table);
     return 0;
 }
\ No newline at end of file
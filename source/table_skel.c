@@ -9,19 +9,29 @@
 #include "table_skel.h"
 #include "table_skel-private.h"
 #include "table.h"
+#include "table-private.h"
 #include "data.h"
 #include "sdmessage.pb-c.h"
 #include "stats.h"
 #include "synchronization.h"
+#include "timer_wheel.h"
+#include "tracking.h"
+#include "watch.h"
+#include "changelog.h"
+#include "network_server.h"
 #include "replica_table.h"
 #include "replica_server_table.h"
 
 #include <time.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 
 // Controlo da concorrencia no acesso a tabela
@@ -30,6 +40,64 @@ rwcctrl_t *cctrl;
 // Estatisticas da tabela
 stats_t *stats;
 
+// Roda de temporizadores das chaves com TTL
+timer_wheel_t *wheel;
+
+// Chaves que os clientes tem em cache, avisados quando mudam
+struct tracking_t *tracking;
+
+// Subscricoes das alteracoes das chaves
+struct watch_t *watch;
+
+// Ultimas escritas aplicadas, enviadas por ordem aos consumidores
+struct changelog_t *changelog;
+
+// Limite de memoria ocupada pelas entradas (0 = sem limite)
+long maxmemory = 0;
+
+// Ultima versao atribuida ou recebida, protegida pelo lock de escrita
+uint64_t last_version = 0;
+
+// Ultima sequencia recebida da cabeca e quando, protegidas pelo lock
+// de escrita, para as leituras com atraso limitado
+uint64_t head_version = 0;
+long head_heard_at = 0;
+long heartbeat_at = 0;
+
+// Escritas propagadas sem esperar pela cauda, protegidas pelo lock de
+// escrita. As leituras fortes das chaves com versao maior que
+// confirmed_version, ate unconfirmed_version, sao pedidas a cauda, e
+// se o servidor seguinte falhar alguma, as escritas seguintes a
+// confirmed_version sao-lhe reenviadas
+uint64_t unconfirmed_version = 0;
+uint64_t confirmed_version = 0;
+// 1 se o servidor seguinte ainda nao recebeu de novo as escritas
+int resync_needed = 0;
+// 1 se a escrita da thread e respondida antes de chegar a cauda
+__thread int partial_write = 0;
+
+// Copia inicial da tabela do servidor anterior. Enquanto decorre, as
+// escritas da cadeia sao aplicadas e os pedidos dos clientes esperam
+_Atomic int syncing = 0;
+pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t sync_done = PTHREAD_COND_INITIALIZER;
+// Versoes das remocoes recebidas durante a copia, protegidas pelo lock
+// de escrita, para a copia nao repor as chaves removidas depois
+struct table_t *tombstones = NULL;
+
+// Thread da recolha ativa das chaves expiradas
+pthread_t expiry_thread;
+// Lidos pelas threads e mudados pelo arranque e pelo fim do servidor
+_Atomic int expiry_running = 0;
+struct table_t *expiry_table;
+s_rptable_t *expiry_rptable;
+
+// Migracao das chaves entre cadeias
+pthread_t migrate_thread;
+_Atomic int migrate_running = 0;
+struct table_t *migrate_table;
+s_rptable_t *migrate_rptable;
+
 int inc_num_clients() {
     return stats_inc_client(stats);
 }
@@ -59,6 +127,13 @@ long get_time() {
     return (now.tv_sec * 1000000) + now.tv_usec;
 }
 
+/**
+ * Retorna o tempo atual em milissegundos.
+*/
+long get_time_ms() {
+    return get_time() / 1000;
+}
+
 /**
  * Preenche a mensagem com codigos de erro.
  * \param msg
@@ -75,6 +150,286 @@ int invoke_error(MessageT *msg) {
     return 0;
 }
 
+/**
+ * Obtem a versao de uma escrita. Um pedido sem versao, vindo de um
+ * cliente, recebe a seguinte a ultima. Uma versao vinda do servidor
+ * anterior da cadeia e mantida e registada, para que a sequencia
+ * continue se este servidor passar a ser a cabeca.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \param version
+ *      Versao que veio no pedido, 0 se nao tiver.
+ * \return
+ *      A versao da escrita.
+*/
+uint64_t write_version(uint64_t version) {
+    if (version == 0)
+        return ++last_version;
+    if (version > last_version)
+        last_version = version;
+    // A escrita veio da cabeca, a replica esta atualizada ate ela
+    if (version >= head_version) {
+        head_version = version;
+        head_heard_at = get_time_ms();
+    }
+    return version;
+}
+
+/**
+ * Durante a copia inicial da tabela, regista a versao da remocao de
+ * uma chave, para que a copia, mais antiga, nao a volte a colocar.
+ * Fora da copia nao faz nada.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \return
+ *      0 (OK) ou -1 em caso de erro.
+*/
+int sync_removed(char *key, uint64_t version) {
+    if (tombstones == NULL)
+        return 0;
+    struct data_t removed = {1, ""};
+    return table_put_version(tombstones, key, &removed, version);
+}
+
+/**
+ * Indica se o pedido vem do servidor anterior da cadeia: as escritas
+ * propagadas ja tem a versao atribuida pela cabeca.
+ * \return
+ *      1 se vem da cadeia, 0 caso contrario.
+*/
+int chain_request(MessageT *msg) {
+    switch (msg->opcode) {
+        case MESSAGE_T__OPCODE__OP_HEARTBEAT:
+            return 1;
+        case MESSAGE_T__OPCODE__OP_PUT:
+            return msg->entry != NULL && msg->entry->version != 0;
+        case MESSAGE_T__OPCODE__OP_DEL:
+        case MESSAGE_T__OPCODE__OP_MDEL:
+            return msg->version != 0;
+        case MESSAGE_T__OPCODE__OP_MPUT:
+        case MESSAGE_T__OPCODE__OP_BATCH:
+            return msg->n_entries > 0 && msg->entries[0] != NULL &&
+                   msg->entries[0]->version != 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Atribui versoes as remocoes de chaves decididas por este servidor
+ * (expiracao, falta de memoria ou migracao), guarda-as no registo
+ * das escritas e avisa as caches dos clientes e as subscricoes.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \return
+ *      A versao da remocao da primeira chave, as seguintes tem as
+ *      versoes seguintes.
+*/
+uint64_t removed_keys(char **keys, int n_keys) {
+    uint64_t first = last_version + 1;
+    for (int i = 0; i < n_keys; i++)
+        changelog_append(changelog, write_version(0), keys[i], NULL, 0);
+    tracking_invalidate(tracking, keys, n_keys);
+    for (int i = 0; i < n_keys; i++)
+        if (watch_wanted(watch, keys[i]))
+            watch_publish(watch, keys[i], NULL, 0);
+    return first;
+}
+
+/**
+ * Reenvia ao servidor seguinte as escritas do registo posteriores a
+ * ultima confirmada pela cauda, depois de uma falhar. Se o registo ja
+ * nao as tem ou o reenvio falha, as escritas seguintes falham ate o
+ * reenvio ser possivel, em vez de a cadeia divergir.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int chain_resync(s_rptable_t *rptable) {
+    uint64_t until = last_version;
+    uint64_t after = confirmed_version;
+    // Sem servidor seguinte nao ha nada a reenviar
+    resync_needed = rptable_is_tail(rptable) == 0;
+    while (resync_needed && after < until) {
+        struct changelog_record_t records[CHANGELOG_BATCH];
+        int n_records = changelog_copy(changelog, after, records, CHANGELOG_BATCH);
+        if (n_records == -1)
+            return -1;
+        if (n_records == 0)
+            break;
+        int result = rptable_replay(rptable, records, n_records);
+        after = records[n_records - 1].sequence;
+        changelog_free_records(records, n_records);
+        if (result == -1)
+            return -1;
+    }
+    resync_needed = 0;
+    unconfirmed_version = confirmed_version = until;
+    return 0;
+}
+
+/**
+ * Trata o resultado da propagacao de uma escrita ao servidor
+ * seguinte. Uma escrita enviada sem esperar so falha na resposta a
+ * uma seguinte, por isso uma falha reenvia todas as nao confirmadas.
+ * Deve ser chamada dentro da seccao critica de escrita, logo depois
+ * de propagar.
+ * \param result
+ *      Resultado da propagacao.
+ * \param logged
+ *      1 se a escrita ja esta no registo, e e reenviada com as
+ *      outras, 0 se falha de qualquer forma.
+ * \return
+ *      result, 0 se a escrita foi reenviada ou -1 em caso de erro.
+*/
+int forwarded(s_rptable_t *rptable, int result, int logged) {
+    if (result != -1 && !resync_needed) {
+        // So uma escrita esperada por toda a cadeia, sem outras por
+        // confirmar, confirma as anteriores
+        if (partial_write)
+            unconfirmed_version = last_version;
+        else if (unconfirmed_version <= confirmed_version)
+            unconfirmed_version = confirmed_version = last_version;
+        return result;
+    }
+    if (chain_resync(rptable) == -1 || (result == -1 && !logged))
+        return -1;
+    return result == -1 ? 0 : result;
+}
+
+/**
+ * Propaga a sequencia da cabeca. As escritas enviadas sem esperar
+ * sao lidas antes, por isso o sucesso confirma que as anteriores
+ * chegaram a cauda. Deve ser chamada dentro da seccao critica de
+ * escrita.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int heartbeat_forward(s_rptable_t *rptable, uint64_t version) {
+    uint64_t sent = last_version;
+    if (!resync_needed && rptable_heartbeat(rptable, version) == 0) {
+        unconfirmed_version = confirmed_version = sent;
+        return 0;
+    }
+    return chain_resync(rptable);
+}
+
+/**
+ * Verifica se o valor da chave nesta replica pode ainda nao ter
+ * chegado a cauda. Uma chave sem entrada pode ter sido removida por
+ * uma escrita por confirmar. Deve ser chamada dentro da seccao
+ * critica de leitura.
+ * \return
+ *      1 se o valor pode nao estar confirmado, 0 caso contrario.
+*/
+int unconfirmed_key(struct table_t *table, char *key) {
+    if (unconfirmed_version <= confirmed_version)
+        return 0;
+    struct entry_t *entry = table_lookup(table, key);
+    if (entry == NULL)
+        return 1;
+    uint64_t version = table_entry_version(entry);
+    return version > confirmed_version && version <= unconfirmed_version;
+}
+
+/**
+ * Remove entradas, escolhidas pelo algoritmo CLOCK, ate a memoria
+ * ocupada pela tabela voltar a estar dentro de maxmemory. Apenas a
+ * cabeca da cadeia escolhe as entradas a remover, os restantes
+ * servidores recebem as remocoes pela tabela replicada.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \param keys
+ *      Chaves acabadas de escrever pelo pedido, que nao sao removidas.
+ * \param n_keys
+ *      Numero de chaves.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int evict_entries(struct table_t *table, s_rptable_t *rptable, char **keys, int n_keys) {
+    if (maxmemory <= 0 || rptable_is_head(rptable) != 1)
+        return 0;
+
+    // Cada entrada e considerada no maximo uma vez
+    int attempts = table_size(table);
+    while (table_memory(table) > maxmemory && attempts-- > 0) {
+        char *victim = table_evict_key(table);
+        if (victim == NULL)
+            return -1;
+        // Um pedido com varias chaves nao pode perder as anteriores
+        int protected = 0;
+        for (int i = 0; i < n_keys && !protected; i++)
+            protected = strcmp(victim, keys[i]) == 0;
+        if (!protected && table_remove(table, victim) == 0) {
+            wheel_cancel(wheel, victim);
+            uint64_t version = removed_keys(&victim, 1);
+            stats_inc_evicted(stats);
+            if (forwarded(rptable, rptable_del(rptable, victim, version), 1) == -1) {
+                free(victim);
+                return -1;
+            }
+        }
+        free(victim);
+    }
+    return 0;
+}
+
+/**
+ * Retorna ha quantos ms esta replica nao tem noticias da cabeca, ou
+ * seja, o maior atraso possivel dos seus dados. A cabeca nao tem
+ * atraso. Deve ser chamada dentro de uma seccao critica.
+ * \return
+ *      Atraso em ms ou -1 se nunca recebeu nada da cabeca.
+*/
+long replica_lag(s_rptable_t *rptable) {
+    if (rptable_is_head(rptable) == 1)
+        return 0;
+    if (head_heard_at == 0 || last_version < head_version)
+        return -1;
+    return get_time_ms() - head_heard_at;
+}
+
+/**
+ * Coloca uma entrada na tabela, atualiza o seu temporizador,
+ * propaga-a pela tabela replicada e liberta memoria se o limite
+ * foi ultrapassado.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \param key
+ *      Chave da entrada.
+ * \param data
+ *      Dados da entrada, copiados pela tabela.
+ * \param expire_at
+ *      Instante de expiracao em ms (0 = sem expiracao).
+ * \param version
+ *      Versao da entrada, obtida com write_version().
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int put_entry(struct table_t *table, s_rptable_t *rptable, char *key,
+              struct data_t *data, unsigned long expire_at, uint64_t version) {
+    // Colocar o conteudo na tabela
+    if (table_put_version(table, key, data, version) == -1)
+        return -1;
+    changelog_append(changelog, version, key, data, expire_at);
+    // Atualizar o temporizador da chave
+    int result;
+    if (expire_at != 0)
+        result = wheel_set(wheel, key, expire_at);
+    else
+        result = wheel_cancel(wheel, key);
+    if (result == -1)
+        return -1;
+    // Colocar o conteudo na tabela replicada
+    if (forwarded(rptable, rptable_put_expire(rptable, key, data, expire_at, version), 1) == -1)
+        return -1;
+    // Libertar memoria se o limite foi ultrapassado
+    return evict_entries(table, rptable, &key, 1);
+}
+
 /**
  * Coloca a entrada no pedido para tabela e prepara a 
  * mensagem da resposta.
@@ -101,6 +456,12 @@ int invoke_put(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     // Registar o tempo do inicio
     long start_time = get_time();
 
+    // O instante de expiracao e fixado por quem recebe o pedido do
+    // cliente (a cabeca) e propagado tal como esta pela cadeia
+    unsigned long expire_at = msg->entry->expire_at;
+    if (expire_at == 0 && msg->entry->ttl != 0)
+        expire_at = get_time_ms() + msg->entry->ttl;
+
     // Alocar espaco para o conteudo
     void *buf_dup = malloc(msg->entry->value.len);
     if (buf_dup == NULL) {
@@ -120,15 +481,8 @@ int invoke_put(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     // ============== SECCAO CRITICA ==============
     write_begin(cctrl);
 
-    // Colocar o conteudo na tabela
-    int result = table_put(table, msg->entry->key, data);
-    if(result == -1) {
-        write_end(cctrl);
-        data_destroy(data);
-        return invoke_error(msg);
-    }
-    // Colocar o conteudo na tabela replicada
-    result = rptable_put(rptable, msg->entry->key, data);
+    uint64_t version = write_version(msg->entry->version);
+    int result = put_entry(table, rptable, msg->entry->key, data, expire_at, version);
     if (result == -1) {
         write_end(cctrl);
         data_destroy(data);
@@ -142,6 +496,7 @@ int invoke_put(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     data_destroy(data);
 
     // Preencher os campos da resposta
+    msg->version = version;
     msg->opcode = MESSAGE_T__OPCODE__OP_PUT + 1;
     msg->c_type = MESSAGE_T__C_TYPE__CT_NONE;
 
@@ -150,6 +505,91 @@ int invoke_put(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     return result;
 }
 
+/**
+ * Remove uma chave expirada da tabela, caso este servidor seja
+ * a cabeca da cadeia, propagando a remocao pela tabela replicada.
+ * Os restantes servidores aguardam pela remocao vinda da cabeca.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \param key
+ *      Chave expirada.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int expire_key(struct table_t *table, s_rptable_t *rptable, char *key) {
+    if (rptable_is_head(rptable) != 1)
+        return 0;
+
+    int result = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    // A chave pode ter sido substituida entretanto
+    long expire_at = wheel_get(wheel, key);
+    if (expire_at > 0 && expire_at <= get_time_ms()) {
+        wheel_cancel(wheel, key);
+        if (table_remove(table, key) == 0) {
+            uint64_t version = removed_keys(&key, 1);
+            result = forwarded(rptable, rptable_del(rptable, key, version), 1);
+        }
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    return result;
+}
+
+/**
+ * Regista a sequencia da cabeca recebida do servidor anterior e
+ * propaga-a pela cadeia, pela mesma ordem das escritas.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_heartbeat(MessageT *msg, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_NONE)
+        return invoke_error(msg);
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    // As escritas anteriores a sequencia ja foram aplicadas
+    if (msg->version >= head_version && last_version >= msg->version) {
+        head_version = msg->version;
+        head_heard_at = get_time_ms();
+    }
+    int result = heartbeat_forward(rptable, msg->version);
+
+    write_end(cctrl);
+    // ============================================
+
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->opcode = MESSAGE_T__OPCODE__OP_HEARTBEAT + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    return 0;
+}
+
+/**
+ * Passa a resposta de outro servidor a ser a resposta ao pedido.
+ * O pedido original e libertado com resp.
+*/
+void adopt_response(MessageT *msg, MessageT *resp) {
+    MessageT request = *msg;
+    *msg = *resp;
+    *resp = request;
+    message_t__free_unpacked(resp, NULL);
+}
+
 /**
  * Obtem uma entrada da tabela e coloca-a na mensagem
  * da resposta.
@@ -157,10 +597,12 @@ int invoke_put(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
  *      Mensagem que contem o pedido.
  * \param table
  *      Tabela sobre qual sera feira a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
  * \return
  *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
 */
-int invoke_get(MessageT *msg, struct table_t *table) {
+int invoke_get(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     // Validacao do pedido
     if (msg->c_type != MESSAGE_T__C_TYPE__CT_KEY) 
         return invoke_error(msg);
@@ -170,19 +612,69 @@ int invoke_get(MessageT *msg, struct table_t *table) {
     // Registar o tempo do inicio
     long start_time = get_time();
 
+    // Seguir a chave para a cache do cliente antes de a ler, para a
+    // escrita seguinte ser avisada. Sem track_id na resposta o
+    // cliente nao guarda o valor
+    if (msg->track_id != 0 && tracking_track(tracking, msg->key, msg->track_id) == -1)
+        msg->track_id = 0;
+
     // ============== SECCAO CRITICA ==============
-    read_begin(cctrl);
+    // Uma escrita em curso numa replica que nao e a cauda ainda nao
+    // esta confirmada: em vez de esperar que chegue a cauda, pedir a
+    // ela a versao confirmada (leituras repartidas, como no CRAQ).
+    // O mesmo para uma escrita ja aplicada que foi respondida antes de
+    // chegar a cauda. As leituras fracas esperam pela escrita local
+    int strong = msg->consistency == MESSAGE_T__CONSISTENCY__READ_STRONG;
+    int local = 1;
+    if (!strong) {
+        read_begin(cctrl);
+    } else if (read_try_begin(cctrl) != 0) {
+        local = 0;
+    } else if (rptable_is_tail(rptable) == 0 && unconfirmed_key(table, msg->key)) {
+        read_end(cctrl);
+        local = 0;
+    }
+    if (!local) {
+        MessageT *resp = rptable_is_tail(rptable) == 0 ? rptable_tail_read(rptable, msg) : NULL;
+        if (resp != NULL) {
+            adopt_response(msg, resp);
+            return 0;
+        }
+        read_begin(cctrl);
+    }
+
+    // Recusar a leitura se a replica pode estar mais atrasada do que o
+    // limite pedido, o cliente repete-a noutra replica
+    if (msg->consistency == MESSAGE_T__CONSISTENCY__READ_BOUNDED) {
+        long lag = replica_lag(rptable);
+        if (lag == -1 || lag > (long) msg->max_lag) {
+            read_end(cctrl);
+            msg->opcode = MESSAGE_T__OPCODE__OP_ERROR;
+            msg->c_type = MESSAGE_T__C_TYPE__CT_STALE;
+            return 0;
+        }
+    }
 
     // Obter a entrada da tabela
-    struct data_t *data = table_get(table, msg->key);
+    struct entry_t *entry = table_lookup(table, msg->key);
+    struct data_t *data = entry != NULL ? data_dup(entry->value) : NULL;
     if (data == NULL) {
         read_end(cctrl);
         return invoke_error(msg);
     }
+    uint64_t version = table_entry_version(entry);
+    long expire_at = wheel_get(wheel, msg->key);
     
     read_end(cctrl);
     // ============================================
 
+    // Expiracao preguicosa: a entrada expirada nao e devolvida
+    if (expire_at > 0 && expire_at <= get_time_ms()) {
+        data_destroy(data);
+        expire_key(table, rptable, msg->key);
+        return invoke_error(msg);
+    }
+
     char value[data->datasize + 1];
     value[data->datasize] = '\0';
     memcpy(value, data->data, data->datasize);
@@ -205,6 +697,7 @@ int invoke_get(MessageT *msg, struct table_t *table) {
     msg->value.data = content;
     msg->value.len = size;
 
+    msg->version = version;
     msg->opcode = MESSAGE_T__OPCODE__OP_GET + 1;
     msg->c_type = MESSAGE_T__C_TYPE__CT_VALUE;
 
@@ -242,11 +735,21 @@ int invoke_delete(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
         write_end(cctrl);
         return invoke_error(msg);
     }
-    // Remover a entrada da tabela replicada
-    result = rptable_del(rptable, msg->key);
-    if (result == -1) {
-        write_end(cctrl);
-        return invoke_error(msg);
+    // Uma chave que nao existia nao muda a tabela: a remocao de um
+    // cliente nao gasta versao, nao entra no registo das escritas nem
+    // segue pela cadeia. Uma remocao vinda da cadeia ja tem versao e
+    // segue sempre, para os seguintes e o registo nao divergirem da cabeca
+    if (result == 0 || msg->version != 0) {
+        wheel_cancel(wheel, msg->key);
+        // A remocao tem versao, como as colocacoes, para o registo das escritas
+        uint64_t version = write_version(msg->version);
+        changelog_append(changelog, version, msg->key, NULL, 0);
+        // Remover a entrada da tabela replicada
+        if (sync_removed(msg->key, version) == -1 ||
+            forwarded(rptable, rptable_del(rptable, msg->key, version), 1) == -1) {
+            write_end(cctrl);
+            return invoke_error(msg);
+        }
     }
 
     write_end(cctrl);
@@ -301,8 +804,118 @@ int invoke_size(MessageT *msg, struct table_t *table) {
 }
 
 /**
- * Obtem todas as chaves da tabela e coloca-as 
- * na mensagem da resposta.
+ * Cria uma EntryT com copias da chave e dos dados, e com o
+ * instante de expiracao e a versao da entrada.
+ * \return
+ *      A EntryT ou NULL em caso de erro.
+*/
+EntryT *entry_pack(char *key, struct data_t *data, long expire_at, uint64_t version) {
+    EntryT *entry = malloc(sizeof(EntryT));
+    if (entry == NULL)
+        return NULL;
+    entry_t__init(entry);
+    entry->key = strdup(key);
+    entry->value.data = malloc(data->datasize);
+    if (entry->key == NULL || entry->value.data == NULL) {
+        free(entry->key);
+        free(entry->value.data);
+        free(entry);
+        return NULL;
+    }
+    memcpy(entry->value.data, data->data, data->datasize);
+    entry->value.len = data->datasize;
+    entry->expire_at = expire_at > 0 ? expire_at : 0;
+    entry->version = version;
+    return entry;
+}
+
+/**
+ * Copia para EntryT as entradas das chaves dadas, numa unica
+ * passagem pela tabela. As chaves que ja nao existem e as entradas
+ * expiradas sao ignoradas, pelo que uma alteracao concorrente
+ * nunca faz falhar a leitura.
+ * \attention
+ *      Deve ser chamada com o lock de leitura da tabela, que garante
+ *      que todas as entradas sao do mesmo momento.
+ * \param n_keys
+ *      Numero de chaves.
+ * \param n_entries
+ *      Onde guardar o numero de entradas copiadas.
+ * \return
+ *      Array de EntryT terminada por NULL ou NULL em caso de erro.
+*/
+EntryT **entries_collect(struct table_t *table, char **keys, int n_keys, long now,
+                         int *n_entries) {
+    EntryT **entries = malloc((n_keys + 1) * sizeof(EntryT *));
+    if (entries == NULL)
+        return NULL;
+
+    int n = 0;
+    for (int i = 0; i < n_keys; i++) {
+        // As entradas expiradas nao sao devolvidas
+        long expire_at = wheel_get(wheel, keys[i]);
+        if (expire_at > 0 && expire_at <= now)
+            continue;
+        struct entry_t *entry = table_lookup(table, keys[i]);
+        if (entry == NULL)
+            continue;
+        entries[n] = entry_pack(keys[i], entry->value, expire_at, table_entry_version(entry));
+        if (entries[n] == NULL) {
+            for (int j = n - 1; j >= 0; j--)
+                entry_t__free_unpacked(entries[j], NULL);
+            free(entries);
+            return NULL;
+        }
+        n++;
+    }
+    entries[n] = NULL;
+    *n_entries = n;
+    return entries;
+}
+
+/**
+ * Valida um pedido de OP_GETKEYS/OP_GETTABLE, de todas as chaves
+ * (CT_NONE) ou de uma pagina a partir de um cursor (CT_CURSOR).
+ * \return
+ *      Retorna 1 se o pedido e valido, 0 caso contrario.
+*/
+int keys_request_valid(MessageT *msg) {
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_NONE)
+        return 1;
+    return msg->c_type == MESSAGE_T__C_TYPE__CT_CURSOR &&
+           msg->cursor != NULL && msg->limit > 0;
+}
+
+/**
+ * Obtem as chaves pedidas por OP_GETKEYS/OP_GETTABLE, filtradas pelo
+ * prefixo e padrao opcionais do pedido (um campo vazio nao filtra).
+ * Com um cursor obtem apenas uma pagina e avanca o cursor do pedido,
+ * que segue na resposta.
+ * \attention
+ *      Deve ser chamada com o lock de leitura da tabela.
+ * \return
+ *      Array de chaves terminada por NULL ou NULL em caso de erro.
+*/
+char **keys_request(MessageT *msg, struct table_t *table) {
+    char *prefix = msg->prefix != NULL && msg->prefix[0] != '\0' ? msg->prefix : NULL;
+    char *pattern = msg->pattern != NULL && msg->pattern[0] != '\0' ? msg->pattern : NULL;
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_NONE)
+        return table_match_keys(table, prefix, pattern);
+
+    int bucket = msg->cursor->bucket;
+    uint64_t position = msg->cursor->position;
+    char **keys = table_iterate(table, &bucket, &position, msg->limit, prefix, pattern);
+    if (keys != NULL) {
+        msg->cursor->bucket = bucket;
+        msg->cursor->position = position;
+    }
+    return keys;
+}
+
+/**
+ * Obtem as chaves da tabela, ou uma pagina delas, filtradas pelo
+ * prefixo e padrao opcionais do pedido, e coloca-as na mensagem
+ * da resposta.
  * \param msg
  *      Mensagem que contem o pedido.
  * \param table
@@ -312,7 +925,7 @@ int invoke_size(MessageT *msg, struct table_t *table) {
 */
 int invoke_getkeys(MessageT *msg, struct table_t *table) {
     // Validacao do pedido
-    if (msg->c_type != MESSAGE_T__C_TYPE__CT_NONE)
+    if (!keys_request_valid(msg))
         return invoke_error(msg);
     
     long start_time = get_time();
@@ -320,48 +933,23 @@ int invoke_getkeys(MessageT *msg, struct table_t *table) {
     // ============== SECCAO CRITICA ==============
     read_begin(cctrl);
 
-    // Obter a array de chaves
-    char **keys = table_get_keys(table);
+    // Obter a array das chaves pedidas
+    char **keys = keys_request(msg, table);
     if (keys == NULL) {
         read_end(cctrl);
         return invoke_error(msg);
     }
-    
-    // Obter o tamanho da tabela
-    int keyarraysize = table_size(table);
-    if (keyarraysize == -1) {
-        read_end(cctrl);
-        table_free_keys(keys);
-        return invoke_error(msg);
-    }
 
     read_end(cctrl);
     // ============================================
 
-    // Reservar espaco para a array de chaves
-    char** keysptr = malloc(keyarraysize * sizeof(char*));
-    if (keysptr == NULL) {
-        table_free_keys(keys);
-        return invoke_error(msg);
-    }
-
-    // Iterar pela array e duplicar chaves
-    for (int i = 0; i < keyarraysize; i++) {
-        keysptr[i] = strdup(keys[i]);
-        if (keysptr[i] == NULL) {
-            // Libertar strings copiadas anteriormente
-            for (int j = i - 1; j >= 0; j--)
-                free(keysptr[j]);
-            free(keysptr);
-            table_free_keys(keys);
-            return invoke_error(msg);
-        }
-    }
-    
-    table_free_keys(keys);
+    // A array e passada para a mensagem, que a liberta
+    int keyarraysize = 0;
+    while (keys[keyarraysize] != NULL)
+        keyarraysize++;
 
     msg->n_keys = keyarraysize;
-    msg->keys = keysptr;
+    msg->keys = keys;
     msg->opcode = MESSAGE_T__OPCODE__OP_GETKEYS + 1;
     msg->c_type = MESSAGE_T__C_TYPE__CT_KEYS;
 
@@ -373,8 +961,9 @@ int invoke_getkeys(MessageT *msg, struct table_t *table) {
 }
 
 /**
- * Obtem todas as entradas da tabela e coloca-as 
- * na mensagem da resposta.
+ * Obtem as entradas da tabela, ou uma pagina delas, filtradas pelo
+ * prefixo e padrao opcionais do pedido, e coloca-as na mensagem
+ * da resposta.
  * \param msg
  *      Mensagem que contem o pedido.
  * \param table
@@ -384,90 +973,43 @@ int invoke_getkeys(MessageT *msg, struct table_t *table) {
 */
 int invoke_gettable(MessageT *msg, struct table_t *table) {
     // Validacao do pedido
-    if (msg->c_type != MESSAGE_T__C_TYPE__CT_NONE)
+    if (!keys_request_valid(msg))
         return invoke_error(msg);
     
     // Registar o tempo do inicio
     long start_time = get_time();
+    long now = get_time_ms();
     
     // ============== SECCAO CRITICA ==============
     read_begin(cctrl);
     
-    // Obter array de chaves
-    char **keys = table_get_keys(table);
+    // Obter array das chaves pedidas
+    char **keys = keys_request(msg, table);
     if (keys == NULL) {
         read_end(cctrl);
         return invoke_error(msg);
     }
 
-    // Obter o tamanho da tabela
-    int entryarraysize = table_size(table);
-    if (entryarraysize == -1) {
-        read_end(cctrl);
-        table_free_keys(keys);
-        return invoke_error(msg);
-    }
+    int n_keys = 0;
+    while (keys[n_keys] != NULL)
+        n_keys++;
+
+    // As entradas sao lidas com o mesmo lock que as chaves
+    int n_entries;
+    EntryT **entries = entries_collect(table, keys, n_keys, now, &n_entries);
+    // A copia tem as escritas ate esta versao
+    uint64_t version = last_version;
 
     read_end(cctrl);
     // ============================================
 
-    // Alocar espaco para array de apontadores de entradas
-    EntryT **entriesptr = malloc(entryarraysize * sizeof(EntryT *));
-    if (entriesptr == NULL) {
-        table_free_keys(keys);
-        return invoke_error(msg);
-    }
-
-    // Obter cada entrada da tabela e passar para EntryT
-    for (int i = 0; i < entryarraysize; i++) {
-        // ============== SECCAO CRITICA ==============
-        read_begin(cctrl);
-
-        struct data_t *data = table_get(table, keys[i]);
-        if (data == NULL) {
-            read_end(cctrl);
-            free(entriesptr);
-            table_free_keys(keys);
-            return invoke_error(msg);
-        }
-
-        read_end(cctrl);
-        // ============================================
-
-        // Duplicar o conteudo
-        void *content = malloc(data->datasize);
-        if (content == NULL) {
-            data_destroy(data);
-            free(entriesptr);
-            table_free_keys(keys);
-            return invoke_error(msg);
-        }
-        memcpy(content, data->data, data->datasize);
-
-        // Inicializar EntryT
-        entriesptr[i] = malloc(sizeof(EntryT));
-        entry_t__init(entriesptr[i]);
-        entriesptr[i]->key = strdup(keys[i]);
-        entriesptr[i]->value.len = data->datasize;
-        entriesptr[i]->value.data = content;
-        if (entriesptr[i]->key == NULL) {
-            // Libertar posicoes anteriores
-            for (int j = i - 1; j >= 0; j--)
-                entry_t__free_unpacked(entriesptr[i], NULL);
-            free(content);
-            data_destroy(data);
-            free(entriesptr);
-            table_free_keys(keys);
-            return invoke_error(msg);
-        }
-
-        data_destroy(data);
-    }
-
     table_free_keys(keys);
+    if (entries == NULL)
+        return invoke_error(msg);
 
-    msg->n_entries = entryarraysize;
-    msg->entries = entriesptr;
+    msg->n_entries = n_entries;
+    msg->entries = entries;
+    msg->version = version;
     msg->opcode = MESSAGE_T__OPCODE__OP_GETTABLE + 1;
     msg->c_type = MESSAGE_T__C_TYPE__CT_TABLE;
 
@@ -477,7 +1019,1090 @@ int invoke_gettable(MessageT *msg, struct table_t *table) {
 }
 
 /**
- * Retorna as estatisticas do servidor.
+ * Obtem, por ordem das chaves, as entradas entre a chave inicial
+ * e a final do pedido e coloca-as na mensagem da resposta.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feira a operacao.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_scan(MessageT *msg, struct table_t *table) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_RANGE || msg->limit < 0)
+        return invoke_error(msg);
+
+    // Chaves vazias deixam o intervalo aberto
+    char *start = msg->key != NULL && msg->key[0] != '\0' ? msg->key : NULL;
+    char *end = msg->end_key != NULL && msg->end_key[0] != '\0' ? msg->end_key : NULL;
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+
+    // ============== SECCAO CRITICA ==============
+    read_begin(cctrl);
+
+    char **keys = table_scan(table, start, end, msg->limit);
+    if (keys == NULL) {
+        read_end(cctrl);
+        return invoke_error(msg);
+    }
+
+    int n_keys = 0;
+    while (keys[n_keys] != NULL)
+        n_keys++;
+
+    // As entradas sao lidas com o mesmo lock que as chaves
+    int n_entries;
+    EntryT **entries = entries_collect(table, keys, n_keys, now, &n_entries);
+
+    read_end(cctrl);
+    // ============================================
+
+    table_free_keys(keys);
+    if (entries == NULL)
+        return invoke_error(msg);
+
+    msg->n_entries = n_entries;
+    msg->entries = entries;
+    msg->opcode = MESSAGE_T__OPCODE__OP_SCAN + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Obtem as entradas de varias chaves, com um unico lock de leitura,
+ * e coloca-as na mensagem da resposta pela ordem pedida. As chaves
+ * que nao existem ou expiraram nao tem entrada na resposta.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feira a operacao.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_mget(MessageT *msg, struct table_t *table) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_KEYS)
+        return invoke_error(msg);
+    for (size_t i = 0; i < msg->n_keys; i++)
+        if (msg->keys[i] == NULL)
+            return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+
+    // ============== SECCAO CRITICA ==============
+    read_begin(cctrl);
+
+    int n_entries;
+    EntryT **entries = entries_collect(table, msg->keys, msg->n_keys, now, &n_entries);
+
+    read_end(cctrl);
+    // ============================================
+
+    if (entries == NULL)
+        return invoke_error(msg);
+
+    msg->n_entries = n_entries;
+    msg->entries = entries;
+    msg->opcode = MESSAGE_T__OPCODE__OP_MGET + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Liberta as entradas criadas por invoke_mput().
+*/
+void batch_destroy(struct entry_t **entries, unsigned long *expire_at, uint64_t *versions) {
+    if (entries != NULL) {
+        for (int i = 0; entries[i] != NULL; i++)
+            entry_destroy(entries[i]);
+        free(entries);
+    }
+    free(expire_at);
+    free(versions);
+}
+
+/**
+ * Coloca as entradas do pedido na tabela, com um unico lock de
+ * escrita, e propaga-as pela cadeia num so pedido. Se uma entrada
+ * falhar, as anteriores ficam escritas e sao propagadas.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_mput(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_TABLE || msg->n_entries == 0)
+        return invoke_error(msg);
+    for (size_t i = 0; i < msg->n_entries; i++)
+        if (msg->entries[i]->key == NULL || msg->entries[i]->value.data == NULL)
+            return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    unsigned long now = get_time_ms();
+
+    // Copiar as entradas antes de entrar na seccao critica
+    int n = msg->n_entries;
+    struct entry_t **entries = calloc(n + 1, sizeof(struct entry_t *));
+    unsigned long *expire_at = malloc(n * sizeof(unsigned long));
+    uint64_t *versions = malloc(n * sizeof(uint64_t));
+    if (entries == NULL || expire_at == NULL || versions == NULL) {
+        batch_destroy(entries, expire_at, versions);
+        return invoke_error(msg);
+    }
+    for (int i = 0; i < n; i++) {
+        EntryT *entryt = msg->entries[i];
+        char *key = strdup(entryt->key);
+        void *buf = malloc(entryt->value.len);
+        struct data_t *data = buf != NULL ? data_create(entryt->value.len, buf) : NULL;
+        entries[i] = key != NULL && data != NULL ? entry_create(key, data) : NULL;
+        if (entries[i] == NULL) {
+            free(key);
+            if (data != NULL)
+                data_destroy(data);
+            else
+                free(buf);
+            batch_destroy(entries, expire_at, versions);
+            return invoke_error(msg);
+        }
+        memcpy(buf, entryt->value.data, entryt->value.len);
+
+        // Tal como no OP_PUT, a cabeca fixa o instante de expiracao
+        expire_at[i] = entryt->expire_at;
+        if (expire_at[i] == 0 && entryt->ttl != 0)
+            expire_at[i] = now + entryt->ttl;
+    }
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    int result = 0;
+    int applied;
+    for (applied = 0; applied < n; applied++) {
+        char *key = entries[applied]->key;
+        versions[applied] = write_version(msg->entries[applied]->version);
+        if (table_put_version(table, key, entries[applied]->value, versions[applied]) == -1) {
+            result = -1;
+            break;
+        }
+        changelog_append(changelog, versions[applied], key, entries[applied]->value, expire_at[applied]);
+        if (expire_at[applied] != 0)
+            result = wheel_set(wheel, key, expire_at[applied]);
+        else
+            result = wheel_cancel(wheel, key);
+        if (result == -1) {
+            // A entrada esta na tabela e segue pela cadeia
+            applied++;
+            break;
+        }
+    }
+
+    // Propagar de uma vez as entradas que foram escritas
+    if (applied > 0) {
+        struct entry_t *last = entries[applied];
+        entries[applied] = NULL;
+        if (forwarded(rptable, rptable_mput_expire(rptable, entries, expire_at, versions), 1) == -1)
+            result = -1;
+        entries[applied] = last;
+        if (result == 0) {
+            char *keys[applied];
+            for (int i = 0; i < applied; i++)
+                keys[i] = entries[i]->key;
+            result = evict_entries(table, rptable, keys, applied);
+        }
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    batch_destroy(entries, expire_at, versions);
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->opcode = MESSAGE_T__OPCODE__OP_MPUT + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_NONE;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Remove as chaves do pedido da tabela, com um unico lock de
+ * escrita, e propaga as remocoes pela cadeia num so pedido. O
+ * resultado da resposta e o numero de chaves removidas.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_mdel(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_KEYS || msg->n_keys == 0)
+        return invoke_error(msg);
+    for (size_t i = 0; i < msg->n_keys; i++)
+        if (msg->keys[i] == NULL)
+            return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+
+    // Chaves removidas, a propagar pela cadeia
+    char **removed = malloc((msg->n_keys + 1) * sizeof(char *));
+    if (removed == NULL)
+        return invoke_error(msg);
+    int n_removed = 0;
+    uint64_t first = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    // Vindas da cadeia, as remocoes tem versoes seguidas a partir da
+    // do pedido, a cabeca atribui-as as chaves que removeu. As vindas
+    // da cadeia seguem todas, mesmo as das chaves que esta replica
+    // nao tinha, para as versoes continuarem seguidas
+    int result = 0;
+    for (size_t i = 0; i < msg->n_keys; i++) {
+        if (table_remove(table, msg->keys[i]) == 0 || msg->version != 0) {
+            wheel_cancel(wheel, msg->keys[i]);
+            uint64_t version = write_version(msg->version != 0 ? msg->version + i : 0);
+            changelog_append(changelog, version, msg->keys[i], NULL, 0);
+            if (sync_removed(msg->keys[i], version) == -1)
+                result = -1;
+            if (n_removed == 0)
+                first = version;
+            removed[n_removed++] = msg->keys[i];
+        }
+    }
+    removed[n_removed] = NULL;
+
+    if (n_removed > 0 && forwarded(rptable, rptable_mdel(rptable, removed, first), 1) == -1)
+        result = -1;
+
+    write_end(cctrl);
+    // ============================================
+
+    free(removed);
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->result = n_removed;
+    msg->opcode = MESSAGE_T__OPCODE__OP_MDEL + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Obtem a entrada de uma chave que nao expirou.
+ * Deve ser chamada dentro de uma seccao critica.
+ * \param expire_at
+ *      Onde guardar o instante de expiracao da entrada (0 = sem
+ *      expiracao).
+ * \return
+ *      A entrada (referencia na tabela) ou NULL se a chave nao
+ *      existe ou expirou.
+*/
+struct entry_t *live_entry(struct table_t *table, char *key, long now, long *expire_at) {
+    *expire_at = wheel_get(wheel, key);
+    if (*expire_at <= 0)
+        *expire_at = 0;
+    else if (*expire_at <= now) {
+        *expire_at = 0;
+        return NULL;
+    }
+    return table_lookup(table, key);
+}
+
+/**
+ * Le o valor de uma entrada como um inteiro em decimal.
+ * \return
+ *      Retorna 0 se o valor e um inteiro, -1 caso contrario.
+*/
+int parse_counter(struct data_t *data, long *counter) {
+    char buf[COUNTER_MAX_DIGITS + 1];
+    if (data->datasize <= 0 || data->datasize > COUNTER_MAX_DIGITS)
+        return -1;
+    memcpy(buf, data->data, data->datasize);
+    buf[data->datasize] = '\0';
+
+    char *end = NULL;
+    errno = 0;
+    *counter = strtol(buf, &end, 10);
+    if (errno != 0 || *end != '\0' || isspace((unsigned char) buf[0]))
+        return -1;
+    return 0;
+}
+
+/**
+ * Soma o delta do pedido ao inteiro guardado na chave, que vale 0
+ * se nao existir, e coloca o resultado, em decimal, na mensagem da
+ * resposta. O resultado e propagado pela cadeia como um OP_PUT,
+ * mantendo o tempo de vida da entrada.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_incr(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_KEY || msg->key == NULL)
+        return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+
+    char buf[COUNTER_MAX_DIGITS + 1];
+    int len;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long expire_at;
+    long counter = 0;
+    struct entry_t *entry = live_entry(table, msg->key, now, &expire_at);
+    if ((entry != NULL && parse_counter(entry->value, &counter) == -1) ||
+        __builtin_add_overflow(counter, msg->delta, &counter)) {
+        write_end(cctrl);
+        return invoke_error(msg);
+    }
+
+    len = snprintf(buf, sizeof(buf), "%ld", counter);
+    struct data_t data = {len, buf};
+    uint64_t version = write_version(0);
+    if (put_entry(table, rptable, msg->key, &data, expire_at, version) == -1) {
+        write_end(cctrl);
+        return invoke_error(msg);
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    msg->value.data = malloc(len);
+    if (msg->value.data == NULL)
+        return invoke_error(msg);
+    memcpy(msg->value.data, buf, len);
+    msg->value.len = len;
+    msg->version = version;
+    msg->opcode = MESSAGE_T__OPCODE__OP_INCR + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_VALUE;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Acrescenta o valor do pedido ao fim do valor guardado na chave,
+ * que e criada se nao existir, e coloca o novo tamanho no resultado
+ * da resposta. O novo valor e propagado pela cadeia como um OP_PUT,
+ * mantendo o tempo de vida da entrada.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_append(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_ENTRY)
+        return invoke_error(msg);
+    if (msg->entry == NULL || msg->entry->key == NULL ||
+        msg->entry->value.data == NULL || msg->entry->value.len == 0)
+        return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long expire_at;
+    struct entry_t *entry = live_entry(table, msg->entry->key, now, &expire_at);
+    int old_size = entry != NULL ? entry->value->datasize : 0;
+    if ((long) old_size + msg->entry->value.len > INT_MAX) {
+        write_end(cctrl);
+        return invoke_error(msg);
+    }
+
+    // Juntar o valor guardado e o acrescentado
+    int size = old_size + msg->entry->value.len;
+    void *buf = malloc(size);
+    struct data_t *data = buf != NULL ? data_create(size, buf) : NULL;
+    if (data == NULL) {
+        write_end(cctrl);
+        free(buf);
+        return invoke_error(msg);
+    }
+    if (entry != NULL)
+        memcpy(buf, entry->value->data, old_size);
+    memcpy((char *) buf + old_size, msg->entry->value.data, msg->entry->value.len);
+
+    uint64_t version = write_version(0);
+    int result = put_entry(table, rptable, msg->entry->key, data, expire_at, version);
+
+    write_end(cctrl);
+    // ============================================
+
+    data_destroy(data);
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->result = size;
+    msg->version = version;
+    msg->opcode = MESSAGE_T__OPCODE__OP_APPEND + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Substitui o valor da chave pelo do pedido apenas se o valor
+ * guardado for igual ao esperado. O resultado da resposta e 1 se
+ * o valor foi substituido ou 0 se era diferente ou a chave nao
+ * existe. Tal como no OP_PUT, a entrada fica com o tempo de vida
+ * do pedido.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_cas(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_ENTRY)
+        return invoke_error(msg);
+    if (msg->entry == NULL || msg->entry->key == NULL ||
+        msg->entry->value.data == NULL || msg->expected.data == NULL)
+        return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+    unsigned long expire_at = 0;
+    if (msg->entry->ttl != 0)
+        expire_at = now + msg->entry->ttl;
+
+    struct data_t data = {msg->entry->value.len, msg->entry->value.data};
+    int swapped = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long old_expire_at;
+    struct entry_t *entry = live_entry(table, msg->entry->key, now, &old_expire_at);
+    if (entry != NULL && entry->value->datasize == msg->expected.len &&
+        memcmp(entry->value->data, msg->expected.data, msg->expected.len) == 0) {
+        msg->version = write_version(0);
+        if (put_entry(table, rptable, msg->entry->key, &data, expire_at, msg->version) == -1) {
+            write_end(cctrl);
+            return invoke_error(msg);
+        }
+        swapped = 1;
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    msg->result = swapped;
+    msg->opcode = MESSAGE_T__OPCODE__OP_CAS + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Verifica se a versao guardada de uma chave e a esperada.
+ * Deve ser chamada dentro de uma seccao critica.
+ * \param entry
+ *      Entrada obtida com live_entry(), NULL se nao existe.
+ * \param expected
+ *      Versao esperada, 0 para exigir que a chave nao exista.
+ * \param current
+ *      Onde guardar a versao guardada (0 se a chave nao existe).
+ * \return
+ *      1 se a versao e a esperada, 0 caso contrario.
+*/
+int version_matches(struct entry_t *entry, uint64_t expected, uint64_t *current) {
+    *current = entry != NULL ? table_entry_version(entry) : 0;
+    if (expected == 0)
+        return entry == NULL;
+    return entry != NULL && *current == expected;
+}
+
+/**
+ * Coloca a entrada do pedido na tabela apenas se a versao guardada
+ * for a esperada (0 exige que a chave nao exista). O resultado da
+ * resposta e 1 se a entrada foi escrita, com a nova versao, ou 0 se
+ * nao foi, com a versao guardada. A escrita e propagada pela cadeia
+ * como um OP_PUT com a nova versao.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_cput(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_ENTRY)
+        return invoke_error(msg);
+    if (msg->entry == NULL || msg->entry->key == NULL ||
+        msg->entry->value.data == NULL)
+        return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+    unsigned long expire_at = 0;
+    if (msg->entry->ttl != 0)
+        expire_at = now + msg->entry->ttl;
+
+    struct data_t data = {msg->entry->value.len, msg->entry->value.data};
+    int written = 0;
+    uint64_t version;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long old_expire_at;
+    struct entry_t *entry = live_entry(table, msg->entry->key, now, &old_expire_at);
+    if (version_matches(entry, msg->version, &version)) {
+        version = write_version(0);
+        if (put_entry(table, rptable, msg->entry->key, &data, expire_at, version) == -1) {
+            write_end(cctrl);
+            return invoke_error(msg);
+        }
+        written = 1;
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    msg->result = written;
+    msg->version = version;
+    msg->opcode = MESSAGE_T__OPCODE__OP_CPUT + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Remove a chave do pedido apenas se a versao guardada for a
+ * esperada. O resultado da resposta e 1 se a chave foi removida ou
+ * 0 se nao foi, com a versao guardada (0 se a chave nao existe).
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_cdel(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_KEY || msg->key == NULL || msg->version == 0)
+        return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+    int removed = 0;
+    uint64_t version;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long expire_at;
+    struct entry_t *entry = live_entry(table, msg->key, now, &expire_at);
+    if (version_matches(entry, msg->version, &version)) {
+        if (table_remove(table, msg->key) == -1) {
+            write_end(cctrl);
+            return invoke_error(msg);
+        }
+        wheel_cancel(wheel, msg->key);
+        uint64_t removed_version = write_version(0);
+        changelog_append(changelog, removed_version, msg->key, NULL, 0);
+        if (forwarded(rptable, rptable_del(rptable, msg->key, removed_version), 1) == -1) {
+            write_end(cctrl);
+            return invoke_error(msg);
+        }
+        removed = 1;
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    msg->result = removed;
+    msg->version = version;
+    msg->opcode = MESSAGE_T__OPCODE__OP_CDEL + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Repoe, pela ordem inversa, o estado das chaves guardado antes
+ * das operacoes de um lote e liberta as copias dos valores.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \param undo
+ *      Estado de cada chave antes de cada operacao.
+ * \param n
+ *      Numero de operacoes a desfazer.
+ * \param n_saved
+ *      Numero de estados guardados em undo.
+*/
+void batch_undo(struct table_t *table, struct batch_undo_t *undo, int n, int n_saved) {
+    for (int i = n - 1; i >= 0; i--) {
+        if (undo[i].data == NULL) {
+            table_remove(table, undo[i].key);
+            wheel_cancel(wheel, undo[i].key);
+        } else {
+            table_put_version(table, undo[i].key, undo[i].data, undo[i].version);
+            if (undo[i].expire_at != 0)
+                wheel_set(wheel, undo[i].key, undo[i].expire_at);
+            else
+                wheel_cancel(wheel, undo[i].key);
+        }
+    }
+    for (int i = 0; i < n_saved; i++)
+        if (undo[i].data != NULL)
+            data_destroy(undo[i].data);
+}
+
+/**
+ * Aplica as operacoes de um lote na tabela, todas ou nenhuma. As
+ * versoes e os instantes de expiracao das escritas ficam nas
+ * operacoes, para o lote ser propagado tal como foi aplicado.
+ * Deve ser chamada dentro da seccao critica de escrita.
+ * \param ops
+ *      Operacoes do lote, pela ordem.
+ * \param n_ops
+ *      Numero de operacoes.
+ * \param undo
+ *      Espaco para n_ops estados, que ficam guardados se o lote
+ *      foi aplicado.
+ * \return
+ *      Retorna 0 se aplicou o lote, -1 se nao aplicou nenhuma operacao.
+*/
+int batch_apply(struct table_t *table, EntryT **ops, int n_ops, struct batch_undo_t *undo) {
+    // Guardar o estado das chaves antes de alterar a tabela
+    for (int i = 0; i < n_ops; i++) {
+        struct entry_t *entry = table_lookup(table, ops[i]->key);
+        undo[i].key = ops[i]->key;
+        undo[i].data = NULL;
+        undo[i].expire_at = 0;
+        undo[i].version = 0;
+        if (entry == NULL)
+            continue;
+        if ((undo[i].data = data_dup(entry->value)) == NULL) {
+            batch_undo(table, undo, 0, i);
+            return -1;
+        }
+        long expire_at = wheel_get(wheel, ops[i]->key);
+        undo[i].expire_at = expire_at > 0 ? expire_at : 0;
+        undo[i].version = table_entry_version(entry);
+    }
+
+    for (int i = 0; i < n_ops; i++) {
+        EntryT *op = ops[i];
+        int result;
+        if (op->deleted) {
+            // Remover uma chave que nao existe nao e um erro
+            op->version = write_version(op->version);
+            if (undo[i].data != NULL && table_remove(table, op->key) != 0)
+                result = -1;
+            else
+                result = wheel_cancel(wheel, op->key);
+            if (result == 0)
+                result = sync_removed(op->key, op->version);
+        } else {
+            struct data_t data = {op->value.len, op->value.data};
+            op->version = write_version(op->version);
+            result = table_put_version(table, op->key, &data, op->version);
+            if (result == 0 && op->expire_at != 0)
+                result = wheel_set(wheel, op->key, op->expire_at);
+            else if (result == 0)
+                result = wheel_cancel(wheel, op->key);
+        }
+        if (result == -1) {
+            // A operacao i pode ter alterado a tabela antes de falhar
+            batch_undo(table, undo, i + 1, n_ops);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Aplica as colocacoes e remocoes do pedido, todas ou nenhuma, com
+ * um unico lock de escrita e propaga-as pela cadeia como um so
+ * pedido, que cada servidor aplica tambem como uma unidade. Assim
+ * nenhuma leitura ve apenas parte do lote. O resultado da resposta
+ * e o numero de operacoes aplicadas.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_batch(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_TABLE || msg->n_entries == 0)
+        return invoke_error(msg);
+    for (size_t i = 0; i < msg->n_entries; i++) {
+        EntryT *op = msg->entries[i];
+        if (op->key == NULL)
+            return invoke_error(msg);
+        if (!op->deleted && (op->value.data == NULL || op->value.len == 0))
+            return invoke_error(msg);
+    }
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    unsigned long now = get_time_ms();
+
+    // Tal como no OP_PUT, a cabeca fixa os instantes de expiracao
+    int n_ops = msg->n_entries;
+    char *put_keys[n_ops];
+    int n_put_keys = 0;
+    for (int i = 0; i < n_ops; i++) {
+        EntryT *op = msg->entries[i];
+        if (!op->deleted && op->expire_at == 0 && op->ttl != 0)
+            op->expire_at = now + op->ttl;
+        if (!op->deleted)
+            put_keys[n_put_keys++] = op->key;
+    }
+
+    struct batch_undo_t *undo = malloc(n_ops * sizeof(struct batch_undo_t));
+    if (undo == NULL)
+        return invoke_error(msg);
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    if (batch_apply(table, msg->entries, n_ops, undo) == -1) {
+        write_end(cctrl);
+        free(undo);
+        return invoke_error(msg);
+    }
+
+    // O lote segue inteiro pela cadeia, com as versoes atribuidas
+    struct rtable_batch_t batch = {msg->entries, n_ops, n_ops};
+    if (forwarded(rptable, rptable_batch(rptable, &batch), 0) == -1) {
+        batch_undo(table, undo, n_ops, n_ops);
+        write_end(cctrl);
+        free(undo);
+        return invoke_error(msg);
+    }
+    batch_undo(table, undo, 0, n_ops);
+
+    // So o lote aplicado em toda a cadeia fica no registo das escritas
+    for (int i = 0; i < n_ops; i++) {
+        EntryT *op = msg->entries[i];
+        struct data_t data = {op->value.len, op->value.data};
+        changelog_append(changelog, op->version, op->key, op->deleted ? NULL : &data, op->expire_at);
+    }
+
+    // Libertar memoria se o limite foi ultrapassado
+    int result = n_put_keys > 0 ? evict_entries(table, rptable, put_keys, n_put_keys) : 0;
+
+    write_end(cctrl);
+    // ============================================
+
+    free(undo);
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->result = n_ops;
+    msg->opcode = MESSAGE_T__OPCODE__OP_BATCH + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Coloca as entradas enviadas pela cabeca de outra cadeia, que o
+ * anel passou a atribuir a esta, apenas se a chave nao existe, pois
+ * uma escrita ja feita nesta cadeia e mais recente do que a entrada
+ * migrada. As entradas recebem novas versoes desta cadeia e sao
+ * propagadas num so pedido. O resultado da resposta e o numero de
+ * entradas colocadas.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_migrate(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    // Validacao do pedido
+    if (msg->c_type != MESSAGE_T__C_TYPE__CT_TABLE || msg->n_entries == 0)
+        return invoke_error(msg);
+    for (size_t i = 0; i < msg->n_entries; i++)
+        if (msg->entries[i]->key == NULL || msg->entries[i]->value.data == NULL ||
+            msg->entries[i]->value.len == 0)
+            return invoke_error(msg);
+
+    // Registar o tempo do inicio
+    long start_time = get_time();
+    long now = get_time_ms();
+
+    // As entradas colocadas apontam para os dados do pedido
+    int n = msg->n_entries;
+    struct data_t *values = malloc(n * sizeof(struct data_t));
+    struct entry_t *items = malloc(n * sizeof(struct entry_t));
+    struct entry_t **applied = malloc((n + 1) * sizeof(struct entry_t *));
+    unsigned long *expire_at = malloc(n * sizeof(unsigned long));
+    uint64_t *versions = malloc(n * sizeof(uint64_t));
+    int result = values == NULL || items == NULL || applied == NULL ||
+                 expire_at == NULL || versions == NULL ? -1 : 0;
+    int n_applied = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    for (int i = 0; i < n && result == 0; i++) {
+        EntryT *entryt = msg->entries[i];
+        long current;
+        if (live_entry(table, entryt->key, now, &current) != NULL)
+            continue;
+        if (entryt->expire_at != 0 && entryt->expire_at <= now)
+            continue;
+
+        values[n_applied].datasize = entryt->value.len;
+        values[n_applied].data = entryt->value.data;
+        items[n_applied].key = entryt->key;
+        items[n_applied].value = &values[n_applied];
+        expire_at[n_applied] = entryt->expire_at;
+        versions[n_applied] = write_version(0);
+        if (table_put_version(table, entryt->key, &values[n_applied], versions[n_applied]) == -1) {
+            result = -1;
+            break;
+        }
+        changelog_append(changelog, versions[n_applied], entryt->key, &values[n_applied],
+                         expire_at[n_applied]);
+        applied[n_applied] = &items[n_applied];
+        n_applied++;
+        if (entryt->expire_at != 0)
+            result = wheel_set(wheel, entryt->key, entryt->expire_at);
+        else
+            result = wheel_cancel(wheel, entryt->key);
+    }
+
+    // Propagar de uma vez as entradas que foram escritas
+    if (n_applied > 0) {
+        applied[n_applied] = NULL;
+        if (forwarded(rptable, rptable_mput_expire(rptable, applied, expire_at, versions), 1) == -1)
+            result = -1;
+        if (result == 0) {
+            char *keys[n_applied];
+            for (int i = 0; i < n_applied; i++)
+                keys[i] = applied[i]->key;
+            result = evict_entries(table, rptable, keys, n_applied);
+        }
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    free(values);
+    free(items);
+    free(applied);
+    free(expire_at);
+    free(versions);
+    if (result == -1)
+        return invoke_error(msg);
+
+    msg->result = n_applied;
+    msg->opcode = MESSAGE_T__OPCODE__OP_MIGRATE + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+
+    stats_op_finish(stats, get_time() - start_time);
+
+    return 0;
+}
+
+/**
+ * Retorna a chave das escritas de uma so chave, que a cabeca de
+ * uma instalacao particionada reencaminha se pertencer a outra
+ * cadeia, ou NULL para os restantes pedidos. Durante uma migracao
+ * os clientes enviam ao dono anterior, uma a uma, as chaves dos
+ * OP_MPUT e OP_MDEL que mudaram de dono.
+*/
+char *redirect_key(MessageT *msg) {
+    switch (msg->opcode) {
+        case MESSAGE_T__OPCODE__OP_PUT:
+        case MESSAGE_T__OPCODE__OP_APPEND:
+        case MESSAGE_T__OPCODE__OP_CAS:
+        case MESSAGE_T__OPCODE__OP_CPUT:
+            return msg->entry != NULL ? msg->entry->key : NULL;
+
+        case MESSAGE_T__OPCODE__OP_DEL:
+        case MESSAGE_T__OPCODE__OP_INCR:
+        case MESSAGE_T__OPCODE__OP_CDEL:
+            return msg->key;
+
+        case MESSAGE_T__OPCODE__OP_MPUT:
+            return msg->n_entries == 1 && msg->entries[0] != NULL ? msg->entries[0]->key : NULL;
+
+        case MESSAGE_T__OPCODE__OP_MDEL:
+            return msg->n_keys == 1 ? msg->keys[0] : NULL;
+
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Trata, na cabeca, uma escrita de uma chave que o anel atribui a
+ * outra cadeia, vinda de um cliente que ainda nao viu a mudanca. Se
+ * a entrada ainda nao foi migrada, e enviada e removida primeiro,
+ * para a escrita ser feita sobre o valor atual, e depois o pedido e
+ * reencaminhado a cabeca da cadeia dona, cuja resposta e devolvida.
+ * \param msg
+ *      Mensagem que contem o pedido.
+ * \param table
+ *      Tabela sobre qual sera feita a operacao.
+ * \param rptable
+ *      Tabela replicada remota.
+ * \param key
+ *      Chave da escrita.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int invoke_redirect(MessageT *msg, struct table_t *table, s_rptable_t *rptable, char *key) {
+    long now = get_time_ms();
+    int result = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    long expire_at;
+    struct entry_t *entry = live_entry(table, key, now, &expire_at);
+    if (entry != NULL) {
+        struct entry_t *moved[] = {entry, NULL};
+        unsigned long moved_expire_at[] = {expire_at};
+        result = rptable_migrate(rptable, moved, moved_expire_at);
+        // A remocao segue pela cadeia como as expiracoes
+        if (result == 0 && table_remove(table, key) == 0) {
+            wheel_cancel(wheel, key);
+            uint64_t version = removed_keys(&key, 1);
+            if (forwarded(rptable, rptable_del(rptable, key, version), 1) == -1)
+                result = -1;
+        }
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    if (result == -1)
+        return invoke_error(msg);
+
+    MessageT *resp = rptable_redirect(rptable, key, msg);
+    if (resp == NULL)
+        return invoke_error(msg);
+
+    adopt_response(msg, resp);
+    return 0;
+}
+
+/**
+ * Preenche as estatisticas com a ocupacao das classes do
+ * alocador da tabela que ja reservaram paginas.
+ * \attention
+ *      Deve ser chamada com o lock de leitura da tabela.
+ * \return
+ *      Retorna 0 se concluiu com sucesso, -1 caso contrario.
+*/
+int fill_slab_stats(StatsT *statis, struct table_t *table) {
+    statis->slabs = malloc(SLAB_N_CLASSES * sizeof(SlabClassT *));
+    if (statis->slabs == NULL)
+        return -1;
+
+    for (int i = 0; i < SLAB_N_CLASSES; i++) {
+        int size;
+        long used, capacity;
+        if (slab_class_stats(table->slab, i, &size, &used, &capacity) == -1)
+            goto err_slabs;
+        if (capacity == 0)
+            continue;
+
+        SlabClassT *class = malloc(sizeof(SlabClassT));
+        if (class == NULL)
+            goto err_slabs;
+        slab_class_t__init(class);
+        class->size = size;
+        class->used = used;
+        class->capacity = capacity;
+        statis->slabs[statis->n_slabs++] = class;
+    }
+    return 0;
+
+err_slabs:
+    for (int i = 0; i < statis->n_slabs; i++)
+        free(statis->slabs[i]);
+    free(statis->slabs);
+    statis->slabs = NULL;
+    statis->n_slabs = 0;
+    return -1;
+}
+
+/**
+ * Retorna as estatisticas do servidor.
  * \param msg
  *      Mensagem que contem o pedido.
  * \param table
@@ -504,8 +2129,31 @@ int invoke_stats(MessageT *msg, struct table_t *table) {
     statis->n_clients = stats_get_n_client(stats_cpy);
     statis->n_op = stats_get_n_op(stats_cpy);
     statis->time = stats_get_time_lasted(stats_cpy);
+    statis->n_evicted = stats_get_n_evicted(stats_cpy);
+
+    read_begin(cctrl);
+    statis->memory = table_memory(table);
+    int result = fill_slab_stats(statis, table);
+    read_end(cctrl);
+
+    // Escritas e o seu tempo por nivel de durabilidade
+    statis->write_ops = malloc(STATS_DURABILITY_LEVELS * sizeof(uint64_t));
+    statis->write_time = malloc(STATS_DURABILITY_LEVELS * sizeof(uint64_t));
+    if (statis->write_ops == NULL || statis->write_time == NULL)
+        result = -1;
+    for (int i = 0; result == 0 && i < STATS_DURABILITY_LEVELS; i++) {
+        long ops, time;
+        stats_get_write(stats_cpy, i, &ops, &time);
+        statis->write_ops[i] = ops;
+        statis->write_time[i] = time;
+    }
+    statis->n_write_ops = statis->n_write_time = result == 0 ? STATS_DURABILITY_LEVELS : 0;
 
     stats_destroy(stats_cpy);
+    if (result == -1) {
+        stats_t__free_unpacked(statis, NULL);
+        return invoke_error(msg);
+    }
 
     msg->stats = statis;
     msg->opcode = MESSAGE_T__OPCODE__OP_STATS + 1;
@@ -514,12 +2162,267 @@ int invoke_stats(MessageT *msg, struct table_t *table) {
     return 0;
 }
 
+/**
+ * Thread que faz a recolha ativa das chaves expiradas, a cada
+ * tick recolhe no maximo EXPIRY_MAX_KEYS chaves para limitar
+ * o tempo em que o lock de escrita fica ocupado.
+*/
+void *expiry_loop(void *arg) {
+    while (expiry_running) {
+        usleep(EXPIRY_TICK_MS * 1000);
+
+        // Apenas a cabeca decide as expiracoes, os restantes
+        // servidores recebem as remocoes pela cadeia
+        if (rptable_is_head(expiry_rptable) != 1)
+            continue;
+
+        // ============== SECCAO CRITICA ==============
+        write_begin(cctrl);
+
+        char **keys = wheel_advance(wheel, get_time_ms(), EXPIRY_MAX_KEYS);
+        for (int i = 0; keys != NULL && keys[i] != NULL; i++) {
+            if (table_remove(expiry_table, keys[i]) == 0) {
+                uint64_t version = removed_keys(&keys[i], 1);
+                forwarded(expiry_rptable, rptable_del(expiry_rptable, keys[i], version), 1);
+            }
+        }
+
+        // Enviar a sequencia pela cadeia, para as replicas saberem
+        // que continuam atualizadas mesmo sem escritas
+        long now = get_time_ms();
+        if (now - heartbeat_at >= HEARTBEAT_MS) {
+            heartbeat_forward(expiry_rptable, last_version);
+            heartbeat_at = now;
+        }
+
+        write_end(cctrl);
+        // ============================================
+
+        wheel_free_keys(keys);
+    }
+    return NULL;
+}
+
+int table_skel_expiry_start(struct table_t *table, s_rptable_t *rptable) {
+    if (table == NULL || rptable == NULL)
+        return -1;
+    expiry_table = table;
+    expiry_rptable = rptable;
+    // So um arranque pode passar de 0 a 1
+    int stopped = 0;
+    if (!atomic_compare_exchange_strong(&expiry_running, &stopped, 1))
+        return -1;
+    if (pthread_create(&expiry_thread, NULL, expiry_loop, NULL) != 0) {
+        expiry_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Percorre a tabela e envia as entradas que o anel atribui a outras
+ * cadeias, MIGRATE_PAGE chaves de cada vez, removendo-as depois de
+ * serem aceites. Entre paginas espera o necessario para nao enviar
+ * mais de MIGRATE_BYTES_PER_SEC, para os pedidos dos clientes nao
+ * ficarem sem rede nem a espera do lock de escrita.
+ * \param generation
+ *      Geracao das cadeias que esta a ser aplicada.
+ * \return
+ *      0 se percorreu a tabela, 1 se parou porque as cadeias ou a
+ *      cabeca mudaram, ou -1 em caso de erro.
+*/
+int migrate_pass(struct table_t *table, s_rptable_t *rptable, unsigned int generation) {
+    int bucket = 0;
+    uint64_t position = 0;
+    do {
+        if (!migrate_running || rptable_is_head(rptable) != 1 ||
+            rptable_generation(rptable) != generation)
+            return 1;
+
+        long now = get_time_ms();
+        long bytes = 0;
+        int result = 0;
+
+        // ============== SECCAO CRITICA ==============
+        write_begin(cctrl);
+
+        char **keys = table_iterate(table, &bucket, &position, MIGRATE_PAGE, NULL, NULL);
+        int n_keys = 0;
+        while (keys != NULL && keys[n_keys] != NULL)
+            n_keys++;
+        struct entry_t *moved[n_keys + 1];
+        unsigned long expire_at[n_keys + 1];
+        char *moved_keys[n_keys + 1];
+        int n_moved = 0;
+        for (int i = 0; i < n_keys; i++) {
+            long entry_expire_at;
+            struct entry_t *entry;
+            if (rptable_owns(rptable, keys[i]) != 0 ||
+                (entry = live_entry(table, keys[i], now, &entry_expire_at)) == NULL)
+                continue;
+            moved[n_moved] = entry;
+            expire_at[n_moved] = entry_expire_at;
+            moved_keys[n_moved++] = keys[i];
+            bytes += strlen(keys[i]) + entry->value->datasize;
+        }
+        moved[n_moved] = NULL;
+        moved_keys[n_moved] = NULL;
+
+        if (keys == NULL)
+            result = -1;
+        else if (n_moved > 0 && (result = rptable_migrate(rptable, moved, expire_at)) == 0) {
+            // As cadeias donas ja tem as entradas, remover e propagar
+            for (int i = 0; i < n_moved; i++) {
+                table_remove(table, moved_keys[i]);
+                wheel_cancel(wheel, moved_keys[i]);
+            }
+            uint64_t version = removed_keys(moved_keys, n_moved);
+            result = forwarded(rptable, rptable_mdel(rptable, moved_keys, version), 1);
+        }
+
+        write_end(cctrl);
+        // ============================================
+
+        table_free_keys(keys);
+        if (result == -1)
+            return -1;
+
+        // Limitar a largura de banda usada pela migracao
+        if (bytes > 0)
+            usleep(bytes * 1000000 / MIGRATE_BYTES_PER_SEC);
+    } while (bucket != 0 || position != 0);
+    return 0;
+}
+
+/**
+ * Thread que, na cabeca de uma instalacao particionada, migra as
+ * chaves que deixaram de pertencer a cadeia sempre que as cadeias
+ * mudam, anunciando no ZooKeeper enquanto esta a migrar.
+*/
+void *migrate_loop(void *arg) {
+    unsigned int done = 0;
+    while (migrate_running) {
+        usleep(MIGRATE_TICK_MS * 1000);
+
+        // Apenas a cabeca migra, os restantes servidores recebem
+        // as remocoes pela cadeia
+        unsigned int generation = rptable_generation(migrate_rptable);
+        if (generation == done || rptable_is_head(migrate_rptable) != 1)
+            continue;
+
+        rptable_set_migrating(migrate_rptable, 1);
+        if (migrate_pass(migrate_table, migrate_rptable, generation) == 0)
+            done = generation;
+        rptable_set_migrating(migrate_rptable, 0);
+    }
+    return NULL;
+}
+
+int table_skel_migration_start(struct table_t *table, s_rptable_t *rptable) {
+    if (table == NULL || rptable == NULL || migrate_running)
+        return -1;
+    // Sem particoes nao ha chaves para migrar
+    if (rptable_generation(rptable) == 0)
+        return 0;
+    migrate_table = table;
+    migrate_rptable = rptable;
+    int stopped = 0;
+    if (!atomic_compare_exchange_strong(&migrate_running, &stopped, 1))
+        return -1;
+    if (pthread_create(&migrate_thread, NULL, migrate_loop, NULL) != 0) {
+        migrate_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int table_skel_set_maxmemory(long bytes) {
+    if (bytes < 0)
+        return -1;
+    maxmemory = bytes;
+    return 0;
+}
+
+int table_skel_set_version(unsigned long version) {
+    write_begin(cctrl);
+    if (version > last_version)
+        last_version = version;
+    // As escritas ate a versao chegaram com a tabela, nao pelo registo
+    changelog_truncate(changelog, version);
+    write_end(cctrl);
+    return 0;
+}
+
+int table_skel_sync_begin() {
+    write_begin(cctrl);
+    tombstones = table_create(SYNC_TOMBSTONE_LISTS);
+    write_end(cctrl);
+    if (tombstones == NULL)
+        return -1;
+    syncing = 1;
+    return 0;
+}
+
+int table_skel_sync_entry(struct table_t *table, char *key, struct data_t *value,
+                          uint64_t version, unsigned long expire_at) {
+    if (table == NULL || key == NULL || value == NULL)
+        return -1;
+    int result = 0;
+
+    // ============== SECCAO CRITICA ==============
+    write_begin(cctrl);
+
+    // A cadeia ja trouxe uma escrita ou uma remocao mais recente que a
+    // copia, que fica como esta
+    struct entry_t *entry = table_lookup(table, key);
+    struct entry_t *removed = tombstones == NULL ? NULL : table_lookup(tombstones, key);
+    if ((entry == NULL || table_entry_version(entry) < version) &&
+        (removed == NULL || table_entry_version(removed) < version)) {
+        result = table_put_version(table, key, value, version);
+        // Manter o instante de expiracao fixado pela cabeca
+        if (result == 0 && expire_at != 0)
+            result = wheel_set(wheel, key, expire_at);
+    }
+
+    write_end(cctrl);
+    // ============================================
+
+    return result;
+}
+
+void table_skel_sync_end() {
+    write_begin(cctrl);
+    if (tombstones != NULL)
+        table_destroy(tombstones);
+    tombstones = NULL;
+    write_end(cctrl);
+
+    pthread_mutex_lock(&sync_lock);
+    syncing = 0;
+    pthread_cond_broadcast(&sync_done);
+    pthread_mutex_unlock(&sync_lock);
+}
+
+void table_skel_sync_wait(MessageT *msg) {
+    if (!syncing || msg == NULL || chain_request(msg))
+        return;
+    pthread_mutex_lock(&sync_lock);
+    while (syncing)
+        pthread_cond_wait(&sync_done, &sync_lock);
+    pthread_mutex_unlock(&sync_lock);
+}
+
 struct table_t *table_skel_init(int n_lists) {
     if (n_lists <= 0)
         return NULL;
     struct table_t *table = table_create(n_lists);
     if (table == NULL)
         return NULL;
+    // Manter as chaves ordenadas para o OP_SCAN
+    if (table_index_enable(table) == -1) {
+        table_destroy(table);
+        return NULL;
+    }
     // Inicializar a estrutura para controlo de concorrencia
     if ((cctrl = cctrl_init()) == NULL) {
         table_destroy(table);
@@ -531,12 +2434,52 @@ struct table_t *table_skel_init(int n_lists) {
         cctrl_destroy(cctrl);
         return NULL;
     }
+    // Inicializar a roda de temporizadores
+    if ((wheel = wheel_init(EXPIRY_TICK_MS, get_time_ms())) == NULL) {
+        table_destroy(table);
+        cctrl_destroy(cctrl);
+        stats_destroy(stats);
+        return NULL;
+    }
+    // Inicializar as chaves seguidas para as caches dos clientes
+    if ((tracking = tracking_create(TRACKING_MAX_KEYS)) == NULL) {
+        table_destroy(table);
+        cctrl_destroy(cctrl);
+        stats_destroy(stats);
+        wheel_destroy(wheel);
+        return NULL;
+    }
+    // Inicializar as subscricoes das alteracoes
+    if ((watch = watch_create()) == NULL) {
+        table_destroy(table);
+        cctrl_destroy(cctrl);
+        stats_destroy(stats);
+        wheel_destroy(wheel);
+        tracking_destroy(tracking);
+        return NULL;
+    }
+    // Inicializar o registo das escritas aplicadas
+    if ((changelog = changelog_create(CHANGELOG_RECORDS, CHANGELOG_BYTES)) == NULL) {
+        table_destroy(table);
+        cctrl_destroy(cctrl);
+        stats_destroy(stats);
+        wheel_destroy(wheel);
+        tracking_destroy(tracking);
+        watch_destroy(watch);
+        return NULL;
+    }
 
     return table;
 }
 
 int table_skel_destroy(struct table_t *table) {
     int result = 0;
+    // Parar a recolha das chaves expiradas
+    if (atomic_exchange(&expiry_running, 0))
+        pthread_join(expiry_thread, NULL);
+    // Parar a migracao das chaves
+    if (atomic_exchange(&migrate_running, 0))
+        pthread_join(migrate_thread, NULL);
     if (table == NULL)
         result = -1;
     if (table_destroy(table) != 0)
@@ -545,22 +2488,197 @@ int table_skel_destroy(struct table_t *table) {
         result = -1;
     if (stats_destroy(stats) != 0)
         result = -1;
+    if (wheel_destroy(wheel) != 0)
+        result = -1;
+    tracking_destroy(tracking);
+    watch_destroy(watch);
+    changelog_destroy(changelog);
     return result;
 }
 
-int invoke(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+int table_skel_track(int sockfd, MessageT *msg) {
     if (msg == NULL)
         return -1;
-    if (table == NULL || rptable == NULL)
-        return invoke_error(msg);
-        
+    struct tracking_client_t *client = NULL;
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_NONE && msg->track_id != 0)
+        client = tracking_subscribe(tracking, msg->track_id, sockfd);
+
+    // A resposta vai antes de qualquer invalidacao
+    MessageT resp;
+    message_t__init(&resp);
+    resp.opcode = client != NULL ? MESSAGE_T__OPCODE__OP_TRACK + 1 : MESSAGE_T__OPCODE__OP_ERROR;
+    resp.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    if (network_send(sockfd, &resp) == -1 && client != NULL) {
+        // O cliente e removido por tracking_serve() na primeira falha
+        pthread_mutex_lock(&tracking->lock);
+        client->closed = 1;
+        pthread_mutex_unlock(&tracking->lock);
+    }
+    if (client == NULL)
+        return -1;
+    return tracking_serve(tracking, client);
+}
+
+int table_skel_watch(int sockfd, MessageT *msg) {
+    if (msg == NULL)
+        return -1;
+    struct watch_subscriber_t *subscriber = NULL;
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_KEYS && msg->limit >= 0)
+        subscriber = watch_subscribe(watch, sockfd, msg->keys, msg->n_keys,
+                                     msg->prefixes, msg->n_prefixes, msg->limit);
+
+    // A resposta vai antes de qualquer evento
+    MessageT resp;
+    message_t__init(&resp);
+    resp.opcode = subscriber != NULL ? MESSAGE_T__OPCODE__OP_WATCH + 1 : MESSAGE_T__OPCODE__OP_ERROR;
+    resp.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    if (network_send(sockfd, &resp) == -1 && subscriber != NULL) {
+        // A subscricao e removida por watch_serve() na primeira falha
+        pthread_mutex_lock(&watch->lock);
+        subscriber->closed = 1;
+        pthread_mutex_unlock(&watch->lock);
+    }
+    if (subscriber == NULL)
+        return -1;
+    return watch_serve(watch, subscriber);
+}
+
+int table_skel_changes(int sockfd, MessageT *msg) {
+    if (msg == NULL)
+        return -1;
+    int valid = msg->c_type == MESSAGE_T__C_TYPE__CT_NONE;
+
+    // A resposta vai antes de qualquer escrita
+    MessageT resp;
+    message_t__init(&resp);
+    resp.opcode = valid ? MESSAGE_T__OPCODE__OP_CHANGES + 1 : MESSAGE_T__OPCODE__OP_ERROR;
+    resp.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    if (network_send(sockfd, &resp) == -1 || !valid)
+        return -1;
+    return changelog_serve(changelog, sockfd, msg->version);
+}
+
+/**
+ * Retorna o nivel de durabilidade de uma escrita pedida por um
+ * cliente, para as estatisticas, ou -1 se o pedido nao e uma
+ * escrita.
+*/
+int write_durability(MessageT *msg) {
+    switch (msg->opcode) {
+        case MESSAGE_T__OPCODE__OP_PUT:
+        case MESSAGE_T__OPCODE__OP_DEL:
+        case MESSAGE_T__OPCODE__OP_MPUT:
+        case MESSAGE_T__OPCODE__OP_MDEL:
+        case MESSAGE_T__OPCODE__OP_INCR:
+        case MESSAGE_T__OPCODE__OP_APPEND:
+        case MESSAGE_T__OPCODE__OP_CAS:
+        case MESSAGE_T__OPCODE__OP_CPUT:
+        case MESSAGE_T__OPCODE__OP_CDEL:
+        case MESSAGE_T__OPCODE__OP_BATCH:
+            if (msg->replicas == 0)
+                return STATS_DURABILITY_ALL;
+            return msg->replicas == 1 ? STATS_DURABILITY_HEAD : STATS_DURABILITY_SOME;
+
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Guarda em keys as chaves que o pedido pode escrever, se keys nao
+ * for NULL, para avisar os clientes que as tem em cache.
+ * \return
+ *      O numero de chaves, 0 se o pedido nao e uma escrita.
+*/
+int written_keys(MessageT *msg, char **keys) {
+    int n_keys = 0;
+    switch (msg->opcode) {
+        case MESSAGE_T__OPCODE__OP_PUT:
+        case MESSAGE_T__OPCODE__OP_APPEND:
+        case MESSAGE_T__OPCODE__OP_CAS:
+        case MESSAGE_T__OPCODE__OP_CPUT:
+            if (msg->entry != NULL && msg->entry->key != NULL) {
+                if (keys != NULL)
+                    keys[0] = msg->entry->key;
+                n_keys = 1;
+            }
+            break;
+
+        case MESSAGE_T__OPCODE__OP_DEL:
+        case MESSAGE_T__OPCODE__OP_INCR:
+        case MESSAGE_T__OPCODE__OP_CDEL:
+            if (msg->key != NULL) {
+                if (keys != NULL)
+                    keys[0] = msg->key;
+                n_keys = 1;
+            }
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MPUT:
+        case MESSAGE_T__OPCODE__OP_BATCH:
+        case MESSAGE_T__OPCODE__OP_MIGRATE:
+            for (int i = 0; i < (int) msg->n_entries; i++) {
+                if (msg->entries[i] == NULL || msg->entries[i]->key == NULL)
+                    continue;
+                if (keys != NULL)
+                    keys[n_keys] = msg->entries[i]->key;
+                n_keys++;
+            }
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MDEL:
+            for (int i = 0; i < (int) msg->n_keys; i++) {
+                if (msg->keys[i] == NULL)
+                    continue;
+                if (keys != NULL)
+                    keys[n_keys] = msg->keys[i];
+                n_keys++;
+            }
+            break;
+
+        default:
+            break;
+    }
+    return n_keys;
+}
+
+/**
+ * Coloca nas subscricoes o estado das chaves depois de um pedido as
+ * escrever: o novo valor e a versao, ou a remocao. A tabela e lida
+ * com o lock de leitura, para os eventos de uma chave ficarem pela
+ * ordem das escritas, podendo repetir o mesmo estado.
+*/
+void publish_written(struct table_t *table, char **keys, int n_keys) {
+    int wanted = 0;
+    for (int i = 0; i < n_keys && !wanted; i++)
+        wanted = watch_wanted(watch, keys[i]);
+    if (!wanted)
+        return;
+
+    // ============== SECCAO CRITICA ==============
+    read_begin(cctrl);
+    for (int i = 0; i < n_keys; i++) {
+        if (!watch_wanted(watch, keys[i]))
+            continue;
+        struct entry_t *entry = table_lookup(table, keys[i]);
+        watch_publish(watch, keys[i], entry != NULL ? entry->value : NULL,
+                      entry != NULL ? table_entry_version(entry) : 0);
+    }
+    read_end(cctrl);
+    // ============================================
+}
+
+/**
+ * Executa o pedido na tabela local.
+*/
+int invoke_op(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
     switch (msg->opcode) {
         case MESSAGE_T__OPCODE__OP_PUT:
             return invoke_put(msg, table, rptable);
             break;
         
         case MESSAGE_T__OPCODE__OP_GET:
-            return invoke_get(msg, table);
+            return invoke_get(msg, table, rptable);
             break;
         
         case MESSAGE_T__OPCODE__OP_DEL:
@@ -583,8 +2701,96 @@ int invoke(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
             return invoke_stats(msg, table);
             break;
 
+        case MESSAGE_T__OPCODE__OP_SCAN:
+            return invoke_scan(msg, table);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MGET:
+            return invoke_mget(msg, table);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MPUT:
+            return invoke_mput(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MDEL:
+            return invoke_mdel(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_INCR:
+            return invoke_incr(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_APPEND:
+            return invoke_append(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_CAS:
+            return invoke_cas(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_CPUT:
+            return invoke_cput(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_CDEL:
+            return invoke_cdel(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_BATCH:
+            return invoke_batch(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_MIGRATE:
+            return invoke_migrate(msg, table, rptable);
+            break;
+
+        case MESSAGE_T__OPCODE__OP_HEARTBEAT:
+            return invoke_heartbeat(msg, rptable);
+            break;
+
         default:
             invoke_error(msg);
             return 0;
     }
+}
+
+int invoke(MessageT *msg, struct table_t *table, s_rptable_t *rptable) {
+    if (msg == NULL)
+        return -1;
+    if (table == NULL || rptable == NULL)
+        return invoke_error(msg);
+
+    // As escritas propagadas por esta thread seguem a durabilidade
+    // pedida, os servidores seguintes recebem-nas sem esperar quando
+    // ja foram aplicadas por servidores suficientes
+    int level = write_durability(msg);
+    rptable_forward_durability(level == -1 ? 0 : msg->replicas);
+    partial_write = level != -1 && msg->replicas != 0;
+
+    long start_time = get_time();
+    int result;
+
+    // Numa instalacao particionada, a cabeca reencaminha as escritas
+    // das chaves que o anel passou a atribuir a outra cadeia
+    char *key = redirect_key(msg);
+    if (key != NULL && !msg->forwarded && rptable_is_head(rptable) == 1 &&
+        rptable_owns(rptable, key) == 0) {
+        result = invoke_redirect(msg, table, rptable, key);
+    } else {
+        // Depois de aplicada, a escrita e avisada aos clientes que
+        // tem as chaves em cache e as subscricoes, mesmo que tenha falhado
+        int n_written = written_keys(msg, NULL);
+        char *written[n_written + 1];
+        written_keys(msg, written);
+        result = invoke_op(msg, table, rptable);
+        if (n_written > 0) {
+            tracking_invalidate(tracking, written, n_written);
+            publish_written(table, written, n_written);
+        }
+    }
+
+    if (level != -1 && msg->opcode != MESSAGE_T__OPCODE__OP_ERROR)
+        stats_write_finish(stats, level, get_time() - start_time);
+    return result;
 }
\ No newline at end of file
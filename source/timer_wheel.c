@@ -0,0 +1,288 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "timer_wheel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define WHEEL_INDEX_INIT 64     /* tamanho inicial do indice */
+
+// =========================================================
+//                  Funcoes auxiliares
+// =========================================================
+
+/**
+ * Funcao de dispersao FNV-1a sobre a chave.
+*/
+static unsigned long wheel_hash(const char *key) {
+    unsigned long h = 2166136261UL;
+    while (*key != '\0') {
+        h ^= (unsigned char) *key++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+/**
+ * Insere o temporizador no inicio da lista head.
+*/
+static void timer_link(struct wheel_timer_t **head, struct wheel_timer_t *timer) {
+    timer->next = *head;
+    if (*head != NULL)
+        (*head)->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+/**
+ * Retira o temporizador da lista em que se encontra.
+*/
+static void timer_unlink(struct wheel_timer_t *timer) {
+    if (timer->pprev == NULL)
+        return;
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * Coloca o temporizador na ranhura correspondente a distancia
+ * entre o seu tick e o tick atual da roda.
+*/
+static void timer_place(timer_wheel_t *wheel, struct wheel_timer_t *timer) {
+    long delta = timer->tick - wheel->current;
+
+    // Ja venceu
+    if (delta <= 0) {
+        timer_link(&wheel->due, timer);
+        return;
+    }
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (delta < (1L << (WHEEL_BITS * (level + 1)))) {
+            int slot = (timer->tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+            timer_link(&wheel->slots[level][slot], timer);
+            return;
+        }
+    }
+
+    // Fora do alcance da roda: fica na ultima ranhura a ser
+    // processada do nivel superior e volta a ser colocada
+    int top = WHEEL_LEVELS - 1;
+    int slot = ((wheel->current >> (WHEEL_BITS * top)) - 1) & WHEEL_MASK;
+    timer_link(&wheel->slots[top][slot], timer);
+}
+
+/**
+ * Procura o temporizador da chave no indice.
+ * \return
+ *      Apontador para o apontador que referencia o temporizador
+ *      (ou que referenciaria, caso nao exista).
+*/
+static struct wheel_timer_t **index_find(timer_wheel_t *wheel, const char *key) {
+    struct wheel_timer_t **it = &wheel->index[wheel_hash(key) % wheel->index_size];
+    while (*it != NULL && strcmp((*it)->key, key) != 0)
+        it = &(*it)->hnext;
+    return it;
+}
+
+/**
+ * Duplica o numero de listas do indice.
+*/
+static int index_grow(timer_wheel_t *wheel) {
+    int new_size = wheel->index_size * 2;
+    struct wheel_timer_t **new_index = calloc(new_size, sizeof(struct wheel_timer_t *));
+    if (new_index == NULL)
+        return -1;
+
+    for (int i = 0; i < wheel->index_size; i++) {
+        struct wheel_timer_t *it = wheel->index[i];
+        while (it != NULL) {
+            struct wheel_timer_t *next = it->hnext;
+            unsigned long pos = wheel_hash(it->key) % new_size;
+            it->hnext = new_index[pos];
+            new_index[pos] = it;
+            it = next;
+        }
+    }
+
+    free(wheel->index);
+    wheel->index = new_index;
+    wheel->index_size = new_size;
+    return 0;
+}
+
+/**
+ * Retira o temporizador do indice e da roda e liberta-o.
+ * \param keep_key
+ *      Se diferente de 0, a chave nao e libertada.
+*/
+static void timer_remove(timer_wheel_t *wheel, struct wheel_timer_t **ref, int keep_key) {
+    struct wheel_timer_t *timer = *ref;
+    *ref = timer->hnext;
+    timer_unlink(timer);
+    if (!keep_key)
+        free(timer->key);
+    free(timer);
+    wheel->count--;
+}
+
+/**
+ * Volta a colocar os temporizadores de uma ranhura,
+ * que descem para os niveis inferiores.
+*/
+static void wheel_cascade(timer_wheel_t *wheel, int level, int slot) {
+    struct wheel_timer_t *list = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    while (list != NULL) {
+        struct wheel_timer_t *next = list->next;
+        list->next = NULL;
+        list->pprev = NULL;
+        timer_place(wheel, list);
+        list = next;
+    }
+}
+
+/**
+ * Avanca a roda um tick.
+*/
+static void wheel_tick(timer_wheel_t *wheel) {
+    wheel->current++;
+
+    // Nas fronteiras de cada nivel, descer os temporizadores
+    // da ranhura seguinte do nivel superior
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if ((wheel->current & ((1L << (WHEEL_BITS * level)) - 1)) != 0)
+            break;
+        wheel_cascade(wheel, level, (wheel->current >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    }
+
+    // Passar os temporizadores da ranhura atual para os vencidos
+    wheel_cascade(wheel, 0, wheel->current & WHEEL_MASK);
+}
+
+// =========================================================
+//                        Funcoes
+// =========================================================
+
+timer_wheel_t *wheel_init(long tick_ms, long now) {
+    if (tick_ms <= 0 || now < 0)
+        return NULL;
+
+    timer_wheel_t *wheel = calloc(1, sizeof(timer_wheel_t));
+    if (wheel == NULL)
+        return NULL;
+
+    wheel->index = calloc(WHEEL_INDEX_INIT, sizeof(struct wheel_timer_t *));
+    if (wheel->index == NULL) {
+        free(wheel);
+        return NULL;
+    }
+
+    wheel->index_size = WHEEL_INDEX_INIT;
+    wheel->tick_ms = tick_ms;
+    wheel->current = now / tick_ms;
+    return wheel;
+}
+
+int wheel_destroy(timer_wheel_t *wheel) {
+    if (wheel == NULL)
+        return -1;
+    for (int i = 0; i < wheel->index_size; i++) {
+        while (wheel->index[i] != NULL)
+            timer_remove(wheel, &wheel->index[i], 0);
+    }
+    free(wheel->index);
+    free(wheel);
+    return 0;
+}
+
+int wheel_set(timer_wheel_t *wheel, char *key, long expire_at) {
+    if (wheel == NULL || key == NULL || expire_at <= 0)
+        return -1;
+
+    struct wheel_timer_t **ref = index_find(wheel, key);
+    struct wheel_timer_t *timer = *ref;
+
+    if (timer == NULL) {
+        // Manter o fator de carga do indice abaixo de 1
+        if (wheel->count >= wheel->index_size) {
+            if (index_grow(wheel) == -1)
+                return -1;
+            ref = index_find(wheel, key);
+        }
+
+        if ((timer = calloc(1, sizeof(struct wheel_timer_t))) == NULL)
+            return -1;
+        if ((timer->key = strdup(key)) == NULL) {
+            free(timer);
+            return -1;
+        }
+        *ref = timer;
+        wheel->count++;
+    } else {
+        timer_unlink(timer);
+    }
+
+    // O tick seguinte ao instante de expiracao, para que uma chave
+    // nunca seja recolhida antes de expirar
+    timer->expire_at = expire_at;
+    timer->tick = expire_at / wheel->tick_ms + 1;
+    timer_place(wheel, timer);
+    return 0;
+}
+
+int wheel_cancel(timer_wheel_t *wheel, char *key) {
+    if (wheel == NULL || key == NULL)
+        return -1;
+    struct wheel_timer_t **ref = index_find(wheel, key);
+    if (*ref == NULL)
+        return 1;
+    timer_remove(wheel, ref, 0);
+    return 0;
+}
+
+long wheel_get(timer_wheel_t *wheel, char *key) {
+    if (wheel == NULL || key == NULL)
+        return -1;
+    struct wheel_timer_t *timer = *index_find(wheel, key);
+    return timer == NULL ? 0 : timer->expire_at;
+}
+
+char **wheel_advance(timer_wheel_t *wheel, long now, int max) {
+    if (wheel == NULL || max < 0)
+        return NULL;
+
+    long target = now / wheel->tick_ms;
+    while (wheel->current < target)
+        wheel_tick(wheel);
+
+    char **keys = malloc((max + 1) * sizeof(char *));
+    if (keys == NULL)
+        return NULL;
+
+    int n = 0;
+    while (n < max && wheel->due != NULL) {
+        char *key = wheel->due->key;
+        timer_remove(wheel, index_find(wheel, key), 1);
+        keys[n++] = key;
+    }
+    keys[n] = NULL;
+    return keys;
+}
+
+void wheel_free_keys(char **keys) {
+    if (keys == NULL)
+        return;
+    for (int i = 0; keys[i] != NULL; i++)
+        free(keys[i]);
+    free(keys);
+}
@@ -0,0 +1,354 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "tracking.h"
+#include "hash.h"
+#include "network_server.h"
+#include "sdmessage.pb-c.h"
+
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct tracking_t *tracking_create(long max_keys) {
+    if (max_keys <= 0)
+        return NULL;
+    struct tracking_t *tracking = malloc(sizeof(struct tracking_t));
+    if (tracking == NULL)
+        return NULL;
+    tracking->buckets = calloc(TRACKING_BUCKETS, sizeof(struct tracking_key_t *));
+    if (tracking->buckets == NULL) {
+        free(tracking);
+        return NULL;
+    }
+    pthread_mutex_init(&tracking->lock, NULL);
+    tracking->clients = NULL;
+    tracking->n_keys = 0;
+    tracking->max_keys = max_keys;
+    tracking->evict_bucket = 0;
+    return tracking;
+}
+
+static void key_destroy(struct tracking_key_t *node) {
+    free(node->key);
+    free(node->ids);
+    free(node);
+}
+
+static void queued_destroy(char **queued, int n_queued) {
+    for (int i = 0; i < n_queued; i++)
+        free(queued[i]);
+    free(queued);
+}
+
+static void client_destroy(struct tracking_client_t *client) {
+    queued_destroy(client->queued, client->n_queued);
+    pthread_cond_destroy(&client->changed);
+    free(client);
+}
+
+void tracking_destroy(struct tracking_t *tracking) {
+    if (tracking == NULL)
+        return;
+    pthread_mutex_lock(&tracking->lock);
+    for (int i = 0; i < TRACKING_BUCKETS; i++) {
+        struct tracking_key_t *node = tracking->buckets[i];
+        while (node != NULL) {
+            struct tracking_key_t *next = node->next;
+            key_destroy(node);
+            node = next;
+        }
+        tracking->buckets[i] = NULL;
+    }
+    tracking->n_keys = 0;
+    // As threads das ligacoes terminam no proximo acordar
+    for (struct tracking_client_t *client = tracking->clients; client != NULL; client = client->next) {
+        client->closed = 1;
+        pthread_cond_broadcast(&client->changed);
+    }
+    pthread_mutex_unlock(&tracking->lock);
+}
+
+static int key_bucket(const char *key) {
+    return hash_key(key) % TRACKING_BUCKETS;
+}
+
+/**
+ * Retira a chave do indice.
+ * \return
+ *      O no da chave ou NULL se nao era seguida.
+*/
+static struct tracking_key_t *key_unlink(struct tracking_t *tracking, const char *key) {
+    struct tracking_key_t **pnode = &tracking->buckets[key_bucket(key)];
+    while (*pnode != NULL) {
+        struct tracking_key_t *node = *pnode;
+        if (strcmp(node->key, key) == 0) {
+            *pnode = node->next;
+            tracking->n_keys--;
+            return node;
+        }
+        pnode = &node->next;
+    }
+    return NULL;
+}
+
+static int key_has_id(struct tracking_key_t *node, uint64_t id) {
+    for (int i = 0; i < node->n_ids; i++)
+        if (node->ids[i] == id)
+            return 1;
+    return 0;
+}
+
+/**
+ * Troca as chaves na fila do cliente pelo pedido para esquecer toda
+ * a cache. Chamada com o lock.
+*/
+static void client_overflow(struct tracking_client_t *client) {
+    queued_destroy(client->queued, client->n_queued);
+    client->queued = NULL;
+    client->n_queued = 0;
+    client->flush = 1;
+}
+
+/**
+ * Coloca na fila de cada cliente as chaves que seguia entre as dadas,
+ * para a thread da sua ligacao as enviar. Chamada com o lock.
+*/
+static void tracking_notify(struct tracking_t *tracking, struct tracking_key_t **nodes, int n_nodes) {
+    for (struct tracking_client_t *client = tracking->clients; client != NULL; client = client->next) {
+        int queued = 0;
+        for (int i = 0; i < n_nodes && !client->closed; i++) {
+            if (!key_has_id(nodes[i], client->id))
+                continue;
+            queued = 1;
+            // O pedido para esquecer tudo ja cobre a chave
+            if (client->flush)
+                break;
+            if (client->queued == NULL &&
+                (client->queued = malloc(TRACKING_QUEUE * sizeof(char *))) == NULL) {
+                client->flush = 1;
+                break;
+            }
+            char *key = client->n_queued < TRACKING_QUEUE ? strdup(nodes[i]->key) : NULL;
+            if (key == NULL) {
+                client_overflow(client);
+                break;
+            }
+            client->queued[client->n_queued++] = key;
+        }
+        if (queued)
+            pthread_cond_signal(&client->changed);
+    }
+}
+
+/**
+ * Invalida uma chave seguida para dar lugar a outra, percorrendo
+ * as listas do indice de forma rotativa. Chamada com o lock.
+*/
+static void tracking_evict(struct tracking_t *tracking) {
+    for (int i = 0; i < TRACKING_BUCKETS; i++) {
+        struct tracking_key_t *node = tracking->buckets[tracking->evict_bucket];
+        tracking->evict_bucket = (tracking->evict_bucket + 1) % TRACKING_BUCKETS;
+        if (node == NULL)
+            continue;
+        key_unlink(tracking, node->key);
+        tracking_notify(tracking, &node, 1);
+        key_destroy(node);
+        return;
+    }
+}
+
+struct tracking_client_t *tracking_subscribe(struct tracking_t *tracking, uint64_t id, int sockfd) {
+    if (tracking == NULL || id == 0)
+        return NULL;
+    struct tracking_client_t *client = calloc(1, sizeof(struct tracking_client_t));
+    if (client == NULL)
+        return NULL;
+    client->id = id;
+    client->sockfd = sockfd;
+    pthread_cond_init(&client->changed, NULL);
+
+    pthread_mutex_lock(&tracking->lock);
+    // A ligacao anterior do mesmo cliente e terminada pela sua thread
+    struct tracking_client_t **pclient = &tracking->clients;
+    while (*pclient != NULL) {
+        struct tracking_client_t *old = *pclient;
+        if (old->id == id) {
+            *pclient = old->next;
+            old->closed = 1;
+            pthread_cond_broadcast(&old->changed);
+            continue;
+        }
+        pclient = &old->next;
+    }
+    client->next = tracking->clients;
+    tracking->clients = client;
+    pthread_mutex_unlock(&tracking->lock);
+    return client;
+}
+
+/**
+ * Retira o cliente da lista. Chamada com o lock.
+*/
+static int client_unlink(struct tracking_t *tracking, struct tracking_client_t *client) {
+    struct tracking_client_t **pclient = &tracking->clients;
+    while (*pclient != NULL && *pclient != client)
+        pclient = &(*pclient)->next;
+    if (*pclient == NULL)
+        return -1;
+    *pclient = client->next;
+    return 0;
+}
+
+/**
+ * Envia as chaves num ou mais OP_INVALIDATE, limitando os bytes de
+ * cada um, ou um OP_INVALIDATE sem chaves se queued e NULL.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+static int tracking_send(int sockfd, char **queued, int n_queued) {
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_INVALIDATE;
+    if (queued == NULL) {
+        msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+        return network_send(sockfd, &msg);
+    }
+    msg.c_type = MESSAGE_T__C_TYPE__CT_KEYS;
+    int first = 0;
+    while (first < n_queued) {
+        int last = first;
+        size_t bytes = 0;
+        while (last < n_queued && (last == first || bytes + strlen(queued[last]) <= TRACKING_BATCH_BYTES))
+            bytes += strlen(queued[last++]);
+        msg.n_keys = last - first;
+        msg.keys = &queued[first];
+        if (network_send(sockfd, &msg) == -1)
+            return -1;
+        first = last;
+    }
+    return 0;
+}
+
+int tracking_serve(struct tracking_t *tracking, struct tracking_client_t *client) {
+    if (tracking == NULL || client == NULL)
+        return -1;
+    int failed = 0;
+    pthread_mutex_lock(&tracking->lock);
+    while (!failed && !client->closed) {
+        if (client->n_queued == 0 && !client->flush) {
+            // Sem avisos, verificar de vez em quando se o cliente saiu
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += TRACKING_IDLE_MS / 1000;
+            deadline.tv_nsec += (TRACKING_IDLE_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&client->changed, &tracking->lock, &deadline) == ETIMEDOUT &&
+                client->n_queued == 0 && !client->flush) {
+                pthread_mutex_unlock(&tracking->lock);
+                failed = network_peer_closed(client->sockfd);
+                pthread_mutex_lock(&tracking->lock);
+            }
+            continue;
+        }
+
+        // Enviar fora do lock, as escritas continuam a colocar chaves
+        char **queued = client->flush ? NULL : client->queued;
+        int n_queued = client->n_queued;
+        if (!client->flush)
+            client->queued = NULL;
+        client->n_queued = 0;
+        client->flush = 0;
+        pthread_mutex_unlock(&tracking->lock);
+
+        failed = tracking_send(client->sockfd, queued, n_queued) == -1;
+        queued_destroy(queued, n_queued);
+
+        pthread_mutex_lock(&tracking->lock);
+    }
+    int result = client_unlink(tracking, client);
+    pthread_mutex_unlock(&tracking->lock);
+    client_destroy(client);
+    return result;
+}
+
+int tracking_track(struct tracking_t *tracking, const char *key, uint64_t id) {
+    if (tracking == NULL || key == NULL || id == 0)
+        return -1;
+    pthread_mutex_lock(&tracking->lock);
+    struct tracking_client_t *client = tracking->clients;
+    while (client != NULL && client->id != id)
+        client = client->next;
+    if (client == NULL || client->closed)
+        goto err;
+
+    int bucket = key_bucket(key);
+    struct tracking_key_t *node = tracking->buckets[bucket];
+    while (node != NULL && strcmp(node->key, key) != 0)
+        node = node->next;
+
+    if (node == NULL) {
+        if (tracking->n_keys >= tracking->max_keys)
+            tracking_evict(tracking);
+        if ((node = calloc(1, sizeof(struct tracking_key_t))) == NULL)
+            goto err;
+        if ((node->key = strdup(key)) == NULL) {
+            free(node);
+            goto err;
+        }
+        node->next = tracking->buckets[bucket];
+        tracking->buckets[bucket] = node;
+        tracking->n_keys++;
+    }
+
+    if (!key_has_id(node, id)) {
+        if (node->n_ids == node->capacity) {
+            int capacity = node->capacity == 0 ? 2 : node->capacity * 2;
+            uint64_t *ids = realloc(node->ids, capacity * sizeof(uint64_t));
+            if (ids == NULL)
+                goto err;
+            node->ids = ids;
+            node->capacity = capacity;
+        }
+        node->ids[node->n_ids++] = id;
+    }
+    pthread_mutex_unlock(&tracking->lock);
+    return 0;
+
+err:
+    pthread_mutex_unlock(&tracking->lock);
+    return -1;
+}
+
+int tracking_invalidate(struct tracking_t *tracking, char **keys, int n_keys) {
+    if (tracking == NULL || keys == NULL || n_keys <= 0)
+        return -1;
+    pthread_mutex_lock(&tracking->lock);
+    if (tracking->n_keys == 0) {
+        pthread_mutex_unlock(&tracking->lock);
+        return 0;
+    }
+
+    struct tracking_key_t *nodes[n_keys];
+    int n_nodes = 0;
+    for (int i = 0; i < n_keys; i++) {
+        struct tracking_key_t *node = keys[i] == NULL ? NULL : key_unlink(tracking, keys[i]);
+        if (node != NULL)
+            nodes[n_nodes++] = node;
+    }
+    if (n_nodes > 0)
+        tracking_notify(tracking, nodes, n_nodes);
+    for (int i = 0; i < n_nodes; i++)
+        key_destroy(nodes[i]);
+    pthread_mutex_unlock(&tracking->lock);
+    return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * SD-07
+ *
+ * Xiting Wang
+ * Goncalo Pinto
+ * Guilherme Wind
+*/
+
+#include "watch.h"
+#include "data.h"
+#include "network_server.h"
+#include "sdmessage.pb-c.h"
+
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct watch_t *watch_create() {
+    struct watch_t *watch = malloc(sizeof(struct watch_t));
+    if (watch == NULL)
+        return NULL;
+    pthread_mutex_init(&watch->lock, NULL);
+    watch->subscribers = NULL;
+    watch->n_subscribers = 0;
+    return watch;
+}
+
+static void event_destroy(struct watch_event_t *event) {
+    free(event->key);
+    if (event->value != NULL)
+        data_destroy(event->value);
+    free(event);
+}
+
+static void events_destroy(struct watch_event_t *event) {
+    while (event != NULL) {
+        struct watch_event_t *next = event->next;
+        event_destroy(event);
+        event = next;
+    }
+}
+
+static void strings_destroy(char **strings) {
+    for (int i = 0; strings != NULL && strings[i] != NULL; i++)
+        free(strings[i]);
+    free(strings);
+}
+
+/**
+ * Copia n strings para um array terminado por NULL.
+ * \return
+ *      O array ou NULL em caso de erro.
+*/
+static char **strings_dup(char **strings, int n) {
+    char **copy = calloc(n + 1, sizeof(char *));
+    for (int i = 0; copy != NULL && i < n; i++) {
+        if ((copy[i] = strdup(strings[i])) == NULL) {
+            strings_destroy(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static void subscriber_destroy(struct watch_subscriber_t *subscriber) {
+    events_destroy(subscriber->head);
+    strings_destroy(subscriber->keys);
+    strings_destroy(subscriber->prefixes);
+    pthread_cond_destroy(&subscriber->changed);
+    free(subscriber);
+}
+
+void watch_destroy(struct watch_t *watch) {
+    if (watch == NULL)
+        return;
+    // As threads das ligacoes terminam no proximo acordar
+    pthread_mutex_lock(&watch->lock);
+    for (struct watch_subscriber_t *s = watch->subscribers; s != NULL; s = s->next) {
+        s->closed = 1;
+        pthread_cond_broadcast(&s->changed);
+    }
+    pthread_mutex_unlock(&watch->lock);
+}
+
+struct watch_subscriber_t *watch_subscribe(struct watch_t *watch, int sockfd,
+                                           char **keys, int n_keys,
+                                           char **prefixes, int n_prefixes, int capacity) {
+    if (watch == NULL || n_keys < 0 || n_prefixes < 0 || n_keys + n_prefixes == 0 ||
+        capacity < 0 || capacity > WATCH_MAX_QUEUE)
+        return NULL;
+    struct watch_subscriber_t *subscriber = calloc(1, sizeof(struct watch_subscriber_t));
+    if (subscriber == NULL)
+        return NULL;
+    subscriber->keys = strings_dup(keys, n_keys);
+    subscriber->prefixes = strings_dup(prefixes, n_prefixes);
+    if (subscriber->keys == NULL || subscriber->prefixes == NULL) {
+        strings_destroy(subscriber->keys);
+        strings_destroy(subscriber->prefixes);
+        free(subscriber);
+        return NULL;
+    }
+    subscriber->sockfd = sockfd;
+    subscriber->capacity = capacity == 0 ? WATCH_QUEUE : capacity;
+    pthread_cond_init(&subscriber->changed, NULL);
+
+    pthread_mutex_lock(&watch->lock);
+    subscriber->next = watch->subscribers;
+    watch->subscribers = subscriber;
+    watch->n_subscribers++;
+    pthread_mutex_unlock(&watch->lock);
+    return subscriber;
+}
+
+/**
+ * Retira a subscricao da lista. Chamada com o lock.
+*/
+static int watch_unlink(struct watch_t *watch, struct watch_subscriber_t *subscriber) {
+    struct watch_subscriber_t **psubscriber = &watch->subscribers;
+    while (*psubscriber != NULL && *psubscriber != subscriber)
+        psubscriber = &(*psubscriber)->next;
+    if (*psubscriber == NULL)
+        return -1;
+    *psubscriber = subscriber->next;
+    watch->n_subscribers--;
+    return 0;
+}
+
+/**
+ * Envia um evento pela ligacao.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+static int watch_send_event(int sockfd, struct watch_event_t *event) {
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_EVENT;
+    msg.version = event->version;
+    EntryT entry;
+    if (event->value != NULL) {
+        entry_t__init(&entry);
+        entry.key = event->key;
+        entry.value.len = event->value->datasize;
+        entry.value.data = event->value->data;
+        entry.version = event->version;
+        msg.c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+        msg.entry = &entry;
+    } else {
+        msg.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+        msg.key = event->key;
+    }
+    return network_send(sockfd, &msg);
+}
+
+/**
+ * Avisa o cliente de que perdeu eventos.
+ * \return
+ *      0 (OK) ou -1 se a ligacao falhou.
+*/
+static int watch_send_dropped(int sockfd, long dropped) {
+    MessageT msg;
+    message_t__init(&msg);
+    msg.opcode = MESSAGE_T__OPCODE__OP_EVENT;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+    msg.result = dropped > INT_MAX ? INT_MAX : dropped;
+    return network_send(sockfd, &msg);
+}
+
+int watch_serve(struct watch_t *watch, struct watch_subscriber_t *subscriber) {
+    if (watch == NULL || subscriber == NULL)
+        return -1;
+    int failed = 0;
+    pthread_mutex_lock(&watch->lock);
+    while (!failed && !subscriber->closed) {
+        if (subscriber->head == NULL && subscriber->dropped == 0) {
+            // Sem eventos, verificar de vez em quando se o cliente saiu
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += WATCH_IDLE_MS / 1000;
+            deadline.tv_nsec += (WATCH_IDLE_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&subscriber->changed, &watch->lock, &deadline) == ETIMEDOUT &&
+                subscriber->head == NULL && subscriber->dropped == 0) {
+                pthread_mutex_unlock(&watch->lock);
+                failed = network_peer_closed(subscriber->sockfd);
+                pthread_mutex_lock(&watch->lock);
+            }
+            continue;
+        }
+
+        // Enviar fora do lock, as escritas continuam a colocar eventos
+        struct watch_event_t *events = subscriber->head;
+        long dropped = subscriber->dropped;
+        subscriber->head = subscriber->tail = NULL;
+        subscriber->n_events = 0;
+        subscriber->dropped = 0;
+        pthread_mutex_unlock(&watch->lock);
+
+        for (struct watch_event_t *event = events; event != NULL && !failed; event = event->next)
+            failed = watch_send_event(subscriber->sockfd, event) == -1;
+        // Os eventos perdidos sao posteriores aos que estavam na fila
+        if (!failed && dropped > 0)
+            failed = watch_send_dropped(subscriber->sockfd, dropped) == -1;
+        events_destroy(events);
+
+        pthread_mutex_lock(&watch->lock);
+    }
+    int result = watch_unlink(watch, subscriber);
+    pthread_mutex_unlock(&watch->lock);
+    subscriber_destroy(subscriber);
+    return result;
+}
+
+/**
+ * Verifica se a subscricao segue a chave.
+*/
+static int subscriber_wants(struct watch_subscriber_t *subscriber, const char *key) {
+    for (int i = 0; subscriber->keys[i] != NULL; i++)
+        if (strcmp(subscriber->keys[i], key) == 0)
+            return 1;
+    for (int i = 0; subscriber->prefixes[i] != NULL; i++)
+        if (strncmp(subscriber->prefixes[i], key, strlen(subscriber->prefixes[i])) == 0)
+            return 1;
+    return 0;
+}
+
+int watch_wanted(struct watch_t *watch, const char *key) {
+    if (watch == NULL || key == NULL || watch->n_subscribers == 0)
+        return 0;
+    int wanted = 0;
+    pthread_mutex_lock(&watch->lock);
+    for (struct watch_subscriber_t *s = watch->subscribers; s != NULL && !wanted; s = s->next)
+        wanted = subscriber_wants(s, key);
+    pthread_mutex_unlock(&watch->lock);
+    return wanted;
+}
+
+int watch_publish(struct watch_t *watch, const char *key, struct data_t *value, uint64_t version) {
+    if (watch == NULL || key == NULL)
+        return -1;
+    int result = 0;
+    pthread_mutex_lock(&watch->lock);
+    for (struct watch_subscriber_t *s = watch->subscribers; s != NULL; s = s->next) {
+        if (s->closed || !subscriber_wants(s, key))
+            continue;
+        // Fila cheia, o cliente e avisado de quantos perdeu
+        if (s->n_events >= s->capacity) {
+            s->dropped++;
+            pthread_cond_signal(&s->changed);
+            continue;
+        }
+        struct watch_event_t *event = calloc(1, sizeof(struct watch_event_t));
+        if (event == NULL || (event->key = strdup(key)) == NULL ||
+            (value != NULL && (event->value = data_dup(value)) == NULL)) {
+            if (event != NULL)
+                event_destroy(event);
+            s->dropped++;
+            result = -1;
+        } else {
+            event->version = version;
+            if (s->tail == NULL)
+                s->head = event;
+            else
+                s->tail->next = event;
+            s->tail = event;
+            s->n_events++;
+        }
+        pthread_cond_signal(&s->changed);
+    }
+    pthread_mutex_unlock(&watch->lock);
+    return result;
+}
@@ -139,6 +139,64 @@ int data_exists(zhandle_t *handler, char* rootpath, char* data) {
     return 0;
 }
 
+char* get_child_path(char* path, char* child) {
+    if (path == NULL || child == NULL)
+        return NULL;
+    char* fullpath = malloc(strlen(path) + strlen(child) + 2);
+    if (fullpath == NULL)
+        return NULL;
+    strcpy(fullpath, path);
+
+    // Verificar se tem / no fim do diretorio
+    if (fullpath[strlen(path) - 1] != '/')
+        strcat(fullpath, "/");
+    strcat(fullpath, child);
+    return fullpath;
+}
+
+static int name_compare(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+char** get_children(zhandle_t* handler, char* path, watcher_fn watcher) {
+    if (handler == NULL || path == NULL)
+        return NULL;
+
+    zoo_string node_list;
+    int res = watcher == NULL ? zoo_get_children(handler, path, 0, &node_list) :
+                                zoo_wget_children(handler, path, watcher, NULL, &node_list);
+    // Se o no nao existe nao tem filhos
+    if (res == ZNONODE)
+        return calloc(1, sizeof(char*));
+    if (res != ZOK)
+        return NULL;
+
+    char** children = calloc(node_list.count + 1, sizeof(char*));
+    if (children == NULL) {
+        deallocate_String_vector(&node_list);
+        return NULL;
+    }
+    for (int i = 0; i < node_list.count; i++) {
+        if ((children[i] = strdup(node_list.data[i])) == NULL) {
+            free_children(children);
+            deallocate_String_vector(&node_list);
+            return NULL;
+        }
+    }
+    qsort(children, node_list.count, sizeof(char*), name_compare);
+
+    deallocate_String_vector(&node_list);
+    return children;
+}
+
+void free_children(char** children) {
+    if (children == NULL)
+        return;
+    for (int i = 0; children[i] != NULL; i++)
+        free(children[i]);
+    free(children);
+}
+
 int set_server_prefix(char* nameprefix) {
     if (server_name_prefix != NULL)
         free(server_name_prefix);
@@ -184,10 +242,29 @@ int create_root(zhandle_t *handler, char *path) {
     return 0;
 }
 
+int create_ephemeral(zhandle_t *handler, char *path) {
+    if (handler == NULL || path == NULL)
+        return -1;
+    int res = zoo_create(handler, path, NULL, -1, 
+                &ZOO_OPEN_ACL_UNSAFE, ZOO_EPHEMERAL, NULL, 0);
+    if (res == ZNODEEXISTS)
+        return 1;
+    return res == ZOK ? 0 : -1;
+}
+
+int delete_node(zhandle_t *handler, char *path) {
+    if (handler == NULL || path == NULL)
+        return -1;
+    int res = zoo_delete(handler, path, -1);
+    if (res == ZNONODE)
+        return 1;
+    return res == ZOK ? 0 : -1;
+}
+
 /**
  * <a>https://man7.org/linux/man-pages/man3/getifaddrs.3.html</a>
 */
-char* register_server(zhandle_t* handler, char* path, int socket) {
+char* register_server(zhandle_t* handler, char* path, int socket, const char *unix_path) {
     if (handler == NULL || path == NULL || socket < 0)
         return NULL;
     
@@ -226,11 +303,15 @@ char* register_server(zhandle_t* handler, char* path, int socket) {
     strcpy(ipaddr, ip);
     free(ip);
 
-    // Concatenar o ip e porto
-    char sock[32];
+    // Concatenar o ip e porto, e o socket local se existir
+    char sock[strlen(ipaddr) + strlen(port_str) + (unix_path != NULL ? strlen(unix_path) : 0) + 3];
     strcpy(sock, ipaddr);
     strcat(sock, ":");
     strcat(sock, port_str);
+    if (unix_path != NULL) {
+        strcat(sock, ";");
+        strcat(sock, unix_path);
+    }
 
     int socket_len = strlen(sock) + 1;
 
@@ -592,3 +673,29 @@ char* get_tail_server(zhandle_t* handler, char* path, watcher_fn watcher) {
 // static void (search_node)(zhandle_t* handler, char* path, watcher_fn watcher) {
 
 // }
+
+char** get_servers(zhandle_t* handler, char* path, watcher_fn watcher) {
+    // Os nomes sequenciais ficam ordenados da cabeca para a cauda
+    char** names = get_children(handler, path, watcher);
+    if (names == NULL)
+        return NULL;
+
+    for (int i = 0; names[i] != NULL; i++) {
+        char* node = get_child_path(path, names[i]);
+        char* zdata_buf = malloc(ZDATALEN * sizeof(char));
+        int zdata_len = ZDATALEN * sizeof(char) - 1;
+        if (node == NULL || zdata_buf == NULL ||
+            ZOK != zoo_get(handler, node, 0, zdata_buf, &zdata_len, NULL)) {
+            free(node);
+            free(zdata_buf);
+            free_children(names);
+            return NULL;
+        }
+        zdata_buf[zdata_len < 0 ? 0 : zdata_len] = '\0';
+        free(node);
+        // O socket substitui o nome do no
+        free(names[i]);
+        names[i] = zdata_buf;
+    }
+    return names;
+}